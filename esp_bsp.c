@@ -413,6 +413,9 @@ static void bsp_touch_interrupt_cb(esp_lcd_touch_handle_t tp)
     if (xHigherPriorityTaskWoken) {
         portYIELD_FROM_ISR();
     }
+
+    /* Wake the touch sampling task (lv_port.c) - it performs the I2C read */
+    lvgl_port_touch_wake_isr();
 }
 
 static void bsp_touch_process_points_cb(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength, uint8_t *point_num, uint8_t max_point_num)
@@ -516,6 +519,7 @@ static lv_indev_t *bsp_display_indev_init(const bsp_display_cfg_t *config, lv_di
         .disp = disp,
         .handle = tp,
         .touch_wait_cb = bsp_touch_sync_cb,
+        .int_driven = (EXAMPLE_PIN_NUM_QSPI_TOUCH_INT > 0),
     };
 
     return lvgl_port_add_touch(&touch_cfg);
@@ -527,9 +531,16 @@ lv_disp_t *bsp_display_start_with_config(const bsp_display_cfg_t *cfg)
 
     BSP_ERROR_CHECK_RETURN_NULL(bsp_display_brightness_init());
 
-    BSP_NULL_CHECK(disp = bsp_display_lcd_init(cfg), NULL);
+    /* In LVGL task mode the task is already running: register drivers under the lock */
+    lvgl_port_lock(0);
+    disp = bsp_display_lcd_init(cfg);
+    if (disp) {
+        disp_indev = bsp_display_indev_init(cfg, disp);
+    }
+    lvgl_port_unlock();
 
-    BSP_NULL_CHECK(disp_indev = bsp_display_indev_init(cfg, disp), NULL);
+    BSP_NULL_CHECK(disp, NULL);
+    BSP_NULL_CHECK(disp_indev, NULL);
 
     return disp;
 }
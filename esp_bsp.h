@@ -49,7 +49,7 @@ extern SemaphoreHandle_t i2c_mutex;
 #define EXAMPLE_PIN_NUM_QSPI_TOUCH_SCL  (GPIO_NUM_8)
 #define EXAMPLE_PIN_NUM_QSPI_TOUCH_SDA  (GPIO_NUM_4)
 #define EXAMPLE_PIN_NUM_QSPI_TOUCH_RST  (-1)
-#define EXAMPLE_PIN_NUM_QSPI_TOUCH_INT  (-1)
+#define EXAMPLE_PIN_NUM_QSPI_TOUCH_INT  (GPIO_NUM_3)    // TOUCH_PIN_NUM_INT: wakes the touch task, no polling while idle
 
 #ifdef __cplusplus
 extern "C" {
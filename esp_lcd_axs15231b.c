@@ -420,6 +420,7 @@ esp_err_t esp_lcd_touch_new_i2c_axs15231b(const esp_lcd_panel_io_handle_t io, co
     if (axs15231b->config.int_gpio_num != GPIO_NUM_NC) {
         const gpio_config_t int_gpio_config = {
             .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,   /* Active low, idles high */
             .intr_type = GPIO_INTR_NEGEDGE,
             .pin_bit_mask = BIT64(axs15231b->config.int_gpio_num)
         };
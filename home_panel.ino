@@ -19,11 +19,24 @@
 
 // Module includes
 #include "src/net/net_module.h"
+#include "src/net/net_metrics.h"
+#include "src/net/wifi_fast.h"
 #include "src/image/image_fetcher.h"
 #include "src/screen/screen_power.h"
 #include "src/time/time_service.h"
 #include "src/temperature/temperature_service.h"
 #include "src/light/light_service.h"
+#include "src/light/light_grid.h"
+#include "src/power/power_service.h"
+#include "src/power/cost_service.h"
+#include "src/power/power_alert.h"
+#include "src/storage/sample_log.h"
+#include "src/storage/settings_store.h"
+#include "src/snapshot/status_snapshot.h"
+#include "src/registry/entity_registry.h"
+#include "src/perf/perf_monitor.h"
+#include "src/perf/latency_probe.h"
+#include "src/ui/ui_dispatch.h"
 
 // Secrets (credentials)
 #include "secrets_private.h"
@@ -38,24 +51,34 @@
 #define SCREEN_WIDTH  480
 #define SCREEN_HEIGHT 320
 
-// MQTT Topics
+// MQTT Topics (weather and light are registered by their services)
 #define TOPIC_IMAGE "esp32image"
 #define TOPIC_POWER "ha/hilo_meter_power"
 #define TOPIC_ENERGY "hilo_energie"
-#define TOPIC_WEATHER "weather"
-#define TOPIC_LIGHT "m18toggle"
+
+// Largest accepted payload per topic (larger messages are dropped by the router)
+constexpr size_t MAX_PAYLOAD_POWER = 32;
+constexpr size_t MAX_PAYLOAD_ENERGY = 32;
+constexpr size_t MAX_PAYLOAD_IMAGE = 64;
+
+// Network metrics summary over MQTT ("homepanel/<client id>/metrics"); 0 disables
+constexpr uint32_t METRICS_PUBLISH_INTERVAL_MS = 60000;
 
 // ============================================================================
 // Global Objects
 // ============================================================================
 
-// Network clients
+// Network clients - one set per MQTT server so both can be connected in parallel
 WiFiClient wifiClient;
-WiFiClientSecure secureClient;
+TlsSessionClient secureClient;
 PubSubClient mqttClient;
+WiFiClient wifiClient2;
+TlsSessionClient secureClient2;
+PubSubClient mqttClient2;
 
 // Dynamic MQTT client ID (generated from chip ID)
 char mqttClientId[16];
+char metricsTopic[40];
 
 // Web server for OTA updates
 WebServer server(80);
@@ -63,24 +86,47 @@ WebServer server(80);
 // Timing
 unsigned long lastWiFiCheck = 0;
 constexpr unsigned long WIFI_CHECK_INTERVAL = 10000;  // 10 seconds
+constexpr unsigned long WIFI_RECOVERY_CHECK_INTERVAL = 250;  // While recovering: notice the IP promptly
 unsigned long lastStatusUpdate = 0;
 constexpr unsigned long STATUS_UPDATE_INTERVAL = 2000;  // 2 seconds
 unsigned long lastHeapLog = 0;
 constexpr unsigned long HEAP_LOG_INTERVAL = 300000;  // 5 minutes
 
-// MQTT power stale data detection
-unsigned long lastPowerReceived = 0;
-bool powerStale = false;
-constexpr unsigned long MQTT_STALE_TIMEOUT_MS = 300000;  // 5 minutes
+// Energy meter readings kept in the sample log
+unsigned long lastEnergyLogged = 0;
+bool energyLogged = false;
+constexpr unsigned long ENERGY_LOG_INTERVAL_MS = 60000;  // 1 minute
 
 // WiFi recovery state machine
-enum WifiState { WIFI_STATE_CONNECTED, WIFI_STATE_RECOVERING, WIFI_STATE_FAILED };
+// RECOVERING: reconnect every 5 s for a minute; OFFLINE: UI stays up with stale
+// values while the network stack is reset and retried with exponential backoff
+enum WifiState { WIFI_STATE_CONNECTED, WIFI_STATE_RECOVERING, WIFI_STATE_OFFLINE };
 WifiState wifiState = WIFI_STATE_CONNECTED;
 unsigned long wifiDisconnectTime = 0;
 constexpr unsigned long WIFI_RECOVERY_TIMEOUT_MS = 60000;   // 1 minute recovery window
 constexpr unsigned long WIFI_RECONNECT_ATTEMPT_MS = 5000;   // 5 seconds between attempts
 unsigned long lastWifiReconnectAttempt = 0;
 
+// Offline mode (replaces the restart after the recovery window)
+constexpr unsigned long WIFI_OFFLINE_BACKOFF_MIN_MS = 10000;
+constexpr unsigned long WIFI_OFFLINE_BACKOFF_MAX_MS = 300000;  // 5 minutes
+constexpr uint32_t WIFI_OFFLINE_RESET_EVERY = 4;               // Stack reset every N attempts
+unsigned long offlineBackoffMs = WIFI_OFFLINE_BACKOFF_MIN_MS;
+uint32_t offlineAttempts = 0;
+
+// Stale marking and time back to fully live (reconnected and first MQTT data)
+constexpr uint32_t COLOR_VALUE_LIVE = 0xE9B804;    // Power/energy label color (SquareLine)
+constexpr uint32_t COLOR_VALUE_STALE = 0x808080;
+constexpr const char* SETTING_REBOOTS_AVOIDED = "reboots_avoid";
+bool valuesStale = false;
+bool awaitingLive = false;
+uint32_t liveDeliveredMark = 0;    // Topic router delivered count when WiFi came back
+uint32_t offlineEntries = 0;       // Since boot
+uint32_t rebootsAvoided = 0;       // Persisted in NVS, survives real reboots
+uint32_t liveRecoveries = 0;
+unsigned long lastBackToLiveMs = 0;
+uint64_t backToLiveMsTotal = 0;
+
 // ============================================================================
 // Forward Declarations
 // ============================================================================
@@ -89,8 +135,14 @@ void configModeCallback(WiFiManager *myWiFiManager);
 void restartESP();
 void initWiFiManager();
 void checkWiFi();
+void enterOfflineMode();
+void resetNetworkStack();
+void setValuesStale(bool stale);
+void checkBackToLive();
 void initMQTT();
-void mqttCallback(char* topic, byte* payload, unsigned int length);
+void onPowerMessage(const char* topic, PayloadView payload);
+void onEnergyMessage(const char* topic, PayloadView payload);
+void onImageMessage(const char* topic, PayloadView payload);
 void updateConnectionStatus();
 void logHeapStatus();
 void showConnectScreen(const char* message);
@@ -107,15 +159,19 @@ bool isWifiAvailable();
 
 // Show connect screen with status message
 void showConnectScreen(const char* message) {
+    lvgl_port_lock(0);
     lv_label_set_text(ui_labelConnectStatus, message);
     lv_scr_load(ui_ScreenConnect);
-    lv_timer_handler();  // Force render before blocking WiFi operations
+    lv_refr_now(NULL);  // Force render before blocking WiFi operations
+    lvgl_port_unlock();
 }
 
 // Show main screen after successful connection
 void showMainScreen() {
     Serial.println("Switching to main screen...");
+    lvgl_port_lock(0);
     lv_scr_load(ui_Screen1);
+    lvgl_port_unlock();
     Serial.println("Main screen active");
 }
 
@@ -128,10 +184,12 @@ void onOTAStart() {
 
     // Switch to OTA screen
     if (ui_ScreenOTA) {
+        lvgl_port_lock(0);
         lv_label_set_text(ui_labelOTAStatus, "Updating firmware...");
         lv_label_set_text(ui_labelOTAProgress, "0%");
         lv_scr_load(ui_ScreenOTA);
         lv_refr_now(NULL);  // Force immediate refresh
+        lvgl_port_unlock();
         Serial.println("OTA screen loaded");
     } else {
         Serial.println("ERROR: ui_ScreenOTA is NULL!");
@@ -151,14 +209,19 @@ void onOTAProgress(size_t current, size_t final) {
         Serial.printf("OTA: %u KB\n", kb);
         char buf[16];
         snprintf(buf, sizeof(buf), "%u KB", kb);
+        lvgl_port_lock(0);
         lv_label_set_text(ui_labelOTAProgress, buf);
         lv_refr_now(NULL);  // Force immediate refresh
+        lvgl_port_unlock();
     }
 }
 
 void onOTAEnd(bool success) {
+    lvgl_port_lock(0);
     if (success) {
         Serial.println("OTA update finished successfully");
+        sampleLogFlush();  // ElegantOTA restarts next: keep the buffered samples
+        settingsFlush();   // (also run by esp_restart(), done here while the UI still shows progress)
         lv_label_set_text(ui_labelOTAStatus, "Update complete!");
         lv_label_set_text(ui_labelOTAProgress, "Restarting...");
     } else {
@@ -167,6 +230,7 @@ void onOTAEnd(bool success) {
         lv_label_set_text(ui_labelOTAProgress, "");
     }
     lv_refr_now(NULL);  // Force immediate refresh
+    lvgl_port_unlock();
 }
 
 // Initialize OTA web server
@@ -178,6 +242,18 @@ void initOTA() {
         server.send(200, "text/plain", "Home Panel module - OTA available at /update");
     });
 
+    // LVGL performance statistics (JSON)
+    perf_monitor_register_http(server);
+
+    // Touch-to-photon latency percentiles and synthetic tap source (JSON)
+    latency_probe_register_http(server);
+
+    // Network health counters and histograms (Prometheus text)
+    netMetricsRegisterHttp(server);
+
+    // WiFi connect timings and simulated AP outages (JSON)
+    wifiFastRegisterHttp(server);
+
     // Initialize ElegantOTA with authentication
     ElegantOTA.begin(&server, OTA_USERNAME, OTA_PASSWORD);
     ElegantOTA.onStart(onOTAStart);
@@ -205,14 +281,26 @@ void configModeCallback(WiFiManager *myWiFiManager) {
     bsp_display_brightness_set(25);  // Dim for portal mode
 }
 
-// Restart ESP after WiFi recovery timeout
+// Restart ESP when WiFi setup fails at boot (portal timeout)
+// Later outages go to offline mode instead (see checkWiFi)
 void restartESP() {
-    Serial.println("WiFi recovery failed, restarting now...");
+    Serial.println("WiFi setup failed, restarting now...");
     ESP.restart();
 }
 
 // Initialize WiFi using WiFiManager (captive portal for configuration)
 void initWiFiManager() {
+    // Cached BSSID/channel (and lease or static IP) first: no scan, often no DHCP
+    wifiFastInit();
+    if (wifiFastConnect()) {
+        Serial.println("Connected to WiFi (fast path)");
+        Serial.printf("SSID: %s\n", WiFi.SSID().c_str());
+        Serial.printf("IP: %s\n", WiFi.localIP().toString().c_str());
+        showMainScreen();
+        updateConnectionStatus();
+        return;
+    }
+
     Serial.println("Initializing WiFiManager...");
 
     WiFiManager wm;
@@ -252,7 +340,56 @@ bool isWifiAvailable() {
     return wifiState == WIFI_STATE_CONNECTED && WiFi.status() == WL_CONNECTED;
 }
 
-// Check WiFi connection with recovery window before restarting
+// Gray out the last known values while offline; restored once data flows again
+void setValuesStale(bool stale) {
+    if (stale == valuesStale) return;
+    valuesStale = stale;
+    lv_color_t color = lv_color_hex(stale ? COLOR_VALUE_STALE : COLOR_VALUE_LIVE);
+    ui_dispatch_text_color(ui_labelPowerValue, color);
+    ui_dispatch_text_color(ui_labelEnergyValue, color);
+    temperature_service_setStale(stale);
+}
+
+// Restart the WiFi driver only (display, UI and services keep running)
+void resetNetworkStack() {
+    Serial.println("WiFi: Resetting network stack");
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    WiFi.mode(WIFI_STA);
+}
+
+// Recovery window expired: stay up, keep the last values (marked stale) and retry with backoff
+void enterOfflineMode() {
+    wifiState = WIFI_STATE_OFFLINE;
+    offlineEntries++;
+    offlineAttempts = 0;
+    offlineBackoffMs = WIFI_OFFLINE_BACKOFF_MIN_MS;
+    lastWifiReconnectAttempt = millis();
+    setValuesStale(true);
+
+    // Each entry is a restart the previous recovery logic would have done
+    rebootsAvoided++;
+    settingsSetUInt(SETTING_REBOOTS_AVOIDED, rebootsAvoided);
+
+    Serial.printf("WiFi: Recovery timeout, offline mode (reboots avoided: %lu)\n", (unsigned long)rebootsAvoided);
+    resetNetworkStack();
+    wifiFastReconnect();
+    updateConnectionStatus();
+}
+
+// Fully live again: WiFi up, MQTT session up and a message delivered since the outage
+void checkBackToLive() {
+    if (!awaitingLive || !netIsMqttConnected() || netGetTopicStats().delivered == liveDeliveredMark) return;
+
+    awaitingLive = false;
+    lastBackToLiveMs = millis() - wifiDisconnectTime;
+    backToLiveMsTotal += lastBackToLiveMs;
+    liveRecoveries++;
+    setValuesStale(false);
+    Serial.printf("WiFi: Fully live %lu ms after the disconnect\n", lastBackToLiveMs);
+}
+
+// Check WiFi connection: recovery window, then offline mode with backoff
 void checkWiFi() {
     bool connected = (WiFi.status() == WL_CONNECTED);
 
@@ -269,31 +406,40 @@ void checkWiFi() {
             break;
 
         case WIFI_STATE_RECOVERING:
+        case WIFI_STATE_OFFLINE:
             if (connected) {
                 // WiFi reconnected successfully
+                Serial.printf("WiFi: Recovered successfully%s\n", wifiState == WIFI_STATE_OFFLINE ? " (was offline)" : "");
                 wifiState = WIFI_STATE_CONNECTED;
-                Serial.println("WiFi: Recovered successfully");
+                awaitingLive = true;
+                liveDeliveredMark = netGetTopicStats().delivered;
                 time_service_sync();  // Re-sync time after recovery
+                netCheckMqtt(true);   // Start the MQTT race now rather than after the rate limit
                 updateConnectionStatus();
+            } else if (wifiState == WIFI_STATE_OFFLINE) {
+                if (millis() - lastWifiReconnectAttempt > offlineBackoffMs) {
+                    lastWifiReconnectAttempt = millis();
+                    offlineAttempts++;
+                    if (offlineAttempts % WIFI_OFFLINE_RESET_EVERY == 0) {
+                        resetNetworkStack();
+                    }
+                    Serial.printf("WiFi: Offline reconnect attempt %lu (next in %lu s)\n",
+                                  (unsigned long)offlineAttempts, min(offlineBackoffMs * 2, WIFI_OFFLINE_BACKOFF_MAX_MS) / 1000);
+                    wifiFastReconnect();
+                    offlineBackoffMs = min(offlineBackoffMs * 2, WIFI_OFFLINE_BACKOFF_MAX_MS);
+                }
             } else if (millis() - wifiDisconnectTime > WIFI_RECOVERY_TIMEOUT_MS) {
-                // Timeout - trigger restart
-                wifiState = WIFI_STATE_FAILED;
-                Serial.println("WiFi: Recovery timeout, restarting...");
-                restartESP();
+                enterOfflineMode();
             } else if (millis() - lastWifiReconnectAttempt > WIFI_RECONNECT_ATTEMPT_MS) {
                 // Attempt reconnection
                 lastWifiReconnectAttempt = millis();
                 Serial.printf("WiFi: Reconnecting... (%lu/%lu ms)\n",
                               millis() - wifiDisconnectTime,
                               WIFI_RECOVERY_TIMEOUT_MS);
-                WiFi.reconnect();
+                wifiFastReconnect();
             }
             break;
 
-        case WIFI_STATE_FAILED:
-            // Should not reach here - restarting
-            restartESP();
-            break;
     }
 }
 
@@ -312,82 +458,106 @@ void initMQTT() {
     // Load MQTT server preference from NVS (defaults to LOCAL)
     netLoadMqttServerFromNVS();
 
-    // Attempt connection with fallback
+    // Topics handled by the sketch; services register their own in their init
+    netSubscribe(TOPIC_POWER, onPowerMessage, MAX_PAYLOAD_POWER);
+    netSubscribe(TOPIC_ENERGY, onEnergyMessage, MAX_PAYLOAD_ENERGY);
+    netSubscribe(TOPIC_IMAGE, onImageMessage, MAX_PAYLOAD_IMAGE);
+
+    snprintf(metricsTopic, sizeof(metricsTopic), "homepanel/%s/metrics", mqttClientId);
+    netMetricsSetMqttPublish(metricsTopic, METRICS_PUBLISH_INTERVAL_MS);
+
+    // Race both servers (stored one first) - completes in the background (netLoop)
     if (!netConnectMqttWithFallback()) {
-        Serial.println("MQTT: Both servers failed, will retry periodically");
+        Serial.println("MQTT: Could not start connection, will retry periodically");
     }
 
     updateConnectionStatus();
 }
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    // Null-terminate the payload
-    char message[length + 1];
-    memcpy(message, payload, length);
-    message[length] = '\0';
-
-    Serial.printf("MQTT [%s]: %s\n", topic, message);
-
-    // Handle power topic
-    if (strcmp(topic, TOPIC_POWER) == 0) {
-        lastPowerReceived = millis();
-        powerStale = false;
-        if (ui_labelPowerValue) {
-            char buf[32];
-            snprintf(buf, sizeof(buf), "%s %s W", LV_SYMBOL_HOME, message);
-            lv_label_set_text(ui_labelPowerValue, buf);
-        }
-    }
-    // Handle energy topic
-    else if (strcmp(topic, TOPIC_ENERGY) == 0) {
-        if (ui_labelEnergyValue) {
-            char buf[32];
-            snprintf(buf, sizeof(buf), "%s", message);
-            lv_label_set_text(ui_labelEnergyValue, buf);
-        }
+// MQTT handlers - called by the net module's topic router on the app task
+
+// Payloads are views into the MQTT receive buffer (not NUL-terminated): print with %.*s
+void onPowerMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %.*s\n", topic, (int)payload.len, payload.data);
+
+    // Garbled or implausible readings count against the signal quality
+    // (power_alert) and reach neither the label nor the history and cost
+    float watts;
+    if (!payload.parseFloat(&watts) || !powerReadingPlausible(watts)) {
+        power_alert_invalid();
+        return;
     }
-    // Handle image topic
-    else if (strcmp(topic, TOPIC_IMAGE) == 0) {
-        Serial.println("Image request received via MQTT");
-        requestLatestImage();
+    if (ui_labelPowerValue) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%s %.*s W", LV_SYMBOL_HOME, (int)payload.len, payload.data);
+        ui_dispatch_label_text(ui_labelPowerValue, buf);
     }
-    // Handle weather topic - route to temperature service
-    else if (strcmp(topic, TOPIC_WEATHER) == 0) {
-        temperature_service_handleMQTT(message);
+    power_service_record(watts);
+    cost_service_record(watts);
+    power_alert_record(watts);
+}
+
+void onEnergyMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %.*s\n", topic, (int)payload.len, payload.data);
+    if (ui_labelEnergyValue) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*s", (int)payload.len, payload.data);
+        ui_dispatch_label_text(ui_labelEnergyValue, buf);
     }
-    // Handle light topic - route to light service
-    else if (strcmp(topic, TOPIC_LIGHT) == 0) {
-        light_service_handleMQTT(message);
+
+    float kwh;
+    if (payload.parseFloat(&kwh) &&
+        (!energyLogged || millis() - lastEnergyLogged >= ENERGY_LOG_INTERVAL_MS)) {
+        if (sampleLogAppend(SAMPLE_ENERGY, 0, kwh)) {
+            energyLogged = true;
+            lastEnergyLogged = millis();
+        }
     }
 }
 
+void onImageMessage(const char* topic, PayloadView payload) {
+    Serial.println("Image request received via MQTT");
+    requestLatestImage();
+}
+
 // ============================================================================
 // UI Update Functions
 // ============================================================================
 
 void updateConnectionStatus() {
-    // Single-threaded mode: no lock needed
+    // Runs on the app task: widget updates go through the UI dispatch queue
     if (ui_labelConnectionStatus) {
-        if (wifiState == WIFI_STATE_RECOVERING) {
+        if (wifiState == WIFI_STATE_OFFLINE) {
+            unsigned long wait = offlineBackoffMs - min(offlineBackoffMs, millis() - lastWifiReconnectAttempt);
+            char buf[64];
+            snprintf(buf, sizeof(buf), "WiFi: Offline (retry in %lus)", wait / 1000);
+            ui_dispatch_label_text(ui_labelConnectionStatus, buf);
+            ui_dispatch_text_color(ui_labelConnectionStatus, lv_color_hex(0xFF0000));
+        } else if (wifiState == WIFI_STATE_RECOVERING) {
             // Show recovery countdown
             unsigned long elapsed = (millis() - wifiDisconnectTime) / 1000;
             char buf[64];
             snprintf(buf, sizeof(buf), "WiFi: Recovering (%lus)", elapsed);
-            lv_label_set_text(ui_labelConnectionStatus, buf);
-            lv_obj_set_style_text_color(ui_labelConnectionStatus, lv_color_hex(0xFFA500), LV_PART_MAIN);  // Orange
+            ui_dispatch_label_text(ui_labelConnectionStatus, buf);
+            ui_dispatch_text_color(ui_labelConnectionStatus, lv_color_hex(0xFFA500));  // Orange
         } else if (WiFi.status() != WL_CONNECTED) {
-            lv_label_set_text(ui_labelConnectionStatus, "WiFi: Disconnected");
-            lv_obj_set_style_text_color(ui_labelConnectionStatus, lv_color_hex(0xFF0000), LV_PART_MAIN);
+            ui_dispatch_label_text(ui_labelConnectionStatus, "WiFi: Disconnected");
+            ui_dispatch_text_color(ui_labelConnectionStatus, lv_color_hex(0xFF0000));
         } else if (!netIsMqttConnected()) {
             char buf[64];
-            snprintf(buf, sizeof(buf), "IP: %s | No MQTT", WiFi.localIP().toString().c_str());
-            lv_label_set_text(ui_labelConnectionStatus, buf);
-            lv_obj_set_style_text_color(ui_labelConnectionStatus, lv_color_hex(0xFFFF00), LV_PART_MAIN);
+            const char* linkState = netGetMqttLinkState();
+            if (strcmp(linkState, "idle") == 0 || strcmp(linkState, "failed") == 0) {
+                snprintf(buf, sizeof(buf), "IP: %s | No MQTT", WiFi.localIP().toString().c_str());
+            } else {
+                snprintf(buf, sizeof(buf), "IP: %s | MQTT %s...", WiFi.localIP().toString().c_str(), linkState);
+            }
+            ui_dispatch_label_text(ui_labelConnectionStatus, buf);
+            ui_dispatch_text_color(ui_labelConnectionStatus, lv_color_hex(0xFFFF00));
         } else {
             char buf[64];
             snprintf(buf, sizeof(buf), "IP: %s | MQTT %s", WiFi.localIP().toString().c_str(), netGetMqttServerName());
-            lv_label_set_text(ui_labelConnectionStatus, buf);
-            lv_obj_set_style_text_color(ui_labelConnectionStatus, lv_color_hex(0x00FF00), LV_PART_MAIN);
+            ui_dispatch_label_text(ui_labelConnectionStatus, buf);
+            ui_dispatch_text_color(ui_labelConnectionStatus, lv_color_hex(0x00FF00));
         }
     }
 }
@@ -401,6 +571,120 @@ void logHeapStatus() {
                   ESP.getFreeHeap(),
                   ESP.getMinFreeHeap(),
                   ESP.getFreePsram());
+
+    UiDispatchStats ui;
+    ui_dispatch_get_stats(&ui);
+    Serial.printf("[UI] Applied: %lu | Coalesced: %lu | Dropped: %lu | Frames: %lu\n",
+                  (unsigned long)ui.applied, (unsigned long)ui.coalesced,
+                  (unsigned long)ui.dropped, (unsigned long)ui.frames);
+
+    // Loop task stack: lowest free space seen (MQTT handlers run on this stack)
+    Serial.printf("[STACK] Loop min free: %u bytes\n", (unsigned)uxTaskGetStackHighWaterMark(NULL));
+
+    TopicRouterStats topics = netGetTopicStats();
+    Serial.printf("[MQTT] Delivered: %lu | Rejected: %lu | Unrouted: %lu\n",
+                  (unsigned long)topics.delivered, (unsigned long)topics.rejected,
+                  (unsigned long)topics.unrouted);
+
+    // TLS handshakes on the secure broker: full vs resumed (reconnect cost)
+    for (int server = MQTT_SERVER_LOCAL; server <= MQTT_SERVER_REMOTE; server++) {
+        const TlsHandshakeStats* tls = netGetTlsStats(server);
+        if (!tls || tls->full + tls->resumed == 0) continue;
+        Serial.printf("[TLS %s] Full: %lu (avg %lu ms, cpu %lu ms) | Resumed: %lu (avg %lu ms, cpu %lu ms) | Rejected: %lu\n",
+                      server == MQTT_SERVER_LOCAL ? "Local" : "Remote",
+                      (unsigned long)tls->full,
+                      (unsigned long)(tls->full ? tls->fullWallMs / tls->full : 0),
+                      (unsigned long)(tls->full ? tls->fullCpuMs / tls->full : 0),
+                      (unsigned long)tls->resumed,
+                      (unsigned long)(tls->resumed ? tls->resumedWallMs / tls->resumed : 0),
+                      (unsigned long)(tls->resumed ? tls->resumedCpuMs / tls->resumed : 0),
+                      (unsigned long)tls->resumeRejected);
+    }
+
+    WifiFastStats wifi = wifiFastGetStats();
+    Serial.printf("[WIFI] Boot-to-IP: %lu ms | Outages: %lu (last %lu ms, avg %lu ms) | Fast: %lu | Scan: %lu | Fast failed: %lu\n",
+                  (unsigned long)wifi.bootToIpMs, (unsigned long)wifi.outages, (unsigned long)wifi.lastOutageMs,
+                  (unsigned long)(wifi.outages ? wifi.outageMsTotal / wifi.outages : 0),
+                  (unsigned long)wifi.fastConnects, (unsigned long)wifi.fullConnects,
+                  (unsigned long)wifi.fastFailures);
+
+    Serial.printf("[OFFLINE] Entries: %lu | Reboots avoided: %lu (all boots) | Back to live: %lu (last %lu ms, avg %lu ms)\n",
+                  (unsigned long)offlineEntries, (unsigned long)rebootsAvoided, (unsigned long)liveRecoveries,
+                  lastBackToLiveMs, (unsigned long)(liveRecoveries ? backToLiveMsTotal / liveRecoveries : 0));
+
+    OutboxStats outbox = netGetOutboxStats();
+    Serial.printf("[OUTBOX] Sent: %lu | Pending: %lu | Retried: %lu | Deduped: %lu | Cancelled: %lu | Dropped: %lu | Expired: %lu\n",
+                  (unsigned long)outbox.sent, (unsigned long)outbox.pending, (unsigned long)outbox.retried,
+                  (unsigned long)outbox.deduped, (unsigned long)outbox.cancelled, (unsigned long)outbox.dropped,
+                  (unsigned long)outbox.expired);
+
+    LightToggleStats light = light_service_get_stats();
+    Serial.printf("[LIGHT] Optimistic: %lu | Confirmed: %lu (last %lu ms) | Rolled back: %lu | Out-of-order: %lu\n",
+                  (unsigned long)light.optimistic, (unsigned long)light.confirmed, (unsigned long)light.lastConfirmMs,
+                  (unsigned long)light.rolledBack, (unsigned long)light.outOfOrder);
+
+    LightGridStats grid = light_grid_get_stats();
+    Serial.printf("[GRID] Tiles: %lu | Updates: %lu (coalesced %lu) | Batches: %lu (%lu tiles, max %lu) | Render: last %lu ms for %lu tiles, avg %lu us/tile, full grid %lu ms\n",
+                  (unsigned long)grid.tiles, (unsigned long)grid.updates, (unsigned long)grid.coalesced,
+                  (unsigned long)grid.batches, (unsigned long)grid.tilesApplied, (unsigned long)grid.maxBatch,
+                  (unsigned long)grid.lastRenderMs, (unsigned long)grid.lastRenderTiles,
+                  (unsigned long)(grid.renderTilesTotal ? grid.renderMsTotal * 1000 / grid.renderTilesTotal : 0),
+                  (unsigned long)grid.fullRenderMs);
+
+    RegistryStats reg = entity_registry_get_stats();
+    Serial.printf("[REGISTRY] Gen: %lu (%s) | Lights: %lu | Locations: %lu | Hash: %lu keys/%lu slots (%lu tries, %lu us) | Lookups: %lu (miss %lu) | Rejected: %lu\n",
+                  (unsigned long)reg.generation,
+                  reg.source == RegistrySource::MQTT ? "MQTT" : reg.source == RegistrySource::NVS ? "NVS" : "built-in",
+                  (unsigned long)reg.lights, (unsigned long)reg.locations, (unsigned long)reg.keys,
+                  (unsigned long)reg.slots, (unsigned long)reg.seedTries, (unsigned long)reg.buildUs,
+                  (unsigned long)reg.lookups, (unsigned long)reg.misses, (unsigned long)reg.rejected);
+
+    SettingsStats set = settingsGetStats();
+    Serial.printf("[SETTINGS] Keys: %lu (dirty %lu) | Sets: %lu | Writes: %lu in %lu flushes (last %lu us) | Saved: %lu (unchanged %lu, coalesced %lu) | Reads: %lu | Errors: %lu\n",
+                  (unsigned long)set.keys, (unsigned long)set.dirty, (unsigned long)set.sets,
+                  (unsigned long)set.writes, (unsigned long)set.flushes, (unsigned long)set.lastFlushUs,
+                  (unsigned long)(set.unchanged + set.coalesced), (unsigned long)set.unchanged,
+                  (unsigned long)set.coalesced, (unsigned long)set.reads, (unsigned long)set.errors);
+
+    SnapshotStats snap = status_snapshot_get_stats();
+    Serial.printf("[SNAPSHOT] Sessions: %lu | Snapshot: %lu (after get %lu) | Legacy: %lu | Last: %lu ms, %lu msgs | Avg: %lu ms, %lu msgs\n",
+                  (unsigned long)snap.sessions, (unsigned long)snap.snapshots, (unsigned long)snap.requested,
+                  (unsigned long)snap.legacy, (unsigned long)snap.lastLatencyMs, (unsigned long)snap.lastMessages,
+                  (unsigned long)((snap.snapshots + snap.legacy) ? snap.latencyMsTotal / (snap.snapshots + snap.legacy) : 0),
+                  (unsigned long)((snap.snapshots + snap.legacy) ? snap.messagesTotal / (snap.snapshots + snap.legacy) : 0));
+
+    SampleLogStats slog = sampleLogGetStats();
+    Serial.printf("[SLOG] Segments: %lu/%lu | Appended: %lu | Dropped: %lu | Erases: %lu | Mount: %lu ms | Replay: %lu records in %lu ms\n",
+                  (unsigned long)slog.segmentsUsed, (unsigned long)slog.segments, (unsigned long)slog.appended,
+                  (unsigned long)slog.dropped, (unsigned long)slog.sectorErases, (unsigned long)slog.mountMs,
+                  (unsigned long)slog.replayRecords, (unsigned long)slog.replayMs);
+
+    const EnergyCost& cost = cost_service_engine();
+    CostServiceStats costStats = cost_service_get_stats();
+    const EnergyCostStats& integ = cost.stats();
+    Serial.printf("[COST] Today: %.3f kWh %.2f $ | Month: %.2f kWh %.2f $ | Samples: %lu (rejected %lu, before clock %lu) | Slices: %lu (splits %lu) | Gaps: %lu (%lu s) | Replayed: %lu min in %lu ms | Sample: %lu us (max %lu)\n",
+                  cost.today().kwh, cost.today().cost, cost.month().kwh, cost.month().cost,
+                  (unsigned long)integ.samples, (unsigned long)integ.rejected, (unsigned long)costStats.beforeClock,
+                  (unsigned long)integ.slices, (unsigned long)integ.splits, (unsigned long)integ.gaps,
+                  (unsigned long)integ.gapSeconds, (unsigned long)integ.replayedMinutes, (unsigned long)costStats.replayMs,
+                  (unsigned long)costStats.lastSampleUs, (unsigned long)costStats.maxSampleUs);
+    for (size_t b = 0; b < ENERGY_COST_BUCKETS; b++) {
+        if (cost.month().buckets[b].kwh <= 0) continue;
+        Serial.printf("[COST]   %-15s %.4f $/kWh | Today: %.3f kWh %.2f $ | Month: %.2f kWh %.2f $\n",
+                      cost.bucketName(b), cost.bucketPrice(b), cost.today().buckets[b].kwh,
+                      cost.today().buckets[b].cost, cost.month().buckets[b].kwh, cost.month().buckets[b].cost);
+    }
+
+    PowerAlertStats alert = power_alert_get_stats();
+    const PowerAnomalyDetector& det = power_alert_detector();
+    const PowerAnomalyStats& anomaly = det.stats();
+    Serial.printf("[PALERT] Signal: %s (%lu changes, stale %lu, invalid %lu) | Baseline: %.0f W (sd %.0f) | Samples: %lu (invalid %lu) | Spikes: %lu (max z %.1f) | Sustained: %lu | Alerts: %lu (wakes %lu, dismissed %lu) | Record: %lu us (max %lu)\n",
+                  power_alert_signal_name(alert.signal), (unsigned long)alert.signalChanges,
+                  (unsigned long)alert.staleEvents, (unsigned long)alert.invalidEvents, det.mean(), det.sigma(),
+                  (unsigned long)anomaly.samples, (unsigned long)anomaly.invalid, (unsigned long)anomaly.spikes,
+                  anomaly.maxZ, (unsigned long)anomaly.sustained, (unsigned long)alert.alerts,
+                  (unsigned long)alert.wakes, (unsigned long)alert.dismissed,
+                  (unsigned long)alert.lastRecordUs, (unsigned long)alert.maxRecordUs);
 }
 
 // ============================================================================
@@ -416,6 +700,12 @@ void setup() {
     Serial.printf("Heap: %d free of %d\n", ESP.getFreeHeap(), ESP.getHeapSize());
     Serial.printf("PSRAM: %d free of %d\n", ESP.getFreePsram(), ESP.getPsramSize());
 
+    // Settings shadow (NVS "homepanel" namespace), before any module reads a setting
+    settingsInit();
+
+    // Restarts avoided by offline mode, across boots (soak statistics)
+    rebootsAvoided = settingsGetUInt(SETTING_REBOOTS_AVOIDED, 0);
+
     // Generate dynamic MQTT client ID from chip ID (last 20 bits as 5 hex digits)
     uint32_t chipId = (uint32_t)(ESP.getEfuseMac() & 0xFFFFF);
     snprintf(mqttClientId, sizeof(mqttClientId), "home%05X", chipId);
@@ -449,11 +739,19 @@ void setup() {
     screenPowerInit();  // Initialize screen power manager (turns backlight on)
     Serial.println("Display initialized");
 
-    // Initialize LVGL UI (single-threaded mode, no lock needed)
+    // Initialize LVGL UI (lock is a no-op in single-threaded mode)
     Serial.println("Initializing UI...");
+    lvgl_port_lock(0);
     ui_init();
     Serial.println("UI initialized");
 
+    // Initialize LVGL performance monitor (long-press status label toggles overlay)
+    perf_monitor_init(ui_labelConnectionStatus);
+
+    // Initialize app task <-> LVGL thread dispatch queues
+    ui_dispatch_init();
+    lvgl_port_unlock();
+
     // Show connect screen before WiFi attempt
     showConnectScreen("Connecting...");
 
@@ -469,14 +767,9 @@ void setup() {
         .mqttClient = &mqttClient,
         .wifiClient = &wifiClient,
         .secureClient = &secureClient,
-        .mqttCallback = mqttCallback,
-        .topics = {
-            .image = TOPIC_IMAGE,
-            .power = TOPIC_POWER,
-            .energy = TOPIC_ENERGY,
-            .weather = TOPIC_WEATHER,
-            .light = TOPIC_LIGHT
-        }
+        .mqttClient2 = &mqttClient2,
+        .wifiClient2 = &wifiClient2,
+        .secureClient2 = &secureClient2
     };
     netInit(netCfg);
     Serial.println("Network module initialized");
@@ -490,9 +783,23 @@ void setup() {
         .screen2 = ui_Screen2,
         .imgScreen2Background = ui_imgScreen2Background
     };
+    lvgl_port_lock(0);
     imageFetcherInit(imgCfg);
+    lvgl_port_unlock();
     Serial.println("Image fetcher initialized");
 
+    // Sample log on the "fat" partition (replayed by the services once NTP has set the clock)
+    sampleLogInit();
+
+    // Initialize power history and its chart (under the power/energy labels)
+    lvgl_port_lock(0);
+    power_service_init(ui_electricContainer);
+    // Today / month-to-date cost line above the chart (tariff from NVS or built-in, then the retained topic)
+    cost_service_init(ui_electricContainer);
+    // Spike / high-load banner on the top layer, power signal quality
+    power_alert_init(ui_labelPowerValue);
+    lvgl_port_unlock();
+
     // Connect to WiFi using WiFiManager (captive portal for configuration)
     initWiFiManager();
 
@@ -505,12 +812,18 @@ void setup() {
     // Initialize time service (NTP sync + label updates)
     time_service_init();
 
+    // Lights and temperature locations (NVS copy or built-in defaults, then the retained topic)
+    entity_registry_init();
+
     // Initialize temperature service (cycling display)
-    temperature_service_init(ui_tempLocLabel, ui_labelOutsideTemp, ui_tempTimeLabel, &mqttClient);
+    temperature_service_init(ui_tempLocLabel, ui_labelOutsideTemp, ui_tempTimeLabel);
 
     // Initialize light service (cycling light control)
     light_service_init(ui_ButtonSelectLight, ui_ButtonLight, ui_lightLabel,
-                       ui_lightONImage, ui_lightOFFImage, &mqttClient);
+                       ui_lightONImage, ui_lightOFFImage);
+
+    // Light and temperature state after each MQTT session
+    status_snapshot_init();
 
     Serial.println("=== Setup Complete ===\n");
 }
@@ -520,29 +833,41 @@ void setup() {
 // ============================================================================
 
 void loop() {
+    uint32_t loopStart = micros();
+
+#if !LVGL_PORT_USE_TASK
     // Process LVGL - single-threaded mode, called directly from main loop
+    uint32_t lvglStart = micros();
     lv_timer_handler();
+    perf_monitor_record_timer_handler(micros() - lvglStart);
+#endif
+
+    // Run service calls forwarded from LVGL event handlers
+    ui_dispatch_app_loop();
+
+    // NTP answer or timeout (the sync itself never blocks)
+    time_service_loop();
 
-    // Check WiFi connection periodically
-    if (millis() - lastWiFiCheck > WIFI_CHECK_INTERVAL) {
+    // Check WiFi connection periodically (often while recovering)
+    unsigned long wifiCheckInterval =
+        (wifiState != WIFI_STATE_CONNECTED) ? WIFI_RECOVERY_CHECK_INTERVAL : WIFI_CHECK_INTERVAL;
+    if (millis() - lastWiFiCheck > wifiCheckInterval) {
         lastWiFiCheck = millis();
         checkWiFi();
     }
 
-    // Process MQTT if connected
+    // WiFi cache persistence, connect timings, reused lease renewal
+    wifiFastLoop();
+    checkBackToLive();
+
+    // Advance the MQTT connection state machine and process MQTT (never blocks)
     if (WiFi.status() == WL_CONNECTED) {
-        mqttClient.loop();
-        netCheckMqtt();
+        netLoop();
     }
 
-    // Detect MQTT reconnection and request fresh status from services
-    static bool wasMqttConnected = false;
-    bool isMqttConnected = mqttClient.connected();
-    if (isMqttConnected && !wasMqttConnected) {
-        light_service_requestStatus();
-        temperature_service_requestStatus();
-    }
-    wasMqttConnected = isMqttConnected;
+    // New MQTT session (reconnect or local/remote switch): retained status snapshot,
+    // a get if it does not come, per-service status requests as the last resort
+    status_snapshot_loop();
 
     // Process OTA web server
     server.handleClient();
@@ -551,6 +876,9 @@ void loop() {
     // Process image fetcher
     imageFetcherLoop();
 
+    // Synthetic touch source for latency measurements (idle unless started via /latency)
+    latency_probe_loop();
+
     // Periodic heap logging for memory leak detection
     if (millis() - lastHeapLog > HEAP_LOG_INTERVAL) {
         lastHeapLog = millis();
@@ -561,26 +889,36 @@ void loop() {
     if (millis() - lastStatusUpdate > STATUS_UPDATE_INTERVAL) {
         lastStatusUpdate = millis();
         updateConnectionStatus();
-
-        // Check for stale power data (no MQTT update in 5 minutes)
-        if (lastPowerReceived > 0 && millis() - lastPowerReceived > MQTT_STALE_TIMEOUT_MS && !powerStale) {
-            powerStale = true;
-            if (ui_labelPowerValue) {
-                lv_label_set_text(ui_labelPowerValue, "N/A");
-            }
-            Serial.println("MQTT: Power data stale (no update in 5 minutes)");
-        }
     }
 
+    // Power signal quality ("N/A" once stale; offline: the last value stays, grayed
+    // by setValuesStale), sustained-load window and alert banner
+    power_alert_loop(valuesStale);
+
     // Screen power management (auto-dim after inactivity)
     screenPowerLoop();
 
-    // Temperature service (NVS debounce save)
+    // Temperature service (registry reload, history slots)
     temperature_service_loop();
 
-    // Light service (NVS debounce save)
+    // Power history (close seconds, roll up, append chart columns)
+    power_service_loop();
+
+    // Energy cost (month replay once the clock is set, midnight rollover)
+    cost_service_loop();
+
+    // Sample log (write buffered records once a minute)
+    sampleLogLoop();
+
+    // Light service (toggle deadlines, rollback cue)
     light_service_loop();
 
+    // Settings store (dirty keys written together, 30 s after the first change)
+    settingsLoop();
+
+    // Worst-case iteration is the longest stall seen by network and services
+    perf_monitor_record_loop(micros() - loopStart);
+
     // Small delay to prevent watchdog issues and yield to other tasks
     delay(2);
 }
\ No newline at end of file
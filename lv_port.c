@@ -12,6 +12,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include <stdatomic.h>
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_panel_ops.h"
 #include "esp_lcd_panel_interface.h"
@@ -19,6 +21,9 @@
 #include "lv_port.h"
 #include "lvgl.h"
 #include "esp_bsp.h"
+#include "src/perf/perf_monitor.h"
+#include "src/perf/latency_probe.h"
+#include "src/light/light_grid.h"
 
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
 #include "esp_lcd_touch.h"
@@ -38,6 +43,7 @@ static const char *TAG = "LVGL";
 
 typedef struct lvgl_port_ctx_s {
     SemaphoreHandle_t   lvgl_mux;
+    TaskHandle_t        lvgl_task;
     esp_timer_handle_t  tick_timer;
     bool                running;
     int                 task_max_sleep_ms;
@@ -59,11 +65,30 @@ typedef struct {
 } lvgl_port_display_ctx_t;
 
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
+typedef struct {
+    int64_t     timestamp_us;   /* Interrupt time (or read time when polled) */
+    uint16_t    x;
+    uint16_t    y;
+    bool        pressed;
+} lvgl_port_touch_sample_t;
+
 typedef struct {
     esp_lcd_touch_handle_t  handle;        /* LCD touch IO handle */
     lv_indev_drv_t          indev_drv;     /* LVGL input device driver */
     lvgl_port_wait_cb       touch_wait_cb;  /* Callback function for touch */
+    bool                    int_driven;     /* Task is woken by the INT line */
+    TaskHandle_t            task;           /* Touch sampling task */
+    QueueHandle_t           inject_queue;   /* Synthetic samples (lvgl_port_touch_inject) */
+
+    /* SPSC ring: head written by the touch task, tail by the LVGL read callback */
+    lvgl_port_touch_sample_t ring[LVGL_PORT_TOUCH_RING_SIZE];
+    atomic_uint             ring_head;
+    atomic_uint             ring_tail;
+    lvgl_port_touch_sample_t last;          /* Reported again while the ring is empty */
 } lvgl_port_touch_ctx_t;
+
+_Static_assert((LVGL_PORT_TOUCH_RING_SIZE & (LVGL_PORT_TOUCH_RING_SIZE - 1)) == 0,
+               "LVGL_PORT_TOUCH_RING_SIZE must be a power of two");
 #endif
 
 /*******************************************************************************
@@ -71,6 +96,11 @@ typedef struct {
 *******************************************************************************/
 static lvgl_port_ctx_t lvgl_port_ctx;
 static int lvgl_port_timer_period_ms = 5;
+static lvgl_port_touch_stats_t lvgl_port_touch_stats;
+#ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
+static lvgl_port_touch_ctx_t *lvgl_port_touch_active;   /* Woken by lvgl_port_touch_wake_isr() */
+static volatile int64_t lvgl_port_touch_isr_time_us;    /* Timestamp of the last INT edge */
+#endif
 
 /*******************************************************************************
 * Function definitions
@@ -84,8 +114,10 @@ static void lvgl_port_task_deinit(void);
 static bool lvgl_port_flush_ready_callback(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx);
 #endif
 static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
+static void lvgl_port_monitor_callback(lv_disp_drv_t *drv, uint32_t time, uint32_t px);
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
 static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
+static void lvgl_port_touch_task(void *arg);
 #endif
 /*******************************************************************************
 * Public API functions
@@ -105,10 +137,28 @@ esp_err_t lvgl_port_init(const lvgl_port_cfg_t *cfg)
     lvgl_port_timer_period_ms = cfg->timer_period_ms;
     ESP_RETURN_ON_ERROR(lvgl_port_tick_init(), TAG, "");
 
+#if LVGL_PORT_USE_TASK
+    /* Dedicated task mode: LVGL runs on its own pinned task, guarded by a recursive mutex */
+    lvgl_port_ctx.task_max_sleep_ms = cfg->task_max_sleep_ms;
+    if (lvgl_port_ctx.task_max_sleep_ms == 0) {
+        lvgl_port_ctx.task_max_sleep_ms = 500;
+    }
+    lvgl_port_ctx.lvgl_mux = xSemaphoreCreateRecursiveMutex();
+    ESP_GOTO_ON_FALSE(lvgl_port_ctx.lvgl_mux, ESP_ERR_NO_MEM, err, TAG, "Create LVGL mutex fail!");
+
+    BaseType_t res;
+    if (cfg->task_affinity < 0) {
+        res = xTaskCreate(lvgl_port_task, "LVGL task", cfg->task_stack, NULL, cfg->task_priority, &lvgl_port_ctx.lvgl_task);
+    } else {
+        res = xTaskCreatePinnedToCore(lvgl_port_task, "LVGL task", cfg->task_stack, NULL, cfg->task_priority, &lvgl_port_ctx.lvgl_task, cfg->task_affinity);
+    }
+    ESP_GOTO_ON_FALSE(res == pdPASS, ESP_FAIL, err, TAG, "Create LVGL task fail!");
+#else
     /* Single-threaded mode: No LVGL task created.
      * lv_timer_handler() is called directly from main loop.
      * This eliminates deadlock risks from mutex contention. */
     lvgl_port_ctx.running = true;  // Mark as running for compatibility
+#endif
 
 err:
     if (ret != ESP_OK) {
@@ -226,6 +276,7 @@ lv_disp_t *lvgl_port_add_disp(const lvgl_port_display_cfg_t *disp_cfg)
     disp_ctx->disp_drv.hor_res = disp_cfg->hres;
     disp_ctx->disp_drv.ver_res = disp_cfg->vres;
     disp_ctx->disp_drv.flush_cb = lvgl_port_flush_callback;
+    disp_ctx->disp_drv.monitor_cb = lvgl_port_monitor_callback;
 
     disp_ctx->disp_drv.draw_buf = disp_buf;
     disp_ctx->disp_drv.user_data = disp_ctx;
@@ -310,8 +361,13 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg)
         ESP_LOGE(TAG, "Not enough memory for touch context allocation!");
         return NULL;
     }
+    memset(touch_ctx, 0, sizeof(lvgl_port_touch_ctx_t));
     touch_ctx->handle = touch_cfg->handle;
     touch_ctx->touch_wait_cb = touch_cfg->touch_wait_cb;
+    touch_ctx->int_driven = touch_cfg->int_driven;
+    atomic_init(&touch_ctx->ring_head, 0);
+    atomic_init(&touch_ctx->ring_tail, 0);
+    touch_ctx->inject_queue = xQueueCreate(LVGL_PORT_TOUCH_INJECT_QUEUE, sizeof(lvgl_port_touch_sample_t));
 
     /* Register a touchpad input device */
     lv_indev_drv_init(&touch_ctx->indev_drv);
@@ -319,7 +375,24 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg)
     touch_ctx->indev_drv.disp = touch_cfg->disp;
     touch_ctx->indev_drv.read_cb = lvgl_port_touchpad_read;
     touch_ctx->indev_drv.user_data = touch_ctx;
-    return lv_indev_drv_register(&touch_ctx->indev_drv);
+    lv_indev_t *indev = lv_indev_drv_register(&touch_ctx->indev_drv);
+
+    /* Sampling task: reads the controller so the LVGL read callback never touches I2C */
+    lvgl_port_touch_active = touch_ctx;
+    if (xTaskCreate(lvgl_port_touch_task, "Touch task", LVGL_PORT_TOUCH_TASK_STACK, touch_ctx,
+                    LVGL_PORT_TOUCH_TASK_PRIORITY, &touch_ctx->task) != pdPASS) {
+        ESP_LOGE(TAG, "Create touch task fail!");
+        lvgl_port_touch_active = NULL;
+        lv_indev_delete(indev);
+        if (touch_ctx->inject_queue) {
+            vQueueDelete(touch_ctx->inject_queue);
+        }
+        free(touch_ctx);
+        return NULL;
+    }
+    ESP_LOGI(TAG, "Touch task started (%s)", touch_ctx->int_driven ? "interrupt" : "polling");
+
+    return indev;
 }
 
 esp_err_t lvgl_port_remove_touch(lv_indev_t *touch)
@@ -333,24 +406,98 @@ esp_err_t lvgl_port_remove_touch(lv_indev_t *touch)
     lv_indev_delete(touch);
 
     if (touch_ctx) {
+        if (lvgl_port_touch_active == touch_ctx) {
+            lvgl_port_touch_active = NULL;
+        }
+        if (touch_ctx->task) {
+            vTaskDelete(touch_ctx->task);
+        }
+        if (touch_ctx->inject_queue) {
+            vQueueDelete(touch_ctx->inject_queue);
+        }
         free(touch_ctx);
     }
 
     return ESP_OK;
 }
+
+void lvgl_port_touch_wake_isr(void)
+{
+    lvgl_port_touch_ctx_t *touch_ctx = lvgl_port_touch_active;
+    if (touch_ctx == NULL || touch_ctx->task == NULL) {
+        return;
+    }
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    lvgl_port_touch_isr_time_us = esp_timer_get_time();
+    lvgl_port_touch_stats.wakeups++;
+    vTaskNotifyGiveFromISR(touch_ctx->task, &xHigherPriorityTaskWoken);
+
+    if (xHigherPriorityTaskWoken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+bool lvgl_port_touch_inject(uint16_t x, uint16_t y, bool pressed)
+{
+    lvgl_port_touch_ctx_t *touch_ctx = lvgl_port_touch_active;
+    if (touch_ctx == NULL || touch_ctx->task == NULL || touch_ctx->inject_queue == NULL) {
+        return false;
+    }
+
+    const lvgl_port_touch_sample_t sample = {
+        .timestamp_us = esp_timer_get_time(),
+        .x = x,
+        .y = y,
+        .pressed = pressed,
+    };
+    if (xQueueSend(touch_ctx->inject_queue, &sample, 0) != pdTRUE) {
+        return false;
+    }
+    xTaskNotifyGive(touch_ctx->task);
+    return true;
+}
 #endif
 
+void lvgl_port_touch_get_stats(lvgl_port_touch_stats_t *stats)
+{
+    if (stats) {
+        *stats = lvgl_port_touch_stats;
+    }
+}
+
 bool lvgl_port_lock(uint32_t timeout_ms)
 {
+#if LVGL_PORT_USE_TASK
+    assert(lvgl_port_ctx.lvgl_mux && "lvgl_port_init must be called first");
+
+    const TickType_t timeout_ticks = (timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    return xSemaphoreTakeRecursive(lvgl_port_ctx.lvgl_mux, timeout_ticks) == pdTRUE;
+#else
     // Single-threaded mode: no locking needed
     // LVGL is now called directly from main loop via lv_timer_handler()
     (void)timeout_ms;
     return true;
+#endif
 }
 
 void lvgl_port_unlock(void)
 {
+#if LVGL_PORT_USE_TASK
+    assert(lvgl_port_ctx.lvgl_mux && "lvgl_port_init must be called first");
+    xSemaphoreGiveRecursive(lvgl_port_ctx.lvgl_mux);
+#else
     // Single-threaded mode: no unlocking needed
+#endif
+}
+
+bool lvgl_port_in_lvgl_task(void)
+{
+#if LVGL_PORT_USE_TASK
+    return xTaskGetCurrentTaskHandle() == lvgl_port_ctx.lvgl_task;
+#else
+    return true;
+#endif
 }
 
 void lvgl_port_flush_ready(lv_disp_t *disp)
@@ -372,7 +519,9 @@ static void lvgl_port_task(void *arg)
     lvgl_port_ctx.running = true;
     while (lvgl_port_ctx.running) {
         if (lvgl_port_lock(0)) {
+            const int64_t start_us = esp_timer_get_time();
             task_delay_ms = lv_timer_handler();
+            perf_monitor_record_timer_handler((uint32_t)(esp_timer_get_time() - start_us));
             lvgl_port_unlock();
         }
         if ((task_delay_ms > lvgl_port_ctx.task_max_sleep_ms) || (1 == task_delay_ms)) {
@@ -431,6 +580,7 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
     const int y_end = area->y2;
     const int width = x_end - x_start + 1;
     const int height = y_end - y_start + 1;
+    const int64_t flush_start_us = esp_timer_get_time();
 
     lv_color_t *from = color_map;
     lv_color_t *to = NULL;
@@ -563,49 +713,140 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
     } else {
         esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_start, y_start, x_end + 1, y_end + 1, color_map);
     }
+    perf_monitor_record_flush(width * height, (uint32_t)(esp_timer_get_time() - flush_start_us));
+    latency_probe_on_flush(area);
     lv_disp_flush_ready(drv);
 }
 
+static void lvgl_port_monitor_callback(lv_disp_drv_t *drv, uint32_t time, uint32_t px)
+{
+    (void)drv;
+    /* Called by LVGL after each refresh with render time [ms] and rendered pixel count */
+    perf_monitor_record_render(time, px);
+    light_grid_on_render(time, px);
+}
+
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
-static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
+static void lvgl_port_touch_push(lvgl_port_touch_ctx_t *touch_ctx, const lvgl_port_touch_sample_t *sample)
 {
-    assert(indev_drv);
-    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)indev_drv->user_data;
-    assert(touch_ctx->handle);
+    unsigned head = atomic_load_explicit(&touch_ctx->ring_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&touch_ctx->ring_tail, memory_order_acquire);
+    if (head - tail >= LVGL_PORT_TOUCH_RING_SIZE) {
+        lvgl_port_touch_stats.dropped++;
+        return;
+    }
 
-    uint16_t touchpad_x[1] = {0};
-    uint16_t touchpad_y[1] = {0};
-    uint8_t touchpad_cnt = 0;
+    touch_ctx->ring[head & (LVGL_PORT_TOUCH_RING_SIZE - 1)] = *sample;
+    atomic_store_explicit(&touch_ctx->ring_head, head + 1, memory_order_release);
+    lvgl_port_touch_stats.samples++;
+}
 
-    /* Check if touch interrupt occurred */
-    bool touch_int = false;
-    if (touch_ctx->touch_wait_cb) {
-        touch_int = touch_ctx->touch_wait_cb(touch_ctx->handle->config.user_data);
-    }
+static void lvgl_port_touch_task(void *arg)
+{
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)arg;
+    assert(touch_ctx && touch_ctx->handle);
+
+    bool pressed = false;
+    uint16_t last_x = 0;
+    uint16_t last_y = 0;
+
+    while (1) {
+        /* Sleep until INT (or the poll period); keep polling while a finger is down */
+        TickType_t wait;
+        if (pressed) {
+            wait = pdMS_TO_TICKS(LVGL_PORT_TOUCH_ACTIVE_POLL_MS);
+        } else if (touch_ctx->int_driven) {
+            wait = pdMS_TO_TICKS(LVGL_PORT_TOUCH_INT_IDLE_POLL_MS);
+        } else {
+            wait = pdMS_TO_TICKS(LVGL_PORT_TOUCH_IDLE_POLL_MS);
+        }
+        bool woken = ulTaskNotifyTake(pdTRUE, wait) > 0;
+
+        /* Synthetic samples take the same path as controller readings */
+        lvgl_port_touch_sample_t injected;
+        bool was_injected = false;
+        while (touch_ctx->inject_queue && xQueueReceive(touch_ctx->inject_queue, &injected, 0) == pdTRUE) {
+            lvgl_port_touch_push(touch_ctx, &injected);
+            was_injected = true;
+        }
+        if (was_injected && !pressed) {
+            continue;
+        }
+
+        /* Consume the BSP interrupt flag so it does not carry over to the next wake-up */
+        if (touch_ctx->touch_wait_cb) {
+            touch_ctx->touch_wait_cb(touch_ctx->handle->config.user_data);
+        }
 
-    if (touch_int) {
-        /* START I2C MUTEX PROTECTION - prevents race conditions on I2C bus */
-        if (i2c_mutex && xSemaphoreTakeRecursive(i2c_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-            /* Read data from touch controller into memory */
-            esp_lcd_touch_read_data(touch_ctx->handle);
+        /* This task may block on the bus: a busy mutex delays the sample instead of dropping it */
+        int64_t wait_start = esp_timer_get_time();
+        if (i2c_mutex) {
+            xSemaphoreTakeRecursive(i2c_mutex, portMAX_DELAY);
+        }
+        int64_t read_time = esp_timer_get_time();
+        uint32_t waited = (uint32_t)(read_time - wait_start);
+        if (waited > lvgl_port_touch_stats.i2c_wait_max_us) {
+            lvgl_port_touch_stats.i2c_wait_max_us = waited;
+        }
 
-            /* Get touch coordinates */
-            bool touchpad_pressed = esp_lcd_touch_get_coordinates(touch_ctx->handle, touchpad_x, touchpad_y, NULL, &touchpad_cnt, 1);
+        uint16_t touchpad_x[1] = {0};
+        uint16_t touchpad_y[1] = {0};
+        uint8_t touchpad_cnt = 0;
+        bool touchpad_pressed = false;
+        if (esp_lcd_touch_read_data(touch_ctx->handle) == ESP_OK) {
+            touchpad_pressed = esp_lcd_touch_get_coordinates(touch_ctx->handle, touchpad_x, touchpad_y, NULL, &touchpad_cnt, 1);
+        } else {
+            lvgl_port_touch_stats.read_errors++;
+        }
 
+        if (i2c_mutex) {
             xSemaphoreGiveRecursive(i2c_mutex);
-            /* END I2C MUTEX PROTECTION */
+        }
 
-            /* Ghost touch filter: only process if valid touch count */
-            if (touchpad_pressed && touchpad_cnt > 0) {
-                data->point.x = touchpad_x[0];
-                data->point.y = touchpad_y[0];
-                data->state = LV_INDEV_STATE_PRESSED;
-            } else {
-                data->state = LV_INDEV_STATE_RELEASED;
-            }
+        /* Ghost touch filter: only a valid touch count counts as pressed */
+        bool now_pressed = touchpad_pressed && touchpad_cnt > 0;
+        if (now_pressed && !pressed && !woken && touch_ctx->int_driven) {
+            lvgl_port_touch_stats.missed_edges++;
         }
-        /* If mutex acquisition fails, skip this touch read (non-blocking fallback) */
+
+        /* Queue state changes and moves only */
+        if (now_pressed != pressed || (now_pressed && (touchpad_x[0] != last_x || touchpad_y[0] != last_y))) {
+            lvgl_port_touch_sample_t sample = {
+                .timestamp_us = (woken && touch_ctx->int_driven) ? lvgl_port_touch_isr_time_us : read_time,
+                .x = now_pressed ? touchpad_x[0] : last_x,
+                .y = now_pressed ? touchpad_y[0] : last_y,
+                .pressed = now_pressed,
+            };
+            lvgl_port_touch_push(touch_ctx, &sample);
+            last_x = sample.x;
+            last_y = sample.y;
+        }
+        pressed = now_pressed;
+    }
+}
+
+static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
+{
+    assert(indev_drv);
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)indev_drv->user_data;
+    assert(touch_ctx);
+
+    /* Drain one queued sample per call; ask LVGL to read again while more are pending */
+    unsigned tail = atomic_load_explicit(&touch_ctx->ring_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&touch_ctx->ring_head, memory_order_acquire);
+    if (tail != head) {
+        touch_ctx->last = touch_ctx->ring[tail & (LVGL_PORT_TOUCH_RING_SIZE - 1)];
+        atomic_store_explicit(&touch_ctx->ring_tail, tail + 1, memory_order_release);
+        data->continue_reading = (tail + 1 != head);
+
+        /* Touch-to-event latency: controller interrupt (or read) until LVGL consumes the sample */
+        perf_monitor_record_touch((uint32_t)(esp_timer_get_time() - touch_ctx->last.timestamp_us));
+        latency_probe_on_touch(touch_ctx->last.timestamp_us, touch_ctx->last.pressed);
     }
+
+    data->point.x = touch_ctx->last.x;
+    data->point.y = touch_ctx->last.y;
+    data->state = touch_ctx->last.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
 }
 #endif
 
@@ -22,6 +22,37 @@
 extern "C" {
 #endif
 
+/**
+ * @brief LVGL threading mode
+ *
+ * 0: Single-threaded. lv_timer_handler() is called from the Arduino loop() and
+ *    lvgl_port_lock()/lvgl_port_unlock() are no-ops.
+ * 1: Dedicated LVGL task pinned to lvgl_port_cfg_t.task_affinity. The loop() task
+ *    must not call LVGL directly: widget updates go through ui_dispatch, and rare
+ *    structural operations (screen loads, timers) are done under lvgl_port_lock().
+ */
+#ifndef LVGL_PORT_USE_TASK
+#define LVGL_PORT_USE_TASK 0
+#endif
+
+/**
+ * @brief Touch sampling task
+ *
+ * The touch controller is read by a small high-priority task instead of the LVGL
+ * read callback. When the controller INT line is wired (lvgl_port_touch_cfg_t.int_driven)
+ * the task sleeps until the interrupt and only polls while a finger is down, so there
+ * is almost no I2C traffic while idle: one read per LVGL_PORT_TOUCH_INT_IDLE_POLL_MS, so
+ * a missed edge cannot leave touch dead. Without INT it polls at LVGL_PORT_TOUCH_IDLE_POLL_MS.
+ * Samples are timestamped and queued on a ring that the LVGL read callback drains.
+ */
+#define LVGL_PORT_TOUCH_TASK_PRIORITY   (5)     /* Above the LVGL task (4) and loop() (1) */
+#define LVGL_PORT_TOUCH_TASK_STACK      (3072)
+#define LVGL_PORT_TOUCH_ACTIVE_POLL_MS  (10)    /* Poll period while pressed */
+#define LVGL_PORT_TOUCH_IDLE_POLL_MS    (30)    /* Poll period while released (no INT line) */
+#define LVGL_PORT_TOUCH_INT_IDLE_POLL_MS (1000) /* Fallback read while released (INT line) */
+#define LVGL_PORT_TOUCH_RING_SIZE       (32)    /* Must be a power of two */
+#define LVGL_PORT_TOUCH_INJECT_QUEUE    (8)     /* Pending synthetic samples */
+
 typedef bool (*lvgl_port_wait_cb)(void *handle);
 
 /**
@@ -60,9 +91,22 @@ typedef struct {
     esp_lcd_touch_handle_t   handle;   /*!< LCD touch IO handle */
 
     lvgl_port_wait_cb touch_wait_cb;
+    bool int_driven;    /*!< INT line calls lvgl_port_touch_wake_isr(); otherwise polled */
 } lvgl_port_touch_cfg_t;
 #endif
 
+/**
+ * @brief Touch sampling statistics
+ */
+typedef struct {
+    uint32_t samples;           /*!< Samples queued by the touch task */
+    uint32_t dropped;           /*!< Samples lost because the ring was full */
+    uint32_t read_errors;       /*!< Failed controller reads */
+    uint32_t i2c_wait_max_us;   /*!< Longest wait for the I2C bus mutex */
+    uint32_t wakeups;           /*!< Interrupt wake-ups (0 when polled) */
+    uint32_t missed_edges;      /*!< Presses found by the INT fallback read instead of an interrupt */
+} lvgl_port_touch_stats_t;
+
 /**
  * @brief LVGL port configuration structure
  *
@@ -70,7 +114,7 @@ typedef struct {
 #define ESP_LVGL_PORT_INIT_CONFIG() \
     {                               \
         .task_priority = 4,       \
-        .task_stack = 6144,       \
+        .task_stack = 8192,       \
         .task_affinity = 0,      \
         .task_max_sleep_ms = 500, \
         .timer_period_ms = 5,     \
@@ -140,8 +184,34 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg);
  *      - ESP_OK                    on success
  */
 esp_err_t lvgl_port_remove_touch(lv_indev_t *touch);
+
+/**
+ * @brief Wake the touch task from the controller INT handler (ISR-safe)
+ */
+void lvgl_port_touch_wake_isr(void);
+
+/**
+ * @brief Inject a synthetic touch sample (latency harness)
+ *
+ * The sample is queued by the touch task exactly like a controller reading, so it
+ * follows the same path through the ring and the LVGL read callback.
+ *
+ * @param x, y    Logical display coordinates
+ * @param pressed Pressed (true) or released (false)
+ * @return
+ *      - true:  Sample queued
+ *      - false: No touch device registered or injection queue full
+ */
+bool lvgl_port_touch_inject(uint16_t x, uint16_t y, bool pressed);
 #endif
 
+/**
+ * @brief Get touch sampling statistics
+ *
+ * @param[out] stats Statistics since boot (zeroed when no touch device is registered)
+ */
+void lvgl_port_touch_get_stats(lvgl_port_touch_stats_t *stats);
+
 /**
  * @brief Take LVGL mutex
  *
@@ -159,6 +229,15 @@ bool lvgl_port_lock(uint32_t timeout_ms);
  */
 void lvgl_port_unlock(void);
 
+/**
+ * @brief Check if the caller runs in the LVGL task
+ *
+ * @return
+ *      - true:  Called from the LVGL task (always true in single-threaded mode)
+ *      - false: Called from another task
+ */
+bool lvgl_port_in_lvgl_task(void);
+
 #ifdef __cplusplus
 }
 #endif
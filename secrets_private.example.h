@@ -35,6 +35,13 @@ extern const char* API_TOKEN;
 // WiFiManager AP Password (for configuration portal)
 #define WIFIMANAGER_AP_PASSWORD "your_ap_password"
 
+// Optional static IP (skips DHCP on every connect). Leave undefined to use
+// DHCP; the last lease is then reused for up to an hour on reconnect.
+// #define WIFI_STATIC_IP      "192.168.1.50"
+// #define WIFI_STATIC_GATEWAY "192.168.1.1"
+// #define WIFI_STATIC_SUBNET  "255.255.255.0"
+// #define WIFI_STATIC_DNS     "192.168.1.1"
+
 // --- CERTIFICATES ---
 
 // Certificate for secure MQTT connection (port 9735)
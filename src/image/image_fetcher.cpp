@@ -6,8 +6,11 @@
 #include <WiFiClientSecure.h>
 
 #include "secrets_private.h"
+#include "../net/net_metrics.h"
 #include "../net/net_module.h"
+#include "lv_port.h"
 #include "ui.h"
+#include "../ui/ui_dispatch.h"  // App task <-> LVGL thread hand-off
 #include "../ui_custom.h"  // Custom UI extensions (not overwritten by SquareLine Studio)
 #include "../screen/screen_power.h"  // Screen power management
 #include "../time/time_service.h"  // For pausing timer during image display
@@ -67,6 +70,8 @@ static bool requestImage(const char* endpoint_type);
 static void processHTTPResponse();
 static bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap);
 static void button2_pressed_handler(lv_event_t* e);
+static void startRequestOnApp(void* ctx);
+static void releaseImageResourcesOnApp(void* ctx);
 
 
 // External dependencies
@@ -123,19 +128,20 @@ static void cleanupImageRequest() {
   cleanupInProgress = true;
   httpState = HTTP_IDLE;  // Set state early to prevent further processing
 
-  // Reset back button state
+  // 1. Hide image and reset back button state before freeing buffers
+  //    (avoids LVGL accessing freed memory)
+  lvgl_port_lock(0);
   ui_Screen2_setImageDisplayed(false);
+  if (cfg.imgScreen2Background) {
+    lv_obj_set_style_opa(cfg.imgScreen2Background, LV_OPA_TRANSP, LV_PART_MAIN);
+  }
+  lvgl_port_unlock();
 
-  // 1. Stop HTTP connections
+  // 2. Stop HTTP connections (outside the LVGL lock: delay() must not stall rendering)
   httpClient.end();
   httpsClient.stop();
   delay(100);  // Give WiFi stack time to properly close connections
 
-  // 2. Hide image if it exists to avoid LVGL accessing freed memory
-  if (cfg.imgScreen2Background) {
-    lv_obj_set_style_opa(cfg.imgScreen2Background, LV_OPA_TRANSP, LV_PART_MAIN);
-  }
-
   // 3. Free buffers
   if (jpeg_buffer_psram) {
     free(jpeg_buffer_psram);
@@ -169,18 +175,23 @@ static void returnToScreen1(const char* reason) {
   screen2TimeoutActive = false;
   imageDisplayTimeoutActive = false;
 
+  lvgl_port_lock(0);
   time_service_resume();
   if (ui_previous_screen) {
     lv_disp_load_scr(ui_previous_screen);
   } else if (cfg.screen1) {
     lv_disp_load_scr(cfg.screen1);
   }
+  lvgl_port_unlock();
 }
 
 //***************************************************************************************************
 static void prepareForRequest() {
   cleanupImageRequest();
 
+  // Screen transition is a structural LVGL change: hold the lock (no-op single-threaded)
+  lvgl_port_lock(0);
+
   // Pause time service timer to prevent LVGL conflicts during image display
   time_service_pause();
 
@@ -213,6 +224,8 @@ static void prepareForRequest() {
   // Force an immediate UI refresh so the rotation and "Loading" state are visible
   // BEFORE we potentially block on the network request in the next loop.
   lv_refr_now(NULL);
+
+  lvgl_port_unlock();
 }
 
 //***************************************************************************************************
@@ -394,6 +407,7 @@ static void processHTTPResponse() {
       unsigned long downloadTime = millis() - httpRequestStartTime;
       USBSerial.printf("Image downloaded: %d bytes in %lums. Decoding...\n",
                        jpeg_bytes_received, downloadTime);
+      netMetricsRecordImage(jpeg_bytes_received, downloadTime);
       httpClient.end();
       httpState = HTTP_DECODING;
     }
@@ -465,7 +479,16 @@ static void processHTTPResponse() {
     img_dsc.data_size = cfg.screenWidth * cfg.screenHeight * LV_COLOR_DEPTH / 8;
     img_dsc.data = reinterpret_cast<const uint8_t*>(image_buffer_psram);
 
-    // Update LVGL image (single-threaded mode, no lock needed)
+    // Update LVGL image under the lock (no-op in single-threaded mode)
+    lvgl_port_lock(0);
+
+    // Screen2 may have been unloaded by the LVGL thread while decoding (task mode)
+    if (httpState != HTTP_DECODING) {
+      lvgl_port_unlock();
+      USBSerial.println("Screen2 unloaded during decode, discarding image.");
+      return;
+    }
+
     if (cfg.imgScreen2Background) {
       lv_img_set_src(cfg.imgScreen2Background, &img_dsc);
       lv_obj_set_style_opa(cfg.imgScreen2Background, LV_OPA_COVER, LV_PART_MAIN);
@@ -488,6 +511,8 @@ static void processHTTPResponse() {
       }, 500, NULL);  // 500ms delay
     }
 
+    lvgl_port_unlock();
+
     httpState = HTTP_COMPLETE;
     requestInProgress = false;
     screen2TimeoutActive = false;
@@ -527,37 +552,45 @@ bool requestLatestImage() {
   return true;
 }
 
+//***************************************************************************************************
+// Start an image request on the app task (HTTP client is only used there)
+static void startRequestOnApp(void* ctx) {
+  const char* endpoint = static_cast<const char*>(ctx);
+
+  if (strcmp(endpoint, "latest") == 0) {
+    requestLatestImage();
+    return;
+  }
+
+  if (!isWifiAvailable()) {
+    USBSerial.printf("%s button clicked but WiFi not available (recovering)\n", endpoint);
+    return;
+  }
+  prepareForRequest();
+  pendingEndpoint = endpoint;
+}
+
 //***************************************************************************************************
 void buttonLatest_event_handler(lv_event_t* e) {
   if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
     USBSerial.println("Button: latest");
-    requestLatestImage();
+    ui_dispatch_to_app(startRequestOnApp, const_cast<char*>("latest"));
   }
 }
 
 //***************************************************************************************************
 void buttonNew_event_handler(lv_event_t* e) {
   if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
-    if (!isWifiAvailable()) {
-      USBSerial.println("New button clicked but WiFi not available (recovering)");
-      return;
-    }
     USBSerial.println("Button: new");
-    prepareForRequest();
-    pendingEndpoint = "new";
+    ui_dispatch_to_app(startRequestOnApp, const_cast<char*>("new"));
   }
 }
 
 //***************************************************************************************************
 void buttonBack_event_handler(lv_event_t* e) {
   if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
-    if (!isWifiAvailable()) {
-      USBSerial.println("Back button clicked but WiFi not available (recovering)");
-      return;
-    }
     USBSerial.println("Button: back");
-    prepareForRequest();
-    pendingEndpoint = "back";
+    ui_dispatch_to_app(startRequestOnApp, const_cast<char*>("back"));
   }
 }
 
@@ -587,10 +620,9 @@ void screen2_event_handler(lv_event_t* e) {
       imageDisplayTimeoutActive = false;
     }
   } else if (code == LV_EVENT_SCREEN_UNLOAD_START) {
-    // Screen 2 unloading — stop HTTP and free buffers
+    // Screen 2 unloading — hide the image now, stop HTTP and free buffers on the app task
 
-    // Set cleanup flag FIRST to stop any buffer access
-    cleanupInProgress = true;
+    // Stop any further receive/decode processing
     httpState = HTTP_IDLE;
     screen2TimeoutActive = false;
     imageDisplayTimeoutActive = false;
@@ -604,23 +636,9 @@ void screen2_event_handler(lv_event_t* e) {
       lv_obj_add_flag(ui_Button2, LV_OBJ_FLAG_CLICKABLE);
     }
 
-    // Stop HTTP connections
-    httpClient.end();
-    httpsClient.stop();
-
     if (cfg.imgScreen2Background) {
       lv_obj_set_style_opa(cfg.imgScreen2Background, LV_OPA_TRANSP, LV_PART_MAIN);
     }
-    if (image_buffer_psram != nullptr) {
-      free(image_buffer_psram);
-      image_buffer_psram = nullptr;
-    }
-    if (jpeg_buffer_psram != nullptr) {
-      free(jpeg_buffer_psram);
-      jpeg_buffer_psram = nullptr;
-    }
-    memset(&img_dsc, 0, sizeof(lv_img_dsc_t));
-    requestInProgress = false;
 
     // NOTE: No rotation change needed - display stays at 90° throughout.
     // Toggling rotation during screen transitions causes display corruption.
@@ -628,7 +646,34 @@ void screen2_event_handler(lv_event_t* e) {
     // Resume time service timer now that we're returning to Screen1
     time_service_resume();
 
-    // Clear cleanup flag
-    cleanupInProgress = false;
+    ui_dispatch_to_app(releaseImageResourcesOnApp, nullptr);
+  }
+}
+
+//***************************************************************************************************
+// Stop HTTP and free image buffers after Screen2 unloads (runs on the app task)
+static void releaseImageResourcesOnApp(void* ctx) {
+  (void)ctx;
+
+  // Set cleanup flag FIRST to stop any buffer access
+  cleanupInProgress = true;
+  httpState = HTTP_IDLE;
+
+  // Stop HTTP connections
+  httpClient.end();
+  httpsClient.stop();
+
+  if (image_buffer_psram != nullptr) {
+    free(image_buffer_psram);
+    image_buffer_psram = nullptr;
+  }
+  if (jpeg_buffer_psram != nullptr) {
+    free(jpeg_buffer_psram);
+    jpeg_buffer_psram = nullptr;
   }
+  memset(&img_dsc, 0, sizeof(lv_img_dsc_t));
+  requestInProgress = false;
+
+  // Clear cleanup flag
+  cleanupInProgress = false;
 }
@@ -0,0 +1,280 @@
+#include "light_grid.h"
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "lv_port.h"
+#include "light_service.h"
+#include "../perf/latency_probe.h"
+#include "../registry/entity_registry.h"
+#include "../screen/screen_power.h"
+#include "../ui/ui_dispatch.h"
+
+static_assert(LIGHT_GRID_MAX_TILES >= REGISTRY_MAX_LIGHTS, "one tile per registry light");
+static_assert(LIGHT_GRID_MAX_TILES <= 32, "dirty tiles are a 32-bit mask");
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+constexpr lv_coord_t MARGIN = 8;
+constexpr lv_coord_t GAP = 8;
+constexpr lv_coord_t HEADER_HEIGHT = 48;
+constexpr lv_coord_t MAX_TILE_HEIGHT = 120;
+constexpr uint32_t NO_VALUE = 0xFFFFFFFF;        // Tile not set since it was created
+constexpr uint32_t RENDER_FULL_GRID = 0xFFFFFFFF; // Next render is the whole grid (screen load)
+
+// Widgets: created and deleted under the LVGL lock, used on the LVGL thread
+lv_obj_t* gridScreen = nullptr;
+lv_obj_t* defaultReturn = nullptr;
+lv_obj_t* returnTo = nullptr;
+lv_obj_t* tiles[LIGHT_GRID_MAX_TILES] = {};
+lv_obj_t* stateLabels[LIGHT_GRID_MAX_TILES] = {};
+size_t tileCount = 0;
+
+// App task -> LVGL thread: latest value per tile (color RGB | state << 24) and
+// the tiles changed since the last batch. One batch call is queued at a time.
+std::atomic<uint32_t> tileValue[LIGHT_GRID_MAX_TILES];
+std::atomic<uint32_t> dirtyMask{0};
+std::atomic<bool> batchQueued{false};
+
+// LVGL thread: tiles restyled since the last rendered frame
+uint32_t renderTilesPending = 0;
+
+unsigned long lastTapTime = 0;
+
+LightGridStats stats = {};
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+const char* stateText(LightTileState state) {
+    switch (state) {
+        case LightTileState::ON:  return "ON";
+        case LightTileState::OFF: return "OFF";
+        default:                  return "?";
+    }
+}
+
+// LVGL thread: restyle one tile (background and state label only - fixed
+// sizes and absolute positions, so nothing outside the tile is invalidated)
+bool applyTile(size_t i) {
+    uint32_t v = tileValue[i].load(std::memory_order_acquire);
+    if (v == NO_VALUE) return false;
+
+    latency_probe_on_widget_update(tiles[i]);
+    lv_obj_set_style_bg_color(tiles[i], lv_color_hex(v & 0xFFFFFF), LV_PART_MAIN);
+    const char* text = stateText(static_cast<LightTileState>(v >> 24));
+    if (strcmp(lv_label_get_text(stateLabels[i]), text) != 0) {
+        lv_label_set_text(stateLabels[i], text);
+    }
+    return true;
+}
+
+// LVGL thread (ui_dispatch_call): every tile marked since the last batch, in one pass
+void applyBatchOnLvgl(void* ctx) {
+    (void)ctx;
+    // Cleared first: a tile marked from here on queues the next batch
+    batchQueued.store(false, std::memory_order_release);
+    uint32_t mask = dirtyMask.exchange(0, std::memory_order_acq_rel);
+
+    uint32_t applied = 0;
+    while (mask) {
+        size_t i = __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (i < tileCount && applyTile(i)) applied++;
+    }
+    if (!applied) return;
+
+    stats.batches++;
+    stats.tilesApplied += applied;
+    if (applied > stats.maxBatch) stats.maxBatch = applied;
+    if (lv_scr_act() == gridScreen && renderTilesPending != RENDER_FULL_GRID) {
+        renderTilesPending += applied;
+    }
+}
+
+void postBatch() {
+    if (batchQueued.exchange(true, std::memory_order_acq_rel)) return;
+    if (!ui_dispatch_call(applyBatchOnLvgl, nullptr)) {
+        batchQueued.store(false, std::memory_order_release);   // Retried by light_grid_loop()
+    }
+}
+
+// Runs on the app task (see ui_dispatch_to_app)
+void toggleTileOnApp(void* ctx) {
+    light_service_toggle(static_cast<size_t>(reinterpret_cast<uintptr_t>(ctx)));
+}
+
+void tileClicked(lv_event_t* e) {
+    screenPowerActivity();
+    unsigned long now = millis();
+    if (now - lastTapTime < LIGHT_GRID_TAP_DEBOUNCE_MS) return;
+    lastTapTime = now;
+
+    uintptr_t i = reinterpret_cast<uintptr_t>(lv_event_get_user_data(e));
+    latency_probe_begin(tiles[i]);   // Optimistic toggle: the tile changes on the next frame
+    ui_dispatch_to_app(toggleTileOnApp, reinterpret_cast<void*>(i));
+}
+
+void backClicked(lv_event_t* e) {
+    (void)e;
+    screenPowerActivity();
+    lv_scr_load(returnTo ? returnTo : defaultReturn);
+}
+
+// Under the LVGL lock: one tile per registry light, in rows of LIGHT_GRID_COLUMNS
+void buildTiles() {
+    for (size_t i = 0; i < tileCount; i++) {
+        lv_obj_del(tiles[i]);
+        tiles[i] = nullptr;
+        stateLabels[i] = nullptr;
+    }
+    dirtyMask.store(0, std::memory_order_relaxed);
+    tileCount = entity_registry_light_count();
+    if (tileCount > LIGHT_GRID_MAX_TILES) tileCount = LIGHT_GRID_MAX_TILES;
+    stats.tiles = tileCount;
+    if (!tileCount) return;
+
+    size_t columns = tileCount < LIGHT_GRID_COLUMNS ? tileCount : LIGHT_GRID_COLUMNS;
+    size_t rows = (tileCount + columns - 1) / columns;
+    lv_coord_t width = lv_disp_get_hor_res(nullptr) - 2 * MARGIN;
+    lv_coord_t height = lv_disp_get_ver_res(nullptr) - HEADER_HEIGHT - MARGIN;
+    lv_coord_t tileW = (width - (columns - 1) * GAP) / columns;
+    lv_coord_t tileH = (height - (rows - 1) * GAP) / rows;
+    if (tileH > MAX_TILE_HEIGHT) tileH = MAX_TILE_HEIGHT;
+
+    for (size_t i = 0; i < tileCount; i++) {
+        tileValue[i].store(NO_VALUE, std::memory_order_relaxed);
+
+        lv_obj_t* tile = lv_btn_create(gridScreen);
+        lv_obj_set_size(tile, tileW, tileH);
+        lv_obj_set_pos(tile, MARGIN + (i % columns) * (tileW + GAP),
+                       HEADER_HEIGHT + (i / columns) * (tileH + GAP));
+        lv_obj_clear_flag(tile, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_set_style_bg_color(tile, lv_color_hex(0x800080), LV_PART_MAIN);
+        lv_obj_add_event_cb(tile, tileClicked, LV_EVENT_CLICKED, reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+
+        lv_obj_t* name = lv_label_create(tile);
+        lv_obj_set_width(name, tileW - 12);
+        lv_label_set_long_mode(name, LV_LABEL_LONG_DOT);
+        lv_obj_set_style_text_align(name, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+        lv_obj_set_style_text_font(name, &lv_font_montserrat_16, LV_PART_MAIN);
+        lv_obj_align(name, LV_ALIGN_TOP_MID, 0, 0);
+        lv_label_set_text(name, entity_registry_light(i).name);
+
+        // Fixed width: a new state never resizes the label
+        lv_obj_t* state = lv_label_create(tile);
+        lv_obj_set_width(state, tileW - 12);
+        lv_obj_set_style_text_align(state, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+        lv_obj_set_style_text_font(state, &lv_font_montserrat_20, LV_PART_MAIN);
+        lv_obj_align(state, LV_ALIGN_BOTTOM_MID, 0, 0);
+        lv_label_set_text(state, stateText(LightTileState::UNKNOWN));
+
+        tiles[i] = tile;
+        stateLabels[i] = state;
+    }
+    if (lv_scr_act() == gridScreen) renderTilesPending = RENDER_FULL_GRID;
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void light_grid_init(lv_obj_t* returnScreen) {
+    for (size_t i = 0; i < LIGHT_GRID_MAX_TILES; i++) {
+        tileValue[i].store(NO_VALUE, std::memory_order_relaxed);
+    }
+
+    lvgl_port_lock(0);
+    defaultReturn = returnScreen;
+    gridScreen = lv_obj_create(nullptr);
+    lv_obj_clear_flag(gridScreen, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_bg_color(gridScreen, lv_color_hex(0x000000), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(gridScreen, LV_OPA_COVER, LV_PART_MAIN);
+
+    lv_obj_t* back = lv_btn_create(gridScreen);
+    lv_obj_set_size(back, 100, 36);
+    lv_obj_set_pos(back, MARGIN, 6);
+    lv_obj_set_style_bg_color(back, lv_color_hex(0x5B5B5B), LV_PART_MAIN);
+    lv_obj_add_event_cb(back, backClicked, LV_EVENT_CLICKED, nullptr);
+    lv_obj_t* backLabel = lv_label_create(back);
+    lv_label_set_text(backLabel, LV_SYMBOL_LEFT " Back");
+    lv_obj_center(backLabel);
+
+    lv_obj_t* title = lv_label_create(gridScreen);
+    lv_label_set_text(title, "Lights");
+    lv_obj_set_style_text_font(title, &lv_font_montserrat_20, LV_PART_MAIN);
+    lv_obj_set_style_text_color(title, lv_color_white(), LV_PART_MAIN);
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 14);
+
+    buildTiles();
+    lvgl_port_unlock();
+
+    Serial.printf("Light grid: %u tiles\n", (unsigned)tileCount);
+}
+
+void light_grid_rebuild() {
+    if (!gridScreen) return;
+    lvgl_port_lock(0);
+    buildTiles();
+    lvgl_port_unlock();
+    Serial.printf("Light grid: rebuilt with %u tiles\n", (unsigned)tileCount);
+}
+
+void light_grid_set_tile(size_t i, lv_color_t color, LightTileState state) {
+    if (i >= LIGHT_GRID_MAX_TILES) return;
+    uint32_t v = (lv_color_to32(color) & 0xFFFFFF) | (static_cast<uint32_t>(state) << 24);
+    if (tileValue[i].exchange(v, std::memory_order_acq_rel) == v) return;   // Nothing to redraw
+
+    stats.updates++;
+    uint32_t bit = 1u << i;
+    if (dirtyMask.fetch_or(bit, std::memory_order_acq_rel) & bit) {
+        stats.coalesced++;   // Already dirty: the batch picks up the latest value
+        return;
+    }
+    postBatch();
+}
+
+void light_grid_show() {
+    if (!gridScreen || lv_scr_act() == gridScreen) return;
+    returnTo = lv_scr_act();
+    renderTilesPending = RENDER_FULL_GRID;
+    lv_scr_load(gridScreen);
+}
+
+void light_grid_loop() {
+    if (dirtyMask.load(std::memory_order_acquire) && !batchQueued.load(std::memory_order_acquire)) {
+        postBatch();
+    }
+}
+
+LightGridStats light_grid_get_stats() {
+    return stats;
+}
+
+void light_grid_on_render(uint32_t time_ms, uint32_t pixels) {
+    if (!renderTilesPending) return;
+    if (lv_scr_act() != gridScreen) {
+        renderTilesPending = 0;
+        return;
+    }
+
+    if (renderTilesPending == RENDER_FULL_GRID) {
+        stats.fullRenderMs = time_ms;
+        stats.fullRenderPx = pixels;
+    } else {
+        stats.renders++;
+        stats.lastRenderMs = time_ms;
+        stats.lastRenderPx = pixels;
+        stats.lastRenderTiles = renderTilesPending;
+        stats.renderMsTotal += time_ms;
+        stats.renderTilesTotal += renderTilesPending;
+    }
+    renderTilesPending = 0;
+}
@@ -0,0 +1,73 @@
+// Light Grid Screen
+// Every light of the entity registry as a tile (name, state, button color), tap to toggle
+// Opened with a long press on the light select button, Back returns to the previous screen
+// Tile changes are batched: the app task marks tiles dirty, the LVGL thread restyles
+// only those tiles in one pass per frame (one dispatch call however many messages arrive)
+// Render cost is attributed per batch through the display monitor callback
+
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hook - LVGL thread (lv_port.c monitor callback, after perf_monitor_record_render)
+void light_grid_on_render(uint32_t time_ms, uint32_t pixels);
+
+#ifdef __cplusplus
+}
+
+// Configuration constants
+constexpr size_t LIGHT_GRID_MAX_TILES = 16;     // REGISTRY_MAX_LIGHTS
+constexpr uint8_t LIGHT_GRID_COLUMNS = 4;
+constexpr uint32_t LIGHT_GRID_TAP_DEBOUNCE_MS = 500;
+
+enum class LightTileState : uint8_t {
+    UNKNOWN,
+    ON,
+    OFF
+};
+
+// Cumulative since boot
+struct LightGridStats {
+    uint32_t tiles;             // Tiles on the grid
+    uint32_t updates;           // Tile changes requested by the app task
+    uint32_t coalesced;         // Landed on a tile already dirty for this frame
+    uint32_t batches;           // LVGL passes (at most one per frame)
+    uint32_t tilesApplied;      // Tiles restyled by those passes
+    uint32_t maxBatch;          // Most tiles restyled in one pass
+    uint32_t renders;           // Frames rendered after a batch while the grid was shown
+    uint32_t lastRenderMs;
+    uint32_t lastRenderPx;
+    uint32_t lastRenderTiles;
+    uint64_t renderMsTotal;     // Over those frames (per-tile cost = renderMsTotal / renderTilesTotal)
+    uint64_t renderTilesTotal;
+    uint32_t fullRenderMs;      // Whole grid (screen load), all tiles
+    uint32_t fullRenderPx;
+};
+
+// Create the grid screen and one tile per light (app task, takes the LVGL lock)
+// returnScreen: where Back goes when the grid was not opened from another screen
+void light_grid_init(lv_obj_t* returnScreen);
+
+// Recreate the tiles after the registry changed (app task, takes the LVGL lock)
+void light_grid_rebuild();
+
+// New state for tile i (app task); applied on the next frame with the other dirty tiles
+void light_grid_set_tile(size_t i, lv_color_t color, LightTileState state);
+
+// Show the grid (LVGL thread)
+void light_grid_show();
+
+// Re-post a batch the dispatch ring could not take (call from loop())
+void light_grid_loop();
+
+LightGridStats light_grid_get_stats();
+#endif
+
+#endif // LIGHT_GRID_H
@@ -1,45 +1,24 @@
 #include "light_service.h"
 
-#include <Preferences.h>
+#include "lv_port.h"
+#include "light_grid.h"
+#include "../net/json_scan.h"
+#include "../net/net_module.h"
+#include "../registry/entity_registry.h"
+#include "../storage/settings_store.h"
+#include "../ui/ui_dispatch.h"
+#include "../perf/latency_probe.h"
 
 // ============================================================================
-// MQTT Payload Constants
+// MQTT Constants
 // ============================================================================
+// Light names and payloads come from the entity registry (src/registry/)
 
-// Toggle command payloads (published to toggle a light)
-static const char PAYLOAD_CUI[] = "cuisine";
-static const char PAYLOAD_SAL[] = "salon";
-static const char PAYLOAD_STA[] = "statue";
-static const char PAYLOAD_GAL[] = "galerie";
-static const char PAYLOAD_PIS[] = "piscine";
-static const char PAYLOAD_BJP[] = "bureaujp";  // 4 lights all following this pattern in Node-RED
 static const char PAYLOAD_STATUS[] = "status";
-static const char PAYLOAD_CJP[] = "chambrejp";
-
-// Status payloads (received from Node-RED)
-static const char CUISINE_ON[]  = "cu_on";
-static const char CUISINE_OFF[] = "cu_of";
-static const char SALON_ON[]    = "sa_on";
-static const char SALON_OFF[]   = "sa_of";
-static const char STATUE_ON[]   = "st_on";
-static const char STATUE_OFF[]  = "st_of";
-static const char GALERIE_ON[]  = "ga_on";
-static const char GALERIE_OFF[] = "ga_of";
-static const char PISCINE_ON[]  = "pi_on";
-static const char PISCINE_OFF[] = "pi_of";
-static const char BURJP_ON[]  = "bj_on";
-static const char BURJP_OFF[] = "bj_of";
-static const char CHAMBREJP_ON[]  = "cj_on";
-static const char CHAMBREJP_OFF[] = "cj_of";
 
 // MQTT topic for light commands and status
 static const char TOPIC_LIGHT[] = "m18toggle";
-
-// ============================================================================
-// Light Configuration - Single Source of Truth
-// ============================================================================
-// To add/remove lights, only modify this array and add the payload constants.
-// Everything else adapts automatically.
+static constexpr size_t MAX_PAYLOAD_LIGHT = 32;
 
 enum class LightState : uint8_t {
     UNKNOWN,
@@ -47,42 +26,40 @@ enum class LightState : uint8_t {
     OFF
 };
 
-struct LightMeta {
-    const char* description;       // Display name
-    const char* togglePayload;     // Sent to toggle
-    const char* statusOnPayload;   // Received when ON
-    const char* statusOffPayload;  // Received when OFF
-};
-
-static const LightMeta lightMeta[] = {
-    { "Cuisine",  PAYLOAD_CUI, CUISINE_ON,  CUISINE_OFF  },
-    { "Salon",    PAYLOAD_SAL, SALON_ON,    SALON_OFF    },
-    { "Statue",   PAYLOAD_STA, STATUE_ON,   STATUE_OFF   },
-    { "Galerie",  PAYLOAD_GAL, GALERIE_ON,  GALERIE_OFF  },
-    { "Piscine",  PAYLOAD_PIS, PISCINE_ON,  PISCINE_OFF  },
-    { "Bureau JP",PAYLOAD_BJP, BURJP_ON,    BURJP_OFF    },   
-    { "Chambre JP",PAYLOAD_CJP, CHAMBREJP_ON, CHAMBREJP_OFF  }, 
-};
-
-static constexpr size_t LIGHT_COUNT = sizeof(lightMeta) / sizeof(lightMeta[0]);
-
 // ============================================================================
 // Module State
 // ============================================================================
 
 namespace {
 
-// NVS configuration
-constexpr const char* NVS_NAMESPACE = "homepanel";
-constexpr const char* NVS_KEY_LIGHT_IDX = "light_idx";
-constexpr unsigned long NVS_DEBOUNCE_MS = 30000;  // 30 seconds
+// Settings key (written by the settings store's deferred flush)
+constexpr const char* SETTING_LIGHT_IDX = "light_idx";
 
-// Light states (derived from MQTT, not persisted)
-LightState lightStates[LIGHT_COUNT] = {};  // All UNKNOWN (0)
+// Light states (derived from MQTT, not persisted): last state reported by Node-RED
+LightState lightStates[REGISTRY_MAX_LIGHTS] = {};  // All UNKNOWN (0)
+
+// Optimistic toggles: shown right away, confirmed by the echo or rolled back
+struct PendingToggle {
+    bool active;
+    LightState expected;        // State shown while pending
+    uint8_t outstanding;        // Toggles sent and not yet echoed
+    unsigned long sentAt;       // Latest toggle; the deadline runs from here
+};
+
+PendingToggle pending[REGISTRY_MAX_LIGHTS] = {};
+LightToggleStats toggleStats = {};
+
+// Rollback cue: the light button flashes red, then shows the reported state
+size_t cueLight = 0;
+unsigned long cueUntil = 0;
+bool cueActive = false;
 
 // Current selected light index
 size_t currentLight = 0;
 
+// Registry the states above are indexed by
+uint32_t registryGeneration = 0;
+
 // LVGL object pointers
 lv_obj_t* btnSelect = nullptr;
 lv_obj_t* btnLight = nullptr;
@@ -90,42 +67,25 @@ lv_obj_t* labelLight = nullptr;
 lv_obj_t* imgOn = nullptr;
 lv_obj_t* imgOff = nullptr;
 
-// MQTT client pointer (for publishing)
-PubSubClient* mqtt = nullptr;
-
-// NVS debounce state
-unsigned long lastSelectionChangeTime = 0;
-bool nvsSavePending = false;
-size_t pendingLight = 0;
-size_t lastSavedLight = 0;
-
-Preferences preferences;
-
 // ============================================================================
 // Internal Functions
 // ============================================================================
 
-void loadLightFromNVS() {
-    preferences.begin(NVS_NAMESPACE, true);  // read-only
-    int savedIdx = preferences.getInt(NVS_KEY_LIGHT_IDX, 0);
-    preferences.end();
+void loadSavedLight() {
+    int32_t savedIdx = settingsGetInt(SETTING_LIGHT_IDX, 0);
 
-    if (savedIdx >= 0 && savedIdx < static_cast<int>(LIGHT_COUNT)) {
+    if (savedIdx >= 0 && savedIdx < static_cast<int>(entity_registry_light_count())) {
         currentLight = static_cast<size_t>(savedIdx);
     } else {
         currentLight = 0;
     }
-    lastSavedLight = currentLight;
-    Serial.printf("Light service: loaded index %d (%s) from NVS\n",
-                  currentLight, lightMeta[currentLight].description);
+    Serial.printf("Light service: loaded index %d (%s) from settings\n",
+                  currentLight, entity_registry_light(currentLight).name);
 }
 
-void saveLightToNVS(size_t idx) {
-    preferences.begin(NVS_NAMESPACE, false);  // read-write
-    preferences.putInt(NVS_KEY_LIGHT_IDX, static_cast<int>(idx));
-    preferences.end();
-    Serial.printf("Light service: saved index %d (%s) to NVS\n",
-                  idx, lightMeta[idx].description);
+// State shown on the UI: the optimistic one while a toggle is pending
+LightState displayState(size_t i) {
+    return pending[i].active ? pending[i].expected : lightStates[i];
 }
 
 lv_color_t getLightColor(LightState state) {
@@ -137,36 +97,119 @@ lv_color_t getLightColor(LightState state) {
     }
 }
 
+// Button / tile color of light i: the rollback cue wins over the state
+lv_color_t shownColor(size_t i) {
+    bool cue = cueActive && cueLight == i;
+    return cue ? lv_color_hex(0xB00020) : getLightColor(displayState(i));
+}
+
 void updateUI() {
-    const LightMeta& meta = lightMeta[currentLight];
-    LightState state = lightStates[currentLight];
+    const LightEntity& meta = entity_registry_light(currentLight);
+    LightState state = displayState(currentLight);
 
     // Update light name label
-    if (labelLight) {
-        lv_label_set_text(labelLight, meta.description);
-    }
+    ui_dispatch_label_text(labelLight, meta.name);
 
     // Update button background color based on light state
-    if (btnLight) {
-        lv_obj_set_style_bg_color(btnLight, getLightColor(state), LV_PART_MAIN);
-    }
+    ui_dispatch_bg_color(btnLight, shownColor(currentLight));
 
     // Update ON/OFF images based on light state
-    switch (state) {
-        case LightState::ON:
-            if (imgOn) lv_obj_clear_flag(imgOn, LV_OBJ_FLAG_HIDDEN);
-            if (imgOff) lv_obj_add_flag(imgOff, LV_OBJ_FLAG_HIDDEN);
-            break;
-        case LightState::OFF:
-            if (imgOn) lv_obj_add_flag(imgOn, LV_OBJ_FLAG_HIDDEN);
-            if (imgOff) lv_obj_clear_flag(imgOff, LV_OBJ_FLAG_HIDDEN);
-            break;
-        case LightState::UNKNOWN:
-        default:
-            if (imgOn) lv_obj_add_flag(imgOn, LV_OBJ_FLAG_HIDDEN);
-            if (imgOff) lv_obj_add_flag(imgOff, LV_OBJ_FLAG_HIDDEN);
-            break;
+    ui_dispatch_hidden(imgOn, state != LightState::ON);
+    ui_dispatch_hidden(imgOff, state != LightState::OFF);
+}
+
+// Light i changed: its grid tile (batched per frame), and Screen1 if it is the selected light
+void refreshLight(size_t i) {
+    LightState state = displayState(i);
+    light_grid_set_tile(i, shownColor(i),
+                        state == LightState::ON ? LightTileState::ON :
+                        state == LightState::OFF ? LightTileState::OFF : LightTileState::UNKNOWN);
+    if (i == currentLight) {
+        updateUI();
+    }
+}
+
+// Reported state for light i (echo, status reply or snapshot): settles a pending toggle
+void reconcile(size_t i, LightState reported) {
+    lightStates[i] = reported;
+    PendingToggle& p = pending[i];
+    if (!p.active) return;
+
+    if (p.outstanding > 1 || reported != p.expected) {
+        // Echo of an earlier toggle, or a reply sent before ours was handled:
+        // keep showing the expected state until its own echo or the deadline
+        toggleStats.outOfOrder++;
+        if (p.outstanding > 1) p.outstanding--;
+        Serial.printf("Light toggle: %s out-of-order echo (%s), still pending\n",
+                      entity_registry_light(i).name, reported == LightState::ON ? "ON" : "OFF");
+        return;
+    }
+    p.active = false;
+    toggleStats.confirmed++;
+    unsigned long took = millis() - p.sentAt;
+    toggleStats.lastConfirmMs = took;
+    Serial.printf("Light toggle: %s confirmed after %lu ms\n", entity_registry_light(i).name, took);
+}
+
+void rollBack(size_t i) {
+    pending[i].active = false;
+    toggleStats.rolledBack++;
+    Serial.printf("Light toggle: %s not confirmed within %lu ms, rolled back to %s\n",
+                  entity_registry_light(i).name, (unsigned long)LIGHT_CONFIRM_TIMEOUT_MS,
+                  lightStates[i] == LightState::ON ? "ON" :
+                  lightStates[i] == LightState::OFF ? "OFF" : "UNKNOWN");
+    cueLight = i;
+    cueUntil = millis() + LIGHT_ROLLBACK_CUE_MS;
+    cueActive = true;
+}
+
+// Registry replaced (retained topic): forget per-light state and ask Node-RED again
+void reloadLights() {
+    for (size_t i = 0; i < REGISTRY_MAX_LIGHTS; i++) {
+        lightStates[i] = LightState::UNKNOWN;
+        pending[i].active = false;
+    }
+    cueActive = false;
+    if (currentLight >= entity_registry_light_count()) {
+        currentLight = 0;
+    }
+    Serial.printf("Light service: registry reloaded, %u lights\n", (unsigned)entity_registry_light_count());
+    light_grid_rebuild();
+    for (size_t i = 0; i < entity_registry_light_count(); i++) {
+        refreshLight(i);
+    }
+    updateUI();
+    light_service_requestStatus();
+}
+
+// Event handler thunks - run on the app task (see ui_dispatch_to_app)
+void cycleLightOnApp(void* ctx) {
+    (void)ctx;
+    light_service_cycleLight();
+}
+
+void toggleCurrentOnApp(void* ctx) {
+    (void)ctx;
+    light_service_toggleCurrent();
+}
+
+// Long press on the select button (LVGL thread): open the grid, and keep the
+// click LVGL still sends on release from cycling the selection
+bool suppressSelectClick = false;
+
+void selectLongPressed(lv_event_t* e) {
+    if (lv_event_get_code(e) == LV_EVENT_PRESSED) {
+        suppressSelectClick = false;   // No click came after the last long press (dragged off)
+        return;
     }
+    suppressSelectClick = true;
+    light_grid_show();
+}
+
+// Topic router handler (app task)
+void onLightMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %.*s\n", topic, (int)payload.len, payload.data);
+    light_service_handleMQTT(payload.data, payload.len);
 }
 
 }  // namespace
@@ -176,96 +219,169 @@ void updateUI() {
 // ============================================================================
 
 void light_service_init(lv_obj_t* selectBtn, lv_obj_t* lightBtn,
-                        lv_obj_t* label, lv_obj_t* imageOn, lv_obj_t* imageOff,
-                        PubSubClient* mqttClient) {
+                        lv_obj_t* label, lv_obj_t* imageOn, lv_obj_t* imageOff) {
     btnSelect = selectBtn;
     btnLight = lightBtn;
     labelLight = label;
     imgOn = imageOn;
     imgOff = imageOff;
-    mqtt = mqttClient;
 
     // Initialize all light states to UNKNOWN
-    for (size_t i = 0; i < LIGHT_COUNT; i++) {
+    for (size_t i = 0; i < REGISTRY_MAX_LIGHTS; i++) {
         lightStates[i] = LightState::UNKNOWN;
     }
+    registryGeneration = entity_registry_generation();
+
+    // Load saved light index
+    loadSavedLight();
 
-    // Load saved light index from NVS
-    loadLightFromNVS();
+    // Status echoes from Node-RED
+    netSubscribe(TOPIC_LIGHT, onLightMessage, MAX_PAYLOAD_LIGHT);
 
     // Display initial state
     updateUI();
 
-    // Request current light status from Node-RED
-    light_service_requestStatus();
+    // Grid of every light, opened with a long press on the select button
+    light_grid_init(lv_obj_get_screen(btnSelect));
+    for (size_t i = 0; i < entity_registry_light_count(); i++) {
+        refreshLight(i);
+    }
+    lvgl_port_lock(0);
+    lv_obj_add_event_cb(btnSelect, selectLongPressed, LV_EVENT_PRESSED, nullptr);
+    lv_obj_add_event_cb(btnSelect, selectLongPressed, LV_EVENT_LONG_PRESSED, nullptr);
+    lvgl_port_unlock();
+
+    // Tap targets for the synthetic latency harness (/latency?tap=...)
+    latency_probe_register_target("light", btnLight);
+    latency_probe_register_target("select_light", btnSelect);
+
+    // Current states arrive with the status snapshot of the first MQTT session
 
     Serial.println("Light service initialized");
 }
 
 void light_service_requestStatus() {
-    if (mqtt && mqtt->connected()) {
-        mqtt->publish(TOPIC_LIGHT, PAYLOAD_STATUS);
+    // One pending request at most; sent on the next session if disconnected
+    if (netPublish(TOPIC_LIGHT, PAYLOAD_STATUS, OutboxPriority::LOW, "light_status")) {
         Serial.println("Light service: requested status from Node-RED");
     }
 }
 
-void light_service_handleMQTT(const char* payload) {
-    for (size_t i = 0; i < LIGHT_COUNT; i++) {
-        if (strcmp(payload, lightMeta[i].statusOnPayload) == 0) {
-            lightStates[i] = LightState::ON;
-            Serial.printf("Light status: %s = ON\n", lightMeta[i].description);
-            if (i == currentLight) {
-                updateUI();
-            }
-            return;
-        }
-        if (strcmp(payload, lightMeta[i].statusOffPayload) == 0) {
-            lightStates[i] = LightState::OFF;
-            Serial.printf("Light status: %s = OFF\n", lightMeta[i].description);
-            if (i == currentLight) {
-                updateUI();
-            }
-            return;
+void light_service_handleMQTT(const char* payload, size_t length) {
+    // One perfect-hash lookup whatever the number of lights (our "status" request is a miss)
+    EntityRef ref = entity_registry_find(EntityDomain::LIGHT_STATUS, payload, length);
+    if (ref.index < 0) return;
+
+    size_t i = static_cast<size_t>(ref.index);
+    Serial.printf("Light status: %s = %s\n", entity_registry_light(i).name, ref.on ? "ON" : "OFF");
+    reconcile(i, ref.on ? LightState::ON : LightState::OFF);
+    refreshLight(i);
+}
+
+void light_service_applySnapshot(const char* json, size_t length) {
+    JsonScanner scanner(json, length);
+    JsonMember member;
+    while (scanner.next(&member)) {
+        EntityRef ref = entity_registry_find(EntityDomain::LIGHT_TOGGLE, member.key, member.keyLen);
+        if (ref.index < 0) continue;
+
+        long number;
+        LightState state;
+        if (member.type == JsonType::BOOL) {
+            state = member.value[0] == 't' ? LightState::ON : LightState::OFF;
+        } else if (member.toInt(&number)) {
+            state = number ? LightState::ON : LightState::OFF;
+        } else {
+            continue;
         }
+        size_t i = static_cast<size_t>(ref.index);
+        reconcile(i, state);
+        refreshLight(i);   // Tiles are batched into one grid pass; Screen1 once (one current light)
+    }
+    if (scanner.failed()) {
+        Serial.println("Light service: malformed snapshot");
     }
+
+    Serial.printf("Light status: snapshot applied (%s = %s)\n", entity_registry_light(currentLight).name,
+                  displayState(currentLight) == LightState::ON ? "ON" :
+                  displayState(currentLight) == LightState::OFF ? "OFF" : "UNKNOWN");
 }
 
 void light_service_cycleLight() {
-    currentLight = (currentLight + 1) % LIGHT_COUNT;
+    currentLight = (currentLight + 1) % entity_registry_light_count();
 
-    Serial.printf("Light selection cycled to: %s\n", lightMeta[currentLight].description);
+    Serial.printf("Light selection cycled to: %s\n", entity_registry_light(currentLight).name);
 
     // Update UI immediately
     updateUI();
 
-    // Start/reset NVS debounce timer
-    lastSelectionChangeTime = millis();
-    nvsSavePending = true;
-    pendingLight = currentLight;
+    // Written on the settings store's next flush (repeated cycling is one write)
+    settingsSetInt(SETTING_LIGHT_IDX, static_cast<int32_t>(currentLight));
 }
 
 void light_service_toggleCurrent() {
-    if (!mqtt) {
-        Serial.println("Light service: MQTT client not available");
+    light_service_toggle(currentLight);
+}
+
+void light_service_toggle(size_t i) {
+    if (i >= entity_registry_light_count()) return;   // Tap queued before a registry change
+
+    // Queued through the outbox so a press during a reconnect is not lost.
+    // A toggle is not idempotent: a second press while the first is still
+    // queued withdraws it (no net change) rather than replacing it.
+    const char* payload = entity_registry_light(i).toggle;
+    if (netCancelPublish(payload)) {
+        Serial.printf("Light toggle: %s (%s) - cancelled the queued toggle\n",
+                      entity_registry_light(i).name, payload);
         return;
     }
-
-    const char* payload = lightMeta[currentLight].togglePayload;
-    bool success = mqtt->publish(TOPIC_LIGHT, payload);
+    bool connected = netIsMqttConnected();
+    bool queued = netPublish(TOPIC_LIGHT, payload, OutboxPriority::HIGH, payload);
 
     Serial.printf("Light toggle: %s (%s) - %s\n",
-                  lightMeta[currentLight].description, payload,
-                  success ? "sent" : "failed");
+                  entity_registry_light(i).name, payload,
+                  !queued ? "dropped" : connected ? "sent" : "queued");
+
+    // Optimistic only when the echo can come back soon: a queued toggle may be
+    // sent much later (or cancelled by the next press), an unknown state cannot be flipped
+    LightState shown = displayState(i);
+    if (!queued || !connected || shown == LightState::UNKNOWN) return;
+
+    PendingToggle& p = pending[i];
+    p.expected = shown == LightState::ON ? LightState::OFF : LightState::ON;
+    p.outstanding = p.active ? p.outstanding + 1 : 1;
+    p.sentAt = millis();
+    p.active = true;
+    toggleStats.optimistic++;
+    if (cueActive && cueLight == i) cueActive = false;
+    refreshLight(i);
+}
+
+LightToggleStats light_service_get_stats() {
+    return toggleStats;
 }
 
 void light_service_loop() {
-    // Handle NVS debounce save
-    if (nvsSavePending && (millis() - lastSelectionChangeTime >= NVS_DEBOUNCE_MS)) {
-        if (pendingLight != lastSavedLight) {
-            saveLightToNVS(pendingLight);
-            lastSavedLight = pendingLight;
+    unsigned long now = millis();
+
+    // New registry: indices may have moved, states are fetched again
+    if (registryGeneration != entity_registry_generation()) {
+        registryGeneration = entity_registry_generation();
+        reloadLights();
+    }
+
+    light_grid_loop();
+
+    // Roll back toggles Node-RED did not confirm in time
+    for (size_t i = 0; i < entity_registry_light_count(); i++) {
+        if (pending[i].active && now - pending[i].sentAt >= LIGHT_CONFIRM_TIMEOUT_MS) {
+            rollBack(i);
+            refreshLight(i);
         }
-        nvsSavePending = false;
+    }
+    if (cueActive && (long)(now - cueUntil) >= 0) {
+        cueActive = false;
+        refreshLight(cueLight);
     }
 }
 
@@ -274,10 +390,15 @@ void buttonSelectLight_event_handler(lv_event_t* e) {
     constexpr unsigned long CLICK_DEBOUNCE_MS = 500;
 
     if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
+        if (suppressSelectClick) {
+            suppressSelectClick = false;   // Release of the long press that opened the grid
+            return;
+        }
         unsigned long now = millis();
         if (now - lastClickTime >= CLICK_DEBOUNCE_MS) {
             lastClickTime = now;
-            light_service_cycleLight();
+            latency_probe_begin(btnLight);  // Name, color and icon change on the light button
+            ui_dispatch_to_app(cycleLightOnApp, nullptr);
         }
     }
 }
@@ -290,7 +411,8 @@ void buttonLight_event_handler(lv_event_t* e) {
         unsigned long now = millis();
         if (now - lastClickTime >= CLICK_DEBOUNCE_MS) {
             lastClickTime = now;
-            light_service_toggleCurrent();
+            latency_probe_begin(btnLight);  // Optimistic: changes color on the next frame
+            ui_dispatch_to_app(toggleCurrentOnApp, nullptr);
         }
     }
 }
@@ -2,50 +2,80 @@
 
 #include <Arduino.h>
 #include <lvgl.h>
-#include <PubSubClient.h>
 
 // ============================================================================
 // Light Control Service Module
 // ============================================================================
 // Provides cycling light control for multiple lights via MQTT.
-// Light status is received via MQTT, selected light index is persisted in NVS.
+// Light status is received via MQTT, selected light index is persisted in the settings store.
+// The lights and their payloads come from the entity registry; a new registry
+// is picked up by light_service_loop() (states are then requested again).
 //
 // Features:
 // - Cycle through lights with a select button
 // - Toggle the currently selected light via MQTT
 // - Visual feedback: yellow (ON), dark grey (OFF), purple (UNKNOWN)
-// - NVS persistence of selected light index (with 30-second debounce)
+// - Optimistic toggles: the new state is shown right away and kept pending
+//   until Node-RED echoes it; without a matching echo within
+//   LIGHT_CONFIRM_TIMEOUT_MS the reported state is restored and the button
+//   flashes red for LIGHT_ROLLBACK_CUE_MS
+// - Grid screen with every light (src/light/light_grid), opened with a long
+//   press on the select button; tiles are refreshed with the same states
+// - Selected light index persisted through the settings store (deferred flush)
 // ============================================================================
 
+constexpr uint32_t LIGHT_CONFIRM_TIMEOUT_MS = 4000;
+constexpr uint32_t LIGHT_ROLLBACK_CUE_MS = 800;
+
+// Optimistic toggle counters (cumulative since boot)
+struct LightToggleStats {
+    uint32_t optimistic;        // Toggles shown before the echo
+    uint32_t confirmed;         // Settled by the matching echo
+    uint32_t rolledBack;        // Deadline passed without it
+    uint32_t outOfOrder;        // Reports that did not match a pending toggle (earlier echo, stale reply)
+    uint32_t lastConfirmMs;     // Toggle to echo, last confirmed
+};
+
 // Initialize light service
-// Pass pointers to LVGL objects created in SquareLine Studio and the MQTT client:
+// Pass pointers to LVGL objects created in SquareLine Studio:
 // - selectBtn: button to cycle through lights (ButtonSelectLight)
 // - lightBtn: button to toggle current light (ButtonLight)
 // - label: displays the selected light name (lightLabel)
 // - imgOn: image shown when light is ON (lightONImage)
 // - imgOff: image shown when light is OFF (lightOFFImage)
-// - mqtt: PubSubClient pointer for publishing toggle commands
+// Toggle commands go through the MQTT outbox (netPublish)
 void light_service_init(lv_obj_t* selectBtn, lv_obj_t* lightBtn,
-                        lv_obj_t* label, lv_obj_t* imgOn, lv_obj_t* imgOff,
-                        PubSubClient* mqtt);
+                        lv_obj_t* label, lv_obj_t* imgOn, lv_obj_t* imgOff);
 
 // Handle incoming MQTT message on the light topic
 // Matches payload against known status strings (e.g., "cu_on", "sa_of")
-void light_service_handleMQTT(const char* payload);
+// payload is length-delimited (not NUL-terminated)
+void light_service_handleMQTT(const char* payload, size_t length);
+
+// Apply the "lights" object of a status snapshot: {"cuisine":1,"salon":0,...}
+// (keys are the toggle payloads, values 1/0 or true/false). All states are
+// updated first, then the UI once. json is length-delimited.
+void light_service_applySnapshot(const char* json, size_t length);
 
 // Cycle to the next light (call from button handler)
 void light_service_cycleLight();
 
 // Toggle the currently selected light (publish MQTT command)
+// While MQTT is connected and the state is known, the UI flips immediately
 void light_service_toggleCurrent();
 
-// Request current light status from Node-RED via MQTT
-// Called at init and after MQTT reconnection
+// Toggle light i of the entity registry (grid tiles); same optimistic handling
+void light_service_toggle(size_t i);
+
+// Request current light status from Node-RED via MQTT (one message per light)
+// Legacy path: called by the status snapshot module when no snapshot arrives
 void light_service_requestStatus();
 
-// Periodic processing - handles NVS debounce save (call in loop())
+// Periodic processing - toggle deadlines, rollback cue (call in loop())
 void light_service_loop();
 
+LightToggleStats light_service_get_stats();
+
 #ifdef __cplusplus
 extern "C" {
 #endif
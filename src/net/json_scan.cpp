@@ -0,0 +1,192 @@
+#include "json_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+constexpr size_t NUMBER_TOKEN_MAX = 31;   // Longer numeric tokens are rejected
+constexpr int MAX_NESTING = 16;
+
+bool isNumberChar(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// Copy a numeric span into a terminated buffer: strtof/strtol need the terminator
+bool numberToken(const JsonMember& m, char* buf, size_t size) {
+  if (m.type != JsonType::NUMBER || m.valueLen == 0 || m.valueLen >= size) return false;
+  memcpy(buf, m.value, m.valueLen);
+  buf[m.valueLen] = '\0';
+  return true;
+}
+
+}  // namespace
+
+// ============================================================================
+// Member Helpers
+// ============================================================================
+
+bool JsonMember::keyEquals(const char* s) const {
+  size_t n = strlen(s);
+  return n == keyLen && memcmp(key, s, n) == 0;
+}
+
+bool JsonMember::toFloat(float* out) const {
+  char buf[NUMBER_TOKEN_MAX + 1];
+  if (!numberToken(*this, buf, sizeof(buf))) return false;
+  char* parsed;
+  *out = strtof(buf, &parsed);
+  return *parsed == '\0';
+}
+
+bool JsonMember::toInt(long* out) const {
+  char buf[NUMBER_TOKEN_MAX + 1];
+  if (!numberToken(*this, buf, sizeof(buf))) return false;
+  char* parsed;
+  *out = strtol(buf, &parsed, 10);
+  return *parsed == '\0';
+}
+
+// ============================================================================
+// Scanner
+// ============================================================================
+
+JsonScanner::JsonScanner(const char* data, size_t len)
+    : p_(data), end_(data ? data + len : nullptr) {}
+
+bool JsonScanner::fail() {
+  failed_ = true;
+  done_ = true;
+  return false;
+}
+
+void JsonScanner::skipSpace() {
+  while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) p_++;
+}
+
+// At an opening quote; on success p_ is past the closing quote
+bool JsonScanner::scanString(const char** start, size_t* len) {
+  if (p_ >= end_ || *p_ != '"') return false;
+  p_++;
+  *start = p_;
+  while (p_ < end_) {
+    char c = *p_;
+    if (c == '"') {
+      *len = p_ - *start;
+      p_++;
+      return true;
+    }
+    if (c == '\\') {
+      if (++p_ >= end_) return false;
+      if (*p_ == 'u') {
+        if (end_ - p_ < 5) return false;
+        p_ += 4;
+      } else if (!strchr("\"\\/bfnrt", *p_)) {
+        return false;
+      }
+    } else if ((unsigned char)c < 0x20) {
+      return false;   // Unescaped control character
+    }
+    p_++;
+  }
+  return false;
+}
+
+// At an opening bracket; skips to just past the matching close, honouring strings
+bool JsonScanner::scanNested(char close) {
+  int depth = 0;
+  while (p_ < end_) {
+    char c = *p_;
+    if (c == '"') {
+      const char* s;
+      size_t n;
+      if (!scanString(&s, &n)) return false;
+      continue;
+    }
+    if (c == '{' || c == '[') {
+      if (++depth > MAX_NESTING) return false;
+    } else if (c == '}' || c == ']') {
+      if (--depth == 0) {
+        p_++;
+        return c == close;
+      }
+      if (depth < 0) return false;
+    }
+    p_++;
+  }
+  return false;
+}
+
+bool JsonScanner::scanValue(JsonMember* out) {
+  skipSpace();
+  if (p_ >= end_) return false;
+
+  const char* start = p_;
+  char c = *p_;
+  if (c == '"') {
+    out->type = JsonType::STRING;
+    return scanString(&out->value, &out->valueLen);
+  }
+  if (c == '{' || c == '[') {
+    out->type = (c == '{') ? JsonType::OBJECT : JsonType::ARRAY;
+    if (!scanNested(c == '{' ? '}' : ']')) return false;
+    out->value = start;
+    out->valueLen = p_ - start;
+    return true;
+  }
+
+  struct Literal { const char* text; size_t len; JsonType type; };
+  static const Literal literals[] = {
+    { "true", 4, JsonType::BOOL }, { "false", 5, JsonType::BOOL }, { "null", 4, JsonType::NUL }
+  };
+  for (const Literal& lit : literals) {
+    if ((size_t)(end_ - p_) >= lit.len && memcmp(p_, lit.text, lit.len) == 0) {
+      p_ += lit.len;
+      out->type = lit.type;
+      out->value = start;
+      out->valueLen = lit.len;
+      return true;
+    }
+  }
+
+  while (p_ < end_ && isNumberChar(*p_)) p_++;
+  if (p_ == start) return false;
+  out->type = JsonType::NUMBER;
+  out->value = start;
+  out->valueLen = p_ - start;
+  return true;
+}
+
+bool JsonScanner::next(JsonMember* out) {
+  if (done_ || !p_) return false;
+
+  skipSpace();
+  if (!started_) {
+    if (p_ >= end_ || *p_ != '{') return fail();
+    p_++;
+    started_ = true;
+    skipSpace();
+    if (p_ < end_ && *p_ == '}') {
+      done_ = true;
+      return false;
+    }
+  } else {
+    // Between members: ',' or the closing brace
+    if (p_ >= end_) return fail();
+    if (*p_ == '}') {
+      done_ = true;
+      return false;
+    }
+    if (*p_ != ',') return fail();
+    p_++;
+    skipSpace();
+  }
+
+  if (!scanString(&out->key, &out->keyLen)) return fail();
+  skipSpace();
+  if (p_ >= end_ || *p_ != ':') return fail();
+  p_++;
+  if (!scanValue(out)) return fail();
+  skipSpace();
+  return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// JSON Scanner
+// ============================================================================
+// Single-pass pull tokenizer over a length-delimited buffer (e.g. a
+// PayloadView). Walks the members of one object in order without allocating
+// or copying: keys and values are returned as spans into the input.
+//
+// Nested objects/arrays are returned as one OBJECT/ARRAY span (scan them with
+// another JsonScanner if needed). String escapes are validated but not decoded;
+// keys are compared on their raw bytes.
+//
+// No Arduino dependency.
+// ============================================================================
+
+enum class JsonType : uint8_t {
+  STRING,     // value/valueLen exclude the quotes
+  NUMBER,
+  BOOL,
+  NUL,
+  OBJECT,     // value/valueLen include the braces
+  ARRAY       // value/valueLen include the brackets
+};
+
+struct JsonMember {
+  const char* key;
+  size_t keyLen;
+  JsonType type;
+  const char* value;
+  size_t valueLen;
+
+  bool keyEquals(const char* s) const;
+  // NUMBER members only; false on anything else or an out-of-range token
+  bool toFloat(float* out) const;
+  bool toInt(long* out) const;
+};
+
+class JsonScanner {
+public:
+  // data must start (after whitespace) with '{'
+  JsonScanner(const char* data, size_t len);
+
+  // Next member of the object; false at the closing brace or on a syntax error
+  bool next(JsonMember* out);
+
+  // True if scanning stopped on malformed input (as opposed to the end of the object)
+  bool failed() const { return failed_; }
+
+private:
+  void skipSpace();
+  bool scanString(const char** start, size_t* len);
+  bool scanValue(JsonMember* out);
+  bool scanNested(char close);
+  bool fail();
+
+  const char* p_;
+  const char* end_;
+  bool started_ = false;
+  bool done_ = false;
+  bool failed_ = false;
+};
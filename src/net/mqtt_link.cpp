@@ -0,0 +1,279 @@
+#include "mqtt_link.h"
+
+#include <WiFi.h>
+
+namespace {
+
+constexpr uint32_t WORKER_STACK_SIZE = 8192;   // TLS handshake runs on this stack
+constexpr UBaseType_t WORKER_PRIORITY = 1;
+
+// Encode an MQTT UTF-8 string (2-byte length prefix); returns new position or 0 on overflow
+size_t putString(uint8_t* buf, size_t pos, size_t cap, const char* s) {
+  size_t len = strlen(s);
+  if (pos + 2 + len > cap) return 0;
+  buf[pos++] = (uint8_t)(len >> 8);
+  buf[pos++] = (uint8_t)(len & 0xFF);
+  memcpy(buf + pos, s, len);
+  return pos + len;
+}
+
+}  // namespace
+
+// ============================================================================
+// Gate Client
+// ============================================================================
+
+size_t MqttGateClient::write(const uint8_t* buf, size_t size) {
+  if (!open_) return 0;
+  if (swallow_) return size;   // CONNECT already sent by MqttLink
+  return inner_->write(buf, size);
+}
+
+void MqttGateClient::stop() {
+  open_ = false;
+  if (inner_) inner_->stop();
+}
+
+// ============================================================================
+// MQTT Link
+// ============================================================================
+
+void MqttLink::attach(PubSubClient* mqtt, WiFiClient* plain, TlsSessionClient* tls) {
+  mqtt_ = mqtt;
+  plain_ = plain;
+  tls_ = tls;
+  if (mqtt_) mqtt_->setClient(gate_);
+}
+
+bool MqttLink::start(const char* host, uint16_t port, bool secure, const char* caCert,
+                     const char* clientId, const char* user, const char* pass) {
+  if (!mqtt_ || !plain_ || !tls_ || busy()) return false;
+
+  // Drop any previous session (no-op when already closed)
+  mqtt_->disconnect();
+  gate_.setOpen(false);
+
+  host_ = host;
+  port_ = port;
+  secure_ = secure;
+  caCert_ = caCert;
+  clientId_ = clientId;
+  user_ = user;
+  pass_ = pass;
+
+  gate_.setInner(secure_ ? static_cast<Client*>(tls_) : static_cast<Client*>(plain_));
+  mqtt_->setServer(host_, port_);
+
+  timings_ = {};
+  failReason_ = "";
+  workerStep_ = STEP_DNS;
+  workerActive_ = true;
+  state_ = MqttLinkState::RESOLVING;
+  stepStart_ = millis();
+
+  if (xTaskCreate(workerTask, "mqtt_conn", WORKER_STACK_SIZE, this, WORKER_PRIORITY, nullptr) != pdPASS) {
+    workerActive_ = false;
+    fail("worker task");
+    return false;
+  }
+  return true;
+}
+
+void MqttLink::poll() {
+  unsigned long now = millis();
+
+  switch (state_) {
+    case MqttLinkState::RESOLVING:
+    case MqttLinkState::CONNECTING: {
+      uint8_t step = workerStep_.load();
+      if (step == STEP_DNS_FAILED || step == STEP_CONNECT_FAILED) {
+        fail(step == STEP_DNS_FAILED ? "dns" : (secure_ ? "tcp/tls" : "tcp"));
+        break;
+      }
+      if (step == STEP_DONE) {
+        timings_.dnsMs = workerDnsMs_;
+        timings_.connectMs = workerConnectMs_;
+        gate_.setOpen(true);
+        if (!sendConnect()) {
+          fail("connect write");
+          break;
+        }
+        state_ = MqttLinkState::WAIT_CONNACK;
+        stepStart_ = now;
+        break;
+      }
+      if (step == STEP_CONNECT && state_ == MqttLinkState::RESOLVING) {
+        timings_.dnsMs = now - stepStart_;
+        state_ = MqttLinkState::CONNECTING;
+        stepStart_ = now;
+        break;
+      }
+
+      // Per-step deadline: abandon the worker
+      uint32_t limit = (state_ == MqttLinkState::RESOLVING) ? MQTT_LINK_DNS_TIMEOUT_MS
+                     : (secure_ ? MQTT_LINK_TLS_TIMEOUT_MS : MQTT_LINK_TCP_TIMEOUT_MS);
+      if (now - stepStart_ > limit) {
+        abandonWorker();
+        fail(state_ == MqttLinkState::RESOLVING ? "dns timeout" : "connect timeout");
+      }
+      break;
+    }
+
+    case MqttLinkState::WAIT_CONNACK:
+      // CONNACK is exactly 4 bytes; only peek at the count, PubSubClient reads it
+      if (gate_.available() >= 4) {
+        timings_.connackMs = now - stepStart_;
+        handOver();
+      } else if (!gate_.connected()) {
+        gate_.stop();
+        fail("closed before connack");
+      } else if (now - stepStart_ > MQTT_LINK_CONNACK_TIMEOUT_MS) {
+        gate_.stop();
+        fail("connack timeout");
+      }
+      break;
+
+    case MqttLinkState::CONNECTED:
+      if (!mqtt_->connected()) {
+        gate_.setOpen(false);
+        fail("connection lost");
+      }
+      break;
+
+    case MqttLinkState::IDLE:
+    case MqttLinkState::FAILED:
+      break;
+  }
+}
+
+void MqttLink::stop() {
+  if (state_ == MqttLinkState::RESOLVING || state_ == MqttLinkState::CONNECTING) {
+    abandonWorker();
+  } else if (state_ == MqttLinkState::CONNECTED) {
+    mqtt_->disconnect();
+  } else if (state_ == MqttLinkState::WAIT_CONNACK) {
+    gate_.stop();
+  }
+  gate_.setOpen(false);
+  state_ = MqttLinkState::IDLE;
+}
+
+const char* MqttLink::stateName() const {
+  switch (state_) {
+    case MqttLinkState::IDLE:         return "idle";
+    case MqttLinkState::RESOLVING:    return "dns";
+    case MqttLinkState::CONNECTING:   return secure_ ? "tls" : "tcp";
+    case MqttLinkState::WAIT_CONNACK: return "connack";
+    case MqttLinkState::CONNECTED:    return "connected";
+    case MqttLinkState::FAILED:       return "failed";
+  }
+  return "?";
+}
+
+void MqttLink::fail(const char* reason) {
+  failReason_ = reason;
+  state_ = MqttLinkState::FAILED;
+}
+
+// Give up on the worker's attempt. Still running: it skips the connect, or closes
+// the transport when its blocking call returns. Already done (the result not
+// yet taken by poll()): the transport is open and closed here.
+void MqttLink::abandonWorker() {
+  if (workerStep_.exchange(STEP_ABANDONED) == STEP_DONE) {
+    gate_.stop();
+  }
+}
+
+// Build and send an MQTT 3.1.1 CONNECT (clean session, user/password)
+bool MqttLink::sendConnect() {
+  uint8_t body[256];
+  size_t pos = 0;
+
+  pos = putString(body, pos, sizeof(body), "MQTT");
+  if (!pos) return false;
+  body[pos++] = 4;                        // Protocol level 3.1.1
+  body[pos++] = 0x80 | 0x40 | 0x02;       // Username, password, clean session
+  body[pos++] = (uint8_t)(MQTT_KEEPALIVE >> 8);
+  body[pos++] = (uint8_t)(MQTT_KEEPALIVE & 0xFF);
+  pos = putString(body, pos, sizeof(body), clientId_);
+  if (pos) pos = putString(body, pos, sizeof(body), user_);
+  if (pos) pos = putString(body, pos, sizeof(body), pass_);
+  if (!pos) return false;
+
+  // Fixed header with variable-length remaining length
+  uint8_t header[5];
+  size_t headerLen = 0;
+  header[headerLen++] = 0x10;
+  size_t remaining = pos;
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    if (remaining > 0) digit |= 0x80;
+    header[headerLen++] = digit;
+  } while (remaining > 0);
+
+  Client* inner = gate_.inner();
+  return inner->write(header, headerLen) == headerLen && inner->write(body, pos) == pos;
+}
+
+// CONNACK is buffered: PubSubClient::connect() skips the TCP connect (transport
+// already connected), its CONNECT write is swallowed and the CONNACK is read at once
+void MqttLink::handOver() {
+  gate_.setSwallowWrites(true);
+  bool ok = mqtt_->connect(clientId_, user_, pass_);
+  gate_.setSwallowWrites(false);
+
+  if (ok) {
+    state_ = MqttLinkState::CONNECTED;
+  } else {
+    static char reason[24];
+    snprintf(reason, sizeof(reason), "connack rc=%d", mqtt_->state());
+    gate_.stop();
+    fail(reason);
+  }
+}
+
+// ============================================================================
+// Worker Task (DNS + TCP/TLS)
+// ============================================================================
+
+void MqttLink::workerTask(void* arg) {
+  static_cast<MqttLink*>(arg)->workerMain();
+  vTaskDelete(nullptr);
+}
+
+void MqttLink::workerMain() {
+  unsigned long t0 = millis();
+
+  IPAddress ip;
+  bool resolved = ip.fromString(host_) || WiFi.hostByName(host_, ip) == 1;
+  workerDnsMs_ = millis() - t0;
+
+  // Abandoned during DNS (stop() or timeout): no connect, nothing to close
+  uint8_t expected = STEP_DNS;
+  if (!workerStep_.compare_exchange_strong(expected, resolved ? STEP_CONNECT : STEP_DNS_FAILED) ||
+      !resolved) {
+    workerActive_ = false;
+    return;
+  }
+
+  unsigned long t1 = millis();
+  int ok;
+  if (secure_) {
+    // Offers the cached session: a resumed handshake skips certificate and key exchange
+    tls_->setCACert(caCert_);
+    ok = tls_->connect(ip, port_, host_, MQTT_LINK_TLS_TIMEOUT_MS);   // Hostname for SNI/verification
+  } else {
+    ok = plain_->connect(ip, port_, MQTT_LINK_TCP_TIMEOUT_MS);
+  }
+  workerConnectMs_ = millis() - t1;
+
+  // Publish the outcome unless poll() / stop() abandoned the attempt meanwhile.
+  // Failed or abandoned: close whatever was opened; STEP_DONE hands the open
+  // transport to the loop.
+  expected = STEP_CONNECT;
+  if (!workerStep_.compare_exchange_strong(expected, ok ? STEP_DONE : STEP_CONNECT_FAILED) || !ok) {
+    if (secure_) tls_->stop(); else plain_->stop();
+  }
+  workerActive_ = false;
+}
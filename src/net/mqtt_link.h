@@ -0,0 +1,141 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+#include <PubSubClient.h>
+#include <WiFiClient.h>
+#include <atomic>
+
+#include "tls_session_client.h"
+// ============================================================================
+// MQTT Link
+// ============================================================================
+// One broker connection driven as a non-blocking state machine:
+//
+//   IDLE -> RESOLVING -> CONNECTING -> WAIT_CONNACK -> CONNECTED
+//                  \___________\____________\_______-> FAILED
+//
+// DNS and TCP (plus the TLS handshake on secure ports) run on a short-lived
+// worker task, so loop() never blocks on them: the handshake itself is stepped
+// on a non-blocking socket, but its crypto is hundreds of ms of CPU that must not
+// run inside loop(). Each step has its own deadline
+// enforced from poll(). The link sends the MQTT CONNECT itself and waits for
+// the CONNACK without blocking. PubSubClient is only handed the session once
+// the CONNACK is already buffered (see MqttGateClient), so its blocking
+// connect() returns immediately.
+// ============================================================================
+
+// Per-step timeouts
+constexpr uint32_t MQTT_LINK_DNS_TIMEOUT_MS = 5000;
+constexpr uint32_t MQTT_LINK_TCP_TIMEOUT_MS = 5000;
+constexpr uint32_t MQTT_LINK_TLS_TIMEOUT_MS = 10000;   // TCP + TLS handshake on secure ports
+constexpr uint32_t MQTT_LINK_CONNACK_TIMEOUT_MS = 5000;
+
+enum class MqttLinkState : uint8_t {
+  IDLE,
+  RESOLVING,
+  CONNECTING,     // TCP connect (and TLS handshake on secure ports)
+  WAIT_CONNACK,
+  CONNECTED,
+  FAILED
+};
+
+// Duration of each step of the last attempt
+struct MqttLinkTimings {
+  uint32_t dnsMs;
+  uint32_t connectMs;   // TCP (+ TLS on secure ports)
+  uint32_t connackMs;
+};
+
+// Client wrapper placed between PubSubClient and the transport.
+// Hides the transport from PubSubClient until the link opens it, and can
+// swallow the CONNECT that PubSubClient::connect() writes (already sent).
+class MqttGateClient : public Client {
+public:
+  void setInner(Client* inner) { inner_ = inner; }
+  Client* inner() { return inner_; }
+  void setOpen(bool open) { open_ = open; }
+  void setSwallowWrites(bool swallow) { swallow_ = swallow; }
+
+  int connect(IPAddress ip, uint16_t port) { return 0; }
+  int connect(const char* host, uint16_t port) { return 0; }
+  int connect(IPAddress ip, uint16_t port, int32_t timeout) { return 0; }
+  int connect(const char* host, uint16_t port, int32_t timeout) { return 0; }
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size);
+  int available() { return open_ ? inner_->available() : 0; }
+  int read() { return open_ ? inner_->read() : -1; }
+  int read(uint8_t* buf, size_t size) { return open_ ? inner_->read(buf, size) : -1; }
+  int peek() { return open_ ? inner_->peek() : -1; }
+  void flush() { if (open_) inner_->flush(); }
+  void stop();
+  uint8_t connected() { return open_ && inner_->connected(); }
+  operator bool() { return connected(); }
+
+private:
+  Client* inner_ = nullptr;
+  bool open_ = false;
+  bool swallow_ = false;
+};
+
+class MqttLink {
+public:
+  // Bind the link to its clients; the PubSubClient is pointed at the gate
+  void attach(PubSubClient* mqtt, WiFiClient* plain, TlsSessionClient* tls);
+
+  // Begin a connection attempt; returns false while a previous worker is still running
+  bool start(const char* host, uint16_t port, bool secure, const char* caCert,
+             const char* clientId, const char* user, const char* pass);
+
+  // Advance the state machine (call from loop(), never blocks)
+  void poll();
+
+  // Close the session or abandon the attempt in progress
+  void stop();
+
+  MqttLinkState state() const { return state_; }
+  const char* stateName() const;
+  const char* failReason() const { return failReason_; }
+  const MqttLinkTimings& timings() const { return timings_; }
+  bool busy() const { return workerActive_.load(); }
+  bool secure() const { return secure_; }
+  const TlsHandshakeStats* tlsStats() const { return tls_ ? &tls_->stats() : nullptr; }
+  PubSubClient* client() { return mqtt_; }
+
+private:
+  static void workerTask(void* arg);
+  void workerMain();
+  void fail(const char* reason);
+  void abandonWorker();
+  bool sendConnect();
+  void handOver();
+
+  PubSubClient* mqtt_ = nullptr;
+  WiFiClient* plain_ = nullptr;
+  TlsSessionClient* tls_ = nullptr;
+  MqttGateClient gate_;
+
+  // Attempt parameters
+  const char* host_ = nullptr;
+  uint16_t port_ = 0;
+  bool secure_ = false;
+  const char* caCert_ = nullptr;
+  const char* clientId_ = nullptr;
+  const char* user_ = nullptr;
+  const char* pass_ = nullptr;
+
+  MqttLinkState state_ = MqttLinkState::IDLE;
+  unsigned long stepStart_ = 0;
+  const char* failReason_ = "";
+  MqttLinkTimings timings_ = {};
+
+  // Worker <-> loop hand-off. The worker only moves on from STEP_DNS / STEP_CONNECT
+  // with a compare-exchange, the loop abandons with an exchange: whichever side
+  // sees the other's value owns closing the transport
+  enum WorkerStep : uint8_t { STEP_DNS, STEP_CONNECT, STEP_DONE, STEP_DNS_FAILED, STEP_CONNECT_FAILED,
+                              STEP_ABANDONED };
+  std::atomic<uint8_t> workerStep_{STEP_DNS};
+  std::atomic<bool> workerActive_{false};
+  uint32_t workerDnsMs_ = 0;
+  uint32_t workerConnectMs_ = 0;
+};
@@ -0,0 +1,171 @@
+#include "mqtt_outbox.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+
+// Time-to-live per priority (LOW, NORMAL, HIGH)
+constexpr uint32_t TTL_MS[] = { 120000, 60000, 30000 };
+
+bool copyBounded(char* dst, size_t size, const char* src) {
+  size_t len = strlen(src);
+  if (len >= size) return false;
+  memcpy(dst, src, len + 1);
+  return true;
+}
+
+}  // namespace
+
+MqttOutbox::~MqttOutbox() {
+  free(entries_);     // heap_caps_calloc memory is released with free() too
+}
+
+bool MqttOutbox::begin(OutboxPublishFn publish, void* ctx) {
+  publish_ = publish;
+  ctx_ = ctx;
+  if (entries_) return true;
+
+  size_t bytes = OUTBOX_CAPACITY * sizeof(Entry);
+#ifdef ARDUINO
+  entries_ = static_cast<Entry*>(heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (!entries_) {
+    entries_ = static_cast<Entry*>(calloc(1, bytes));   // Fall back to internal RAM
+  }
+#else
+  entries_ = static_cast<Entry*>(calloc(1, bytes));
+#endif
+  return entries_ != nullptr;
+}
+
+uint32_t MqttOutbox::ttlFor(OutboxPriority priority) {
+  return TTL_MS[static_cast<uint8_t>(priority)];
+}
+
+MqttOutbox::Entry* MqttOutbox::findKey(const char* key) {
+  for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+    if (entries_[i].used && entries_[i].key[0] && strcmp(entries_[i].key, key) == 0) {
+      return &entries_[i];
+    }
+  }
+  return nullptr;
+}
+
+// Free entry, or the victim chosen by the drop policy, or nullptr to refuse
+MqttOutbox::Entry* MqttOutbox::freeSlot(OutboxPriority priority) {
+  Entry* victim = nullptr;
+  for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+    Entry& e = entries_[i];
+    if (!e.used) return &e;
+    if (e.priority > priority) continue;
+    if (!victim || e.priority < victim->priority ||
+        (e.priority == victim->priority && e.seq < victim->seq)) {
+      victim = &e;
+    }
+  }
+  if (victim) {
+    stats_.dropped++;
+    victim->used = false;
+  }
+  return victim;
+}
+
+bool MqttOutbox::enqueue(const char* topic, const char* payload, OutboxPriority priority,
+                         const char* dedupKey, uint32_t nowMs) {
+  if (!entries_ || !topic || !payload) return false;
+  if (strlen(topic) >= OUTBOX_TOPIC_MAX || strlen(payload) >= OUTBOX_PAYLOAD_MAX ||
+      (dedupKey && strlen(dedupKey) >= OUTBOX_KEY_MAX)) {
+    return false;
+  }
+
+  Entry* e = dedupKey ? findKey(dedupKey) : nullptr;
+  if (e) {
+    stats_.deduped++;
+  } else {
+    e = freeSlot(priority);
+    if (!e) {
+      stats_.dropped++;
+      return false;
+    }
+  }
+
+  e->used = true;
+  e->priority = priority;
+  e->attempts = 0;
+  e->seq = seq_++;
+  e->queuedAt = nowMs;
+  e->nextAttemptAt = nowMs;
+  copyBounded(e->topic, sizeof(e->topic), topic);
+  copyBounded(e->payload, sizeof(e->payload), payload);
+  copyBounded(e->key, sizeof(e->key), dedupKey ? dedupKey : "");
+  stats_.queued++;
+  return true;
+}
+
+bool MqttOutbox::cancel(const char* dedupKey) {
+  if (!entries_ || !dedupKey || !dedupKey[0]) return false;
+  Entry* e = findKey(dedupKey);
+  if (!e) return false;
+  e->used = false;
+  stats_.cancelled++;
+  return true;
+}
+
+// Highest priority, then oldest, among entries due for an attempt
+MqttOutbox::Entry* MqttOutbox::next(uint32_t nowMs) {
+  Entry* best = nullptr;
+  for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+    Entry& e = entries_[i];
+    if (!e.used || (int32_t)(nowMs - e.nextAttemptAt) < 0) continue;
+    if (!best || e.priority > best->priority ||
+        (e.priority == best->priority && e.seq < best->seq)) {
+      best = &e;
+    }
+  }
+  return best;
+}
+
+void MqttOutbox::flush(uint32_t nowMs, bool connected) {
+  if (!entries_) return;
+
+  for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+    Entry& e = entries_[i];
+    if (e.used && nowMs - e.queuedAt > ttlFor(e.priority)) {
+      e.used = false;
+      stats_.expired++;
+    }
+  }
+
+  if (!connected || !publish_) return;
+
+  for (size_t n = 0; n < OUTBOX_MAX_SENDS_PER_FLUSH; n++) {
+    Entry* e = next(nowMs);
+    if (!e) return;
+
+    if (publish_(e->topic, e->payload, ctx_)) {
+      e->used = false;
+      stats_.sent++;
+    } else {
+      // Transport refused (buffer full, socket closing): keep it and back off
+      e->attempts++;
+      e->nextAttemptAt = nowMs + OUTBOX_RETRY_MS;
+      stats_.retried++;
+      return;
+    }
+  }
+}
+
+OutboxStats MqttOutbox::stats() const {
+  OutboxStats s = stats_;
+  s.pending = 0;
+  if (entries_) {
+    for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+      if (entries_[i].used) s.pending++;
+    }
+  }
+  return s;
+}
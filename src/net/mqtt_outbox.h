@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// MQTT Outbox
+// ============================================================================
+// Bounded queue of outgoing messages, kept in PSRAM, that survives reconnects.
+//
+// - Priority: higher priority is sent first, FIFO within a priority
+// - Deduplication: a message with the dedup key of a queued one replaces it
+//   (e.g. one pending status request per topic). Non-idempotent commands use
+//   cancel() instead: a second light toggle withdraws the queued first one.
+// - Retry: a message stays queued until the publish function accepts it, with a
+//   per-priority time-to-live so stale commands are not replayed much later
+// - Drop policy when full: evict the oldest entry of the lowest priority that is
+//   not above the new message's; if every entry is higher, the new one is refused
+//
+// No Arduino or MQTT dependency: time is passed in and the transport is an
+// injected publish function, so the queue can run on host against a stub or a
+// local broker.
+// ============================================================================
+
+constexpr size_t OUTBOX_CAPACITY = 32;
+constexpr size_t OUTBOX_TOPIC_MAX = 48;
+constexpr size_t OUTBOX_PAYLOAD_MAX = 96;
+constexpr size_t OUTBOX_KEY_MAX = 32;               // Light toggle payloads are keys (REGISTRY_MAX_STRING)
+constexpr uint32_t OUTBOX_RETRY_MS = 1000;          // Wait after a rejected publish
+constexpr size_t OUTBOX_MAX_SENDS_PER_FLUSH = 4;    // Bounds time spent per loop()
+
+enum class OutboxPriority : uint8_t {
+  LOW,      // Status requests, telemetry
+  NORMAL,
+  HIGH      // User commands
+};
+
+// Transport: returns true once the message has been handed to the client
+typedef bool (*OutboxPublishFn)(const char* topic, const char* payload, void* ctx);
+
+struct OutboxStats {
+  uint32_t queued;
+  uint32_t sent;
+  uint32_t retried;     // Publish attempts rejected by the transport
+  uint32_t deduped;     // Replaced by a newer message with the same key
+  uint32_t cancelled;   // Withdrawn with cancel()
+  uint32_t dropped;     // Evicted or refused because the outbox was full
+  uint32_t expired;     // TTL elapsed before it could be sent
+  uint32_t pending;
+};
+
+class MqttOutbox {
+public:
+  MqttOutbox() = default;
+  ~MqttOutbox();
+  MqttOutbox(const MqttOutbox&) = delete;
+  MqttOutbox& operator=(const MqttOutbox&) = delete;
+
+  // Allocate storage (PSRAM when available) and set the transport
+  bool begin(OutboxPublishFn publish, void* ctx);
+
+  // Queue a message; dedupKey may be nullptr. Returns false if refused
+  // (not initialized, too long, or full of higher-priority entries).
+  bool enqueue(const char* topic, const char* payload, OutboxPriority priority,
+               const char* dedupKey, uint32_t nowMs);
+
+  // Withdraw the queued message with this dedup key; false if none is queued
+  bool cancel(const char* dedupKey);
+
+  // Drop expired entries and, when connected, send up to OUTBOX_MAX_SENDS_PER_FLUSH
+  void flush(uint32_t nowMs, bool connected);
+
+  OutboxStats stats() const;
+
+private:
+  struct Entry {
+    bool used;
+    OutboxPriority priority;
+    uint16_t attempts;
+    uint32_t seq;
+    uint32_t queuedAt;
+    uint32_t nextAttemptAt;
+    char topic[OUTBOX_TOPIC_MAX];
+    char payload[OUTBOX_PAYLOAD_MAX];
+    char key[OUTBOX_KEY_MAX];
+  };
+
+  static uint32_t ttlFor(OutboxPriority priority);
+  Entry* findKey(const char* key);
+  Entry* freeSlot(OutboxPriority priority);
+  Entry* next(uint32_t nowMs);
+
+  Entry* entries_ = nullptr;
+  OutboxPublishFn publish_ = nullptr;
+  void* ctx_ = nullptr;
+  uint32_t seq_ = 0;
+  OutboxStats stats_ = {};
+};
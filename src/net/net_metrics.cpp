@@ -0,0 +1,362 @@
+#include "net_metrics.h"
+
+#include <WebServer.h>
+#include <WiFi.h>
+#include <stdarg.h>
+
+#include "net_module.h"
+#include "wifi_fast.h"
+
+namespace {
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+constexpr size_t MAX_BUCKETS = 10;
+
+struct Histogram {
+  const char* name;
+  const char* help;
+  const int32_t* bounds;    // Upper bound (inclusive) of each bucket except the last
+  size_t boundCount;        // Number of bounds; bucket count is boundCount + 1
+  uint32_t buckets[MAX_BUCKETS];
+  uint32_t count;
+  int64_t sum;
+};
+
+const int32_t LATENCY_MS_BOUNDS[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+const int32_t OUTAGE_MS_BOUNDS[]  = { 1000, 5000, 15000, 30000, 60000, 300000, 900000 };
+const int32_t RSSI_DBM_BOUNDS[]   = { -90, -80, -75, -70, -67, -60, -50 };
+
+constexpr size_t LATENCY_BOUND_COUNT = sizeof(LATENCY_MS_BOUNDS) / sizeof(LATENCY_MS_BOUNDS[0]);
+constexpr size_t OUTAGE_BOUND_COUNT = sizeof(OUTAGE_MS_BOUNDS) / sizeof(OUTAGE_MS_BOUNDS[0]);
+constexpr size_t RSSI_BOUND_COUNT = sizeof(RSSI_DBM_BOUNDS) / sizeof(RSSI_DBM_BOUNDS[0]);
+
+Histogram dnsTime     = { "homepanel_mqtt_dns_ms", "DNS resolution of the winning connect attempt",
+                          LATENCY_MS_BOUNDS, LATENCY_BOUND_COUNT, {}, 0, 0 };
+Histogram tcpTime     = { "homepanel_mqtt_tcp_connect_ms", "TCP connect (plain broker port)",
+                          LATENCY_MS_BOUNDS, LATENCY_BOUND_COUNT, {}, 0, 0 };
+Histogram tlsTime     = { "homepanel_mqtt_tls_connect_ms", "TCP connect and TLS handshake (secure broker port)",
+                          LATENCY_MS_BOUNDS, LATENCY_BOUND_COUNT, {}, 0, 0 };
+Histogram connackTime = { "homepanel_mqtt_connack_ms", "CONNECT sent to CONNACK received",
+                          LATENCY_MS_BOUNDS, LATENCY_BOUND_COUNT, {}, 0, 0 };
+Histogram outageTime  = { "homepanel_mqtt_reconnect_ms", "Session lost to next session established",
+                          OUTAGE_MS_BOUNDS, OUTAGE_BOUND_COUNT, {}, 0, 0 };
+Histogram rssiSamples = { "homepanel_wifi_rssi_samples_dbm", "WiFi RSSI samples",
+                          RSSI_DBM_BOUNDS, RSSI_BOUND_COUNT, {}, 0, 0 };
+
+Histogram* const histograms[] = { &dnsTime, &tcpTime, &tlsTime, &connackTime, &outageTime, &rssiSamples };
+
+void histogramRecord(Histogram& h, int32_t value) {
+  size_t i = 0;
+  while (i < h.boundCount && value > h.bounds[i]) i++;
+  h.buckets[i]++;
+  h.count++;
+  h.sum += value;
+}
+
+// ============================================================================
+// Counters
+// ============================================================================
+
+uint32_t sessions = 0;
+uint32_t reconnects = 0;
+uint32_t raceFailures = 0;
+uint32_t publishRefused = 0;
+
+int32_t lastRssi = 0;
+unsigned long lastRssiSample = 0;
+
+uint32_t imageDownloads = 0;
+uint64_t imageBytes = 0;
+uint64_t imageMs = 0;
+uint32_t lastImageBytesPerSec = 0;
+
+// Per-route message rate: delivered count at the start of the minute, and the last full minute
+uint32_t minuteStartDelivered[TOPIC_ROUTER_MAX_ROUTES] = {};
+uint32_t lastMinuteDelivered[TOPIC_ROUTER_MAX_ROUTES] = {};
+unsigned long minuteStart = 0;
+constexpr unsigned long RATE_WINDOW_MS = 60000;
+
+// Optional MQTT summary
+const char* publishTopic = nullptr;
+uint32_t publishIntervalMs = 0;
+unsigned long lastPublish = 0;
+
+// ============================================================================
+// Exposition Output
+// ============================================================================
+// Whole lines are buffered in a chunk and handed to the write function when
+// the next ones do not fit, so the text has no size limit and is never cut
+// mid-line. A single append larger than the chunk marks the output failed.
+
+struct TextOut {
+  char* buf;
+  size_t len;
+  size_t pos;
+  NetMetricsWriteFn write;
+  void* ctx;
+  bool failed;
+};
+
+void flushOut(TextOut& out) {
+  if (out.pos > 0) out.write(out.buf, out.pos, out.ctx);
+  out.pos = 0;
+}
+
+// Append formatted lines (fmt ends with a newline)
+void appendf(TextOut& out, const char* fmt, ...) {
+  if (out.failed) return;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(out.buf + out.pos, out.len - out.pos, fmt, args);
+    va_end(args);
+    if (n < 0) break;
+    if (out.pos + static_cast<size_t>(n) < out.len) {
+      out.pos += n;
+      return;
+    }
+    // Send what is buffered (complete lines before out.pos) and retry in an empty chunk
+    if (out.pos == 0) break;
+    flushOut(out);
+  }
+  out.failed = true;
+}
+
+void appendHeader(TextOut& out, const char* name, const char* type, const char* help) {
+  appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void appendHistogram(TextOut& out, const Histogram& h) {
+  appendHeader(out, h.name, "histogram", h.help);
+  uint32_t cumulative = 0;
+  for (size_t b = 0; b < h.boundCount; b++) {
+    cumulative += h.buckets[b];
+    appendf(out, "%s_bucket{le=\"%ld\"} %lu\n", h.name, (long)h.bounds[b], (unsigned long)cumulative);
+  }
+  appendf(out, "%s_bucket{le=\"+Inf\"} %lu\n%s_sum %lld\n%s_count %lu\n",
+          h.name, (unsigned long)h.count, h.name, (long long)h.sum, h.name, (unsigned long)h.count);
+}
+
+void appendCounter(TextOut& out, const char* name, const char* help, uint64_t value) {
+  appendHeader(out, name, "counter", help);
+  appendf(out, "%s %llu\n", name, (unsigned long long)value);
+}
+
+void appendGauge(TextOut& out, const char* name, const char* help, long value) {
+  appendHeader(out, name, "gauge", help);
+  appendf(out, "%s %ld\n", name, value);
+}
+
+// GET /metrics: chunked response, started by the first chunk
+struct HttpStream {
+  WebServer* server;
+  bool started;
+};
+
+void httpWrite(const char* text, size_t len, void* ctx) {
+  HttpStream* stream = static_cast<HttpStream*>(ctx);
+  if (!stream->started) {
+    stream->server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    stream->server->send(200, "text/plain; version=0.0.4", "");
+    stream->started = true;
+  }
+  stream->server->sendContent(text, len);
+}
+
+void rollMinute(unsigned long now) {
+  if (now - minuteStart < RATE_WINDOW_MS) return;
+  // Idle longer than a window (e.g. offline): the last full minute had no traffic
+  bool skipped = now - minuteStart >= 2 * RATE_WINDOW_MS;
+  minuteStart = now;
+  for (size_t i = 0; i < netGetRouteCount(); i++) {
+    uint32_t delivered = netGetRoute(i).delivered;
+    lastMinuteDelivered[i] = skipped ? 0 : delivered - minuteStartDelivered[i];
+    minuteStartDelivered[i] = delivered;
+  }
+}
+
+// Short keys keep the worst case within OUTBOX_PAYLOAD_MAX: up = uptime s,
+// msgs = delivered, rc = reconnects, pf = publish failures, img = last image bytes/s
+void publishSummary() {
+  TopicRouterStats topics = netGetTopicStats();
+  OutboxStats outbox = netGetOutboxStats();
+  char payload[OUTBOX_PAYLOAD_MAX];
+  snprintf(payload, sizeof(payload),
+           "{\"up\":%lu,\"rssi\":%ld,\"msgs\":%lu,\"rc\":%lu,\"pf\":%lu,\"img\":%lu}",
+           millis() / 1000, (long)lastRssi, (unsigned long)topics.delivered, (unsigned long)reconnects,
+           (unsigned long)(publishRefused + outbox.dropped + outbox.expired),
+           (unsigned long)lastImageBytesPerSec);
+  netPublish(publishTopic, payload, OutboxPriority::LOW, "metrics");
+}
+
+}  // namespace
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+void netMetricsRecordSession(bool reconnect, uint32_t outageMs) {
+  sessions++;
+  if (reconnect) {
+    reconnects++;
+    histogramRecord(outageTime, outageMs);
+  }
+}
+
+void netMetricsRecordConnect(bool secure, const MqttLinkTimings& timings) {
+  histogramRecord(dnsTime, timings.dnsMs);
+  histogramRecord(secure ? tlsTime : tcpTime, timings.connectMs);
+  histogramRecord(connackTime, timings.connackMs);
+}
+
+void netMetricsRecordRaceFailed() {
+  raceFailures++;
+}
+
+void netMetricsRecordPublishRefused() {
+  publishRefused++;
+}
+
+void netMetricsRecordImage(size_t bytes, uint32_t durationMs) {
+  imageDownloads++;
+  imageBytes += bytes;
+  imageMs += durationMs;
+  lastImageBytesPerSec = durationMs ? (uint32_t)((uint64_t)bytes * 1000 / durationMs) : 0;
+}
+
+void netMetricsLoop() {
+  unsigned long now = millis();
+
+  if (now - lastRssiSample >= NET_METRICS_RSSI_SAMPLE_MS && WiFi.status() == WL_CONNECTED) {
+    lastRssiSample = now;
+    lastRssi = WiFi.RSSI();
+    histogramRecord(rssiSamples, lastRssi);
+  }
+
+  rollMinute(now);
+
+  if (publishTopic && publishIntervalMs && now - lastPublish >= publishIntervalMs) {
+    lastPublish = now;
+    publishSummary();
+  }
+}
+
+void netMetricsSetMqttPublish(const char* topic, uint32_t intervalMs) {
+  publishTopic = topic;
+  publishIntervalMs = intervalMs;
+  lastPublish = millis();
+}
+
+// ============================================================================
+// Exposition
+// ============================================================================
+
+bool netMetricsWritePrometheus(char* chunk, size_t chunkLen, NetMetricsWriteFn write, void* ctx) {
+  if (!chunk || chunkLen == 0 || !write) return false;
+  TextOut out = { chunk, chunkLen, 0, write, ctx, false };
+
+  appendGauge(out, "homepanel_uptime_seconds", "Time since boot", millis() / 1000);
+
+  // Per-topic traffic
+  appendHeader(out, "homepanel_mqtt_messages_total", "counter", "Messages delivered per routed topic filter");
+  for (size_t i = 0; i < netGetRouteCount(); i++) {
+    const TopicRoute& r = netGetRoute(i);
+    appendf(out, "homepanel_mqtt_messages_total{topic=\"%s\"} %lu\n", r.filter, (unsigned long)r.delivered);
+  }
+  appendHeader(out, "homepanel_mqtt_messages_per_minute", "gauge", "Messages delivered in the last full minute");
+  for (size_t i = 0; i < netGetRouteCount(); i++) {
+    appendf(out, "homepanel_mqtt_messages_per_minute{topic=\"%s\"} %lu\n",
+            netGetRoute(i).filter, (unsigned long)lastMinuteDelivered[i]);
+  }
+  appendHeader(out, "homepanel_mqtt_rejected_total", "counter", "Messages over the route's maximum payload");
+  for (size_t i = 0; i < netGetRouteCount(); i++) {
+    const TopicRoute& r = netGetRoute(i);
+    appendf(out, "homepanel_mqtt_rejected_total{topic=\"%s\"} %lu\n", r.filter, (unsigned long)r.rejected);
+  }
+  appendCounter(out, "homepanel_mqtt_unrouted_total", "Messages with no matching route",
+                netGetTopicStats().unrouted);
+
+  // Sessions
+  appendGauge(out, "homepanel_mqtt_connected", "1 while an MQTT session is active", netIsMqttConnected());
+  appendGauge(out, "homepanel_mqtt_server", "Active or preferred server (1 local, 2 remote)",
+              netGetCurrentMqttServer());
+  appendCounter(out, "homepanel_mqtt_sessions_total", "Sessions established", sessions);
+  appendCounter(out, "homepanel_mqtt_reconnects_total", "Sessions re-established after a loss", reconnects);
+  appendCounter(out, "homepanel_mqtt_connect_failures_total", "Connect races where both servers failed",
+                raceFailures);
+
+  for (const Histogram* h : histograms) {
+    if (h != &rssiSamples) appendHistogram(out, *h);
+  }
+
+  appendHeader(out, "homepanel_tls_handshakes_total", "counter", "Completed TLS handshakes");
+  for (int server = MQTT_SERVER_LOCAL; server <= MQTT_SERVER_REMOTE; server++) {
+    const TlsHandshakeStats* tls = netGetTlsStats(server);
+    if (!tls) continue;
+    const char* name = (server == MQTT_SERVER_LOCAL) ? "local" : "remote";
+    appendf(out, "homepanel_tls_handshakes_total{server=\"%s\",kind=\"full\"} %lu\n",
+            name, (unsigned long)tls->full);
+    appendf(out, "homepanel_tls_handshakes_total{server=\"%s\",kind=\"resumed\"} %lu\n",
+            name, (unsigned long)tls->resumed);
+  }
+
+  // Publishing
+  OutboxStats outbox = netGetOutboxStats();
+  appendCounter(out, "homepanel_mqtt_published_total", "Messages handed to the MQTT client", outbox.sent);
+  appendHeader(out, "homepanel_mqtt_publish_failures_total", "counter", "Publish failures by reason");
+  appendf(out,
+          "homepanel_mqtt_publish_failures_total{reason=\"refused\"} %lu\n"
+          "homepanel_mqtt_publish_failures_total{reason=\"retried\"} %lu\n"
+          "homepanel_mqtt_publish_failures_total{reason=\"dropped\"} %lu\n"
+          "homepanel_mqtt_publish_failures_total{reason=\"expired\"} %lu\n",
+          (unsigned long)publishRefused, (unsigned long)outbox.retried,
+          (unsigned long)outbox.dropped, (unsigned long)outbox.expired);
+  appendGauge(out, "homepanel_mqtt_outbox_pending", "Messages waiting in the outbox", outbox.pending);
+
+  // WiFi
+  appendGauge(out, "homepanel_wifi_rssi_dbm", "Last WiFi RSSI sample", lastRssi);
+  appendHistogram(out, rssiSamples);
+  WifiFastStats wifi = wifiFastGetStats();
+  appendGauge(out, "homepanel_wifi_boot_to_ip_ms", "Boot to first IP address", wifi.bootToIpMs);
+  appendGauge(out, "homepanel_wifi_last_outage_ms", "Disconnect to IP of the last recovery",
+              wifi.lastOutageMs);
+  appendCounter(out, "homepanel_wifi_outages_total", "Recovered WiFi outages", wifi.outages);
+  appendCounter(out, "homepanel_wifi_outage_ms_total", "Time spent reconnecting WiFi", wifi.outageMsTotal);
+  appendHeader(out, "homepanel_wifi_connects_total", "counter", "WiFi connections by path");
+  appendf(out,
+          "homepanel_wifi_connects_total{path=\"fast\"} %lu\n"
+          "homepanel_wifi_connects_total{path=\"scan\"} %lu\n",
+          (unsigned long)wifi.fastConnects, (unsigned long)wifi.fullConnects);
+  appendCounter(out, "homepanel_wifi_fast_failures_total", "Cached BSSID/channel attempts that failed",
+                wifi.fastFailures);
+
+  // Image downloads
+  appendCounter(out, "homepanel_image_downloads_total", "Completed image downloads", imageDownloads);
+  appendCounter(out, "homepanel_image_bytes_total", "Image bytes downloaded", imageBytes);
+  appendCounter(out, "homepanel_image_download_ms_total", "Time spent downloading images", imageMs);
+  appendGauge(out, "homepanel_image_bytes_per_second", "Throughput of the last image download",
+              lastImageBytesPerSec);
+
+  if (out.failed) return false;
+  flushOut(out);
+  return true;
+}
+
+void netMetricsRegisterHttp(WebServer& server) {
+  server.on("/metrics", HTTP_GET, [&server]() {
+    static char chunk[NET_METRICS_CHUNK_MAX];
+    HttpStream stream = { &server, false };
+    if (netMetricsWritePrometheus(chunk, sizeof(chunk), httpWrite, &stream)) {
+      server.sendContent("");           // Last chunk
+    } else if (!stream.started) {
+      server.send(500, "text/plain", "metrics exposition failed");
+    } else {
+      // Headers already sent: end without the last chunk so the scrape fails
+      // instead of parsing a partial exposition
+      server.client().stop();
+    }
+  });
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "mqtt_link.h"
+
+// ============================================================================
+// Network Metrics
+// ============================================================================
+// Counters and fixed-bucket histograms for the panel's network health:
+//
+// - MQTT messages per routed topic (total and last full minute), rejected and
+//   unrouted messages
+// - Sessions, reconnects and outage duration (session lost -> next CONNACK),
+//   failed connect races
+// - DNS, TCP/TLS connect and CONNACK latency of each winning attempt; full vs
+//   resumed TLS handshakes
+// - Publish failures (outbox refused, retried, dropped, expired)
+// - WiFi RSSI, sampled every NET_METRICS_RSSI_SAMPLE_MS
+// - Image download bytes and time (bytes per second)
+//
+// Served as Prometheus text on GET /metrics, streamed (chunked transfer) so
+// the exposition grows with the routes without a fixed buffer. Optionally a compact JSON summary
+// is published over MQTT through the outbox (LOW priority, latest one only).
+//
+// Everything is recorded and read on the app task (loop(), MQTT handlers and
+// the web server all run there): no locking.
+// ============================================================================
+
+constexpr uint32_t NET_METRICS_RSSI_SAMPLE_MS = 10000;
+constexpr size_t NET_METRICS_CHUNK_MAX = 1024;     // Prometheus text is streamed in chunks of whole lines
+
+// Recording hooks (net module and image fetcher)
+void netMetricsRecordSession(bool reconnect, uint32_t outageMs);
+void netMetricsRecordConnect(bool secure, const MqttLinkTimings& timings);
+void netMetricsRecordRaceFailed();
+void netMetricsRecordPublishRefused();
+void netMetricsRecordImage(size_t bytes, uint32_t durationMs);
+
+// Periodic work: RSSI sampling, per-minute topic rates, MQTT publish (call from netLoop())
+void netMetricsLoop();
+
+// Publish the summary on topic every intervalMs (0 disables, the default).
+// topic is not copied.
+void netMetricsSetMqttPublish(const char* topic, uint32_t intervalMs);
+
+// Exposition output: called with each chunk of whole lines
+typedef void (*NetMetricsWriteFn)(const char* text, size_t len, void* ctx);
+
+// Render the Prometheus text exposition format through write, buffering lines in
+// chunk (chunkLen bytes). Returns false if a line did not fit in the chunk: the
+// output is then incomplete and must not be served.
+bool netMetricsWritePrometheus(char* chunk, size_t chunkLen, NetMetricsWriteFn write, void* ctx);
+
+class WebServer;
+
+// Register GET /metrics on the OTA web server
+void netMetricsRegisterHttp(WebServer& server);
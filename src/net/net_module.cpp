@@ -1,5 +1,9 @@
 #include "net_module.h"
+#include "mqtt_link.h"
+#include "mqtt_outbox.h"
+#include "net_metrics.h"
 #include "secrets_private.h"
+#include "../storage/settings_store.h"
 
 namespace {
 
@@ -10,105 +14,326 @@ bool mqttSuccess = false;
 unsigned long lastMqttAttempt = 0;
 constexpr unsigned long MQTT_RECONNECT_INTERVAL = 15000;  // 15s between reconnection attempts
 
-// Current MQTT server (1=LOCAL, 2=REMOTE)
+// Current MQTT server (1=LOCAL, 2=REMOTE): stored preference, then the active session's server
 int currentMqttServer = MQTT_SERVER_LOCAL;
 
-// NVS constants
-constexpr const char* NVS_NAMESPACE = "homepanel";
-constexpr const char* NVS_KEY_MQTT_SERVER = "mqtt_server";
+// One link per server, each with its own clients: [0] = server1 (local), [1] = server2 (remote)
+constexpr int LINK_COUNT = 2;
+MqttLink links[LINK_COUNT];
+int activeLink = -1;               // Link owning the session, -1 when disconnected
 
-// Preferences object for NVS
-Preferences preferences;
+// Client ID per link (cfg.clientId + "-L" / "-R"): when both servers are the same
+// broker (LAN address and port-forwarded TLS), a CONNECT with a shared ID would
+// make it drop the other link's session (race, local probe)
+constexpr size_t LINK_CLIENT_ID_MAX = 32;
+char linkClientIds[LINK_COUNT][LINK_CLIENT_ID_MAX];
+
+// Race state (both servers connecting in parallel)
+bool racing = false;
+int raceFirst = 0;                 // Link that got the head start
+bool raceSecondStarted = false;
+unsigned long raceStartedAt = 0;
+
+// Background probe of the local server while the session is on remote
+bool probing = false;
+unsigned long lastLocalProbe = 0;
+
+// Topic -> handler routes; subscriptions are made from this table
+TopicRouter router;
+constexpr size_t MQTT_WILDCARD_TOPIC_MARGIN = 64;   // Assumed topic length for '+'/'#' filters
+constexpr uint16_t MQTT_MIN_BUFFER_SIZE = 256;     // Outgoing publishes; grown for incoming routes
+
+// Outgoing messages, held across reconnects
+MqttOutbox outbox;
+
+uint32_t sessionCount = 0;
+unsigned long sessionLostAt = 0;   // millis() when the last session dropped, 0 while up
+unsigned long firstDataAt = 0;
+
+// Settings key (NVS, through the settings store)
+constexpr const char* SETTING_MQTT_SERVER = "mqtt_server";
 
 // Helper to decide if port is secure
 bool isSecurePort(uint16_t port) {
   return port == 9735 || port == 8883;
 }
 
-// Subscribe to all configured MQTT topics
-void subscribeToAllTopics() {
-  if (!cfg.mqttClient) return;
-  if (cfg.topics.image)   cfg.mqttClient->subscribe(cfg.topics.image, 1);
-  if (cfg.topics.power)   cfg.mqttClient->subscribe(cfg.topics.power, 1);
-  if (cfg.topics.energy)  cfg.mqttClient->subscribe(cfg.topics.energy, 1);
-  if (cfg.topics.weather) cfg.mqttClient->subscribe(cfg.topics.weather, 1);
-  if (cfg.topics.light)   cfg.mqttClient->subscribe(cfg.topics.light, 1);
+int linkIndex(int server) {
+  return (server == MQTT_SERVER_REMOTE) ? 1 : 0;
+}
+
+int linkServer(int idx) {
+  return (idx == 1) ? MQTT_SERVER_REMOTE : MQTT_SERVER_LOCAL;
+}
+
+const char* linkName(int idx) {
+  return (idx == 1) ? "Remote" : "Local";
+}
+
+// Subscribe to every routed topic
+void subscribeToAllTopics(PubSubClient* client) {
+  if (!client) return;
+  for (size_t i = 0; i < router.count(); i++) {
+    const TopicRoute& r = router.route(i);
+    client->subscribe(r.filter, r.qos);
+  }
+}
+
+// Dispatches through the router; records boot-to-first-data once
+void onMqttMessage(char* topic, byte* payload, unsigned int length) {
+  if (firstDataAt == 0) {
+    firstDataAt = millis();
+    Serial.printf("MQTT: First data %lu ms after boot (%s server)\n", firstDataAt, netGetMqttServerName());
+  }
+  router.dispatch(topic, payload, length);
+}
+
+// Outbox transport: the active session's client
+bool outboxPublish(const char* topic, const char* payload, void* ctx) {
+  (void)ctx;
+  return netIsMqttConnected() && links[activeLink].client()->publish(topic, payload);
+}
+
+// Start an asynchronous attempt on one link (returns immediately)
+bool startLink(int idx) {
+  if (!links[idx].client()) return false;
+  const char* host = (idx == 0) ? cfg.server1 : cfg.server2;
+  uint16_t port = (idx == 0) ? cfg.serverPort1 : cfg.serverPort2;
+  return links[idx].start(host, port, isSecurePort(port), cfg.caCert, linkClientIds[idx], USERNAME, KEY);
+}
+
+bool linkFailed(int idx) {
+  return links[idx].state() == MqttLinkState::FAILED;
+}
+
+// Attempt still running (or already won)
+bool linkPending(int idx) {
+  MqttLinkState s = links[idx].state();
+  return s != MqttLinkState::IDLE && s != MqttLinkState::FAILED;
+}
+
+// Make a connected link own the session
+void activate(int idx) {
+  const MqttLinkTimings& t = links[idx].timings();
+  activeLink = idx;
+  Serial.printf("MQTT: Connected to %s server (dns %lu ms, connect %lu ms, connack %lu ms%s)\n",
+                linkName(idx), (unsigned long)t.dnsMs, (unsigned long)t.connectMs,
+                (unsigned long)t.connackMs,
+                !links[idx].secure() ? "" : links[idx].tlsStats()->lastResumed ? ", tls resumed" : ", tls full");
+
+  if (linkServer(idx) != currentMqttServer) {
+    // Save new preference to NVS since the other server answered first
+    currentMqttServer = linkServer(idx);
+    netSaveMqttServerToNVS();
+  }
+
+  netMetricsRecordConnect(links[idx].secure(), t);
+  netMetricsRecordSession(sessionLostAt != 0, millis() - sessionLostAt);
+  sessionLostAt = 0;
+
+  mqttSuccess = true;
+  sessionCount++;
+  lastLocalProbe = millis();
+  subscribeToAllTopics(links[idx].client());
 }
 
-// Helper to attempt MQTT connection with current server config
-bool tryMqttConnect() {
-  if (!cfg.mqttClient) return false;
+void startRace() {
+  racing = true;
+  raceFirst = linkIndex(currentMqttServer);
+  raceSecondStarted = false;
+  raceStartedAt = millis();
 
-  cfg.mqttClient->disconnect();
-  delay(100);
+  Serial.printf("MQTT: Racing %s and %s servers...\n", linkName(raceFirst), linkName(1 - raceFirst));
+  if (!startLink(raceFirst)) {
+    Serial.printf("MQTT: %s server attempt not started\n", linkName(raceFirst));
+  }
+}
 
-  if (cfg.mqttClient->connect(cfg.clientId, USERNAME, KEY)) {
-    subscribeToAllTopics();
-    return true;
+void pollRace() {
+  int second = 1 - raceFirst;
+
+  // Second server starts after the head start, or at once if the first already failed
+  if (!raceSecondStarted &&
+      (millis() - raceStartedAt >= MQTT_RACE_HEAD_START_MS || !linkPending(raceFirst))) {
+    raceSecondStarted = true;
+    if (!startLink(second)) {
+      Serial.printf("MQTT: %s server attempt not started\n", linkName(second));
+    }
+  }
+
+  // First CONNACK wins; the other attempt is abandoned
+  const int order[2] = { raceFirst, second };
+  for (int idx : order) {
+    if (links[idx].state() == MqttLinkState::CONNECTED) {
+      links[1 - idx].stop();
+      racing = false;
+      activate(idx);
+      return;
+    }
+  }
+
+  if (raceSecondStarted && !linkPending(raceFirst) && !linkPending(second)) {
+    if (linkFailed(raceFirst)) Serial.printf("MQTT: %s server failed (%s)\n", linkName(raceFirst), links[raceFirst].failReason());
+    if (linkFailed(second)) Serial.printf("MQTT: %s server failed (%s)\n", linkName(second), links[second].failReason());
+    Serial.println("MQTT: Both servers failed, will retry");
+    netMetricsRecordRaceFailed();
+    links[0].stop();
+    links[1].stop();
+    racing = false;
+    lastMqttAttempt = millis();   // Next race after MQTT_RECONNECT_INTERVAL
+  }
+}
+
+// While the session is on remote, periodically connect to local in the background
+// and move the session there once it answers (lower latency, no TLS cost)
+void pollLocalProbe() {
+  int local = linkIndex(MQTT_SERVER_LOCAL);
+  if (activeLink == local) return;
+
+  if (!probing) {
+    if (millis() - lastLocalProbe >= MQTT_LOCAL_PROBE_INTERVAL_MS && startLink(local)) {
+      probing = true;
+    }
+    return;
+  }
+
+  if (links[local].state() == MqttLinkState::CONNECTED) {
+    probing = false;
+    Serial.println("MQTT: Local server is back, switching from Remote");
+    links[activeLink].stop();
+    activate(local);
+  } else if (linkFailed(local)) {
+    probing = false;
+    links[local].stop();
+    lastLocalProbe = millis();
   }
-  return false;
 }
 
 }  // namespace
 
 void netInit(const NetConfig& c) {
   cfg = c;
-  if (cfg.mqttClient) {
-    // mqttClient is owned by the sketch; we just configure it here.
-    cfg.mqttClient->setBufferSize(512);
-    if (cfg.mqttCallback) {
-      cfg.mqttClient->setCallback(cfg.mqttCallback);
-    }
+  PubSubClient* clients[LINK_COUNT] = { cfg.mqttClient, cfg.mqttClient2 };
+  WiFiClient* plain[LINK_COUNT] = { cfg.wifiClient, cfg.wifiClient2 };
+  TlsSessionClient* secure[LINK_COUNT] = { cfg.secureClient, cfg.secureClient2 };
+
+  for (int i = 0; i < LINK_COUNT; i++) {
+    snprintf(linkClientIds[i], sizeof(linkClientIds[i]), "%s-%c",
+             cfg.clientId ? cfg.clientId : "", linkServer(i) == MQTT_SERVER_REMOTE ? 'R' : 'L');
+    if (!clients[i]) continue;
+    // Clients are owned by the sketch; we just configure them here.
+    // Receive buffer grows with the routes' maxPayload (netSubscribe)
+    clients[i]->setBufferSize(MQTT_MIN_BUFFER_SIZE);
+    clients[i]->setCallback(onMqttMessage);
+    links[i].attach(clients[i], plain[i], secure[i]);
+  }
+
+  if (!outbox.begin(outboxPublish, nullptr)) {
+    Serial.println("MQTT: Outbox allocation failed, publishes are dropped while disconnected");
   }
 }
 
 void netConfigureMqttClient(int connection) {
-  if (!cfg.mqttClient || !cfg.wifiClient || !cfg.secureClient) return;
+  currentMqttServer = (connection == MQTT_SERVER_REMOTE) ? MQTT_SERVER_REMOTE : MQTT_SERVER_LOCAL;
+}
+
+void netLoop() {
+  for (int i = 0; i < LINK_COUNT; i++) {
+    links[i].poll();
+  }
 
-  if (connection == 1) {
-    if (isSecurePort(cfg.serverPort1)) {
-      cfg.secureClient->setCACert(cfg.caCert);
-      cfg.mqttClient->setClient(*cfg.secureClient);
+  if (racing) {
+    pollRace();
+  } else if (activeLink >= 0) {
+    if (linkFailed(activeLink)) {
+      Serial.printf("MQTT: Connection to %s server lost\n", linkName(activeLink));
+      links[activeLink].stop();
+      activeLink = -1;
+      sessionLostAt = millis();
+      lastMqttAttempt = millis();
+      if (probing) {
+        // A local probe that already has its session takes over instead of a new race
+        int local = linkIndex(MQTT_SERVER_LOCAL);
+        probing = false;
+        if (links[local].state() == MqttLinkState::CONNECTED) {
+          Serial.println("MQTT: Local probe connected, taking over the session");
+          activate(local);
+        } else {
+          links[local].stop();
+        }
+      }
     } else {
-      cfg.mqttClient->setClient(*cfg.wifiClient);
+      pollLocalProbe();
     }
-    cfg.mqttClient->setServer(cfg.server1, cfg.serverPort1);
+  }
+
+  if (activeLink >= 0) {
+    links[activeLink].client()->loop();
   } else {
-    if (isSecurePort(cfg.serverPort2)) {
-      cfg.secureClient->setCACert(cfg.caCert);
-      cfg.mqttClient->setClient(*cfg.secureClient);
-    } else {
-      cfg.mqttClient->setClient(*cfg.wifiClient);
-    }
-    cfg.mqttClient->setServer(cfg.server2, cfg.serverPort2);
+    netCheckMqtt();
   }
+
+  // Expire stale messages; send queued ones once a session is up
+  outbox.flush(millis(), netIsMqttConnected());
+
+  netMetricsLoop();
 }
 
 void netCheckMqtt(bool bypassRateLimit) {
-  if (!cfg.mqttClient) return;
+  if (!cfg.mqttClient || !cfg.mqttClient2) return;
+  if (activeLink >= 0 || racing) return;
 
-  if (!cfg.mqttClient->connected()) {
-    unsigned long currentTime = millis();
-    if (!bypassRateLimit && currentTime - lastMqttAttempt < MQTT_RECONNECT_INTERVAL) {
-      return;
-    }
-    lastMqttAttempt = currentTime;
+  // Workers of abandoned attempts still exiting
+  if (links[0].busy() || links[1].busy()) return;
 
-    Serial.printf("MQTT: Reconnecting to %s server...\n", netGetMqttServerName());
+  unsigned long currentTime = millis();
+  if (!bypassRateLimit && currentTime - lastMqttAttempt < MQTT_RECONNECT_INTERVAL) {
+    return;
+  }
+  lastMqttAttempt = currentTime;
+  startRace();
+}
 
-    cfg.mqttClient->disconnect();  // clean stale state
-    delay(100);
+bool netSubscribe(const char* filter, TopicHandler handler, size_t maxPayload, uint8_t qos) {
+  if (!router.add(filter, handler, maxPayload, qos)) {
+    Serial.printf("MQTT: Cannot route %s\n", filter ? filter : "(null)");
+    return false;
+  }
 
-    if (cfg.mqttClient->connect(cfg.clientId, USERNAME, KEY)) {
-      mqttSuccess = true;
-      Serial.println("MQTT: Reconnected successfully");
-      subscribeToAllTopics();
+  // Receive buffer must hold the largest accepted PUBLISH: fixed header (<= 5),
+  // topic length (2), topic, packet id (2) and payload. Wildcard topics get a margin.
+  size_t topicLen = strchr(filter, '+') || strchr(filter, '#') ? MQTT_WILDCARD_TOPIC_MARGIN : strlen(filter);
+  size_t needed = 5 + 2 + topicLen + 2 + maxPayload;
+  for (int i = 0; i < LINK_COUNT; i++) {
+    PubSubClient* client = links[i].client();
+    if (client && client->getBufferSize() < needed) {
+      client->setBufferSize(needed);
     }
   }
+
+  if (netIsMqttConnected()) {
+    links[activeLink].client()->subscribe(filter, qos);
+  }
+  return true;
+}
+
+bool netPublish(const char* topic, const char* payload, OutboxPriority priority, const char* dedupKey) {
+  if (!outbox.enqueue(topic, payload, priority, dedupKey, millis())) {
+    Serial.printf("MQTT: Outbox refused message on %s\n", topic);
+    netMetricsRecordPublishRefused();
+    return false;
+  }
+  // Send right away when connected; otherwise it waits for the next session
+  outbox.flush(millis(), netIsMqttConnected());
+  return true;
+}
+
+bool netCancelPublish(const char* dedupKey) {
+  return outbox.cancel(dedupKey);
 }
 
 bool netIsMqttConnected() {
-  return cfg.mqttClient && cfg.mqttClient->connected();
+  return activeLink >= 0 && links[activeLink].client()->connected();
 }
 
 bool netHasInitialMqttSuccess() {
@@ -123,63 +348,68 @@ const char* netGetMqttServerName() {
   return (currentMqttServer == MQTT_SERVER_LOCAL) ? "Local" : "Remote";
 }
 
-void netLoadMqttServerFromNVS() {
-  preferences.begin(NVS_NAMESPACE, true);  // read-only
-  currentMqttServer = preferences.getInt(NVS_KEY_MQTT_SERVER, MQTT_SERVER_LOCAL);
-  preferences.end();
+const char* netGetMqttLinkState() {
+  if (activeLink >= 0) return links[activeLink].stateName();
 
-  // Validate value
-  if (currentMqttServer != MQTT_SERVER_LOCAL && currentMqttServer != MQTT_SERVER_REMOTE) {
-    currentMqttServer = MQTT_SERVER_LOCAL;
+  // Furthest attempt in progress
+  int best = -1;
+  for (int i = 0; i < LINK_COUNT; i++) {
+    if (!linkPending(i)) continue;
+    if (best < 0 || links[i].state() > links[best].state()) best = i;
   }
+  return (best >= 0) ? links[best].stateName() : "idle";
+}
 
-  Serial.printf("NVS: Loaded MQTT server preference: %s\n", netGetMqttServerName());
+uint32_t netGetMqttSessionCount() {
+  return sessionCount;
 }
 
-void netSaveMqttServerToNVS() {
-  preferences.begin(NVS_NAMESPACE, false);  // read-write
-  preferences.putInt(NVS_KEY_MQTT_SERVER, currentMqttServer);
-  preferences.end();
+unsigned long netGetFirstDataMs() {
+  return firstDataAt;
+}
 
-  Serial.printf("NVS: Saved MQTT server preference: %s\n", netGetMqttServerName());
+TopicRouterStats netGetTopicStats() {
+  return router.stats();
 }
 
-bool netConnectMqttWithFallback() {
-  if (!cfg.mqttClient) return false;
+const TlsHandshakeStats* netGetTlsStats(int connection) {
+  return links[linkIndex(connection)].tlsStats();
+}
+
+OutboxStats netGetOutboxStats() {
+  return outbox.stats();
+}
 
-  int originalServer = currentMqttServer;  // Save original preference
+size_t netGetRouteCount() {
+  return router.count();
+}
+
+const TopicRoute& netGetRoute(size_t i) {
+  return router.route(i);
+}
 
-  // Try the stored/current server first
-  Serial.printf("MQTT: Trying %s server...\n", netGetMqttServerName());
-  netConfigureMqttClient(currentMqttServer);
+void netLoadMqttServerFromNVS() {
+  currentMqttServer = settingsGetInt(SETTING_MQTT_SERVER, MQTT_SERVER_LOCAL);
 
-  if (tryMqttConnect()) {
-    mqttSuccess = true;
-    Serial.printf("MQTT: Connected to %s server\n", netGetMqttServerName());
-    return true;
+  // Validate value
+  if (currentMqttServer != MQTT_SERVER_LOCAL && currentMqttServer != MQTT_SERVER_REMOTE) {
+    currentMqttServer = MQTT_SERVER_LOCAL;
   }
 
-  Serial.printf("MQTT: %s server failed, trying fallback...\n", netGetMqttServerName());
+  Serial.printf("NVS: Loaded MQTT server preference: %s\n", netGetMqttServerName());
+}
 
-  // Try the fallback server
-  int fallbackServer = (currentMqttServer == MQTT_SERVER_LOCAL)
-                        ? MQTT_SERVER_REMOTE
-                        : MQTT_SERVER_LOCAL;
+void netSaveMqttServerToNVS() {
+  settingsSetInt(SETTING_MQTT_SERVER, currentMqttServer);  // Written on the next settings flush
 
-  currentMqttServer = fallbackServer;
-  netConfigureMqttClient(currentMqttServer);
+  Serial.printf("NVS: Saved MQTT server preference: %s\n", netGetMqttServerName());
+}
 
-  if (tryMqttConnect()) {
-    mqttSuccess = true;
-    // Save new preference to NVS since fallback succeeded
-    netSaveMqttServerToNVS();
-    Serial.printf("MQTT: Connected to %s server (fallback)\n", netGetMqttServerName());
-    return true;
-  }
+bool netConnectMqttWithFallback() {
+  if (!cfg.mqttClient || !cfg.mqttClient2) return false;
+  if (activeLink >= 0 || racing) return true;
 
-  // Both failed - restore original server preference
-  Serial.println("MQTT: Both servers failed, restoring original preference");
-  currentMqttServer = originalServer;
-  netConfigureMqttClient(currentMqttServer);
-  return false;
+  lastMqttAttempt = millis();
+  startRace();
+  return true;
 }
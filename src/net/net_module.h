@@ -1,58 +1,86 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Preferences.h>
 #include <PubSubClient.h>
 #include <WiFiClient.h>
-#include <WiFiClientSecure.h>
+
+#include "mqtt_outbox.h"
+#include "tls_session_client.h"
+#include "topic_router.h"
 
 // MQTT server constants
 constexpr int MQTT_SERVER_LOCAL = 1;
 constexpr int MQTT_SERVER_REMOTE = 2;
 
-struct NetTopics {
-  const char* image;
-  const char* power;
-  const char* energy;
-  const char* weather;
-  const char* light;
-};
+// Parallel connect ("happy eyeballs")
+constexpr unsigned long MQTT_RACE_HEAD_START_MS = 250;     // Preferred server's lead before the other starts
+constexpr unsigned long MQTT_LOCAL_PROBE_INTERVAL_MS = 60000;  // While on remote, retry local this often
 
 struct NetConfig {
-  // NOTE: mqttClient is supplied by the sketch (home_panel.ino). We keep only a
-  // pointer here so the module operates on the single shared instance created
-  // in the sketch; we do not create or own another client.
+  // NOTE: clients are supplied by the sketch (home_panel.ino). We keep only
+  // pointers here; we do not create or own any client. Each server has its own
+  // set (server1: mqttClient/wifiClient/secureClient, server2: the *2 fields)
+  // so both can be connected in parallel.
   const char* server1;
   uint16_t serverPort1;
   const char* server2;
   uint16_t serverPort2;
   const char* caCert;
-  const char* clientId;  // Dynamic MQTT client ID (e.g., "homeA1B2C")
+  const char* clientId;  // Dynamic MQTT client ID (e.g., "homeA1B2C"); links add "-L" / "-R"
   PubSubClient* mqttClient;
   WiFiClient* wifiClient;
-  WiFiClientSecure* secureClient;
-  void (*mqttCallback)(char*, byte*, unsigned int);
-  NetTopics topics;
+  TlsSessionClient* secureClient;   // Keeps the TLS session for resumption
+  PubSubClient* mqttClient2;
+  WiFiClient* wifiClient2;
+  TlsSessionClient* secureClient2;
 };
 
-// Initialize module with static configuration (servers, clients, topics)
+// Initialize module with static configuration (servers, clients)
 void netInit(const NetConfig& cfg);
 
-// Configure MQTT client transport/server based on connection index (1 or 2)
+// Select the preferred server (1 or 2); it gets the head start in the next race
 void netConfigureMqttClient(int connection);
 
+// Drive the non-blocking connect state machine and the MQTT client (call from loop())
+void netLoop();
+
 // MQTT reconnect handler; respects internal rate limiting unless bypassRateLimit=true
+// Starts an asynchronous race of both servers and returns immediately
 void netCheckMqtt(bool bypassRateLimit = false);
 
+// Route a topic filter ('+'/'#' allowed) to a handler; the subscription is made on
+// every session, immediately if one is active. Messages over maxPayload are dropped
+// and the client receive buffer is grown to fit the largest accepted message.
+bool netSubscribe(const char* filter, TopicHandler handler, size_t maxPayload, uint8_t qos = 1);
+
+// Queue a message in the outbox; it is sent at once when connected, otherwise on
+// the next session (until its priority's TTL). A queued message with the same
+// dedupKey is replaced. Returns false if the outbox refused it.
+bool netPublish(const char* topic, const char* payload,
+                OutboxPriority priority = OutboxPriority::NORMAL, const char* dedupKey = nullptr);
+
+// Withdraw a message still waiting in the outbox (not yet sent); false if none
+bool netCancelPublish(const char* dedupKey);
+
 // Accessors
 bool netIsMqttConnected();
 bool netHasInitialMqttSuccess();
 int netGetCurrentMqttServer();
 const char* netGetMqttServerName();
+const char* netGetMqttLinkState();  // "dns", "tcp", "tls", "connack", "connected", ...
+uint32_t netGetMqttSessionCount();  // Incremented each time a session becomes active (reconnect or switch)
+unsigned long netGetFirstDataMs();  // millis() at the first received message, 0 until then
+TopicRouterStats netGetTopicStats();
+const TlsHandshakeStats* netGetTlsStats(int connection);  // nullptr if not configured
+OutboxStats netGetOutboxStats();
+size_t netGetRouteCount();
+const TopicRoute& netGetRoute(size_t i);
 
 // NVS functions for MQTT server preference
 void netLoadMqttServerFromNVS();
 void netSaveMqttServerToNVS();
 
-// Fallback connection logic (for boot-time use)
+// Boot-time connection: races both servers (stored one first, the other after
+// MQTT_RACE_HEAD_START_MS) and keeps the first CONNACK, saving it as the new
+// preference; returns false if the clients are not configured
 bool netConnectMqttWithFallback();
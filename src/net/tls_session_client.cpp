@@ -0,0 +1,372 @@
+#include "tls_session_client.h"
+
+#include <WiFi.h>
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+#include <mbedtls/error.h>
+
+namespace {
+
+// ECDHE-P256 first (S3 ECC accelerator), X25519 as software fallback
+const uint16_t TLS_GROUPS[] = {
+  MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1,
+  MBEDTLS_SSL_IANA_TLS_GROUP_X25519,
+  MBEDTLS_SSL_IANA_TLS_GROUP_SECP384R1,
+  MBEDTLS_SSL_IANA_TLS_GROUP_NONE
+};
+
+// ECDHE with AES-GCM first; plain RSA key exchange last for older brokers
+const int TLS_CIPHERSUITES[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+  MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,
+  0
+};
+
+const char DRBG_PERSONALIZATION[] = "homepanel-mqtt";
+
+void logMbedtlsError(const char* what, int ret) {
+  char buf[96];
+  mbedtls_strerror(ret, buf, sizeof(buf));
+  Serial.printf("TLS: %s failed: -0x%04X %s\n", what, (unsigned)-ret, buf);
+}
+
+// Called for each certificate verified: only a full handshake sends the server's certificate
+int certSeenCallback(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+  (void)crt;
+  (void)depth;
+  (void)flags;
+  *static_cast<bool*>(ctx) = true;
+  return 0;
+}
+
+}  // namespace
+
+TlsSessionClient::TlsSessionClient() {
+  mbedtls_ssl_init(&ssl_);
+  mbedtls_ssl_config_init(&conf_);
+  mbedtls_ctr_drbg_init(&drbg_);
+  mbedtls_entropy_init(&entropy_);
+  mbedtls_x509_crt_init(&ca_);
+  mbedtls_ssl_session_init(&session_);
+}
+
+TlsSessionClient::~TlsSessionClient() {
+  stop();
+  mbedtls_ssl_session_free(&session_);
+  mbedtls_x509_crt_free(&ca_);
+  mbedtls_entropy_free(&entropy_);
+  mbedtls_ctr_drbg_free(&drbg_);
+  mbedtls_ssl_config_free(&conf_);
+  mbedtls_ssl_free(&ssl_);
+}
+
+void TlsSessionClient::setCACert(const char* caCert) {
+  caCert_ = caCert;
+}
+
+void TlsSessionClient::clearSession() {
+  mbedtls_ssl_session_free(&session_);
+  mbedtls_ssl_session_init(&session_);
+  haveSession_ = false;
+  sessionHost_[0] = '\0';
+}
+
+// ============================================================================
+// Configuration (once; CA re-parsed only when it changes)
+// ============================================================================
+
+bool TlsSessionClient::setupConfig() {
+  if (!configured_) {
+    int ret = mbedtls_ctr_drbg_seed(&drbg_, mbedtls_entropy_func, &entropy_,
+                                    reinterpret_cast<const unsigned char*>(DRBG_PERSONALIZATION),
+                                    sizeof(DRBG_PERSONALIZATION) - 1);
+    if (ret != 0) {
+      logMbedtlsError("drbg seed", ret);
+      return false;
+    }
+
+    ret = mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+      logMbedtlsError("config", ret);
+      return false;
+    }
+    mbedtls_ssl_conf_rng(&conf_, mbedtls_ctr_drbg_random, &drbg_);
+    mbedtls_ssl_conf_max_tls_version(&conf_, MBEDTLS_SSL_VERSION_TLS1_2);
+    mbedtls_ssl_conf_groups(&conf_, TLS_GROUPS);
+    mbedtls_ssl_conf_ciphersuites(&conf_, TLS_CIPHERSUITES);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    configured_ = true;
+  }
+
+  if (caCert_ != parsedCaCert_) {
+    mbedtls_x509_crt_free(&ca_);
+    mbedtls_x509_crt_init(&ca_);
+    parsedCaCert_ = nullptr;
+    if (caCert_) {
+      int ret = mbedtls_x509_crt_parse(&ca_, reinterpret_cast<const unsigned char*>(caCert_),
+                                       strlen(caCert_) + 1);
+      if (ret != 0) {
+        logMbedtlsError("CA parse", ret);
+        return false;
+      }
+      mbedtls_ssl_conf_ca_chain(&conf_, &ca_, nullptr);
+      mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+    } else {
+      // No CA: result ignored, but the chain is still walked so full handshakes are seen
+      mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    }
+    parsedCaCert_ = caCert_;
+    clearSession();   // Sessions were verified against the previous CA
+  }
+  return true;
+}
+
+// ============================================================================
+// Connect + Handshake
+// ============================================================================
+
+int TlsSessionClient::connect(const char* host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return connect(ip, port, host, 10000);
+}
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port, const char* host, uint32_t timeoutMs) {
+  stop();
+  if (!setupConfig()) return 0;
+
+  int64_t startUs = esp_timer_get_time();
+  auto remainingMs = [&]() -> uint32_t {
+    int64_t elapsed = (esp_timer_get_time() - startUs) / 1000;
+    return elapsed >= (int64_t)timeoutMs ? 0 : timeoutMs - (uint32_t)elapsed;
+  };
+
+  // Non-blocking TCP connect
+  sock_ = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock_ < 0) return 0;
+  lwip_fcntl(sock_, F_SETFL, lwip_fcntl(sock_, F_GETFL, 0) | O_NONBLOCK);
+  int one = 1;
+  lwip_setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)ip;
+  if (lwip_connect(sock_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+    stop();
+    return 0;
+  }
+  int soError = 0;
+  socklen_t soLen = sizeof(soError);
+  if (!waitSocket(true, remainingMs()) ||
+      lwip_getsockopt(sock_, SOL_SOCKET, SO_ERROR, &soError, &soLen) < 0 || soError != 0) {
+    stop();
+    return 0;
+  }
+
+  // TLS context for this connection
+  mbedtls_ssl_free(&ssl_);
+  mbedtls_ssl_init(&ssl_);
+  int ret = mbedtls_ssl_setup(&ssl_, &conf_);
+  if (ret != 0) {
+    logMbedtlsError("ssl setup", ret);
+    stop();
+    return 0;
+  }
+  if (host) mbedtls_ssl_set_hostname(&ssl_, host);
+  mbedtls_ssl_set_bio(&ssl_, &sock_, sendCallback, recvCallback, nullptr);
+  bool certSeen = false;
+  mbedtls_ssl_set_verify(&ssl_, certSeenCallback, &certSeen);
+
+  // Offer the cached session to the same host
+  bool offered = false;
+  if (haveSession_ && host && strcmp(host, sessionHost_) == 0 &&
+      mbedtls_ssl_set_session(&ssl_, &session_) == 0) {
+    offered = true;
+  }
+
+  // Step the handshake; only time spent inside mbedTLS counts as CPU
+  int64_t handshakeStartUs = esp_timer_get_time();
+  int64_t cpuUs = 0;
+  while (true) {
+    int64_t stepStart = esp_timer_get_time();
+    ret = mbedtls_ssl_handshake(&ssl_);
+    cpuUs += esp_timer_get_time() - stepStart;
+
+    if (ret == 0) break;
+
+    bool wantRead = (ret == MBEDTLS_ERR_SSL_WANT_READ);
+    if ((!wantRead && ret != MBEDTLS_ERR_SSL_WANT_WRITE) || !waitSocket(!wantRead, remainingMs())) {
+      if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        logMbedtlsError("handshake", ret);
+      } else {
+        Serial.println("TLS: handshake timeout");
+      }
+      stats_.failures++;
+      if (offered) clearSession();   // Do not keep offering a session that may be the cause
+      stop();
+      return 0;
+    }
+  }
+  uint32_t wallMs = (uint32_t)((esp_timer_get_time() - handshakeStartUs) / 1000);
+  mbedtls_ssl_set_verify(&ssl_, nullptr, nullptr);   // certSeen goes out of scope
+
+  // Resumed if the server accepted the offered session (no certificate was sent)
+  bool resumed = offered && !certSeen;
+  mbedtls_ssl_session negotiated;
+  mbedtls_ssl_session_init(&negotiated);
+  if (mbedtls_ssl_get_session(&ssl_, &negotiated) == 0) {
+    // Cache the (possibly renewed) session for the next reconnect
+    mbedtls_ssl_session_free(&session_);
+    session_ = negotiated;
+    haveSession_ = true;
+    strncpy(sessionHost_, host ? host : "", sizeof(sessionHost_) - 1);
+    sessionHost_[sizeof(sessionHost_) - 1] = '\0';
+  } else {
+    mbedtls_ssl_session_free(&negotiated);
+  }
+  if (offered && !resumed) stats_.resumeRejected++;
+
+  recordHandshake(resumed, wallMs, (uint32_t)(cpuUs / 1000));
+  Serial.printf("TLS: %s handshake in %lu ms (cpu %lu ms, %s)\n",
+                resumed ? "resumed" : "full", (unsigned long)wallMs, (unsigned long)(cpuUs / 1000),
+                mbedtls_ssl_get_ciphersuite(&ssl_));
+
+  connected_ = true;
+  return 1;
+}
+
+void TlsSessionClient::recordHandshake(bool resumed, uint32_t wallMs, uint32_t cpuMs) {
+  stats_.lastResumed = resumed;
+  stats_.lastWallMs = wallMs;
+  stats_.lastCpuMs = cpuMs;
+  if (resumed) {
+    stats_.resumed++;
+    stats_.resumedWallMs += wallMs;
+    stats_.resumedCpuMs += cpuMs;
+  } else {
+    stats_.full++;
+    stats_.fullWallMs += wallMs;
+    stats_.fullCpuMs += cpuMs;
+  }
+}
+
+bool TlsSessionClient::waitSocket(bool forWrite, uint32_t timeoutMs) {
+  if (sock_ < 0 || timeoutMs == 0) return false;
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(sock_, &fds);
+  struct timeval tv = { (long)(timeoutMs / 1000), (long)((timeoutMs % 1000) * 1000) };
+  int n = forWrite ? lwip_select(sock_ + 1, nullptr, &fds, nullptr, &tv)
+                   : lwip_select(sock_ + 1, &fds, nullptr, nullptr, &tv);
+  return n > 0;
+}
+
+int TlsSessionClient::sendCallback(void* ctx, const unsigned char* buf, size_t len) {
+  int fd = *static_cast<int*>(ctx);
+  int n = lwip_send(fd, buf, len, 0);
+  if (n >= 0) return n;
+  return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsSessionClient::recvCallback(void* ctx, unsigned char* buf, size_t len) {
+  int fd = *static_cast<int*>(ctx);
+  int n = lwip_recv(fd, buf, len, 0);
+  if (n > 0) return n;
+  if (n == 0) return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+  return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+// ============================================================================
+// Client Interface (app task)
+// ============================================================================
+
+size_t TlsSessionClient::write(const uint8_t* buf, size_t size) {
+  if (!connected_) return 0;
+  size_t written = 0;
+  int64_t deadline = esp_timer_get_time() + (int64_t)TLS_SESSION_WRITE_TIMEOUT_MS * 1000;
+  while (written < size) {
+    int ret = mbedtls_ssl_write(&ssl_, buf + written, size - written);
+    if (ret > 0) {
+      written += ret;
+      continue;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) {
+      stop();
+      break;
+    }
+    int64_t left = (deadline - esp_timer_get_time()) / 1000;
+    if (left <= 0 || !waitSocket(ret == MBEDTLS_ERR_SSL_WANT_WRITE, (uint32_t)left)) break;
+  }
+  return written;
+}
+
+int TlsSessionClient::available() {
+  if (!connected_) return 0;
+  int pending = (peeked_ >= 0) ? 1 : 0;
+  // Zero-length read processes incoming records without consuming application data
+  int ret = mbedtls_ssl_read(&ssl_, nullptr, 0);
+  if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    size_t buffered = mbedtls_ssl_get_bytes_avail(&ssl_);
+    if (buffered == 0 && pending == 0) {
+      stop();
+      return 0;
+    }
+  }
+  return pending + (int)mbedtls_ssl_get_bytes_avail(&ssl_);
+}
+
+int TlsSessionClient::read() {
+  uint8_t b;
+  return (read(&b, 1) == 1) ? b : -1;
+}
+
+int TlsSessionClient::read(uint8_t* buf, size_t size) {
+  if (!connected_ || size == 0) return -1;
+  size_t n = 0;
+  if (peeked_ >= 0) {
+    buf[n++] = (uint8_t)peeked_;
+    peeked_ = -1;
+    if (n == size) return n;
+  }
+  int ret = mbedtls_ssl_read(&ssl_, buf + n, size - n);
+  if (ret > 0) return n + ret;
+  if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    stop();
+  }
+  return n > 0 ? (int)n : -1;
+}
+
+int TlsSessionClient::peek() {
+  if (peeked_ < 0) {
+    uint8_t b;
+    int ret = connected_ ? mbedtls_ssl_read(&ssl_, &b, 1) : -1;
+    if (ret == 1) peeked_ = b;
+  }
+  return peeked_;
+}
+
+void TlsSessionClient::stop() {
+  if (connected_) {
+    mbedtls_ssl_close_notify(&ssl_);
+  }
+  connected_ = false;
+  peeked_ = -1;
+  if (sock_ >= 0) {
+    lwip_close(sock_);
+    sock_ = -1;
+  }
+}
+
+uint8_t TlsSessionClient::connected() {
+  if (connected_ && peeked_ < 0 && mbedtls_ssl_get_bytes_avail(&ssl_) == 0) {
+    available();   // Notices a closed peer
+  }
+  return connected_;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+// ============================================================================
+// TLS Session Client
+// ============================================================================
+// mbedTLS client over a non-blocking lwIP socket, used in place of
+// WiFiClientSecure for the MQTT brokers:
+//
+// - The session (ID or ticket) of the last successful handshake is kept and
+//   offered on the next connect to the same host, so reconnects do an
+//   abbreviated handshake without certificate verification or key exchange
+// - ECDHE over P-256 is preferred (hardware-accelerated ECC on the S3), with
+//   AES-GCM suites first; TLS 1.2 so session-ID/ticket resumption applies
+// - The handshake is stepped on a non-blocking socket: time inside
+//   mbedtls_ssl_handshake() is counted as CPU, time waiting in select() is not
+//
+// connect() is still a long call (it returns after the handshake or the
+// timeout); MqttLink runs it on its worker task.
+// ============================================================================
+
+constexpr uint32_t TLS_SESSION_WRITE_TIMEOUT_MS = 3000;   // Max wait for socket space per write()
+
+struct TlsHandshakeStats {
+  uint32_t full;              // Completed full handshakes
+  uint32_t resumed;           // Completed abbreviated handshakes
+  uint32_t failures;
+  uint32_t resumeRejected;    // Session offered but the server did a full handshake
+  uint32_t lastWallMs;
+  uint32_t lastCpuMs;
+  bool lastResumed;
+  uint64_t fullWallMs;        // Sums, for averages
+  uint64_t fullCpuMs;
+  uint64_t resumedWallMs;
+  uint64_t resumedCpuMs;
+};
+
+class TlsSessionClient : public Client {
+public:
+  TlsSessionClient();
+  ~TlsSessionClient();
+
+  // PEM CA certificate; parsed on the next connect if it changed
+  void setCACert(const char* caCert);
+
+  // Connect and handshake within timeoutMs; host is used for SNI and verification
+  int connect(IPAddress ip, uint16_t port, const char* host, uint32_t timeoutMs);
+
+  // Forget the cached session (next connect does a full handshake)
+  void clearSession();
+
+  const TlsHandshakeStats& stats() const { return stats_; }
+
+  // Client interface
+  int connect(IPAddress ip, uint16_t port) { return connect(ip, port, nullptr, 10000); }
+  int connect(const char* host, uint16_t port);
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size);
+  int available();
+  int read();
+  int read(uint8_t* buf, size_t size);
+  int peek();
+  void flush() {}
+  void stop();
+  uint8_t connected();
+  operator bool() { return connected(); }
+
+private:
+  bool setupConfig();
+  bool waitSocket(bool forWrite, uint32_t timeoutMs);
+  void recordHandshake(bool resumed, uint32_t wallMs, uint32_t cpuMs);
+  static int sendCallback(void* ctx, const unsigned char* buf, size_t len);
+  static int recvCallback(void* ctx, unsigned char* buf, size_t len);
+
+  int sock_ = -1;
+  bool connected_ = false;
+  int peeked_ = -1;
+
+  bool configured_ = false;
+  const char* caCert_ = nullptr;
+  const char* parsedCaCert_ = nullptr;
+  mbedtls_ssl_context ssl_;
+  mbedtls_ssl_config conf_;
+  mbedtls_ctr_drbg_context drbg_;
+  mbedtls_entropy_context entropy_;
+  mbedtls_x509_crt ca_;
+
+  // Session cache (one entry: this client always talks to the same broker)
+  mbedtls_ssl_session session_;
+  bool haveSession_ = false;
+  char sessionHost_[64] = "";
+
+  TlsHandshakeStats stats_ = {};
+};
@@ -0,0 +1,161 @@
+#include "topic_router.h"
+
+#include <ctype.h>
+#include <math.h>
+
+static_assert((TOPIC_ROUTER_HASH_SLOTS & (TOPIC_ROUTER_HASH_SLOTS - 1)) == 0,
+              "TOPIC_ROUTER_HASH_SLOTS must be a power of two");
+static_assert(TOPIC_ROUTER_HASH_SLOTS >= 2 * TOPIC_ROUTER_MAX_ROUTES,
+              "Hash table must stay at most half full");
+
+// ============================================================================
+// Payload View
+// ============================================================================
+
+bool PayloadView::equals(const char* s) const {
+  size_t n = strlen(s);
+  return n == len && memcmp(data, s, n) == 0;
+}
+
+const char* PayloadView::find(const char* needle) const {
+  size_t n = strlen(needle);
+  if (n == 0 || n > len) return nullptr;
+  const char* last = data + len - n;
+  for (const char* p = data; p <= last; p++) {
+    p = static_cast<const char*>(memchr(p, needle[0], last - p + 1));
+    if (!p) return nullptr;
+    if (memcmp(p, needle, n) == 0) return p;
+  }
+  return nullptr;
+}
+
+bool PayloadView::parseFloat(float* out) const {
+  const char* p = data;
+  const char* e = end();
+  while (p < e && isspace((unsigned char)*p)) p++;
+  while (e > p && isspace((unsigned char)e[-1])) e--;
+
+  // Copy the token: strtof needs a terminator the view does not have
+  char token[24];
+  size_t n = e - p;
+  if (n == 0 || n >= sizeof(token)) return false;
+  memcpy(token, p, n);
+  token[n] = '\0';
+
+  char* parsed;
+  float value = strtof(token, &parsed);
+  if (parsed != token + n || !isfinite(value)) return false;   // Trailing garbage, nan, inf
+  *out = value;
+  return true;
+}
+
+// ============================================================================
+// Topic Router
+// ============================================================================
+
+TopicRouter::TopicRouter() {
+  memset(slots_, -1, sizeof(slots_));
+}
+
+uint32_t TopicRouter::hashTopic(const char* s) {
+  uint32_t h = 2166136261u;   // FNV-1a
+  while (*s) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+bool TopicRouter::add(const char* filter, TopicHandler handler, size_t maxPayload, uint8_t qos) {
+  if (!filter || !*filter || !handler || count_ >= TOPIC_ROUTER_MAX_ROUTES) return false;
+
+  for (size_t i = 0; i < count_; i++) {
+    if (strcmp(routes_[i].filter, filter) == 0) return false;
+  }
+
+  TopicRoute& r = routes_[count_];
+  r.filter = filter;
+  r.handler = handler;
+  r.maxPayload = maxPayload;
+  r.qos = qos;
+  r.wildcard = strpbrk(filter, "+#") != nullptr;
+  r.hash = hashTopic(filter);
+  r.delivered = 0;
+  r.rejected = 0;
+
+  if (r.wildcard) {
+    wildcards_[wildcardCount_++] = (uint8_t)count_;
+  } else {
+    size_t slot = r.hash & (TOPIC_ROUTER_HASH_SLOTS - 1);
+    while (slots_[slot] >= 0) {
+      slot = (slot + 1) & (TOPIC_ROUTER_HASH_SLOTS - 1);
+    }
+    slots_[slot] = (int8_t)count_;
+  }
+  count_++;
+  return true;
+}
+
+TopicRoute* TopicRouter::find(const char* topic) {
+  uint32_t h = hashTopic(topic);
+  size_t slot = h & (TOPIC_ROUTER_HASH_SLOTS - 1);
+  while (slots_[slot] >= 0) {
+    TopicRoute& r = routes_[slots_[slot]];
+    if (r.hash == h && strcmp(r.filter, topic) == 0) return &r;
+    slot = (slot + 1) & (TOPIC_ROUTER_HASH_SLOTS - 1);
+  }
+
+  for (size_t i = 0; i < wildcardCount_; i++) {
+    TopicRoute& r = routes_[wildcards_[i]];
+    if (matches(r.filter, topic)) return &r;
+  }
+  return nullptr;
+}
+
+bool TopicRouter::dispatch(const char* topic, const uint8_t* payload, size_t length) {
+  TopicRoute* r = find(topic);
+  if (!r) {
+    unrouted_++;
+    Serial.printf("MQTT: No route for %s\n", topic);
+    return false;
+  }
+  if (length > r->maxPayload) {
+    r->rejected++;
+    Serial.printf("MQTT: Dropped %u-byte message on %s (max %u)\n",
+                  (unsigned)length, topic, (unsigned)r->maxPayload);
+    return false;
+  }
+
+  r->delivered++;
+  r->handler(topic, PayloadView{ reinterpret_cast<const char*>(payload), length });
+  return true;
+}
+
+TopicRouterStats TopicRouter::stats() const {
+  TopicRouterStats s = { 0, 0, unrouted_ };
+  for (size_t i = 0; i < count_; i++) {
+    s.delivered += routes_[i].delivered;
+    s.rejected += routes_[i].rejected;
+  }
+  return s;
+}
+
+bool TopicRouter::matches(const char* filter, const char* topic) {
+  while (*filter) {
+    if (*filter == '#') {
+      return true;                      // Rest of the topic, including the parent level
+    }
+    if (*filter == '+') {
+      while (*topic && *topic != '/') topic++;
+      filter++;
+    } else {
+      if (*filter != *topic) {
+        // "a/#" also matches "a"
+        return *topic == '\0' && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0';
+      }
+      filter++;
+      topic++;
+    }
+  }
+  return *topic == '\0';
+}
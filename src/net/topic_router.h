@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================================
+// Topic Router
+// ============================================================================
+// Registration-based MQTT dispatch. Each route binds a topic filter to a
+// handler and the largest payload the handler accepts.
+//
+// Exact filters live in an open-addressing hash table (FNV-1a), so lookup cost
+// does not grow with the number of topics. Filters containing '+' or '#' are
+// kept in a short side list and only tried when the exact lookup misses.
+//
+// Filter strings are not copied: pass string literals or other static storage.
+//
+// Payloads are passed as views into the MQTT client's receive buffer: no copy,
+// not NUL-terminated, valid only for the duration of the handler call.
+// ============================================================================
+
+constexpr size_t TOPIC_ROUTER_MAX_ROUTES = 16;
+constexpr size_t TOPIC_ROUTER_HASH_SLOTS = 32;   // Power of two, at least 2x routes
+
+// Length-delimited view of a received payload
+struct PayloadView {
+  const char* data;
+  size_t len;
+
+  bool equals(const char* s) const;
+  // First occurrence of needle, or nullptr
+  const char* find(const char* needle) const;
+  // The whole view as one finite number (surrounding whitespace allowed);
+  // false for anything else, e.g. "12a3" or "1.2.3"
+  bool parseFloat(float* out) const;
+  const char* end() const { return data + len; }
+};
+
+// Handler receives the topic and a view of the payload (at most maxPayload bytes)
+typedef void (*TopicHandler)(const char* topic, PayloadView payload);
+
+struct TopicRoute {
+  const char* filter;
+  TopicHandler handler;
+  size_t maxPayload;      // Larger messages are rejected before the handler
+  uint8_t qos;            // Subscription QoS
+  bool wildcard;
+  uint32_t hash;
+  uint32_t delivered;
+  uint32_t rejected;
+};
+
+struct TopicRouterStats {
+  uint32_t delivered;
+  uint32_t rejected;      // Over the route's maxPayload
+  uint32_t unrouted;      // No route matched
+};
+
+class TopicRouter {
+public:
+  TopicRouter();
+
+  // Add a route; returns false when full, on a duplicate filter or bad arguments
+  bool add(const char* filter, TopicHandler handler, size_t maxPayload, uint8_t qos = 1);
+
+  // Route for a received topic, or nullptr
+  TopicRoute* find(const char* topic);
+
+  // Find the route and invoke its handler; returns true if delivered
+  bool dispatch(const char* topic, const uint8_t* payload, size_t length);
+
+  size_t count() const { return count_; }
+  const TopicRoute& route(size_t i) const { return routes_[i]; }
+  TopicRouterStats stats() const;
+
+  // MQTT filter match ('+' = one level, '#' = remaining levels)
+  static bool matches(const char* filter, const char* topic);
+
+private:
+  static uint32_t hashTopic(const char* s);
+
+  TopicRoute routes_[TOPIC_ROUTER_MAX_ROUTES];
+  size_t count_ = 0;
+  int8_t slots_[TOPIC_ROUTER_HASH_SLOTS];          // Route index or -1 (exact filters only)
+  uint8_t wildcards_[TOPIC_ROUTER_MAX_ROUTES];     // Route indices of wildcard filters
+  size_t wildcardCount_ = 0;
+  uint32_t unrouted_ = 0;
+};
@@ -0,0 +1,334 @@
+#include "wifi_fast.h"
+
+#include <WebServer.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <time.h>
+
+#include "secrets_private.h"
+#include "../storage/settings_store.h"
+
+namespace {
+
+// Settings key (NVS blob, through the settings store)
+constexpr const char* SETTING_WIFI_CACHE = "wifi_fast";
+constexpr uint8_t CACHE_VERSION = 1;
+
+constexpr time_t MIN_VALID_EPOCH = 1700000000;   // Before this the clock is not set
+
+// Last association and DHCP lease, stored as one NVS blob
+struct WifiCache {
+  uint8_t version;
+  uint8_t channel;
+  uint8_t bssid[6];
+  char ssid[33];
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  int64_t leaseAt;     // Epoch seconds the lease was granted, 0 if unknown
+};
+
+enum class AddressMode : uint8_t { DHCP, STATIC, LEASE };
+
+WifiCache cache = {};
+bool cacheValid = false;
+AddressMode addressMode = AddressMode::DHCP;
+
+// Credentials stored by WiFiManager in the driver config
+char ssid[33] = "";
+char pass[65] = "";
+
+// Attempt/outage state, written from the WiFi event task
+volatile bool fastAttempt = false;       // Current attempt uses the cached BSSID/channel
+volatile bool fastAttemptPending = false;
+volatile bool capturePending = false;    // Got an IP: read the association on the app task
+volatile uint32_t gotIpAt = 0;
+volatile uint32_t lostAt = 0;            // millis() of the disconnect, 0 while connected
+uint8_t outageAttempts = 0;
+
+// Simulated outage (soak testing)
+bool simulating = false;
+unsigned long simulateUntil = 0;
+uint32_t simulatePendingMs = 0;     // Requested over HTTP, started after the reply is sent
+
+WifiFastStats stats = {};
+
+bool clockValid() {
+  return time(nullptr) >= MIN_VALID_EPOCH;
+}
+
+void loadCache() {
+  size_t len = settingsGetBytes(SETTING_WIFI_CACHE, &cache, sizeof(cache));
+
+  cacheValid = (len == sizeof(cache) && cache.version == CACHE_VERSION && cache.channel != 0);
+  if (cacheValid) {
+    Serial.printf("WiFi: Cached AP %02X:%02X:%02X:%02X:%02X:%02X ch %u (%s)\n",
+                  cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4],
+                  cache.bssid[5], cache.channel, cache.ssid);
+  }
+}
+
+void saveCache() {
+  settingsSetBytes(SETTING_WIFI_CACHE, &cache, sizeof(cache));  // Unchanged lease: no flash write
+  cacheValid = true;
+  Serial.printf("WiFi: Saved AP ch %u and %s to NVS\n", cache.channel,
+                addressMode == AddressMode::DHCP ? "lease" : "association");
+}
+
+bool loadCredentials() {
+  wifi_config_t conf;
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK) return false;
+  memcpy(ssid, conf.sta.ssid, sizeof(conf.sta.ssid));
+  ssid[sizeof(ssid) - 1] = '\0';
+  memcpy(pass, conf.sta.password, sizeof(conf.sta.password));
+  pass[sizeof(pass) - 1] = '\0';
+  return ssid[0] != '\0';
+}
+
+// Cache applies to the configured network
+bool cacheUsable() {
+  return cacheValid && ssid[0] && strcmp(cache.ssid, ssid) == 0;
+}
+
+bool leaseUsable() {
+  if (!cacheUsable() || cache.ip == 0 || cache.leaseAt == 0 || !clockValid()) return false;
+  int64_t age = (int64_t)time(nullptr) - cache.leaseAt;
+  return age >= 0 && age < WIFI_FAST_LEASE_MAX_AGE_S;
+}
+
+void useDhcp() {
+  if (addressMode == AddressMode::DHCP) return;
+  WiFi.config(IPAddress(), IPAddress(), IPAddress());   // All zero: DHCP client restarts
+  addressMode = AddressMode::DHCP;
+  stats.leaseReused = false;
+}
+
+// Static IP if configured, else the cached lease while fresh, else DHCP
+void applyAddress() {
+#ifdef WIFI_STATIC_IP
+  IPAddress ip, gateway, subnet, dns;
+  if (ip.fromString(WIFI_STATIC_IP) && gateway.fromString(WIFI_STATIC_GATEWAY) &&
+      subnet.fromString(WIFI_STATIC_SUBNET) && dns.fromString(WIFI_STATIC_DNS)) {
+    WiFi.config(ip, gateway, subnet, dns);
+    addressMode = AddressMode::STATIC;
+    return;
+  }
+  Serial.println("WiFi: Invalid WIFI_STATIC_* address, using DHCP");
+#endif
+  if (leaseUsable()) {
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    addressMode = AddressMode::LEASE;
+    stats.leaseReused = true;
+  } else {
+    useDhcp();
+  }
+}
+
+void beginFast() {
+  applyAddress();
+  fastAttempt = true;
+  fastAttemptPending = true;
+  WiFi.begin(ssid, pass, cache.channel, cache.bssid);
+}
+
+// WiFi event task: timestamps only, the rest happens in wifiFastLoop()
+void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  (void)info;
+  uint32_t now = millis();
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    if (lostAt == 0 && stats.bootToIpMs != 0) lostAt = now;
+  } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+    gotIpAt = now;
+    capturePending = true;
+    fastAttemptPending = false;
+  }
+}
+
+// Got an IP: record timings and refresh the cache (app task)
+void capture() {
+  capturePending = false;
+  uint32_t now = gotIpAt;
+
+  // A new IP without a disconnect is a DHCP renewal, not a connection
+  if (stats.bootToIpMs == 0 || lostAt != 0) {
+    if (fastAttempt) stats.fastConnects++; else stats.fullConnects++;
+  }
+  const char* path = fastAttempt ? "fast" : "scan";
+  const char* addr = addressMode == AddressMode::STATIC ? "static" :
+                     addressMode == AddressMode::LEASE ? "cached lease" : "dhcp";
+  if (stats.bootToIpMs == 0) {
+    stats.bootToIpMs = now;
+    Serial.printf("WiFi: IP %s %lu ms after boot (%s, %s)\n", WiFi.localIP().toString().c_str(),
+                  (unsigned long)now, path, addr);
+  } else if (lostAt != 0) {
+    stats.lastOutageMs = now - lostAt;
+    stats.outages++;
+    stats.outageMsTotal += stats.lastOutageMs;
+    Serial.printf("WiFi: Reconnected in %lu ms (%s, %s)\n", (unsigned long)stats.lastOutageMs, path, addr);
+  }
+  lostAt = 0;
+  outageAttempts = 0;
+  fastAttempt = false;
+
+  WifiCache next = cache;
+  next.version = CACHE_VERSION;
+  next.channel = WiFi.channel();
+  memcpy(next.bssid, WiFi.BSSID(), sizeof(next.bssid));
+  strncpy(next.ssid, ssid[0] ? ssid : WiFi.SSID().c_str(), sizeof(next.ssid) - 1);
+  next.ssid[sizeof(next.ssid) - 1] = '\0';
+  if (addressMode == AddressMode::DHCP) {
+    // Fresh lease; stamped now, or once NTP has set the clock
+    next.ip = (uint32_t)WiFi.localIP();
+    next.gateway = (uint32_t)WiFi.gatewayIP();
+    next.subnet = (uint32_t)WiFi.subnetMask();
+    next.dns = (uint32_t)WiFi.dnsIP(0);
+    next.leaseAt = clockValid() ? (int64_t)time(nullptr) : 0;
+  }
+
+  // Only write when something changed (flash wear); a renewed lease only once it moved
+  // by half the reuse window
+  bool changed = !cacheValid || next.channel != cache.channel ||
+                 memcmp(next.bssid, cache.bssid, sizeof(next.bssid)) != 0 ||
+                 strcmp(next.ssid, cache.ssid) != 0 || next.ip != cache.ip ||
+                 next.gateway != cache.gateway || next.subnet != cache.subnet || next.dns != cache.dns ||
+                 (next.leaseAt != 0 && cache.leaseAt == 0);
+  bool restamp = next.leaseAt != 0 && next.leaseAt - cache.leaseAt >= (int64_t)WIFI_FAST_LEASE_MAX_AGE_S / 2;
+  cache = next;
+  if (changed || restamp) saveCache();
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void wifiFastInit() {
+  WiFi.onEvent(onWifiEvent);
+  WiFi.mode(WIFI_STA);
+  loadCredentials();
+  loadCache();
+}
+
+bool wifiFastConnect(uint32_t timeoutMs) {
+  if (!loadCredentials() || !cacheUsable()) return false;
+
+  Serial.printf("WiFi: Fast connect to %s on channel %u...\n", ssid, cache.channel);
+  beginFast();
+
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    if (WiFi.status() == WL_CONNECTED && WiFi.localIP() != IPAddress()) return true;
+    delay(10);
+  }
+
+  Serial.println("WiFi: Fast connect failed, falling back to scan");
+  stats.fastFailures++;
+  fastAttempt = false;
+  fastAttemptPending = false;
+  WiFi.disconnect();
+  if (addressMode == AddressMode::LEASE) useDhcp();
+  return false;
+}
+
+void wifiFastReconnect() {
+  if (simulating) return;
+  if (!ssid[0] && !loadCredentials()) {
+    WiFi.reconnect();
+    return;
+  }
+
+  // The previous fast attempt never got an IP
+  if (fastAttemptPending) {
+    stats.fastFailures++;
+    fastAttemptPending = false;
+  }
+
+  if (outageAttempts < WIFI_FAST_MAX_ATTEMPTS && cacheUsable()) {
+    outageAttempts++;
+    Serial.printf("WiFi: Fast reconnect on channel %u (attempt %u)\n", cache.channel, outageAttempts);
+    beginFast();
+    return;
+  }
+
+  // Cache did not work for this outage (AP moved or changed channel): full scan, DHCP
+  Serial.println("WiFi: Reconnecting with scan");
+  if (addressMode == AddressMode::LEASE) useDhcp();
+  fastAttempt = false;
+  WiFi.begin(ssid, pass);
+}
+
+void wifiFastLoop() {
+  if (capturePending) {
+    capture();
+  }
+
+  if (simulatePendingMs) {
+    wifiFastSimulateOutage(simulatePendingMs);
+    simulatePendingMs = 0;
+  }
+  if (simulating && (long)(millis() - simulateUntil) >= 0) {
+    simulating = false;
+    WiFi.setAutoReconnect(true);
+    Serial.println("WiFi: Simulated outage over");
+  }
+
+  // Lease granted before NTP sync: back-date it from the boot clock
+  if (addressMode == AddressMode::DHCP && cacheValid && cache.ip != 0 && cache.leaseAt == 0 &&
+      stats.bootToIpMs != 0 && lostAt == 0 && clockValid()) {
+    cache.leaseAt = (int64_t)time(nullptr) - (int64_t)((millis() - gotIpAt) / 1000);
+    saveCache();
+  }
+
+  // Running on a reused lease that is now old: let DHCP renew it with the router
+  if (addressMode == AddressMode::LEASE && lostAt == 0 && clockValid() &&
+      (int64_t)time(nullptr) - cache.leaseAt >= WIFI_FAST_LEASE_MAX_AGE_S) {
+    Serial.println("WiFi: Cached lease expired, switching to DHCP");
+    useDhcp();
+  }
+}
+
+WifiFastStats wifiFastGetStats() {
+  return stats;
+}
+
+void wifiFastSimulateOutage(uint32_t durationMs) {
+  if (durationMs > WIFI_FAST_MAX_SIMULATED_OUTAGE_S * 1000) durationMs = WIFI_FAST_MAX_SIMULATED_OUTAGE_S * 1000;
+  Serial.printf("WiFi: Simulating AP outage for %lu ms\n", (unsigned long)durationMs);
+  simulating = true;
+  simulateUntil = millis() + durationMs;
+  WiFi.setAutoReconnect(false);
+  WiFi.disconnect();
+}
+
+bool wifiFastOutageSimulated() {
+  return simulating;
+}
+
+void wifiFastRegisterHttp(WebServer& server) {
+  server.on("/wifi", HTTP_GET, [&server]() {
+    if (server.hasArg("outage")) {
+      long seconds = server.arg("outage").toInt();
+      if (seconds <= 0) {
+        server.send(400, "text/plain", "outage must be a positive number of seconds");
+        return;
+      }
+      // Started from wifiFastLoop() so this reply still goes out
+      if (seconds > (long)WIFI_FAST_MAX_SIMULATED_OUTAGE_S) seconds = WIFI_FAST_MAX_SIMULATED_OUTAGE_S;
+      simulatePendingMs = (uint32_t)seconds * 1000;
+    }
+
+    char json[320];
+    snprintf(json, sizeof(json),
+             "{\"boot_to_ip_ms\":%lu,\"outages\":%lu,\"last_outage_ms\":%lu,\"avg_outage_ms\":%lu,"
+             "\"fast_connects\":%lu,\"scan_connects\":%lu,\"fast_failures\":%lu,\"lease_reused\":%s,"
+             "\"simulating\":%s,\"rssi\":%d,\"channel\":%d}",
+             (unsigned long)stats.bootToIpMs, (unsigned long)stats.outages, (unsigned long)stats.lastOutageMs,
+             (unsigned long)(stats.outages ? stats.outageMsTotal / stats.outages : 0),
+             (unsigned long)stats.fastConnects, (unsigned long)stats.fullConnects,
+             (unsigned long)stats.fastFailures, stats.leaseReused ? "true" : "false",
+             (simulating || simulatePendingMs) ? "true" : "false", (int)WiFi.RSSI(), (int)WiFi.channel());
+    server.send(200, "application/json", json);
+  });
+}
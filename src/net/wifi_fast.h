@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================================
+// WiFi Fast Connect
+// ============================================================================
+// Skips the channel scan and, when possible, DHCP on (re)connect:
+//
+// - The BSSID and channel of the last association are kept in NVS and passed
+//   to WiFi.begin(), so the station joins that AP without scanning
+// - Addressing: a static IP (WIFI_STATIC_IP & co. in secrets_private.h) if
+//   defined, otherwise the last DHCP lease, reused as a static configuration
+//   while it is younger than WIFI_FAST_LEASE_MAX_AGE_S (wall clock; the RTC
+//   keeps it across ESP.restart()). A connection running on a reused lease
+//   falls back to DHCP once the lease reaches that age, so the router sees a
+//   renewal
+// - Any fast attempt that fails is followed by the normal path (WiFiManager
+//   at boot, a full-scan WiFi.begin() during recovery)
+//
+// Credentials are the ones WiFiManager stored in the WiFi driver config.
+// Timing: boot-to-IP and each outage (disconnect event -> got IP) are
+// recorded from WiFi events.
+// ============================================================================
+
+constexpr uint32_t WIFI_FAST_CONNECT_TIMEOUT_MS = 4000;   // Boot fast path before WiFiManager
+constexpr uint32_t WIFI_FAST_LEASE_MAX_AGE_S = 3600;      // Reuse a DHCP lease for at most 1 hour
+constexpr uint8_t WIFI_FAST_MAX_ATTEMPTS = 2;             // Fast attempts per outage before a full scan
+constexpr uint32_t WIFI_FAST_MAX_SIMULATED_OUTAGE_S = 300; // Upper bound of /wifi?outage (unauthenticated)
+
+struct WifiFastStats {
+  uint32_t bootToIpMs;       // millis() at the first IP, 0 until then
+  uint32_t lastOutageMs;     // Disconnect to IP of the last recovery
+  uint32_t outages;          // Recoveries measured
+  uint64_t outageMsTotal;
+  uint32_t fastConnects;     // Connections made on the cached BSSID/channel
+  uint32_t fastFailures;     // Fast attempts that did not connect
+  uint32_t fullConnects;     // Connections after a scan (WiFiManager or full begin)
+  bool leaseReused;          // Current connection runs on a cached lease
+};
+
+// Register WiFi event handlers and load the cache (call once, before connecting)
+void wifiFastInit();
+
+// Boot: try the cached BSSID/channel/address, blocking up to timeoutMs.
+// Returns false (station left disconnected, DHCP restored) if there is no usable
+// cache or it did not connect; the caller then runs WiFiManager.
+bool wifiFastConnect(uint32_t timeoutMs = WIFI_FAST_CONNECT_TIMEOUT_MS);
+
+// Recovery: start one non-blocking reconnect attempt. The first
+// WIFI_FAST_MAX_ATTEMPTS attempts of an outage use the cache, later ones scan.
+void wifiFastReconnect();
+
+// Persist a changed cache, stamp the lease time once NTP is set and renew a
+// reused lease when it gets old (call from loop())
+void wifiFastLoop();
+
+WifiFastStats wifiFastGetStats();
+
+// Soak testing: drop the association and refuse to reconnect for durationMs
+// (driver auto-reconnect included), as if the AP had gone away
+void wifiFastSimulateOutage(uint32_t durationMs);
+bool wifiFastOutageSimulated();
+
+class WebServer;
+
+// Register GET /wifi on the OTA web server: connect timings as JSON
+// Query options: ?outage=<seconds> starts a simulated outage after the reply
+// (clamped to WIFI_FAST_MAX_SIMULATED_OUTAGE_S; 0, negative or not a number: 400)
+void wifiFastRegisterHttp(WebServer& server);
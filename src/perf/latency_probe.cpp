@@ -0,0 +1,290 @@
+// Touch-to-Photon Latency Probe Implementation
+// Measurement state is driven from the LVGL thread, the synthetic source and HTTP export
+// run on the app task
+
+#include "latency_probe.h"
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <algorithm>
+#include <stdarg.h>
+#include <esp_timer.h>
+
+#include "lv_port.h"
+
+namespace {
+
+// ============================================================================
+// Measurement State
+// ============================================================================
+
+enum class ProbeState : uint8_t {
+    IDLE,           // No click in flight
+    WAIT_UPDATE,    // Click handled, waiting for the target widget to change
+    WAIT_FLUSH      // Widget changed, waiting for a flush covering it
+};
+
+ProbeState state = ProbeState::IDLE;
+lv_obj_t* probeTarget = nullptr;
+int64_t touchUs = 0;        // Release sample that produced the click (the tag)
+int64_t eventUs = 0;        // Click handler ran
+int64_t updateUs = 0;       // Target widget property applied
+
+int64_t lastPressUs = 0;
+int64_t lastReleaseUs = 0;
+
+// End-to-end samples (ring) and per-stage sums
+uint32_t samples[LATENCY_PROBE_SAMPLES];
+uint32_t sampleCount = 0;   // Total recorded; ring index = sampleCount % LATENCY_PROBE_SAMPLES
+uint32_t maxUs = 0;
+uint64_t inputSumUs = 0;    // touch -> click handler
+uint64_t appSumUs = 0;      // click handler -> widget update applied
+uint64_t renderSumUs = 0;   // widget update -> flushed to the panel
+uint32_t timeouts = 0;
+uint32_t overlapped = 0;    // Clicks ignored because a measurement was still in flight
+
+// ============================================================================
+// Synthetic Touch Source
+// ============================================================================
+
+struct Target {
+    const char* name;
+    lv_obj_t* obj;
+};
+
+Target targets[LATENCY_PROBE_MAX_TARGETS];
+size_t targetCount = 0;
+
+struct Script {
+    bool running;
+    bool pressed;
+    uint16_t x;
+    uint16_t y;
+    uint32_t remaining;
+    uint32_t intervalMs;
+    unsigned long nextAt;
+    uint32_t injectFailures;
+};
+
+Script script = {};
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+// Target widget or one of its direct children (label/images inside a button)
+bool isTargetObj(lv_obj_t* obj) {
+    return obj && probeTarget && (obj == probeTarget || lv_obj_get_parent(obj) == probeTarget);
+}
+
+void abandonIfExpired(int64_t nowUs) {
+    if (state != ProbeState::IDLE && nowUs - eventUs > (int64_t)LATENCY_PROBE_TIMEOUT_MS * 1000) {
+        timeouts++;
+        state = ProbeState::IDLE;
+        probeTarget = nullptr;
+    }
+}
+
+void recordSample(int64_t flushUs) {
+    uint32_t total = (uint32_t)(flushUs - touchUs);
+    samples[sampleCount % LATENCY_PROBE_SAMPLES] = total;
+    sampleCount++;
+    if (total > maxUs) maxUs = total;
+    inputSumUs += (uint64_t)(eventUs - touchUs);
+    appSumUs += (uint64_t)(updateUs - eventUs);
+    renderSumUs += (uint64_t)(flushUs - updateUs);
+}
+
+// Nearest-rank percentile over a sorted array
+uint32_t percentile(const uint32_t* sorted, size_t n, uint32_t p) {
+    if (n == 0) return 0;
+    size_t rank = (p * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Append formatted text to buf at *pos, never overflowing
+void appendf(char* buf, size_t len, size_t* pos, const char* fmt, ...) {
+    if (*pos >= len) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *pos, len - *pos, fmt, args);
+    va_end(args);
+    if (n > 0) *pos = min(len - 1, *pos + static_cast<size_t>(n));
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API - LVGL thread hooks
+// ============================================================================
+
+void latency_probe_on_touch(int64_t timestamp_us, bool pressed) {
+    if (pressed) {
+        lastPressUs = timestamp_us;
+    } else {
+        lastReleaseUs = timestamp_us;
+    }
+}
+
+void latency_probe_begin(lv_obj_t* target) {
+    int64_t now = esp_timer_get_time();
+    abandonIfExpired(now);
+
+    if (state != ProbeState::IDLE) {
+        overlapped++;
+        return;
+    }
+    // LV_EVENT_CLICKED fires on release: that sample is the start of the measurement
+    if (!target || lastReleaseUs == 0) return;
+
+    probeTarget = target;
+    touchUs = lastReleaseUs;
+    eventUs = now;
+    state = ProbeState::WAIT_UPDATE;
+}
+
+void latency_probe_on_widget_update(lv_obj_t* obj) {
+    if (state != ProbeState::WAIT_UPDATE || !isTargetObj(obj)) return;
+    updateUs = esp_timer_get_time();
+    state = ProbeState::WAIT_FLUSH;
+}
+
+void latency_probe_on_flush(const lv_area_t* area) {
+    if (state == ProbeState::IDLE) return;
+
+    int64_t now = esp_timer_get_time();
+    abandonIfExpired(now);
+    if (state != ProbeState::WAIT_FLUSH || !area) return;
+
+    // First flushed area overlapping the target is the first frame showing the change
+    lv_area_t coords;
+    lv_area_t overlap;
+    lv_obj_get_coords(probeTarget, &coords);
+    if (!_lv_area_intersect(&overlap, area, &coords)) return;
+
+    recordSample(now);
+    state = ProbeState::IDLE;
+    probeTarget = nullptr;
+}
+
+// ============================================================================
+// Public API - synthetic touch source (app task)
+// ============================================================================
+
+void latency_probe_register_target(const char* name, lv_obj_t* obj) {
+    if (!name || !obj || targetCount >= LATENCY_PROBE_MAX_TARGETS) return;
+    targets[targetCount++] = { name, obj };
+}
+
+bool latency_probe_start_script(const char* target, uint32_t taps, uint32_t interval_ms) {
+    if (!target || taps == 0) return false;
+
+    lv_obj_t* obj = nullptr;
+    for (size_t i = 0; i < targetCount; i++) {
+        if (strcmp(targets[i].name, target) == 0) {
+            obj = targets[i].obj;
+            break;
+        }
+    }
+    if (!obj) return false;
+
+    // Tap the centre of the target widget (logical coordinates, same as touch samples)
+    lv_area_t coords;
+    lvgl_port_lock(0);
+    lv_obj_get_coords(obj, &coords);
+    lvgl_port_unlock();
+
+    script.x = (uint16_t)((coords.x1 + coords.x2) / 2);
+    script.y = (uint16_t)((coords.y1 + coords.y2) / 2);
+    script.remaining = taps;
+    script.intervalMs = max(interval_ms, (uint32_t)LATENCY_PROBE_MIN_INTERVAL_MS);
+    script.pressed = false;
+    script.nextAt = millis();
+    script.injectFailures = 0;
+    script.running = true;
+
+    Serial.printf("Latency probe: %lu taps on '%s' at (%u,%u) every %lu ms\n",
+                  (unsigned long)taps, target, script.x, script.y, (unsigned long)script.intervalMs);
+    return true;
+}
+
+void latency_probe_loop(void) {
+    if (!script.running || (long)(millis() - script.nextAt) < 0) return;
+
+    if (!script.pressed) {
+        if (!lvgl_port_touch_inject(script.x, script.y, true)) script.injectFailures++;
+        script.pressed = true;
+        script.nextAt = millis() + LATENCY_PROBE_TAP_HOLD_MS;
+        return;
+    }
+
+    if (!lvgl_port_touch_inject(script.x, script.y, false)) script.injectFailures++;
+    script.pressed = false;
+    script.nextAt = millis() + script.intervalMs;
+    if (--script.remaining == 0) {
+        script.running = false;
+        Serial.println("Latency probe: script complete");
+    }
+}
+
+void latency_probe_reset(void) {
+    state = ProbeState::IDLE;
+    probeTarget = nullptr;
+    sampleCount = 0;
+    maxUs = 0;
+    inputSumUs = 0;
+    appSumUs = 0;
+    renderSumUs = 0;
+    timeouts = 0;
+    overlapped = 0;
+}
+
+size_t latency_probe_to_json(char* buf, size_t len) {
+    if (!buf || len == 0) return 0;
+    size_t pos = 0;
+    buf[0] = '\0';
+
+    static uint32_t sorted[LATENCY_PROBE_SAMPLES];
+    size_t n = min(sampleCount, (uint32_t)LATENCY_PROBE_SAMPLES);
+    memcpy(sorted, samples, n * sizeof(uint32_t));
+    std::sort(sorted, sorted + n);
+
+    uint32_t total = sampleCount ? sampleCount : 1;
+    appendf(buf, len, &pos, "{\"count\":%lu,\"window\":%u,\"timeouts\":%lu,\"overlapped\":%lu,",
+            (unsigned long)sampleCount, (unsigned)n, (unsigned long)timeouts, (unsigned long)overlapped);
+    appendf(buf, len, &pos, "\"total_us\":{\"p50\":%lu,\"p95\":%lu,\"p99\":%lu,\"max\":%lu},",
+            (unsigned long)percentile(sorted, n, 50), (unsigned long)percentile(sorted, n, 95),
+            (unsigned long)percentile(sorted, n, 99), (unsigned long)maxUs);
+    appendf(buf, len, &pos, "\"stage_avg_us\":{\"input\":%lu,\"app\":%lu,\"render\":%lu},",
+            (unsigned long)(inputSumUs / total), (unsigned long)(appSumUs / total),
+            (unsigned long)(renderSumUs / total));
+    appendf(buf, len, &pos, "\"script\":{\"running\":%s,\"remaining\":%lu,\"inject_failures\":%lu}}",
+            script.running ? "true" : "false", (unsigned long)script.remaining,
+            (unsigned long)script.injectFailures);
+
+    return pos;
+}
+
+void latency_probe_register_http(WebServer& server) {
+    server.on("/latency", HTTP_GET, [&server]() {
+        if (server.hasArg("reset")) {
+            lvgl_port_lock(0);
+            latency_probe_reset();
+            lvgl_port_unlock();
+        }
+        if (server.hasArg("tap")) {
+            uint32_t count = server.hasArg("count") ? server.arg("count").toInt() : 20;
+            uint32_t interval = server.hasArg("interval") ? server.arg("interval").toInt() : 1500;
+            if (!latency_probe_start_script(server.arg("tap").c_str(), count, interval)) {
+                server.send(400, "text/plain", "Unknown tap target");
+                return;
+            }
+        }
+
+        static char json[512];
+        lvgl_port_lock(0);
+        latency_probe_to_json(json, sizeof(json));
+        lvgl_port_unlock();
+        server.send(200, "application/json", json);
+    });
+}
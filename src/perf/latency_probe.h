@@ -0,0 +1,53 @@
+// Touch-to-Photon Latency Probe
+// Follows a touch sample through the LVGL click event and the resulting widget update
+// to the first flushed area that shows it, and records the end-to-end latency distribution
+// Includes a scripted synthetic touch source (lvgl_port_touch_inject) for reproducible runs
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Configuration constants
+#define LATENCY_PROBE_SAMPLES        128     // End-to-end samples kept for percentiles
+#define LATENCY_PROBE_TIMEOUT_MS     5000    // Measurement abandoned if no update is shown by then
+#define LATENCY_PROBE_MAX_TARGETS    4       // Named tap targets for the synthetic source
+#define LATENCY_PROBE_TAP_HOLD_MS    80      // Synthetic press duration
+#define LATENCY_PROBE_MIN_INTERVAL_MS 600    // Above the 500 ms click debounce in the handlers
+
+// Hooks - LVGL thread
+void latency_probe_on_touch(int64_t timestamp_us, bool pressed);  // lv_port.c touch read callback
+void latency_probe_begin(lv_obj_t * target);                      // click handler; target = widget expected to change
+void latency_probe_on_widget_update(lv_obj_t * obj);              // ui_dispatch applied a property
+void latency_probe_on_flush(const lv_area_t * area);              // lv_port.c flush callback
+
+// Synthetic touch source - app task
+void latency_probe_register_target(const char * name, lv_obj_t * obj);
+bool latency_probe_start_script(const char * target, uint32_t taps, uint32_t interval_ms);
+void latency_probe_loop(void);
+
+// Clear all samples and counters (call under lvgl_port_lock: the flush hook reads the state)
+void latency_probe_reset(void);
+
+// Serialize percentiles and stage averages as JSON into buf; returns number of chars written
+// (call under lvgl_port_lock)
+size_t latency_probe_to_json(char * buf, size_t len);
+
+#ifdef __cplusplus
+}
+
+class WebServer;
+
+// Register GET /latency on the OTA web server
+// Query options: ?reset=1 clears samples, ?tap=<target>&count=N&interval=ms runs the synthetic source
+void latency_probe_register_http(WebServer& server);
+#endif
+
+#endif // LATENCY_PROBE_H
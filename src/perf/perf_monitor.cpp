@@ -0,0 +1,273 @@
+// LVGL Performance Monitor Implementation
+// Fixed-bucket histograms, updated from the LVGL thread, read by the web server
+
+#include "perf_monitor.h"
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <stdarg.h>
+#include <esp_heap_caps.h>
+
+#include "lv_port.h"
+
+namespace {
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+constexpr size_t MAX_BUCKETS = 10;
+
+struct Histogram {
+    const char* name;
+    const char* unit;
+    const uint32_t* bounds;   // Upper bound (inclusive) of each bucket except the last
+    size_t boundCount;        // Number of bounds; bucket count is boundCount + 1
+    uint32_t buckets[MAX_BUCKETS];
+    uint32_t count;
+    uint64_t sum;
+    uint32_t max;
+};
+
+// Bucket bounds - chosen around the 20 ms LVGL refresh period
+const uint32_t TIME_US_BOUNDS[] = { 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000 };
+const uint32_t PIXEL_BOUNDS[]   = { 1000, 4000, 10000, 20000, 40000, 80000, 153600 };
+
+constexpr size_t TIME_US_BOUND_COUNT = sizeof(TIME_US_BOUNDS) / sizeof(TIME_US_BOUNDS[0]);
+constexpr size_t PIXEL_BOUND_COUNT = sizeof(PIXEL_BOUNDS) / sizeof(PIXEL_BOUNDS[0]);
+
+Histogram renderTime   = { "render_time",   "us", TIME_US_BOUNDS, TIME_US_BOUND_COUNT, {}, 0, 0, 0 };
+Histogram renderPixels = { "render_pixels", "px", PIXEL_BOUNDS,   PIXEL_BOUND_COUNT,   {}, 0, 0, 0 };
+Histogram flushTime    = { "flush_time",    "us", TIME_US_BOUNDS, TIME_US_BOUND_COUNT, {}, 0, 0, 0 };
+Histogram flushPixels  = { "flush_pixels",  "px", PIXEL_BOUNDS,   PIXEL_BOUND_COUNT,   {}, 0, 0, 0 };
+Histogram timerHandler = { "timer_handler", "us", TIME_US_BOUNDS, TIME_US_BOUND_COUNT, {}, 0, 0, 0 };
+Histogram touchLatency = { "touch_latency", "us", TIME_US_BOUNDS, TIME_US_BOUND_COUNT, {}, 0, 0, 0 };
+Histogram appLoop      = { "app_loop",      "us", TIME_US_BOUNDS, TIME_US_BOUND_COUNT, {}, 0, 0, 0 };
+
+Histogram* const histograms[] = { &renderTime, &renderPixels, &flushTime, &flushPixels, &timerHandler, &touchLatency, &appLoop };
+constexpr size_t HISTOGRAM_COUNT = sizeof(histograms) / sizeof(histograms[0]);
+
+// Stall tracking
+uint32_t stallCount = 0;
+uint32_t lastStallUs = 0;
+unsigned long lastStallAt = 0;   // millis() timestamp of last stall
+
+unsigned long statsSince = 0;    // millis() timestamp of last reset
+
+// Overlay
+lv_obj_t* overlayLabel = nullptr;
+lv_timer_t* overlayTimer = nullptr;
+
+void histogramRecord(Histogram& h, uint32_t value) {
+    size_t i = 0;
+    while (i < h.boundCount && value > h.bounds[i]) i++;
+    h.buckets[i]++;
+    h.count++;
+    h.sum += value;
+    if (value > h.max) h.max = value;
+}
+
+void histogramClear(Histogram& h) {
+    memset(h.buckets, 0, sizeof(h.buckets));
+    h.count = 0;
+    h.sum = 0;
+    h.max = 0;
+}
+
+uint32_t histogramAvg(const Histogram& h) {
+    return h.count ? static_cast<uint32_t>(h.sum / h.count) : 0;
+}
+
+// Append formatted text to buf at *pos, never overflowing
+void appendf(char* buf, size_t len, size_t* pos, const char* fmt, ...) {
+    if (*pos >= len) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *pos, len - *pos, fmt, args);
+    va_end(args);
+    if (n > 0) *pos = min(len - 1, *pos + static_cast<size_t>(n));
+}
+
+void updateOverlay() {
+    if (!overlayLabel) return;
+
+    char buf[224];
+    snprintf(buf, sizeof(buf),
+             "render avg %lu max %lu us\n"
+             "flush avg %lu max %lu us\n"
+             "timer avg %lu max %lu us\n"
+             "touch avg %lu max %lu us\n"
+             "loop avg %lu max %lu us\n"
+             "stalls %lu (last %lu ms)\n"
+             "heap %u psram %u",
+             (unsigned long)histogramAvg(renderTime), (unsigned long)renderTime.max,
+             (unsigned long)histogramAvg(flushTime), (unsigned long)flushTime.max,
+             (unsigned long)histogramAvg(timerHandler), (unsigned long)timerHandler.max,
+             (unsigned long)histogramAvg(touchLatency), (unsigned long)touchLatency.max,
+             (unsigned long)histogramAvg(appLoop), (unsigned long)appLoop.max,
+             (unsigned long)stallCount, (unsigned long)(lastStallUs / 1000),
+             heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    lv_label_set_text(overlayLabel, buf);
+}
+
+void overlayTimerCallback(lv_timer_t* timer) {
+    (void)timer;
+    updateOverlay();
+}
+
+void overlayToggleHandler(lv_event_t* e) {
+    if (lv_event_get_code(e) == LV_EVENT_LONG_PRESSED) {
+        perf_monitor_set_overlay_visible(!perf_monitor_is_overlay_visible());
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void perf_monitor_init(lv_obj_t* toggleObj) {
+    perf_monitor_reset();
+
+    // Overlay lives on the top layer so it stays visible across screen changes
+    overlayLabel = lv_label_create(lv_layer_top());
+    lv_obj_set_align(overlayLabel, LV_ALIGN_BOTTOM_LEFT);
+    lv_obj_set_style_text_font(overlayLabel, &lv_font_montserrat_12, LV_PART_MAIN);
+    lv_obj_set_style_text_color(overlayLabel, lv_color_hex(0x00FF00), LV_PART_MAIN);
+    lv_obj_set_style_bg_color(overlayLabel, lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(overlayLabel, LV_OPA_70, LV_PART_MAIN);
+    lv_obj_set_style_pad_all(overlayLabel, 4, LV_PART_MAIN);
+    lv_obj_add_flag(overlayLabel, LV_OBJ_FLAG_HIDDEN);
+
+    // Timer runs only while the overlay is visible
+    overlayTimer = lv_timer_create(overlayTimerCallback, PERF_OVERLAY_UPDATE_MS, nullptr);
+    lv_timer_pause(overlayTimer);
+
+    if (toggleObj) {
+        lv_obj_add_flag(toggleObj, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_add_event_cb(toggleObj, overlayToggleHandler, LV_EVENT_LONG_PRESSED, nullptr);
+    }
+
+    Serial.println("Perf monitor initialized (long-press status label for overlay)");
+}
+
+void perf_monitor_record_render(uint32_t time_ms, uint32_t pixels) {
+    histogramRecord(renderTime, time_ms * 1000);
+    histogramRecord(renderPixels, pixels);
+}
+
+void perf_monitor_record_flush(uint32_t pixels, uint32_t duration_us) {
+    histogramRecord(flushTime, duration_us);
+    histogramRecord(flushPixels, pixels);
+}
+
+void perf_monitor_record_timer_handler(uint32_t duration_us) {
+    histogramRecord(timerHandler, duration_us);
+    if (duration_us > PERF_STALL_THRESHOLD_US) {
+        stallCount++;
+        lastStallUs = duration_us;
+        lastStallAt = millis();
+    }
+}
+
+void perf_monitor_record_touch(uint32_t latency_us) {
+    histogramRecord(touchLatency, latency_us);
+}
+
+void perf_monitor_record_loop(uint32_t duration_us) {
+    histogramRecord(appLoop, duration_us);
+}
+
+void perf_monitor_set_overlay_visible(bool visible) {
+    if (!overlayLabel) return;
+
+    if (visible) {
+        updateOverlay();
+        lv_obj_clear_flag(overlayLabel, LV_OBJ_FLAG_HIDDEN);
+        lv_timer_resume(overlayTimer);
+    } else {
+        lv_obj_add_flag(overlayLabel, LV_OBJ_FLAG_HIDDEN);
+        lv_timer_pause(overlayTimer);
+    }
+}
+
+bool perf_monitor_is_overlay_visible(void) {
+    return overlayLabel && !lv_obj_has_flag(overlayLabel, LV_OBJ_FLAG_HIDDEN);
+}
+
+void perf_monitor_reset(void) {
+    for (size_t i = 0; i < HISTOGRAM_COUNT; i++) {
+        histogramClear(*histograms[i]);
+    }
+    stallCount = 0;
+    lastStallUs = 0;
+    lastStallAt = 0;
+    statsSince = millis();
+}
+
+size_t perf_monitor_to_json(char* buf, size_t len) {
+    if (!buf || len == 0) return 0;
+    size_t pos = 0;
+    buf[0] = '\0';
+
+    appendf(buf, len, &pos, "{\"uptime_ms\":%lu,\"since_ms\":%lu,",
+            millis(), millis() - statsSince);
+    appendf(buf, len, &pos, "\"stalls\":{\"threshold_us\":%lu,\"count\":%lu,\"last_us\":%lu,\"last_at_ms\":%lu},",
+            (unsigned long)PERF_STALL_THRESHOLD_US, (unsigned long)stallCount,
+            (unsigned long)lastStallUs, lastStallAt);
+    appendf(buf, len, &pos, "\"heap\":{\"internal_free\":%u,\"internal_min\":%u,\"psram_free\":%u},",
+            heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+            heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+            heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+
+    lvgl_port_touch_stats_t touch;
+    lvgl_port_touch_get_stats(&touch);
+    appendf(buf, len, &pos, "\"touch\":{\"samples\":%lu,\"dropped\":%lu,\"read_errors\":%lu,\"i2c_wait_max_us\":%lu,\"wakeups\":%lu,\"missed_edges\":%lu},",
+            (unsigned long)touch.samples, (unsigned long)touch.dropped, (unsigned long)touch.read_errors,
+            (unsigned long)touch.i2c_wait_max_us, (unsigned long)touch.wakeups, (unsigned long)touch.missed_edges);
+
+    appendf(buf, len, &pos, "\"histograms\":{");
+    for (size_t i = 0; i < HISTOGRAM_COUNT; i++) {
+        const Histogram& h = *histograms[i];
+        appendf(buf, len, &pos, "%s\"%s\":{\"unit\":\"%s\",\"count\":%lu,\"avg\":%lu,\"max\":%lu,\"buckets\":[",
+                i ? "," : "", h.name, h.unit, (unsigned long)h.count,
+                (unsigned long)histogramAvg(h), (unsigned long)h.max);
+        for (size_t b = 0; b <= h.boundCount; b++) {
+            if (b < h.boundCount) {
+                appendf(buf, len, &pos, "%s{\"le\":%lu,\"n\":%lu}", b ? "," : "",
+                        (unsigned long)h.bounds[b], (unsigned long)h.buckets[b]);
+            } else {
+                appendf(buf, len, &pos, ",{\"le\":\"inf\",\"n\":%lu}", (unsigned long)h.buckets[b]);
+            }
+        }
+        appendf(buf, len, &pos, "]}");
+    }
+    appendf(buf, len, &pos, "}}");
+
+    return pos;
+}
+
+void perf_monitor_register_http(WebServer& server) {
+    server.on("/perf", HTTP_GET, [&server]() {
+        // Web server runs on the app task: the histograms are written by the
+        // LVGL thread and the overlay widgets belong to it, so hold its lock
+        if (server.hasArg("reset")) {
+            lvgl_port_lock(0);
+            perf_monitor_reset();
+            lvgl_port_unlock();
+        }
+        if (server.hasArg("overlay")) {
+            lvgl_port_lock(0);
+            perf_monitor_set_overlay_visible(server.arg("overlay") != "0");
+            lvgl_port_unlock();
+        }
+
+        static char json[3584];
+        lvgl_port_lock(0);
+        perf_monitor_to_json(json, sizeof(json));
+        lvgl_port_unlock();
+        server.send(200, "application/json", json);
+    });
+}
@@ -0,0 +1,55 @@
+// LVGL Performance Monitor
+// Replaces LV_USE_PERF_MONITOR / LV_USE_MEM_MONITOR (unusable with LV_MEM_CUSTOM 1)
+// Records render time, flushed pixels, touch latency and lv_timer_handler() stalls into histograms
+// Also tracks the app-task loop() duration, whose max is the worst-case network/service stall
+// Results are shown on a hidden debug overlay and served as JSON on /perf
+
+#ifndef PERF_MONITOR_H
+#define PERF_MONITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Configuration constants
+#define PERF_STALL_THRESHOLD_US      50000   // lv_timer_handler() longer than 50 ms is a stall
+#define PERF_OVERLAY_UPDATE_MS       1000    // Overlay refresh period while visible
+
+// Initialize monitor and create the (hidden) overlay on the top layer
+// toggleObj: object whose long-press toggles the overlay (may be NULL)
+void perf_monitor_init(lv_obj_t * toggleObj);
+
+// Hooks - called from lv_port.c (flush/monitor callbacks) and loop()
+void perf_monitor_record_render(uint32_t time_ms, uint32_t pixels);   // lv_disp_drv_t.monitor_cb
+void perf_monitor_record_flush(uint32_t pixels, uint32_t duration_us); // one flush_cb call
+void perf_monitor_record_timer_handler(uint32_t duration_us);         // one lv_timer_handler() call
+void perf_monitor_record_touch(uint32_t latency_us);                  // touch sample consumed by LVGL
+void perf_monitor_record_loop(uint32_t duration_us);                  // one app-task loop() iteration
+
+// Overlay control
+void perf_monitor_set_overlay_visible(bool visible);
+bool perf_monitor_is_overlay_visible(void);
+
+// Clear all histograms and counters (call under lvgl_port_lock: the LVGL thread records)
+void perf_monitor_reset(void);
+
+// Serialize all statistics as JSON into buf; returns number of chars written
+// (call under lvgl_port_lock)
+size_t perf_monitor_to_json(char * buf, size_t len);
+
+#ifdef __cplusplus
+}
+
+class WebServer;
+
+// Register GET /perf on the OTA web server
+// Query options: ?reset=1 clears statistics, ?overlay=0|1 hides/shows the overlay
+void perf_monitor_register_http(WebServer& server);
+#endif
+
+#endif // PERF_MONITOR_H
@@ -0,0 +1,322 @@
+#include "cost_service.h"
+
+#include <sys/time.h>
+#include <time.h>
+
+#include "../net/json_scan.h"
+#include "../net/net_module.h"
+#include "../storage/sample_log.h"
+#include "../storage/settings_store.h"
+#include "../ui/ui_dispatch.h"
+
+// ============================================================================
+// Built-in Defaults
+// ============================================================================
+// Flat price until a schedule is pushed on the tariff topic (and again when
+// the retained message is cleared). Same format as the topic and the NVS copy.
+
+static const char BUILTIN_TARIFF[] = "{\"base\":0.0738,\"peak\":0.4511,\"daily\":0.4603,\"periods\":{}}";
+
+static const char TOPIC_TARIFF[] = "homepanel/tariff";
+static const char TOPIC_PEAK_EVENT[] = "homepanel/peak_event";
+static constexpr size_t MAX_PAYLOAD_PEAK_EVENT = 64;
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+constexpr const char* SETTING_TARIFF = "tariff";     // NVS blob, through the settings store
+constexpr size_t MAX_TEXT = 48;
+
+static_assert(COST_TARIFF_MAX_BLOB <= SETTINGS_MAX_BLOB, "tariff blob larger than a setting");
+
+EnergyCost engine;
+uint32_t activeFingerprint = 0;     // Of the blob behind the active tariff
+size_t activeLength = 0;
+CostServiceStats stats = {};
+
+// Live integration starts after the month has been replayed from the log
+bool replayPending = false;
+bool live = false;
+unsigned long lastAdvance = 0;
+
+lv_obj_t* labelCost = nullptr;
+char shownText[MAX_TEXT] = "";
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+uint32_t fingerprint(const char* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return h;
+}
+
+const char* sourceName(TariffSource source) {
+    switch (source) {
+        case TariffSource::NVS:  return "NVS";
+        case TariffSource::MQTT: return "MQTT";
+        default:                 return "built-in";
+    }
+}
+
+double wallTime() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// "H:MM" or "HH:MM", up to "24:00"
+bool parseClock(const JsonMember& m, uint16_t* minute) {
+    if (m.type != JsonType::STRING || m.valueLen < 4 || m.valueLen > 5) return false;
+    const char* s = m.value;
+    size_t colon = m.valueLen - 3;
+    if (s[colon] != ':') return false;
+    int h = 0;
+    for (size_t i = 0; i < colon; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        h = h * 10 + (s[i] - '0');
+    }
+    if (s[colon + 1] < '0' || s[colon + 1] > '5' || s[colon + 2] < '0' || s[colon + 2] > '9') return false;
+    int total = h * 60 + (s[colon + 1] - '0') * 10 + (s[colon + 2] - '0');
+    if (total > 24 * 60) return false;
+    *minute = (uint16_t)total;
+    return true;
+}
+
+bool parseDays(const JsonMember& m, uint8_t* days) {
+    if (m.type != JsonType::STRING || m.valueLen == 0) return false;
+    *days = 0;
+    for (size_t i = 0; i < m.valueLen; i++) {
+        if (m.value[i] < '0' || m.value[i] > '6') return false;
+        *days |= 1u << (m.value[i] - '0');
+    }
+    return true;
+}
+
+bool parsePeriod(Tariff& t, const JsonMember& m) {
+    if (m.type != JsonType::OBJECT || t.periodCount >= TARIFF_MAX_PERIODS) return false;
+    if (m.keyLen == 0 || m.keyLen >= TARIFF_MAX_NAME) return false;
+    TariffPeriod p = {};
+    memcpy(p.name, m.key, m.keyLen);
+    p.days = 0x7F;
+    bool from = false, to = false, price = false;
+
+    JsonScanner scanner(m.value, m.valueLen);
+    JsonMember field;
+    while (scanner.next(&field)) {
+        bool ok = true;
+        if (field.keyEquals("from")) {
+            ok = from = parseClock(field, &p.fromMinute);
+        } else if (field.keyEquals("to")) {
+            ok = to = parseClock(field, &p.toMinute);
+        } else if (field.keyEquals("days")) {
+            ok = parseDays(field, &p.days);
+        } else if (field.keyEquals("price")) {
+            ok = price = field.toFloat(&p.price) && p.price >= 0;
+        }
+        if (!ok) return false;
+    }
+    if (scanner.failed() || !from || !to || !price || p.fromMinute == p.toMinute) return false;
+    t.periods[t.periodCount++] = p;
+    return true;
+}
+
+bool parse(Tariff& t, const char* blob, size_t len) {
+    t = {};
+    bool base = false, peak = false;
+    JsonScanner scanner(blob, len);
+    JsonMember member;
+    while (scanner.next(&member)) {
+        bool ok = true;
+        if (member.keyEquals("base")) {
+            ok = base = member.toFloat(&t.basePrice) && t.basePrice >= 0;
+        } else if (member.keyEquals("peak")) {
+            ok = peak = member.toFloat(&t.peakPrice) && t.peakPrice >= 0;
+        } else if (member.keyEquals("daily")) {
+            ok = member.toFloat(&t.dailyCharge) && t.dailyCharge >= 0;
+        } else if (member.keyEquals("periods") && member.type == JsonType::OBJECT) {
+            JsonScanner periods(member.value, member.valueLen);
+            JsonMember period;
+            while (ok && periods.next(&period)) {
+                ok = parsePeriod(t, period);
+            }
+            ok = ok && !periods.failed();
+        }
+        if (!ok) return false;
+    }
+    if (!base || scanner.failed()) return false;
+    if (!peak) t.peakPrice = t.basePrice;   // No peak pricing
+    return true;
+}
+
+bool apply(const char* blob, size_t len, TariffSource source) {
+    Tariff t;
+    if (len > COST_TARIFF_MAX_BLOB || !parse(t, blob, len)) {
+        stats.tariffsRejected++;
+        Serial.printf("Cost service: %s tariff rejected (%u bytes)\n", sourceName(source), (unsigned)len);
+        return false;
+    }
+    engine.setTariff(t);
+    activeFingerprint = fingerprint(blob, len);
+    activeLength = len;
+    stats.source = source;
+    stats.tariffsApplied++;
+    Serial.printf("Cost service: tariff from %s (base %.4f, peak %.4f, daily %.4f, %u periods)\n",
+                  sourceName(source), t.basePrice, t.peakPrice, t.dailyCharge, (unsigned)t.periodCount);
+    return true;
+}
+
+bool loadFromNVS() {
+    size_t len = settingsGetBytesLength(SETTING_TARIFF);
+    char* blob = (len && len <= COST_TARIFF_MAX_BLOB) ? static_cast<char*>(malloc(len)) : nullptr;
+    bool ok = blob && settingsGetBytes(SETTING_TARIFF, blob, len) == len &&
+              apply(blob, len, TariffSource::NVS);
+    free(blob);
+    return ok;
+}
+
+void updateLabel() {
+    if (!labelCost) return;
+    char text[MAX_TEXT];
+    if (live) {
+        snprintf(text, sizeof(text), "Today %.2f $ | Month %.2f $", engine.today().cost, engine.month().cost);
+    } else {
+        snprintf(text, sizeof(text), "Today -- | Month --");
+    }
+    if (strcmp(text, shownText) == 0) return;
+    strcpy(shownText, text);
+    ui_dispatch_label_text(labelCost, text);
+}
+
+// Retained: delivered on every session; only a different blob is applied
+void onTariffMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %u bytes\n", topic, (unsigned)payload.len);
+
+    bool cleared = payload.len == 0;
+    const char* blob = cleared ? BUILTIN_TARIFF : payload.data;
+    size_t len = cleared ? strlen(BUILTIN_TARIFF) : payload.len;
+    if (len == activeLength && fingerprint(blob, len) == activeFingerprint) return;
+
+    if (!apply(blob, len, cleared ? TariffSource::BUILTIN : TariffSource::MQTT)) return;
+    if (cleared) {
+        settingsRemove(SETTING_TARIFF);
+    } else {
+        settingsSetBytes(SETTING_TARIFF, blob, len);
+    }
+}
+
+void onPeakEventMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %.*s\n", topic, (int)payload.len, payload.data);
+
+    long start = 0, end = 0;
+    JsonScanner scanner(payload.data, payload.len);
+    JsonMember member;
+    while (scanner.next(&member)) {
+        if (member.keyEquals("start")) member.toInt(&start);
+        else if (member.keyEquals("end")) member.toInt(&end);
+    }
+    if (payload.len && (scanner.failed() || start <= 0 || end <= start)) {
+        Serial.println("Cost service: peak event ignored (needs start < end)");
+        return;
+    }
+    engine.setPeakEvent((uint32_t)start, (uint32_t)end);   // Empty message: 0, 0 clears it
+    stats.peakEvents++;
+}
+
+void replayRecord(const SampleRecord& rec, void* ctx) {
+    uint32_t liveStart = *static_cast<uint32_t*>(ctx);
+    if (rec.kind != SAMPLE_POWER_MINUTE || rec.time > liveStart) return;
+    engine.addMinute(rec.time, rec.value, rec.channel);   // channel: seconds with data
+}
+
+// Local midnight on the first of the month
+uint32_t monthStart(uint32_t now) {
+    time_t t = now;
+    struct tm local;
+    localtime_r(&t, &local);
+    local.tm_mday = 1;
+    local.tm_hour = local.tm_min = local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return (uint32_t)mktime(&local);
+}
+
+void startLive() {
+    replayPending = false;
+    uint32_t now = (uint32_t)time(nullptr);
+    if (sampleLogGetStats().mounted) {
+        sampleLogRead(monthStart(now), replayRecord, &now);
+        stats.replayMs = sampleLogGetStats().replayMs;
+    }
+    engine.advance(now);
+    live = true;
+    Serial.printf("Cost service: %lu minutes replayed in %lu ms (today %.2f $, month %.2f $)\n",
+                  (unsigned long)engine.stats().replayedMinutes, (unsigned long)stats.replayMs,
+                  engine.today().cost, engine.month().cost);
+    updateLabel();
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void cost_service_init(lv_obj_t* container) {
+    if (!loadFromNVS() && !apply(BUILTIN_TARIFF, strlen(BUILTIN_TARIFF), TariffSource::BUILTIN)) {
+        Serial.println("Cost service: built-in tariff rejected");
+    }
+
+    if (container) {
+        // One line between the energy value and the power chart
+        labelCost = lv_label_create(container);
+        lv_obj_set_align(labelCost, LV_ALIGN_BOTTOM_LEFT);
+        lv_obj_set_pos(labelCost, 10, -45);
+        lv_obj_set_style_text_color(labelCost, lv_color_hex(0xB2B2B2), LV_PART_MAIN);
+        lv_obj_set_style_text_font(labelCost, &lv_font_montserrat_12, LV_PART_MAIN);
+        lv_label_set_text(labelCost, "");
+    }
+
+    netSubscribe(TOPIC_TARIFF, onTariffMessage, COST_TARIFF_MAX_BLOB);
+    netSubscribe(TOPIC_PEAK_EVENT, onPeakEventMessage, MAX_PAYLOAD_PEAK_EVENT);
+    replayPending = true;
+    updateLabel();
+    Serial.println("Cost service initialized");
+}
+
+void cost_service_record(float watts) {
+    if (!live) {
+        stats.beforeClock++;
+        return;
+    }
+    unsigned long start = micros();
+    engine.sample(wallTime(), watts);
+    stats.lastSampleUs = micros() - start;
+    if (stats.lastSampleUs > stats.maxSampleUs) stats.maxSampleUs = stats.lastSampleUs;
+    updateLabel();
+}
+
+void cost_service_loop() {
+    if (replayPending) {
+        if (sampleLogClockValid()) startLive();
+        return;
+    }
+    if (millis() - lastAdvance >= COST_ADVANCE_INTERVAL_MS) {
+        lastAdvance = millis();
+        engine.advance(wallTime());
+        updateLabel();
+    }
+}
+
+const EnergyCost& cost_service_engine() {
+    return engine;
+}
+
+CostServiceStats cost_service_get_stats() {
+    return stats;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+#include "energy_cost.h"
+
+// ============================================================================
+// Cost Service Module
+// ============================================================================
+// Runs the EnergyCost engine on the house power readings and shows today's
+// and the month-to-date cost on Screen1 (one line above the power chart).
+//
+// Tariff config, same life cycle as the entity registry: built-in defaults,
+// replaced at boot by the NVS copy (settings key "tariff") and at run time by
+// the retained "homepanel/tariff" topic (an empty message restores the
+// defaults). JSON, prices per kWh, times local:
+//   {"base":0.0738,"peak":0.4511,"daily":0.4603,
+//    "periods":{"Evening":{"from":"16:00","to":"20:00","days":"12345","price":0.11}}}
+// "days" lists weekdays (0 = Sunday, default every day); "to" may be "24:00"
+// or earlier than "from" (wraps midnight).
+//
+// Peak events (Hilo): retained "homepanel/peak_event" with
+//   {"start":<epoch s>,"end":<epoch s>}
+// an empty message clears it. Energy during the event is priced at "peak".
+//
+// Month-to-date survives reboots: once NTP has set the clock, the power
+// minutes of the current month are replayed from the sample log, then live
+// readings are integrated from that point on.
+// ============================================================================
+
+constexpr size_t COST_TARIFF_MAX_BLOB = 1024;
+constexpr uint32_t COST_ADVANCE_INTERVAL_MS = 10000;   // Midnight rollover without readings
+
+enum class TariffSource : uint8_t {
+    BUILTIN,
+    NVS,
+    MQTT
+};
+
+struct CostServiceStats {
+    TariffSource source;
+    uint32_t tariffsApplied;
+    uint32_t tariffsRejected;
+    uint32_t peakEvents;        // Peak-event messages applied
+    uint32_t beforeClock;       // Readings ignored before the clock was set and the log replayed
+    uint32_t replayMs;
+    uint32_t lastSampleUs;      // Engine time for the last reading
+    uint32_t maxSampleUs;
+};
+
+// Create the cost label inside container (call once after ui_init(), under lvgl_port_lock)
+// and subscribe to the tariff and peak-event topics. Call after netInit().
+void cost_service_init(lv_obj_t* container);
+
+// New meter reading in watts (app task)
+void cost_service_record(float watts);
+
+// Log replay once the clock is set, midnight rollover (call from loop())
+void cost_service_loop();
+
+// Read-only access to the engine (totals per bucket, integration stats)
+const EnergyCost& cost_service_engine();
+
+CostServiceStats cost_service_get_stats();
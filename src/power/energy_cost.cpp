@@ -0,0 +1,179 @@
+#include "energy_cost.h"
+
+#include <time.h>
+
+namespace {
+
+constexpr double SECONDS_PER_DAY = 86400;
+constexpr double WATT_SECONDS_PER_KWH = 3600.0 * 1000.0;
+constexpr double MINUTE_MIDPOINT_S = 30;
+
+struct LocalTime {
+    int32_t dayKey;
+    int32_t monthKey;
+    int mday;
+    int wday;
+    double secondOfDay;
+};
+
+LocalTime localAt(double t) {
+    time_t s = (time_t)floor(t);
+    struct tm tm;
+    localtime_r(&s, &tm);
+    LocalTime lt;
+    lt.dayKey = (tm.tm_year + 1900) * 1000 + tm.tm_yday;
+    lt.monthKey = (tm.tm_year + 1900) * 12 + tm.tm_mon;
+    lt.mday = tm.tm_mday;
+    lt.wday = tm.tm_wday;
+    lt.secondOfDay = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec + (t - (double)s);
+    return lt;
+}
+
+bool periodMatches(const TariffPeriod& p, uint16_t minute, int wday) {
+    if (!(p.days & (1u << wday))) return false;
+    if (p.fromMinute <= p.toMinute) return minute >= p.fromMinute && minute < p.toMinute;
+    return minute >= p.fromMinute || minute < p.toMinute;   // Wraps midnight
+}
+
+}  // namespace
+
+// ============================================================================
+// Totals
+// ============================================================================
+
+void EnergyTotals::clear(int32_t newKey) {
+    *this = {};
+    key = newKey;
+}
+
+// ============================================================================
+// Engine
+// ============================================================================
+
+void EnergyCost::setTariff(const Tariff& tariff) {
+    tariff_ = tariff;
+    if (tariff_.periodCount > TARIFF_MAX_PERIODS) tariff_.periodCount = TARIFF_MAX_PERIODS;
+}
+
+void EnergyCost::setPeakEvent(uint32_t start, uint32_t end) {
+    peakStart_ = start;
+    peakEnd_ = end > start ? end : start;
+}
+
+void EnergyCost::sample(double t, float watts) {
+    if (isnan(watts) || watts < 0) {
+        stats_.rejected++;
+        return;
+    }
+    stats_.samples++;
+
+    if (hasPrev_) {
+        double dt = t - prevT_;
+        if (dt > ENERGY_COST_MAX_GAP_S || dt < 0) {
+            // Meter silent too long, or the clock stepped back: start a new run here
+            stats_.gaps++;
+            if (dt > 0) stats_.gapSeconds += dt;
+        } else if (dt > 0) {
+            double a = prevT_;
+            float wa = prevW_;
+            for (;;) {
+                double b = nextBoundary(a);
+                if (b >= t) {
+                    addSlice((a + t) / 2, (wa + watts) / 2 * (t - a) / WATT_SECONDS_PER_KWH);
+                    break;
+                }
+                float wb = wa + (watts - wa) * (float)((b - a) / (t - a));
+                addSlice((a + b) / 2, (wa + wb) / 2 * (b - a) / WATT_SECONDS_PER_KWH);
+                stats_.splits++;
+                a = b;
+                wa = wb;
+            }
+        }
+    }
+    hasPrev_ = true;
+    prevT_ = t;
+    prevW_ = watts;
+}
+
+void EnergyCost::addMinute(uint32_t endTime, float avgWatts, uint16_t seconds) {
+    if (seconds == 0 || isnan(avgWatts) || avgWatts < 0) return;
+    addSlice(endTime - MINUTE_MIDPOINT_S, (double)avgWatts * seconds / WATT_SECONDS_PER_KWH);
+    stats_.replayedMinutes++;
+}
+
+void EnergyCost::advance(double t) {
+    LocalTime lt = localAt(t);
+    if (lt.dayKey > today_.key) roll(lt.dayKey, lt.monthKey, lt.mday);
+}
+
+size_t EnergyCost::bucketAt(double t) const {
+    if (peakActive(t)) return ENERGY_COST_BUCKET_PEAK;
+    LocalTime lt = localAt(t);
+    uint16_t minute = (uint16_t)(lt.secondOfDay / 60);
+    for (size_t i = 0; i < tariff_.periodCount; i++) {
+        if (periodMatches(tariff_.periods[i], minute, lt.wday)) return 1 + i;
+    }
+    return ENERGY_COST_BUCKET_BASE;
+}
+
+float EnergyCost::bucketPrice(size_t bucket) const {
+    if (bucket == ENERGY_COST_BUCKET_BASE) return tariff_.basePrice;
+    if (bucket == ENERGY_COST_BUCKET_PEAK) return tariff_.peakPrice;
+    return bucket - 1 < tariff_.periodCount ? tariff_.periods[bucket - 1].price : tariff_.basePrice;
+}
+
+const char* EnergyCost::bucketName(size_t bucket) const {
+    if (bucket == ENERGY_COST_BUCKET_BASE) return "Base";
+    if (bucket == ENERGY_COST_BUCKET_PEAK) return "Peak";
+    return bucket - 1 < tariff_.periodCount ? tariff_.periods[bucket - 1].name : "?";
+}
+
+// Energy of one slice (priced by the bucket of its midpoint t)
+void EnergyCost::addSlice(double t, double kwh) {
+    LocalTime lt = localAt(t);
+    if (lt.dayKey < today_.key) return;   // Older than today (clock stepped back)
+    if (lt.dayKey > today_.key) roll(lt.dayKey, lt.monthKey, lt.mday);
+
+    size_t bucket = bucketAt(t);
+    double cost = kwh * bucketPrice(bucket);
+    EnergyTotals* totals[2] = { &today_, &month_ };
+    for (EnergyTotals* tot : totals) {
+        tot->buckets[bucket].kwh += kwh;
+        tot->buckets[bucket].cost += cost;
+        tot->kwh += kwh;
+        tot->cost += cost;
+    }
+    stats_.slices++;
+}
+
+// First period edge, peak-event edge or local midnight after t
+double EnergyCost::nextBoundary(double t) const {
+    LocalTime lt = localAt(t);
+    double dayStart = t - lt.secondOfDay;
+    double next = dayStart + SECONDS_PER_DAY;
+    auto consider = [&](double edge) {
+        if (edge > t && edge < next) next = edge;
+    };
+    for (size_t i = 0; i < tariff_.periodCount; i++) {
+        consider(dayStart + tariff_.periods[i].fromMinute * 60.0);
+        consider(dayStart + tariff_.periods[i].toMinute * 60.0);
+    }
+    if (peakEnd_ > peakStart_) {
+        consider(peakStart_);
+        consider(peakEnd_);
+    }
+    return next;
+}
+
+// New day: today restarts with its daily charge; the month carries one daily
+// charge per day elapsed, panel on or not
+void EnergyCost::roll(int32_t dayKey, int32_t monthKey, int mday) {
+    if (monthKey != month_.key) month_.clear(monthKey);
+    today_.clear(dayKey);
+    today_.days = 1;
+    today_.cost = tariff_.dailyCharge;
+    if (month_.days < mday) {
+        month_.cost += tariff_.dailyCharge * (mday - month_.days);
+        month_.days = (uint16_t)mday;
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Energy Cost
+// ============================================================================
+// Integrates the house power readings into energy and cost per tariff
+// period, for the current day and the current month (local time).
+//
+// Tariff: a base price, time-of-use periods (local time of day and days of
+// the week, first match wins, may wrap midnight), a peak-event price that
+// overrides both while an event is on, and a fixed daily charge. Prices are
+// per kWh.
+//
+// Integration: trapezoidal between consecutive readings, O(1) per reading.
+// An interval longer than ENERGY_COST_MAX_GAP_S (the meter stopped
+// publishing, MQTT was down) is a gap: not integrated, counted in the stats.
+// An interval that crosses a period boundary, midnight or a peak-event edge
+// is split there (power interpolated), so every slice is priced once.
+//
+// Minutes restored from the sample log are added as whole slices (average
+// power x seconds with data) before live integration starts.
+//
+// Prices apply when energy is added: a tariff change does not reprice what
+// was already counted. Days are 24 h from local midnight (a DST change day
+// is split at the new midnight, one hour off).
+//
+// No Arduino dependency.
+// ============================================================================
+
+constexpr size_t TARIFF_MAX_PERIODS = 8;
+constexpr size_t TARIFF_MAX_NAME = 16;          // Period name, terminator included
+constexpr double ENERGY_COST_MAX_GAP_S = 120;   // POWER_HOLD_S
+
+// Buckets: base, one per period, peak event
+constexpr size_t ENERGY_COST_BUCKET_BASE = 0;
+constexpr size_t ENERGY_COST_BUCKET_PEAK = TARIFF_MAX_PERIODS + 1;
+constexpr size_t ENERGY_COST_BUCKETS = TARIFF_MAX_PERIODS + 2;
+
+struct TariffPeriod {
+    char name[TARIFF_MAX_NAME];
+    uint16_t fromMinute;        // Local minute of the day, inclusive
+    uint16_t toMinute;          // Exclusive; below fromMinute wraps midnight
+    uint8_t days;               // Bit per weekday, bit 0 = Sunday
+    float price;
+};
+
+struct Tariff {
+    float basePrice;
+    float peakPrice;            // During a peak event
+    float dailyCharge;          // Fixed, per day
+    TariffPeriod periods[TARIFF_MAX_PERIODS];
+    size_t periodCount;
+};
+
+struct EnergyBucket {
+    double kwh;
+    double cost;                // Energy only (the daily charge is added by the totals)
+};
+
+// One day or one month
+struct EnergyTotals {
+    int32_t key;                // Local day (year * 1000 + day of year) or month (year * 12 + month)
+    uint16_t days;              // Daily charges included in cost
+    EnergyBucket buckets[ENERGY_COST_BUCKETS];
+    double kwh;
+    double cost;                // Energy + daily charges
+
+    void clear(int32_t newKey);
+};
+
+struct EnergyCostStats {
+    uint32_t samples;           // Readings integrated (or starting a new run)
+    uint32_t rejected;          // NAN, negative
+    uint32_t slices;            // Trapezoids added
+    uint32_t splits;            // Intervals split at a boundary
+    uint32_t gaps;              // Intervals longer than ENERGY_COST_MAX_GAP_S
+    double gapSeconds;          // Their total length
+    uint32_t replayedMinutes;
+};
+
+class EnergyCost {
+public:
+    void setTariff(const Tariff& tariff);
+    const Tariff& tariff() const { return tariff_; }
+
+    // Peak event [start, end) in epoch seconds; start == end clears it
+    void setPeakEvent(uint32_t start, uint32_t end);
+    bool peakActive(double t) const { return t >= peakStart_ && t < peakEnd_; }
+
+    // Meter reading at wall time t (epoch seconds, fractional)
+    void sample(double t, float watts);
+
+    // Forget the previous reading (the next one starts a new run)
+    void breakRun() { hasPrev_ = false; }
+
+    // A minute restored from the sample log (stamped at its end, oldest first)
+    void addMinute(uint32_t endTime, float avgWatts, uint16_t seconds);
+
+    // Roll today / this month over if t is past them (cheap; call periodically)
+    void advance(double t);
+
+    const EnergyTotals& today() const { return today_; }
+    const EnergyTotals& month() const { return month_; }
+
+    // Bucket index for wall time t (ENERGY_COST_BUCKET_*, or 1 + period)
+    size_t bucketAt(double t) const;
+    // Price of a bucket under the current tariff
+    float bucketPrice(size_t bucket) const;
+    const char* bucketName(size_t bucket) const;
+
+    const EnergyCostStats& stats() const { return stats_; }
+
+private:
+    void addSlice(double t, double kwh);
+    double nextBoundary(double t) const;
+    void roll(int32_t dayKey, int32_t monthKey, int mday);
+
+    Tariff tariff_ = {};
+    double peakStart_ = 0;
+    double peakEnd_ = 0;
+
+    bool hasPrev_ = false;
+    double prevT_ = 0;
+    float prevW_ = 0;
+
+    EnergyTotals today_ = {};
+    EnergyTotals month_ = {};
+    EnergyCostStats stats_ = {};
+};
@@ -0,0 +1,236 @@
+#include "power_alert.h"
+
+#include <esp_timer.h>
+#include <time.h>
+
+#include "cost_service.h"
+#include "../screen/screen_power.h"
+#include "../ui/ui_dispatch.h"
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+constexpr uint32_t COLOR_PEAK_LOAD = 0xB00020;
+constexpr uint32_t COLOR_HIGH_LOAD = 0xD35400;
+constexpr uint32_t COLOR_SPIKE = 0xB8860B;
+constexpr size_t MAX_TEXT = 48;
+
+PowerAnomalyDetector detector;
+PowerAlertStats stats = {};
+
+// Latest spike, shown until spikeUntil
+bool spikeShown = false;
+unsigned long spikeUntil = 0;
+float spikeJumpW = 0;
+float spikeWatts = 0;
+
+// Banner (created under the LVGL lock, then updated through ui_dispatch)
+lv_obj_t* banner = nullptr;
+lv_obj_t* bannerLabel = nullptr;
+lv_obj_t* labelPowerValue = nullptr;
+PowerAlertKind shownKind = PowerAlertKind::NONE;
+char shownText[MAX_TEXT] = "";
+bool dismissed = false;         // Tapped away; cleared by the next alert
+
+unsigned long lastCheck = 0;
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+// 64-bit microsecond clock: millis() wraps after 49.7 days, and the detector
+// would see time jump back (sustained-load durations, baseline windows)
+double nowSeconds() {
+    return esp_timer_get_time() / 1e6;
+}
+
+bool peakEventActive() {
+    return cost_service_engine().peakActive((double)time(nullptr));
+}
+
+float threshold() {
+    return peakEventActive() ? POWER_ALERT_PEAK_THRESHOLD_W : POWER_ALERT_THRESHOLD_W;
+}
+
+// Alert to show now, and its text
+PowerAlertKind currentAlert(char* text, size_t len) {
+    if (detector.sustainedActive()) {
+        bool peak = peakEventActive();
+        unsigned long minutes = (unsigned long)((nowSeconds() - detector.sustainedSince()) / 60);
+        snprintf(text, len, "%s: %.1f kW for %lu min", peak ? "Peak event" : "High load",
+                 detector.last() / 1000.0f, minutes);
+        return peak ? PowerAlertKind::PEAK_LOAD : PowerAlertKind::HIGH_LOAD;
+    }
+    if (spikeShown) {
+        snprintf(text, len, "Power jump: +%.1f kW (%.1f kW)", spikeJumpW / 1000.0f, spikeWatts / 1000.0f);
+        return PowerAlertKind::SPIKE;
+    }
+    text[0] = '\0';
+    return PowerAlertKind::NONE;
+}
+
+uint32_t alertColor(PowerAlertKind kind) {
+    switch (kind) {
+        case PowerAlertKind::PEAK_LOAD: return COLOR_PEAK_LOAD;
+        case PowerAlertKind::HIGH_LOAD: return COLOR_HIGH_LOAD;
+        default:                        return COLOR_SPIKE;
+    }
+}
+
+// Bring the banner in line with the current alert; raised: a new alert started
+void updateBanner(bool raised) {
+    if (raised) {
+        dismissed = false;
+        stats.alerts++;
+        screenPowerActivity();
+        stats.wakes++;
+    }
+    char text[MAX_TEXT];
+    PowerAlertKind kind = currentAlert(text, sizeof(text));
+    if (dismissed) kind = PowerAlertKind::NONE;
+    if (!banner) return;
+
+    if (kind != shownKind) {
+        if (kind == PowerAlertKind::NONE) {
+            ui_dispatch_hidden(banner, true);
+        } else {
+            ui_dispatch_bg_color(banner, lv_color_hex(alertColor(kind)));
+            if (shownKind == PowerAlertKind::NONE) ui_dispatch_hidden(banner, false);
+        }
+        shownKind = kind;
+    }
+    if (kind != PowerAlertKind::NONE && strcmp(text, shownText) != 0) {
+        strcpy(shownText, text);
+        ui_dispatch_label_text(bannerLabel, text);
+    }
+}
+
+void handleEvent(const PowerAnomalyEvent& ev, float watts) {
+    bool raised = ev.sustainedStart;
+    if (ev.spike) {
+        spikeShown = true;
+        spikeUntil = millis() + POWER_ALERT_SPIKE_SHOW_MS;
+        spikeJumpW = watts - detector.mean();
+        spikeWatts = watts;
+        raised = true;
+        Serial.printf("Power alert: jump to %.0f W (z %.1f, baseline %.0f W)\n", watts, ev.z, detector.mean());
+    }
+    if (ev.sustainedStart) {
+        Serial.printf("Power alert: above %.0f W for %.0f s%s\n", threshold(), POWER_SUSTAINED_S,
+                      peakEventActive() ? " during a peak event" : "");
+    }
+    if (ev.sustainedEnd) {
+        Serial.println("Power alert: load back below the threshold");
+    }
+    if (raised || ev.sustainedEnd) updateBanner(raised);
+}
+
+// Runs on the app task (see ui_dispatch_to_app)
+void dismissOnApp(void* ctx) {
+    (void)ctx;
+    if (shownKind == PowerAlertKind::NONE) return;
+    dismissed = true;
+    stats.dismissed++;
+    updateBanner(false);
+}
+
+void bannerClicked(lv_event_t* e) {
+    (void)e;
+    screenPowerActivity();
+    ui_dispatch_to_app(dismissOnApp, nullptr);
+}
+
+void checkSignal(bool offline) {
+    PowerSignal signal = detector.signal(nowSeconds());
+    if (signal == stats.signal) return;
+
+    Serial.printf("Power signal: %s -> %s\n", power_alert_signal_name(stats.signal), power_alert_signal_name(signal));
+    stats.signalChanges++;
+    if (signal == PowerSignal::STALE) stats.staleEvents++;
+    if (signal == PowerSignal::INVALID) stats.invalidEvents++;
+    // Offline: the last value stays, grayed by the sketch
+    if ((signal == PowerSignal::STALE || signal == PowerSignal::INVALID) && !offline && labelPowerValue) {
+        ui_dispatch_label_text(labelPowerValue, "N/A");
+    }
+    stats.signal = signal;
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void power_alert_init(lv_obj_t* labelPower) {
+    labelPowerValue = labelPower;
+    stats.signal = PowerSignal::NO_DATA;
+
+    // Top layer: above every screen, below nothing
+    banner = lv_obj_create(lv_layer_top());
+    lv_obj_set_size(banner, lv_disp_get_hor_res(nullptr) - 16, 36);
+    lv_obj_align(banner, LV_ALIGN_TOP_MID, 0, 4);
+    lv_obj_clear_flag(banner, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_radius(banner, 6, LV_PART_MAIN);
+    lv_obj_set_style_border_width(banner, 0, LV_PART_MAIN);
+    lv_obj_set_style_pad_all(banner, 4, LV_PART_MAIN);
+    lv_obj_set_style_bg_color(banner, lv_color_hex(COLOR_SPIKE), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(banner, LV_OPA_COVER, LV_PART_MAIN);
+    lv_obj_add_event_cb(banner, bannerClicked, LV_EVENT_CLICKED, nullptr);
+    lv_obj_add_flag(banner, LV_OBJ_FLAG_HIDDEN);
+
+    bannerLabel = lv_label_create(banner);
+    lv_obj_set_style_text_color(bannerLabel, lv_color_white(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(bannerLabel, &lv_font_montserrat_16, LV_PART_MAIN);
+    lv_label_set_text(bannerLabel, "");
+    lv_obj_center(bannerLabel);
+
+    Serial.printf("Power alert initialized (threshold %.0f W, %.0f W during peak events)\n",
+                  POWER_ALERT_THRESHOLD_W, POWER_ALERT_PEAK_THRESHOLD_W);
+}
+
+void power_alert_record(float watts) {
+    unsigned long start = micros();
+    PowerAnomalyEvent ev = detector.record(nowSeconds(), watts, threshold());
+    stats.lastRecordUs = micros() - start;
+    if (stats.lastRecordUs > stats.maxRecordUs) stats.maxRecordUs = stats.lastRecordUs;
+    handleEvent(ev, watts);
+}
+
+void power_alert_invalid() {
+    detector.invalid();
+}
+
+void power_alert_loop(bool offline) {
+    checkSignal(offline);
+    if (millis() - lastCheck < POWER_ALERT_CHECK_INTERVAL_MS) return;
+    lastCheck = millis();
+
+    handleEvent(detector.advance(nowSeconds(), threshold()), detector.last());
+    if (spikeShown && (long)(millis() - spikeUntil) >= 0) spikeShown = false;
+    updateBanner(false);   // Spike timeout, minutes of a sustained load
+}
+
+PowerSignal power_alert_signal() {
+    return stats.signal;
+}
+
+const char* power_alert_signal_name(PowerSignal signal) {
+    switch (signal) {
+        case PowerSignal::LIVE:    return "LIVE";
+        case PowerSignal::DELAYED: return "DELAYED";
+        case PowerSignal::STALE:   return "STALE";
+        case PowerSignal::INVALID: return "INVALID";
+        default:                   return "NO_DATA";
+    }
+}
+
+const PowerAnomalyDetector& power_alert_detector() {
+    return detector;
+}
+
+PowerAlertStats power_alert_get_stats() {
+    return stats;
+}
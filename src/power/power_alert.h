@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+#include "power_anomaly.h"
+
+// ============================================================================
+// Power Alert Module
+// ============================================================================
+// Runs the PowerAnomalyDetector on the house power readings and tells the
+// user about it:
+//
+// - Banner across the top of the display (LVGL top layer, over any screen):
+//   red for power above the threshold during a peak event, orange above the
+//   threshold otherwise, amber for a sudden jump (shown
+//   POWER_ALERT_SPIKE_SHOW_MS). Tap to dismiss until the next alert.
+// - A new alert wakes the screen (screenPowerActivity())
+// - Signal quality (PowerSignal) replaces the sketch's single 5-minute stale
+//   timeout: the power value shows "N/A" once the signal is STALE or INVALID
+//   (not while offline, where the last value stays grayed)
+//
+// The sustained-load threshold drops to POWER_ALERT_PEAK_THRESHOLD_W while a
+// peak event is on (homepanel/peak_event, see cost_service.h).
+// ============================================================================
+
+constexpr float POWER_ALERT_THRESHOLD_W = 8000;
+constexpr float POWER_ALERT_PEAK_THRESHOLD_W = 4000;
+constexpr uint32_t POWER_ALERT_SPIKE_SHOW_MS = 60000;
+constexpr uint32_t POWER_ALERT_CHECK_INTERVAL_MS = 1000;
+
+enum class PowerAlertKind : uint8_t {
+    NONE,
+    SPIKE,
+    HIGH_LOAD,
+    PEAK_LOAD
+};
+
+// Cumulative since boot
+struct PowerAlertStats {
+    PowerSignal signal;
+    uint32_t signalChanges;
+    uint32_t staleEvents;       // Transitions to STALE
+    uint32_t invalidEvents;     // Transitions to INVALID
+    uint32_t alerts;            // Banners raised
+    uint32_t wakes;             // Screen wakes
+    uint32_t dismissed;
+    uint32_t lastRecordUs;      // Detector time for the last reading
+    uint32_t maxRecordUs;
+};
+
+// Create the banner (call once after ui_init(), under lvgl_port_lock)
+// labelPower: the power value label ("N/A" when the signal is lost)
+void power_alert_init(lv_obj_t* labelPower);
+
+// Valid meter reading in watts (app task)
+void power_alert_record(float watts);
+
+// Unparsable power payload (app task)
+void power_alert_invalid();
+
+// Signal quality, held-load window, banner timeouts (call from loop())
+// offline: values are already shown as stale, do not replace them with "N/A"
+void power_alert_loop(bool offline);
+
+PowerSignal power_alert_signal();
+const char* power_alert_signal_name(PowerSignal signal);
+
+const PowerAnomalyDetector& power_alert_detector();
+
+PowerAlertStats power_alert_get_stats();
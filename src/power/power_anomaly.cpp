@@ -0,0 +1,106 @@
+#include "power_anomaly.h"
+
+// ============================================================================
+// Detector
+// ============================================================================
+
+PowerAnomalyEvent PowerAnomalyDetector::record(double t, float watts, float threshold) {
+    PowerAnomalyEvent ev = {};
+    if (!powerReadingPlausible(watts)) {
+        invalid();
+        return ev;
+    }
+    stats_.samples++;
+    invalidRun_ = 0;
+
+    if (!hasData_ || t - lastT_ >= POWER_SIGNAL_STALE_S || t < lastT_) {
+        // First reading, or the old baseline no longer describes the house
+        if (hasData_) stats_.resets++;
+        mean_ = watts;
+        var_ = 0;
+        baselineAge_ = 0;
+        aboveSince_ = -1;
+    } else {
+        // The previous reading held until now: fold it in, then score the new one
+        fold(t - lastT_);
+        if (baselineAge_ >= POWER_BASELINE_WARMUP_S) {
+            double sd = sqrt(var_);
+            if (sd < POWER_SPIKE_MIN_SIGMA_W) sd = POWER_SPIKE_MIN_SIGMA_W;
+            ev.z = (float)((watts - mean_) / sd);
+            if (ev.z > stats_.maxZ) stats_.maxZ = ev.z;
+            if (ev.z >= POWER_SPIKE_Z && watts - mean_ >= POWER_SPIKE_MIN_JUMP_W) {
+                ev.spike = true;
+                stats_.spikes++;
+            }
+        }
+    }
+
+    hasData_ = true;
+    lastT_ = t;
+    lastW_ = watts;
+    checkSustained(t, threshold, ev);
+    return ev;
+}
+
+void PowerAnomalyDetector::invalid() {
+    stats_.invalid++;
+    invalidRun_++;
+}
+
+PowerAnomalyEvent PowerAnomalyDetector::advance(double t, float threshold) {
+    PowerAnomalyEvent ev = {};
+    if (!hasData_) return ev;
+    if (t - lastT_ >= POWER_SIGNAL_STALE_S) {
+        // Signal lost: the window cannot complete on the held value
+        if (sustained_) {
+            sustained_ = false;
+            ev.sustainedEnd = true;
+        }
+        aboveSince_ = -1;
+        return ev;
+    }
+    checkSustained(t, threshold, ev);
+    return ev;
+}
+
+PowerSignal PowerAnomalyDetector::signal(double t) const {
+    if (invalidRun_ >= POWER_SIGNAL_INVALID_RUN) return PowerSignal::INVALID;
+    if (!hasData_) return PowerSignal::NO_DATA;
+    double age = t - lastT_;
+    if (age >= POWER_SIGNAL_STALE_S) return PowerSignal::STALE;
+    if (age >= POWER_SIGNAL_DELAYED_S) return PowerSignal::DELAYED;
+    return PowerSignal::LIVE;
+}
+
+// Exponentially weighted mean and variance with the held value over dt seconds
+void PowerAnomalyDetector::fold(double dt) {
+    if (dt > POWER_ANOMALY_HOLD_S) dt = POWER_ANOMALY_HOLD_S;
+    if (dt <= 0) return;
+    double alpha = 1.0 - exp(-dt / POWER_BASELINE_TAU_S);
+    double diff = lastW_ - mean_;
+    double incr = alpha * diff;
+    mean_ += incr;
+    var_ = (1.0 - alpha) * (var_ + diff * incr);
+    baselineAge_ += dt;
+}
+
+void PowerAnomalyDetector::checkSustained(double t, float threshold, PowerAnomalyEvent& ev) {
+    if (sustained_) {
+        if (lastW_ < threshold * POWER_SUSTAINED_CLEAR_RATIO) {
+            sustained_ = false;
+            aboveSince_ = -1;
+            ev.sustainedEnd = true;
+        }
+        return;
+    }
+    if (lastW_ <= threshold) {
+        aboveSince_ = -1;
+        return;
+    }
+    if (aboveSince_ < 0) aboveSince_ = t;
+    if (t - aboveSince_ >= POWER_SUSTAINED_S) {
+        sustained_ = true;
+        ev.sustainedStart = true;
+        stats_.sustained++;
+    }
+}
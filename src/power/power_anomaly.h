@@ -0,0 +1,115 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Power Anomaly Detector
+// ============================================================================
+// Streaming checks on the house power readings, O(1) time and memory per
+// reading:
+//
+// - Baseline: exponentially weighted mean and variance of the power, time
+//   constant POWER_BASELINE_TAU_S. The meter publishes on change, so a
+//   reading holds until the next one: the baseline is first advanced with
+//   the held value over the elapsed time (at most POWER_ANOMALY_HOLD_S), then the
+//   new reading is scored against it.
+// - Spike: z-score of the new reading against the baseline at least
+//   POWER_SPIKE_Z, and a jump of at least POWER_SPIKE_MIN_JUMP_W (so a flat
+//   baseline with a tiny variance does not alert on a kettle). Only once the
+//   baseline has POWER_BASELINE_WARMUP_S of data.
+// - Sustained: power above the threshold for POWER_SUSTAINED_S without a
+//   break; cleared below threshold x POWER_SUSTAINED_CLEAR_RATIO. Checked on
+//   readings and on advance(), since a steady load publishes nothing (the
+//   held value counts until the signal is STALE).
+// - Signal quality: from the age of the last valid reading and the invalid
+//   readings since (see PowerSignal).
+//
+// Time is passed in (seconds on a monotonic clock).
+//
+// No Arduino dependency.
+// ============================================================================
+
+constexpr double POWER_BASELINE_TAU_S = 600;          // 10 minutes
+constexpr double POWER_BASELINE_WARMUP_S = 300;
+constexpr double POWER_ANOMALY_HOLD_S = 120;          // POWER_HOLD_S
+constexpr float POWER_SPIKE_Z = 4.0f;
+constexpr float POWER_SPIKE_MIN_JUMP_W = 1500;
+constexpr float POWER_SPIKE_MIN_SIGMA_W = 100;        // Floor of the deviation used for z
+constexpr double POWER_SUSTAINED_S = 120;
+constexpr float POWER_SUSTAINED_CLEAR_RATIO = 0.9f;
+constexpr float POWER_PLAUSIBLE_MAX_W = 50000;        // Above: a garbled reading, not a load
+constexpr double POWER_SIGNAL_DELAYED_S = 120;        // POWER_HOLD_S
+constexpr double POWER_SIGNAL_STALE_S = 300;          // The former MQTT_STALE_TIMEOUT_MS
+constexpr uint32_t POWER_SIGNAL_INVALID_RUN = 3;      // Invalid readings in a row
+
+// A reading a meter can produce (not NAN, not negative, not above POWER_PLAUSIBLE_MAX_W)
+inline bool powerReadingPlausible(float watts) {
+    return !isnan(watts) && watts >= 0 && watts <= POWER_PLAUSIBLE_MAX_W;
+}
+
+enum class PowerSignal : uint8_t {
+    NO_DATA,    // Nothing since boot
+    LIVE,       // Last valid reading within POWER_SIGNAL_DELAYED_S
+    DELAYED,    // Older: the meter may just be steady (it publishes on change)
+    STALE,      // Older than POWER_SIGNAL_STALE_S: the value is not shown
+    INVALID     // POWER_SIGNAL_INVALID_RUN unparsable or implausible readings in a row
+};
+
+// What a reading (or advance()) changed
+struct PowerAnomalyEvent {
+    bool spike;                 // This reading is a spike
+    bool sustainedStart;        // The sustained window just completed
+    bool sustainedEnd;
+    float z;                    // Of this reading (0 while warming up)
+};
+
+struct PowerAnomalyStats {
+    uint32_t samples;
+    uint32_t invalid;           // Unparsable, negative or implausible
+    uint32_t spikes;
+    uint32_t sustained;         // Windows completed
+    uint32_t resets;            // Baseline restarted after a stale signal
+    float maxZ;
+};
+
+class PowerAnomalyDetector {
+public:
+    // Valid reading at t; threshold is the sustained-window limit in force
+    PowerAnomalyEvent record(double t, float watts, float threshold);
+
+    // Unparsable payload or implausible value
+    void invalid();
+
+    // Sustained window on a held value (call periodically)
+    PowerAnomalyEvent advance(double t, float threshold);
+
+    PowerSignal signal(double t) const;
+
+    bool sustainedActive() const { return sustained_; }
+    double sustainedSince() const { return aboveSince_; }
+    float mean() const { return (float)mean_; }
+    float sigma() const { return (float)sqrt(var_); }
+    float last() const { return lastW_; }
+
+    const PowerAnomalyStats& stats() const { return stats_; }
+
+private:
+    void fold(double dt);
+    void checkSustained(double t, float threshold, PowerAnomalyEvent& ev);
+
+    bool hasData_ = false;
+    double lastT_ = 0;
+    float lastW_ = NAN;
+    uint32_t invalidRun_ = 0;
+
+    double mean_ = 0;
+    double var_ = 0;
+    double baselineAge_ = 0;    // Seconds folded in since the last reset
+
+    double aboveSince_ = -1;    // Start of the run above threshold, -1 if below
+    bool sustained_ = false;
+
+    PowerAnomalyStats stats_ = {};
+};
@@ -0,0 +1,216 @@
+#include "power_history.h"
+
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+
+constexpr uint32_t SECONDS_PER_MINUTE = 60;
+constexpr uint32_t MINUTES_PER_QUARTER = 15;
+
+void* allocate(size_t bytes) {
+#ifdef ARDUINO
+    void* p = heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p) return p;
+#endif
+    return calloc(1, bytes);   // Host, or internal RAM fallback
+}
+
+PowerRollup emptyRollup() {
+    return PowerRollup{ NAN, NAN, NAN, 0 };
+}
+
+}  // namespace
+
+// ============================================================================
+// Chart Points
+// ============================================================================
+
+int16_t powerChartValue(double watts) {
+    if (!(watts > 0)) return 0;   // Negative, or NAN
+    if (watts >= POWER_CHART_VALUE_MAX) return (int16_t)POWER_CHART_VALUE_MAX;
+    return (int16_t)(watts + 0.5);
+}
+
+int32_t powerChartRangeFor(int32_t value, int32_t step) {
+    int32_t range = (value / step + 1) * step;
+    return range > POWER_CHART_VALUE_MAX ? POWER_CHART_VALUE_MAX : range;
+}
+
+// ============================================================================
+// Accumulator
+// ============================================================================
+
+void PowerAccumulator::clear() {
+    min = max = NAN;
+    sum = 0;
+    count = 0;
+}
+
+void PowerAccumulator::add(float value) {
+    if (isnan(value)) return;
+    if (count == 0 || value < min) min = value;
+    if (count == 0 || value > max) max = value;
+    sum += value;
+    count++;
+}
+
+void PowerAccumulator::add(const PowerRollup& r) {
+    if (r.seconds == 0) return;
+    if (count == 0 || r.min < min) min = r.min;
+    if (count == 0 || r.max > max) max = r.max;
+    sum += (double)r.avg * r.seconds;
+    count += r.seconds;
+}
+
+PowerRollup PowerAccumulator::rollup() const {
+    if (count == 0) return emptyRollup();
+    return PowerRollup{ min, max, (float)(sum / count), (uint16_t)count };
+}
+
+// ============================================================================
+// History
+// ============================================================================
+
+size_t PowerHistory::memoryBytes() {
+    return POWER_RAW_CAPACITY * sizeof(float) +
+           (POWER_MINUTE_CAPACITY + POWER_QUARTER_CAPACITY) * sizeof(PowerRollup);
+}
+
+PowerHistory::~PowerHistory() {
+    free(raw_);         // heap_caps_calloc memory is released with free() too
+    free(minutes_);
+    free(quarters_);
+    free(restoreSaved_);
+}
+
+bool PowerHistory::begin() {
+    if (raw_) return true;
+    raw_ = static_cast<float*>(allocate(POWER_RAW_CAPACITY * sizeof(float)));
+    minutes_ = static_cast<PowerRollup*>(allocate(POWER_MINUTE_CAPACITY * sizeof(PowerRollup)));
+    quarters_ = static_cast<PowerRollup*>(allocate(POWER_QUARTER_CAPACITY * sizeof(PowerRollup)));
+    if (!raw_ || !minutes_ || !quarters_) {
+        free(raw_);
+        free(minutes_);
+        free(quarters_);
+        raw_ = nullptr;
+        minutes_ = nullptr;
+        quarters_ = nullptr;
+        return false;
+    }
+    minuteAcc_.clear();
+    quarterAcc_.clear();
+    return true;
+}
+
+void PowerHistory::record(uint32_t nowSec, float watts) {
+    if (!raw_ || isnan(watts)) return;
+    advance(nowSec);
+    if (!started_) {
+        started_ = true;
+        second_ = nowSec;
+    }
+    secondSum_ += watts;
+    secondSamples_++;
+    held_ = watts;
+    heldAt_ = nowSec;
+}
+
+void PowerHistory::advance(uint32_t nowSec) {
+    if (!raw_ || !started_) return;
+    // One iteration per elapsed second (normally 0 or 1)
+    while ((int32_t)(nowSec - second_) > 0) {
+        closeSecond();
+        second_++;
+    }
+}
+
+void PowerHistory::closeSecond() {
+    float value;
+    if (secondSamples_) {
+        value = (float)(secondSum_ / secondSamples_);
+    } else if (!isnan(held_) && second_ - heldAt_ < POWER_HOLD_S) {
+        value = held_;
+    } else {
+        value = NAN;   // Gap (meter silent or panel offline)
+    }
+    secondSum_ = 0;
+    secondSamples_ = 0;
+
+    closed_++;
+    raw_[rawHead_] = value;
+    rawHead_ = (rawHead_ + 1) % POWER_RAW_CAPACITY;
+    if (rawCount_ < POWER_RAW_CAPACITY) rawCount_++;
+
+    minuteAcc_.add(value);
+    if (++minuteSeconds_ < SECONDS_PER_MINUTE) return;
+
+    // Minute closed
+    closedMinutes_++;
+    pushMinute(minuteAcc_.rollup());
+    minuteAcc_.clear();
+    minuteSeconds_ = 0;
+}
+
+void PowerHistory::pushMinute(const PowerRollup& m) {
+    minutes_[minuteHead_] = m;
+    minuteHead_ = (minuteHead_ + 1) % POWER_MINUTE_CAPACITY;
+    if (minuteCount_ < POWER_MINUTE_CAPACITY) minuteCount_++;
+
+    quarterAcc_.add(m);
+    if (++quarterMinutes_ < MINUTES_PER_QUARTER) return;
+
+    // Quarter closed
+    quarters_[quarterHead_] = quarterAcc_.rollup();
+    quarterHead_ = (quarterHead_ + 1) % POWER_QUARTER_CAPACITY;
+    if (quarterCount_ < POWER_QUARTER_CAPACITY) quarterCount_++;
+    quarterAcc_.clear();
+    quarterMinutes_ = 0;
+}
+
+bool PowerHistory::beginRestore() {
+    if (!raw_ || restoreSaved_) return false;
+    restoreSavedCount_ = minuteCount_;
+    if (restoreSavedCount_) {
+        restoreSaved_ = static_cast<PowerRollup*>(allocate(restoreSavedCount_ * sizeof(PowerRollup)));
+        if (!restoreSaved_) {
+            restoreSavedCount_ = 0;
+            return false;
+        }
+        for (size_t i = 0; i < restoreSavedCount_; i++) {
+            restoreSaved_[i] = minute(restoreSavedCount_ - 1 - i);   // Oldest first
+        }
+    }
+    minuteHead_ = minuteCount_ = 0;
+    quarterHead_ = quarterCount_ = 0;
+    quarterAcc_.clear();
+    quarterMinutes_ = 0;
+    return true;
+}
+
+void PowerHistory::endRestore() {
+    for (size_t i = 0; i < restoreSavedCount_; i++) {
+        pushMinute(restoreSaved_[i]);
+    }
+    free(restoreSaved_);
+    restoreSaved_ = nullptr;
+    restoreSavedCount_ = 0;
+}
+
+float PowerHistory::raw(size_t ago) const {
+    if (ago >= rawCount_) return NAN;
+    return raw_[(rawHead_ + POWER_RAW_CAPACITY - 1 - ago) % POWER_RAW_CAPACITY];
+}
+
+PowerRollup PowerHistory::minute(size_t ago) const {
+    if (ago >= minuteCount_) return emptyRollup();
+    return minutes_[(minuteHead_ + POWER_MINUTE_CAPACITY - 1 - ago) % POWER_MINUTE_CAPACITY];
+}
+
+PowerRollup PowerHistory::quarter(size_t ago) const {
+    if (ago >= quarterCount_) return emptyRollup();
+    return quarters_[(quarterHead_ + POWER_QUARTER_CAPACITY - 1 - ago) % POWER_QUARTER_CAPACITY];
+}
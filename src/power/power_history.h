@@ -0,0 +1,131 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Power History
+// ============================================================================
+// Fixed-memory time series of the house power draw:
+//
+// - raw:     one value per second, last POWER_RAW_CAPACITY seconds
+// - minute:  min/max/avg per minute, last POWER_MINUTE_CAPACITY minutes
+// - quarter: min/max/avg per 15 minutes, last POWER_QUARTER_CAPACITY quarters
+//
+// The meter publishes on change, not every second: a sample holds until the
+// next one, for at most POWER_HOLD_S; seconds beyond that are gaps (NAN in raw,
+// not counted in the rollups). Several samples within one second are averaged.
+//
+// Each closed second costs O(1): it is pushed to the raw ring and folded into
+// the running minute accumulator; a closed minute is pushed and folded into the
+// quarter accumulator. Rings overwrite their oldest entry, so memory is fixed
+// for any uptime. Time is passed in (seconds on a monotonic clock).
+//
+// No Arduino dependency (PSRAM allocation only under ARDUINO).
+// ============================================================================
+
+constexpr size_t POWER_RAW_CAPACITY = 3600;       // 1 hour of seconds
+constexpr size_t POWER_MINUTE_CAPACITY = 1440;    // 24 hours of minutes
+constexpr size_t POWER_QUARTER_CAPACITY = 672;    // 7 days of quarter hours
+constexpr uint32_t POWER_HOLD_S = 120;            // A sample is valid this long without a new one
+
+// Chart points: lv_coord_t is int16_t (LV_USE_LARGE_COORD 0) and INT16_MAX is
+// LV_CHART_POINT_NONE (a gap), while plausible readings go up to 50 kW. Values
+// and the Y range are clamped to POWER_CHART_VALUE_MAX before the cast.
+constexpr int32_t POWER_CHART_VALUE_MAX = INT16_MAX - 1;
+
+// Watts as a chart value: rounded, clamped to [0, POWER_CHART_VALUE_MAX]
+int16_t powerChartValue(double watts);
+
+// Y range top for a value: the next multiple of step above it, at most
+// POWER_CHART_VALUE_MAX
+int32_t powerChartRangeFor(int32_t value, int32_t step);
+
+struct PowerRollup {
+    float min;
+    float max;
+    float avg;          // NAN when no second of the period had data
+    uint16_t seconds;   // Seconds with data in the period
+};
+
+// Running min/max/sum over a period
+struct PowerAccumulator {
+    float min;
+    float max;
+    double sum;
+    uint32_t count;
+
+    void clear();
+    void add(float value);
+    // Fold a closed rollup in, weighted by its seconds with data
+    void add(const PowerRollup& r);
+    PowerRollup rollup() const;
+};
+
+class PowerHistory {
+public:
+    PowerHistory() = default;
+    ~PowerHistory();
+    PowerHistory(const PowerHistory&) = delete;
+    PowerHistory& operator=(const PowerHistory&) = delete;
+
+    // Allocate the rings (PSRAM on the target); false if out of memory
+    bool begin();
+
+    // Record a meter reading at nowSec (closes any elapsed seconds first)
+    void record(uint32_t nowSec, float watts);
+
+    // Close every second before nowSec (call periodically; idempotent)
+    void advance(uint32_t nowSec);
+
+    // Newest first: ago = 0 is the last closed second / minute / quarter
+    size_t rawCount() const { return rawCount_; }
+    uint32_t closedSeconds() const { return closed_; }   // Total since begin (consumers track their position)
+    float raw(size_t ago) const;
+    size_t minuteCount() const { return minuteCount_; }
+    PowerRollup minute(size_t ago) const;
+    size_t quarterCount() const { return quarterCount_; }
+    PowerRollup quarter(size_t ago) const;
+
+    // Minute still being filled (for a live "last 60 s" readout)
+    PowerRollup currentMinute() const { return minuteAcc_.rollup(); }
+    uint32_t closedMinutes() const { return closedMinutes_; }   // Total since begin
+
+    // Replay of persisted minutes, placed before the ones closed since boot:
+    // beginRestore(), restoreMinute() oldest first (empty rollups for gaps),
+    // endRestore(). The quarter ring is rebuilt from the same minutes.
+    bool beginRestore();
+    void restoreMinute(const PowerRollup& m) { pushMinute(m); }
+    void endRestore();
+
+    // Bytes allocated for the rings
+    static size_t memoryBytes();
+
+private:
+    void closeSecond();
+    void pushMinute(const PowerRollup& m);
+
+    float* raw_ = nullptr;
+    PowerRollup* minutes_ = nullptr;
+    PowerRollup* quarters_ = nullptr;
+    size_t rawHead_ = 0, rawCount_ = 0;
+    size_t minuteHead_ = 0, minuteCount_ = 0;
+    size_t quarterHead_ = 0, quarterCount_ = 0;
+
+    uint32_t closed_ = 0;
+    uint32_t closedMinutes_ = 0;
+    PowerRollup* restoreSaved_ = nullptr;   // Live minutes, set aside during a restore
+    size_t restoreSavedCount_ = 0;
+    bool started_ = false;
+    uint32_t second_ = 0;          // Second being filled
+    double secondSum_ = 0;         // Samples received during it
+    uint32_t secondSamples_ = 0;
+    float held_ = NAN;             // Last reading, held until POWER_HOLD_S
+    uint32_t heldAt_ = 0;
+
+    PowerAccumulator minuteAcc_ = {};
+    PowerAccumulator quarterAcc_ = {};
+    uint32_t minuteSeconds_ = 0;   // Seconds closed in the current minute
+    uint32_t quarterMinutes_ = 0;  // Minutes closed in the current quarter
+};
@@ -0,0 +1,279 @@
+#include "power_service.h"
+
+#include <esp_timer.h>
+#include <time.h>
+
+#include "../storage/sample_log.h"
+#include "../ui/ui_dispatch.h"
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+static_assert(POWER_CHART_VALUE_MAX < LV_CHART_POINT_NONE, "a clamped chart value would draw as a gap");
+
+namespace {
+
+PowerHistory history;
+bool historyReady = false;
+
+// Chart (created on the app task under the LVGL lock, then only touched on the LVGL thread)
+lv_obj_t* chart = nullptr;
+lv_chart_series_t* series = nullptr;
+int32_t chartRangeMax = POWER_CHART_RANGE_STEP_W;
+
+// Raw seconds already folded into a chart column
+uint32_t chartSecondsSeen = 0;
+uint32_t columnSeconds = 0;
+double columnSum = 0;
+uint32_t columnSamples = 0;
+constexpr uint32_t CHART_MAX_COLUMNS_PER_LOOP = 4;
+
+// Persistence (sample log): closed minutes are appended, the log is replayed
+// once the wall clock is set
+uint32_t minutesLogged = 0;
+bool replayPending = false;
+bool liveDataSeen = false;                 // Readings since boot (the chart is then not seeded)
+constexpr uint32_t REPLAY_WINDOW_S = POWER_QUARTER_CAPACITY * 15 * 60;   // What the rings can hold
+constexpr uint32_t SECONDS_PER_MINUTE = 60;
+
+// Chart columns rebuilt from the log, written in one LVGL call
+lv_coord_t seedColumns[POWER_CHART_POINTS];
+
+constexpr uint32_t REPLAY_RECENT = POWER_CHART_POINTS * POWER_CHART_COLUMN_S / SECONDS_PER_MINUTE;   // Minutes under the chart
+
+struct ReplayState {
+    uint32_t lastTime;          // End of the last restored minute
+    uint32_t minutes;
+    uint32_t recentTime[REPLAY_RECENT];   // Newest minutes, for the chart
+    float recentAvg[REPLAY_RECENT];
+    uint32_t recentNext;
+};
+
+// 64-bit microsecond clock: millis() / 1000 wraps after 49.7 days and would
+// freeze the history (advance() sees time going back) until a reboot
+uint32_t nowSeconds() {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+// Runs on the LVGL thread (ui_dispatch_call); ctx carries the column value in watts
+void appendColumnOnLvgl(void* ctx) {
+    if (!chart) return;
+    lv_coord_t watts = (lv_coord_t)(intptr_t)ctx;
+
+    if (watts != LV_CHART_POINT_NONE && watts > chartRangeMax) {
+        // Rare: full redraw with a taller range
+        chartRangeMax = powerChartRangeFor(watts, POWER_CHART_RANGE_STEP_W);
+        lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, chartRangeMax);
+    }
+    // Circular mode: overwrites the oldest point and invalidates only that column
+    lv_chart_set_next_value(chart, series, watts);
+}
+
+void pushColumn() {
+    lv_coord_t value = LV_CHART_POINT_NONE;   // Gap: no reading in the whole column
+    if (columnSamples) {
+        value = powerChartValue(columnSum / columnSamples);
+    }
+    columnSeconds = 0;
+    columnSum = 0;
+    columnSamples = 0;
+    ui_dispatch_call(appendColumnOnLvgl, (void*)(intptr_t)value);
+}
+
+// Runs on the LVGL thread: rewrite every column, oldest first (a full lap of
+// the circular cursor leaves them in order)
+void seedChartOnLvgl(void* ctx) {
+    (void)ctx;
+    if (!chart) return;
+    for (uint16_t i = 0; i < POWER_CHART_POINTS; i++) {
+        lv_coord_t watts = seedColumns[i];
+        if (watts != LV_CHART_POINT_NONE && watts > chartRangeMax) {
+            chartRangeMax = powerChartRangeFor(watts, POWER_CHART_RANGE_STEP_W);
+        }
+    }
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, chartRangeMax);
+    for (uint16_t i = 0; i < POWER_CHART_POINTS; i++) {
+        lv_chart_set_next_value(chart, series, seedColumns[i]);
+    }
+}
+
+// Empty minutes for the time the panel was not logging
+void restoreGap(ReplayState& st, uint32_t until) {
+    if (st.lastTime == 0 || until <= st.lastTime) return;
+    uint32_t missing = (until - st.lastTime + SECONDS_PER_MINUTE / 2) / SECONDS_PER_MINUTE;
+    if (missing <= 1) return;
+    missing--;
+    if (missing > REPLAY_WINDOW_S / SECONDS_PER_MINUTE) missing = REPLAY_WINDOW_S / SECONDS_PER_MINUTE;
+    const PowerRollup empty = { NAN, NAN, NAN, 0 };
+    for (uint32_t i = 0; i < missing; i++) {
+        history.restoreMinute(empty);
+    }
+}
+
+void replayRecord(const SampleRecord& rec, void* ctx) {
+    if (rec.kind != SAMPLE_POWER_MINUTE) return;
+    ReplayState& st = *static_cast<ReplayState*>(ctx);
+
+    restoreGap(st, rec.time);
+    // The log keeps avg and max; the minimum restores as the average
+    PowerRollup m = { rec.value, rec.extra, rec.value, rec.channel };
+    if (rec.channel == 0) m = PowerRollup{ NAN, NAN, NAN, 0 };
+    history.restoreMinute(m);
+    st.lastTime = rec.time;
+    st.minutes++;
+
+    st.recentTime[st.recentNext] = rec.time;
+    st.recentAvg[st.recentNext] = m.avg;
+    st.recentNext = (st.recentNext + 1) % REPLAY_RECENT;
+}
+
+// Chart columns for the last chart window before now, from the restored minutes
+void seedChart(const ReplayState& st, uint32_t now) {
+    const uint32_t window = POWER_CHART_POINTS * POWER_CHART_COLUMN_S;
+    bool any = false;
+    for (uint16_t c = 0; c < POWER_CHART_POINTS; c++) {
+        uint32_t t = now - window + c * POWER_CHART_COLUMN_S + POWER_CHART_COLUMN_S / 2;
+        seedColumns[c] = LV_CHART_POINT_NONE;
+        for (uint32_t i = 0; i < REPLAY_RECENT; i++) {
+            // Minute records are stamped at their end
+            uint32_t end = st.recentTime[i];
+            if (end && t < end && t + SECONDS_PER_MINUTE >= end && !isnan(st.recentAvg[i])) {
+                seedColumns[c] = powerChartValue(st.recentAvg[i]);
+                any = true;
+                break;
+            }
+        }
+    }
+    if (!any) return;
+
+    // Live columns so far were all gaps: restart the column state after the seed
+    chartSecondsSeen = history.closedSeconds();
+    columnSeconds = 0;
+    columnSum = 0;
+    columnSamples = 0;
+    ui_dispatch_call(seedChartOnLvgl, nullptr);
+}
+
+void replayLog() {
+    replayPending = false;
+    uint32_t now = (uint32_t)time(nullptr);
+    uint32_t liveMinutes = history.closedMinutes();
+
+    static ReplayState st;
+    memset(&st, 0, sizeof(st));
+    if (!history.beginRestore()) {
+        Serial.println("Power service: replay skipped (out of memory)");
+        return;
+    }
+    sampleLogRead(now - REPLAY_WINDOW_S, replayRecord, &st);
+    // Up to the first minute of this boot (approximate to the minute)
+    restoreGap(st, now + SECONDS_PER_MINUTE - liveMinutes * SECONDS_PER_MINUTE);
+    history.endRestore();
+    minutesLogged = liveMinutes;   // Minutes closed before the clock was set are not logged
+
+    if (!liveDataSeen) seedChart(st, now);
+
+    SampleLogStats log = sampleLogGetStats();
+    Serial.printf("Power service: restored %lu minutes from the log (%lu records read in %lu ms)\n",
+                  (unsigned long)st.minutes, (unsigned long)log.replayRecords, (unsigned long)log.replayMs);
+}
+
+// Append the minute that just closed
+void logClosedMinutes() {
+    uint32_t closed = history.closedMinutes();
+    if (closed == minutesLogged) return;
+    // After a stall only the newest is logged (all would carry the same time)
+    minutesLogged = closed;
+    PowerRollup m = history.minute(0);
+    if (m.seconds == 0) return;   // Gaps are implied by missing minutes
+    sampleLogAppend(SAMPLE_POWER_MINUTE, (uint8_t)m.seconds, m.avg, m.max);
+}
+
+// Fold newly closed raw seconds into chart columns
+void updateChart() {
+    if (!chart) return;
+
+    // After a stall only the last chart width matters; the rest would scroll off
+    uint32_t total = history.closedSeconds();
+    const uint32_t window = POWER_CHART_POINTS * POWER_CHART_COLUMN_S;
+    if (total - chartSecondsSeen > window) {
+        chartSecondsSeen = total - window;
+    }
+
+    // Bounded per call so a catch-up does not flood the UI dispatch ring
+    uint32_t pushed = 0;
+    while (chartSecondsSeen != total && pushed < CHART_MAX_COLUMNS_PER_LOOP) {
+        float w = history.raw(total - chartSecondsSeen - 1);
+        chartSecondsSeen++;
+        if (!isnan(w)) {
+            columnSum += w;
+            columnSamples++;
+        }
+        if (++columnSeconds >= POWER_CHART_COLUMN_S) {
+            pushColumn();
+            pushed++;
+        }
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void power_service_init(lv_obj_t* container) {
+    historyReady = history.begin();
+    if (!historyReady) {
+        Serial.println("Power service: history allocation failed");
+    }
+
+    if (container) {
+        // Strip below the power/energy labels
+        chart = lv_chart_create(container);
+        lv_obj_set_size(chart, 400, 44);
+        lv_obj_set_align(chart, LV_ALIGN_BOTTOM_MID);
+        lv_obj_set_y(chart, -2);
+        lv_obj_clear_flag(chart, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+        lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+        lv_chart_set_update_mode(chart, LV_CHART_UPDATE_MODE_CIRCULAR);
+        lv_chart_set_point_count(chart, POWER_CHART_POINTS);
+        lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, chartRangeMax);
+        lv_chart_set_div_line_count(chart, 0, 0);
+        lv_obj_set_style_bg_opa(chart, LV_OPA_TRANSP, LV_PART_MAIN);
+        lv_obj_set_style_border_width(chart, 0, LV_PART_MAIN);
+        lv_obj_set_style_pad_all(chart, 0, LV_PART_MAIN);
+        lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);    // No point markers
+        lv_obj_set_style_line_width(chart, 2, LV_PART_ITEMS);
+
+        series = lv_chart_add_series(chart, lv_color_hex(0xE9B804), LV_CHART_AXIS_PRIMARY_Y);
+        lv_chart_set_all_value(chart, series, LV_CHART_POINT_NONE);
+    }
+
+    replayPending = historyReady && sampleLogGetStats().mounted;
+
+    Serial.printf("Power service initialized (%u bytes history)\n", (unsigned)PowerHistory::memoryBytes());
+}
+
+void power_service_record(float watts) {
+    if (!historyReady) return;
+    liveDataSeen = true;
+    history.record(nowSeconds(), watts);
+}
+
+void power_service_loop() {
+    if (!historyReady) return;
+    if (replayPending && sampleLogClockValid()) {
+        replayLog();
+    }
+    history.advance(nowSeconds());
+    if (!replayPending) {
+        logClosedMinutes();
+    }
+    updateChart();
+}
+
+const PowerHistory& power_service_history() {
+    return history;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+#include "power_history.h"
+
+// ============================================================================
+// Power Service Module
+// ============================================================================
+// Keeps the house power readings (MQTT "ha/hilo_meter_power") in a PowerHistory
+// and draws a live chart under the power/energy labels on Screen1.
+//
+// Chart: one column per POWER_CHART_COLUMN_S seconds (average of the closed raw
+// seconds), POWER_CHART_POINTS columns wide, in LVGL circular mode so that each
+// new column only invalidates its own strip. The Y range only grows (in
+// POWER_CHART_RANGE_STEP_W steps), since a range change redraws the whole chart.
+// ============================================================================
+
+constexpr uint16_t POWER_CHART_POINTS = 100;
+constexpr uint32_t POWER_CHART_COLUMN_S = 6;          // 100 x 6 s = last 10 minutes
+constexpr int32_t POWER_CHART_RANGE_STEP_W = 2500;
+
+// Create the chart inside container (call once after ui_init(), under lvgl_port_lock)
+void power_service_init(lv_obj_t* container);
+
+// New meter reading in watts (app task)
+void power_service_record(float watts);
+
+// Close elapsed seconds and push chart columns (call from loop())
+void power_service_loop();
+
+// Read-only access to the series (app task)
+const PowerHistory& power_service_history();
@@ -0,0 +1,286 @@
+#include "entity_registry.h"
+
+#include "perfect_hash.h"
+#include "../net/json_scan.h"
+#include "../net/net_module.h"
+#include "../storage/settings_store.h"
+
+// ============================================================================
+// Built-in Defaults
+// ============================================================================
+// Used until a registry is pushed on the registry topic (and again when the
+// retained message is cleared). Same format as the topic and the NVS copy.
+
+static const char BUILTIN_REGISTRY[] =
+    "{\"lights\":{"
+        "\"Cuisine\":{\"toggle\":\"cuisine\",\"on\":\"cu_on\",\"off\":\"cu_of\"},"
+        "\"Salon\":{\"toggle\":\"salon\",\"on\":\"sa_on\",\"off\":\"sa_of\"},"
+        "\"Statue\":{\"toggle\":\"statue\",\"on\":\"st_on\",\"off\":\"st_of\"},"
+        "\"Galerie\":{\"toggle\":\"galerie\",\"on\":\"ga_on\",\"off\":\"ga_of\"},"
+        "\"Piscine\":{\"toggle\":\"piscine\",\"on\":\"pi_on\",\"off\":\"pi_of\"},"
+        "\"Bureau JP\":{\"toggle\":\"bureaujp\",\"on\":\"bj_on\",\"off\":\"bj_of\"},"
+        "\"Chambre JP\":{\"toggle\":\"chambrejp\",\"on\":\"cj_on\",\"off\":\"cj_of\"}"
+    "},\"locations\":{"
+        "\"Outside\":{\"key\":\"OutsideTemp\",\"bin\":0},"
+        "\"Salon\":{\"key\":\"AmbientTemp\",\"bin\":1},"
+        "\"Bureau JP\":{\"key\":\"BurjpTemp\",\"bin\":2},"
+        "\"Maitre\":{\"key\":\"MaitreTemp\",\"bin\":3},"
+        "\"Myriam\":{\"key\":\"MyriamTemp\",\"bin\":4}"
+    "}}";
+
+static const char TOPIC_REGISTRY[] = "homepanel/registry";
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+constexpr const char* SETTING_REGISTRY = "registry";     // NVS blob, through the settings store
+
+static_assert(REGISTRY_MAX_BLOB <= SETTINGS_MAX_BLOB, "registry blob larger than a setting");
+static_assert(REGISTRY_MAX_LIGHTS * 3 + REGISTRY_MAX_LOCATIONS <= PERFECT_HASH_MAX_KEYS,
+              "perfect hash too small for the registry");
+
+struct Registry {
+    char pool[REGISTRY_MAX_BLOB];   // Strings (each shorter than its quoted form in the blob)
+    size_t poolUsed;
+    LightEntity lights[REGISTRY_MAX_LIGHTS];
+    size_t lightCount;
+    LocationEntity locations[REGISTRY_MAX_LOCATIONS];
+    size_t locationCount;
+    int8_t binIndex[256];           // Location index per bin id, -1 if none
+    PerfectHash hash;
+};
+
+// Double-buffered: a blob is parsed into the idle one, which becomes active only if valid
+Registry registries[2];
+Registry* active = nullptr;
+
+uint32_t activeFingerprint = 0;     // Of the blob behind the active registry
+size_t activeLength = 0;
+RegistryStats stats = {};
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+uint32_t fingerprint(const char* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return h;
+}
+
+const char* sourceName(RegistrySource source) {
+    switch (source) {
+        case RegistrySource::NVS:  return "NVS";
+        case RegistrySource::MQTT: return "MQTT";
+        default:                   return "built-in";
+    }
+}
+
+// Copy a string span into the pool; nullptr if empty, too long or escaped
+const char* addString(Registry& r, const char* s, size_t len, size_t max) {
+    if (len == 0 || len >= max || memchr(s, '\\', len)) return nullptr;
+    if (r.poolUsed + len + 1 > sizeof(r.pool)) return nullptr;
+    char* out = r.pool + r.poolUsed;
+    memcpy(out, s, len);
+    out[len] = '\0';
+    r.poolUsed += len + 1;
+    return out;
+}
+
+bool parseLight(Registry& r, const JsonMember& m) {
+    if (m.type != JsonType::OBJECT || r.lightCount >= REGISTRY_MAX_LIGHTS) return false;
+    LightEntity e = {};
+    e.name = addString(r, m.key, m.keyLen, REGISTRY_MAX_NAME);
+
+    JsonScanner scanner(m.value, m.valueLen);
+    JsonMember field;
+    while (scanner.next(&field)) {
+        if (field.type != JsonType::STRING) continue;
+        if (field.keyEquals("toggle")) {
+            e.toggle = addString(r, field.value, field.valueLen, REGISTRY_MAX_STRING);
+        } else if (field.keyEquals("on")) {
+            e.statusOn = addString(r, field.value, field.valueLen, REGISTRY_MAX_STRING);
+        } else if (field.keyEquals("off")) {
+            e.statusOff = addString(r, field.value, field.valueLen, REGISTRY_MAX_STRING);
+        }
+    }
+    if (scanner.failed() || !e.name || !e.toggle || !e.statusOn || !e.statusOff) return false;
+    r.lights[r.lightCount++] = e;
+    return true;
+}
+
+bool parseLocation(Registry& r, const JsonMember& m) {
+    if (m.type != JsonType::OBJECT || r.locationCount >= REGISTRY_MAX_LOCATIONS) return false;
+    LocationEntity e = {};
+    e.name = addString(r, m.key, m.keyLen, REGISTRY_MAX_NAME);
+    long bin = -1;
+
+    JsonScanner scanner(m.value, m.valueLen);
+    JsonMember field;
+    while (scanner.next(&field)) {
+        if (field.keyEquals("key") && field.type == JsonType::STRING) {
+            e.mqttKey = addString(r, field.value, field.valueLen, REGISTRY_MAX_STRING);
+        } else if (field.keyEquals("bin") && !field.toInt(&bin)) {
+            return false;
+        }
+    }
+    if (scanner.failed() || !e.name || !e.mqttKey || bin < 0 || bin > 255) return false;
+    if (r.binIndex[bin] >= 0) return false;   // Bin ids are unique
+    e.binId = (uint8_t)bin;
+    r.binIndex[bin] = (int8_t)r.locationCount;
+    r.locations[r.locationCount++] = e;
+    return true;
+}
+
+// Perfect hash over every lookup key; fails on a duplicate within a domain
+bool buildHash(Registry& r) {
+    PerfectHashKey keys[PERFECT_HASH_MAX_KEYS];
+    size_t n = 0;
+    auto add = [&](EntityDomain domain, const char* s, size_t index, bool on) {
+        keys[n++] = { (uint8_t)domain, s, strlen(s), (uint16_t)((index << 1) | (on ? 1 : 0)) };
+    };
+    for (size_t i = 0; i < r.lightCount; i++) {
+        add(EntityDomain::LIGHT_STATUS, r.lights[i].statusOn, i, true);
+        add(EntityDomain::LIGHT_STATUS, r.lights[i].statusOff, i, false);
+        add(EntityDomain::LIGHT_TOGGLE, r.lights[i].toggle, i, false);
+    }
+    for (size_t i = 0; i < r.locationCount; i++) {
+        add(EntityDomain::LOCATION_KEY, r.locations[i].mqttKey, i, false);
+    }
+    return r.hash.build(keys, n);
+}
+
+bool parse(Registry& r, const char* blob, size_t len) {
+    r.poolUsed = 0;
+    r.lightCount = 0;
+    r.locationCount = 0;
+    memset(r.binIndex, -1, sizeof(r.binIndex));
+
+    bool ok = true;
+    JsonScanner scanner(blob, len);
+    JsonMember member;
+    while (ok && scanner.next(&member)) {
+        if (member.type != JsonType::OBJECT) continue;
+        bool lights = member.keyEquals("lights");
+        if (!lights && !member.keyEquals("locations")) continue;
+
+        JsonScanner entities(member.value, member.valueLen);
+        JsonMember entity;
+        while (ok && entities.next(&entity)) {
+            ok = lights ? parseLight(r, entity) : parseLocation(r, entity);
+        }
+        ok = ok && !entities.failed();
+    }
+    return ok && !scanner.failed() && r.lightCount && r.locationCount && buildHash(r);
+}
+
+// Parse into the idle registry and switch to it if valid
+bool apply(const char* blob, size_t len, RegistrySource source) {
+    Registry* next = (active == &registries[0]) ? &registries[1] : &registries[0];
+    unsigned long start = micros();
+    if (len > REGISTRY_MAX_BLOB || !parse(*next, blob, len)) {
+        stats.rejected++;
+        Serial.printf("Registry: %s config rejected (%u bytes)\n", sourceName(source), (unsigned)len);
+        return false;
+    }
+    stats.buildUs = micros() - start;
+
+    active = next;
+    activeFingerprint = fingerprint(blob, len);
+    activeLength = len;
+    stats.source = source;
+    stats.generation++;
+    stats.lights = active->lightCount;
+    stats.locations = active->locationCount;
+    stats.keys = active->hash.keys();
+    stats.slots = active->hash.slots();
+    stats.seedTries = active->hash.tries();
+    Serial.printf("Registry: %u lights, %u locations from %s (%u keys in %u slots, seed %lu after %lu tries, %lu us)\n",
+                  (unsigned)stats.lights, (unsigned)stats.locations, sourceName(source),
+                  (unsigned)stats.keys, (unsigned)stats.slots, (unsigned long)active->hash.seed(),
+                  (unsigned long)stats.seedTries, (unsigned long)stats.buildUs);
+    return true;
+}
+
+bool loadFromNVS() {
+    size_t len = settingsGetBytesLength(SETTING_REGISTRY);
+    char* blob = (len && len <= REGISTRY_MAX_BLOB) ? static_cast<char*>(malloc(len)) : nullptr;
+    bool ok = blob && settingsGetBytes(SETTING_REGISTRY, blob, len) == len &&
+              apply(blob, len, RegistrySource::NVS);
+    free(blob);
+    return ok;
+}
+
+// Retained: delivered on every session; only a different blob is applied
+void onRegistryMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %u bytes\n", topic, (unsigned)payload.len);
+
+    bool cleared = payload.len == 0;
+    const char* blob = cleared ? BUILTIN_REGISTRY : payload.data;
+    size_t len = cleared ? strlen(BUILTIN_REGISTRY) : payload.len;
+    if (len == activeLength && fingerprint(blob, len) == activeFingerprint) return;
+
+    if (!apply(blob, len, cleared ? RegistrySource::BUILTIN : RegistrySource::MQTT)) return;
+    if (cleared) {
+        settingsRemove(SETTING_REGISTRY);
+    } else {
+        settingsSetBytes(SETTING_REGISTRY, blob, len);
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void entity_registry_init() {
+    if (!loadFromNVS() && !apply(BUILTIN_REGISTRY, strlen(BUILTIN_REGISTRY), RegistrySource::BUILTIN)) {
+        Serial.println("Registry: built-in defaults rejected");
+    }
+    netSubscribe(TOPIC_REGISTRY, onRegistryMessage, REGISTRY_MAX_BLOB);
+    Serial.println("Entity registry initialized");
+}
+
+size_t entity_registry_light_count() {
+    return active ? active->lightCount : 0;
+}
+
+const LightEntity& entity_registry_light(size_t i) {
+    return active->lights[i];
+}
+
+size_t entity_registry_location_count() {
+    return active ? active->locationCount : 0;
+}
+
+const LocationEntity& entity_registry_location(size_t i) {
+    return active->locations[i];
+}
+
+EntityRef entity_registry_find(EntityDomain domain, const char* data, size_t len) {
+    stats.lookups++;
+    uint16_t v = active ? active->hash.find((uint8_t)domain, data, len) : PERFECT_HASH_MISS;
+    if (v == PERFECT_HASH_MISS) {
+        stats.misses++;
+        return { -1, false };
+    }
+    return { v >> 1, (v & 1) != 0 };
+}
+
+int entity_registry_location_for_bin(uint8_t binId) {
+    return active ? active->binIndex[binId] : -1;
+}
+
+uint32_t entity_registry_generation() {
+    return stats.generation;
+}
+
+RegistryStats entity_registry_get_stats() {
+    return stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================================
+// Entity Registry Module
+// ============================================================================
+// The lights and temperature locations the panel knows about, loaded at run
+// time instead of compiled in:
+//
+// - Built-in defaults (the former lightMeta / locationMeta arrays)
+// - Replaced at boot by the copy saved in NVS, if any
+// - Replaced at run time by the retained "homepanel/registry" topic; a new
+//   registry is saved to NVS and applied without a restart (services rebuild
+//   when entity_registry_generation() changes). An empty retained message
+//   restores the built-in defaults.
+//
+// Config blob (JSON, members in display order; names are the JSON keys):
+//   {"lights":{"Cuisine":{"toggle":"cuisine","on":"cu_on","off":"cu_of"},...},
+//    "locations":{"Outside":{"key":"OutsideTemp","bin":0},...}}
+// A blob is applied whole or not at all: at least one light and one location,
+// no escapes in strings, unique payloads, keys and bin ids.
+//
+// Payload-to-entity lookups (light status and toggle payloads, weather JSON
+// keys) go through a perfect hash built when the registry is loaded: one hash
+// and one compare per lookup whatever the number of entities. Bin ids use a
+// direct 256-entry table.
+// ============================================================================
+
+constexpr size_t REGISTRY_MAX_LIGHTS = 16;
+constexpr size_t REGISTRY_MAX_LOCATIONS = 12;
+constexpr size_t REGISTRY_MAX_NAME = 24;     // Display name, terminator included
+constexpr size_t REGISTRY_MAX_STRING = 32;   // Payloads and JSON keys, terminator included
+constexpr size_t REGISTRY_MAX_BLOB = 1536;   // Config blob (NVS and MQTT payload)
+
+struct LightEntity {
+    const char* name;           // Display name
+    const char* toggle;         // Published to toggle; key in the status snapshot
+    const char* statusOn;       // Received when ON
+    const char* statusOff;      // Received when OFF
+};
+
+struct LocationEntity {
+    const char* name;           // Display name
+    const char* mqttKey;        // JSON key in the weather payload
+    uint8_t binId;              // Id in the binary payload and the sample log (stable)
+};
+
+// Lookup domains: the same string may appear once in each
+enum class EntityDomain : uint8_t {
+    LIGHT_STATUS,   // m18toggle status payloads (cu_on / cu_of)
+    LIGHT_TOGGLE,   // Toggle payloads (snapshot keys)
+    LOCATION_KEY    // Weather JSON keys
+};
+
+// Lookup result: index into the domain's entities; on is set for an ON status payload
+struct EntityRef {
+    int index;      // -1 if unknown
+    bool on;
+};
+
+enum class RegistrySource : uint8_t {
+    BUILTIN,
+    NVS,
+    MQTT
+};
+
+struct RegistryStats {
+    RegistrySource source;
+    uint32_t generation;        // Registries applied since boot
+    uint32_t rejected;          // Blobs that failed validation
+    uint32_t lights;
+    uint32_t locations;
+    uint32_t keys;              // Keys in the perfect hash
+    uint32_t slots;             // Its table size
+    uint32_t seedTries;         // Seeds tried to build it
+    uint32_t buildUs;           // Parse + hash build time of the last load
+    uint32_t lookups;
+    uint32_t misses;
+};
+
+// Load from NVS (or the built-in defaults) and subscribe to the registry topic.
+// Call after netInit() and before the services that use it.
+void entity_registry_init();
+
+size_t entity_registry_light_count();
+const LightEntity& entity_registry_light(size_t i);
+
+size_t entity_registry_location_count();
+const LocationEntity& entity_registry_location(size_t i);
+
+// Constant-time payload / key lookup (data is length-delimited)
+EntityRef entity_registry_find(EntityDomain domain, const char* data, size_t len);
+
+// Location index for a bin id, or -1
+int entity_registry_location_for_bin(uint8_t binId);
+
+// Changes when another registry is applied (services compare it in their loop)
+uint32_t entity_registry_generation();
+
+RegistryStats entity_registry_get_stats();
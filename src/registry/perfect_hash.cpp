@@ -0,0 +1,73 @@
+#include "perfect_hash.h"
+
+#include <string.h>
+
+static_assert(PERFECT_HASH_MAX_KEYS < 0xFF, "slot table stores key indices as uint8_t");
+
+uint32_t PerfectHash::hash(uint32_t seed, uint8_t tag, const char* data, size_t len) {
+    uint32_t h = 2166136261u ^ seed;
+    h = (h ^ tag) * 16777619u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)data[i]) * 16777619u;
+    }
+    // Final avalanche so the low bits (the slot) depend on every byte
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+// Place every key with this seed; false on the first collision
+bool PerfectHash::place(uint32_t seed, size_t mask) {
+    memset(slot_, EMPTY, mask + 1);
+    for (size_t i = 0; i < count_; i++) {
+        const PerfectHashKey& k = keys_[i];
+        size_t s = hash(seed, k.tag, k.data, k.len) & mask;
+        if (slot_[s] != EMPTY) return false;
+        slot_[s] = (uint8_t)i;
+    }
+    return true;
+}
+
+bool PerfectHash::build(const PerfectHashKey* keys, size_t count) {
+    count_ = 0;
+    mask_ = 0;
+    tries_ = 0;
+    if (count > PERFECT_HASH_MAX_KEYS) return false;
+
+    // Duplicates would never separate: reject them up front (the key set is small)
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (keys[i].tag == keys[j].tag && keys[i].len == keys[j].len &&
+                memcmp(keys[i].data, keys[j].data, keys[i].len) == 0) {
+                return false;
+            }
+        }
+        keys_[i] = keys[i];
+    }
+    count_ = count;
+
+    size_t slots = 16;
+    while (slots < 4 * count) slots <<= 1;
+    for (; slots <= PERFECT_HASH_MAX_SLOTS; slots <<= 1) {
+        for (uint32_t seed = 1; seed <= PERFECT_HASH_SEED_TRIES; seed++) {
+            tries_++;
+            if (place(seed, slots - 1)) {
+                mask_ = slots - 1;
+                seed_ = seed;
+                return true;
+            }
+        }
+    }
+    count_ = 0;
+    return false;
+}
+
+uint16_t PerfectHash::find(uint8_t tag, const char* data, size_t len) const {
+    if (!count_) return PERFECT_HASH_MISS;
+    uint8_t i = slot_[hash(seed_, tag, data, len) & mask_];
+    if (i == EMPTY) return PERFECT_HASH_MISS;
+    const PerfectHashKey& k = keys_[i];
+    if (k.tag != tag || k.len != len || memcmp(k.data, data, len) != 0) return PERFECT_HASH_MISS;
+    return k.value;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Perfect Hash
+// ============================================================================
+// Collision-free lookup table over a fixed key set, built once at load time:
+// keys are hashed with a seeded FNV-1a into a power-of-two table of at least
+// 4x the key count, and seeds are tried until no two keys share a slot (the
+// table doubles if none is found within PERFECT_HASH_SEED_TRIES). A lookup is
+// one hash and one compare, whatever the number of keys.
+//
+// A key is a (tag, bytes) pair: the same string under two tags (e.g. a light
+// payload and a location key) is two keys. Key bytes are not copied - they
+// must outlive the table.
+//
+// No Arduino dependency.
+// ============================================================================
+
+constexpr size_t PERFECT_HASH_MAX_KEYS = 64;
+constexpr size_t PERFECT_HASH_MAX_SLOTS = 512;
+constexpr uint32_t PERFECT_HASH_SEED_TRIES = 4096;   // Per table size
+constexpr uint16_t PERFECT_HASH_MISS = 0xFFFF;
+
+struct PerfectHashKey {
+    uint8_t tag;
+    const char* data;
+    size_t len;
+    uint16_t value;         // Returned by find() (not PERFECT_HASH_MISS)
+};
+
+class PerfectHash {
+public:
+    // False on too many keys, a duplicate key, or no seed within the largest table
+    bool build(const PerfectHashKey* keys, size_t count);
+
+    // Value of the key, or PERFECT_HASH_MISS
+    uint16_t find(uint8_t tag, const char* data, size_t len) const;
+
+    size_t keys() const { return count_; }
+    size_t slots() const { return mask_ + 1; }
+    uint32_t seed() const { return seed_; }
+    uint32_t tries() const { return tries_; }   // Seeds tried by the last build
+
+private:
+    static constexpr uint8_t EMPTY = 0xFF;
+
+    static uint32_t hash(uint32_t seed, uint8_t tag, const char* data, size_t len);
+    bool place(uint32_t seed, size_t mask);
+
+    PerfectHashKey keys_[PERFECT_HASH_MAX_KEYS] = {};
+    uint8_t slot_[PERFECT_HASH_MAX_SLOTS];      // Key index, or EMPTY
+    size_t count_ = 0;
+    size_t mask_ = 0;
+    uint32_t seed_ = 0;
+    uint32_t tries_ = 0;
+};
@@ -0,0 +1,165 @@
+#include "status_snapshot.h"
+
+#include "lv_port.h"
+#include "../light/light_service.h"
+#include "../net/json_scan.h"
+#include "../net/net_module.h"
+#include "../temperature/temperature_service.h"
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+const char TOPIC_SNAPSHOT[] = "homepanel/snapshot";
+const char TOPIC_SNAPSHOT_GET[] = "homepanel/snapshot/get";
+const char PAYLOAD_GET[] = "get";
+// {"lights":{"<toggle>":false,...},"weather":{...}} with every registry light and location
+constexpr size_t SNAPSHOT_LIGHT_ENTRY_MAX = REGISTRY_MAX_STRING + 12;
+constexpr size_t MAX_PAYLOAD_SNAPSHOT = 32 + REGISTRY_MAX_LIGHTS * SNAPSHOT_LIGHT_ENTRY_MAX +
+                                        TEMPERATURE_MAX_PAYLOAD_WEATHER;
+
+enum class SnapshotState : uint8_t {
+    IDLE,           // Consistent (or no session yet)
+    WAIT_RETAINED,  // Session started, retained snapshot expected
+    WAIT_REPLY,     // Get published
+    LEGACY          // Per-service requests sent, counting replies
+};
+
+SnapshotState state = SnapshotState::IDLE;
+uint32_t lastSession = 0;
+unsigned long sessionStart = 0;
+unsigned long stateSince = 0;
+uint32_t deliveredAtStart = 0;
+
+// Legacy fallback: the UI is consistent at the last reply within the settle window
+uint32_t legacyDelivered = 0;
+unsigned long legacyLastReplyAt = 0;
+
+SnapshotStats stats = {};
+
+uint32_t deliveredCount() {
+    return netGetTopicStats().delivered;
+}
+
+void enter(SnapshotState next) {
+    state = next;
+    stateSince = millis();
+}
+
+void recordConsistent(unsigned long at, uint32_t messages) {
+    stats.lastLatencyMs = at - sessionStart;
+    stats.lastMessages = messages;
+    stats.latencyMsTotal += stats.lastLatencyMs;
+    stats.messagesTotal += messages;
+    Serial.printf("Snapshot: UI consistent %lu ms after session start, %lu messages\n",
+                  (unsigned long)stats.lastLatencyMs, (unsigned long)messages);
+}
+
+// Topic router handler (app task)
+void onSnapshotMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %u bytes\n", topic, (unsigned)payload.len);
+
+    // Validate the whole message before touching any service
+    const char* lights = nullptr;
+    size_t lightsLen = 0;
+    const char* weather = nullptr;
+    size_t weatherLen = 0;
+    JsonScanner scanner(payload.data, payload.len);
+    JsonMember member;
+    while (scanner.next(&member)) {
+        if (member.type != JsonType::OBJECT) continue;
+        if (member.keyEquals("lights")) {
+            lights = member.value;
+            lightsLen = member.valueLen;
+        } else if (member.keyEquals("weather")) {
+            weather = member.value;
+            weatherLen = member.valueLen;
+        }
+    }
+    if (scanner.failed() || (!lights && !weather)) {
+        stats.malformed++;
+        Serial.println("Snapshot: malformed message ignored");
+        return;
+    }
+
+    // One frame: the LVGL thread cannot drain the dispatch ring while we hold the lock
+    lvgl_port_lock(0);
+    if (lights) light_service_applySnapshot(lights, lightsLen);
+    if (weather) temperature_service_handleMQTT(weather, weatherLen);
+    lvgl_port_unlock();
+
+    // Later snapshots (republished on change) are plain updates
+    if (state == SnapshotState::WAIT_RETAINED || state == SnapshotState::WAIT_REPLY) {
+        stats.snapshots++;
+        if (state == SnapshotState::WAIT_REPLY) stats.requested++;
+        recordConsistent(millis(), deliveredCount() - deliveredAtStart);
+        enter(SnapshotState::IDLE);
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void status_snapshot_init() {
+    netSubscribe(TOPIC_SNAPSHOT, onSnapshotMessage, MAX_PAYLOAD_SNAPSHOT);
+    Serial.println("Status snapshot initialized");
+}
+
+void status_snapshot_loop() {
+    // New session: the broker (re)delivers the retained snapshot on subscribe
+    uint32_t session = netGetMqttSessionCount();
+    if (session != lastSession) {
+        lastSession = session;
+        stats.sessions++;
+        sessionStart = millis();
+        deliveredAtStart = deliveredCount();
+        enter(SnapshotState::WAIT_RETAINED);
+    }
+
+    unsigned long elapsed = millis() - stateSince;
+    switch (state) {
+        case SnapshotState::IDLE:
+            break;
+
+        case SnapshotState::WAIT_RETAINED:
+            if (elapsed >= SNAPSHOT_RETAINED_WAIT_MS) {
+                netPublish(TOPIC_SNAPSHOT_GET, PAYLOAD_GET, OutboxPriority::LOW, "snapshot_get");
+                enter(SnapshotState::WAIT_REPLY);
+            }
+            break;
+
+        case SnapshotState::WAIT_REPLY:
+            if (elapsed >= SNAPSHOT_TIMEOUT_MS) {
+                Serial.println("Snapshot: no reply, falling back to per-service status requests");
+                stats.legacy++;
+                light_service_requestStatus();
+                temperature_service_requestStatus();
+                legacyDelivered = deliveredCount();
+                legacyLastReplyAt = millis();
+                enter(SnapshotState::LEGACY);
+            }
+            break;
+
+        case SnapshotState::LEGACY: {
+            uint32_t delivered = deliveredCount();
+            if (delivered != legacyDelivered) {
+                legacyDelivered = delivered;
+                legacyLastReplyAt = millis();
+            }
+            if (millis() - legacyLastReplyAt >= SNAPSHOT_LEGACY_SETTLE_MS) {
+                recordConsistent(legacyLastReplyAt, legacyDelivered - deliveredAtStart);
+                enter(SnapshotState::IDLE);
+            }
+            break;
+        }
+    }
+}
+
+SnapshotStats status_snapshot_get_stats() {
+    return stats;
+}
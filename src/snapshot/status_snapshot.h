@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================================
+// Status Snapshot Module
+// ============================================================================
+// Brings the light and temperature state up to date after each new MQTT
+// session (boot, reconnect, local/remote switch) with one combined message
+// instead of one request per service and one reply per entity.
+//
+// Protocol (Node-RED side):
+// - "homepanel/snapshot" carries the whole state, retained, republished on
+//   any change:
+//     {"lights":{"cuisine":1,"salon":0,...},"weather":{"OutsideTemp":-15.8,...}}
+//   Light keys are the toggle payloads; values are 1/0 or true/false. The
+//   weather object is the same as on the "weather" topic.
+// - A "get" on "homepanel/snapshot/get" asks for it to be republished
+//
+// Per session: the broker delivers the retained snapshot on subscribe. If it
+// has not arrived after SNAPSHOT_RETAINED_WAIT_MS, a get is published. If
+// nothing arrives SNAPSHOT_TIMEOUT_MS after that, the legacy per-service
+// "status" requests are sent (flows without snapshot support keep working).
+//
+// A snapshot is applied under the LVGL lock, so every widget change it causes
+// lands in the same frame.
+//
+// Measured per session: time from the session start to a consistent UI (the
+// snapshot applied, or the last legacy reply within SNAPSHOT_LEGACY_SETTLE_MS)
+// and the number of messages received over that time.
+// ============================================================================
+
+constexpr uint32_t SNAPSHOT_RETAINED_WAIT_MS = 500;
+constexpr uint32_t SNAPSHOT_TIMEOUT_MS = 3000;
+constexpr uint32_t SNAPSHOT_LEGACY_SETTLE_MS = 2000;
+
+struct SnapshotStats {
+    uint32_t sessions;
+    uint32_t snapshots;         // Sessions made consistent by a snapshot
+    uint32_t requested;         // Of those, after a get (no retained message)
+    uint32_t legacy;            // Sessions that fell back to per-service requests
+    uint32_t malformed;
+    uint32_t lastLatencyMs;     // Session start to consistent UI
+    uint32_t lastMessages;      // Messages received over that time
+    uint64_t latencyMsTotal;
+    uint64_t messagesTotal;
+};
+
+// Subscribe to the snapshot topic (call once, after the services are initialized)
+void status_snapshot_init();
+
+// Detect new sessions and drive the wait / get / fallback steps (call from loop())
+void status_snapshot_loop();
+
+SnapshotStats status_snapshot_get_stats();
@@ -0,0 +1,388 @@
+#include "sample_log.h"
+
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+constexpr uint32_t SECTOR_BYTES = 4096;
+constexpr uint32_t SLOTS_PER_SECTOR = SECTOR_BYTES / SAMPLE_LOG_RECORD_BYTES;                 // 256
+constexpr uint32_t SECTORS_PER_SEGMENT = SAMPLE_LOG_SEGMENT_BYTES / SECTOR_BYTES;             // 16
+constexpr uint32_t SLOTS_PER_SEGMENT = SAMPLE_LOG_SEGMENT_BYTES / SAMPLE_LOG_RECORD_BYTES;     // 4096
+constexpr uint32_t PAGE_RECORDS = 256 / SAMPLE_LOG_RECORD_BYTES;   // One flash page per write
+constexpr uint32_t SEGMENT_MAGIC = 0x314C5048;                     // "HPL1"
+constexpr uint32_t NO_TIME = 0xFFFFFFFF;                           // Erased flash
+constexpr time_t MIN_VALID_EPOCH = 1700000000;                     // Before this the clock is not set
+
+// On-flash formats (little-endian, 16 bytes each)
+struct FlashHeader {
+    uint32_t magic;
+    uint32_t seq;           // Increases with every new segment, never 0
+    uint32_t createdAt;     // Epoch seconds
+    uint32_t crc;           // CRC32 of the fields above
+};
+
+struct FlashRecord {
+    uint32_t time;
+    uint8_t kind;
+    uint8_t channel;
+    uint16_t check;         // Low half of a CRC32 seeded with the segment seq
+    float value;
+    float extra;
+};
+
+static_assert(sizeof(FlashHeader) == SAMPLE_LOG_RECORD_BYTES, "header must fill one slot");
+static_assert(sizeof(FlashRecord) == SAMPLE_LOG_RECORD_BYTES, "record must fill one slot");
+
+const esp_partition_t* part = nullptr;
+uint32_t segCount = 0;
+uint32_t* segSeq = nullptr;         // Per segment, 0 = free
+uint32_t* sectorFirst = nullptr;    // Sparse index: first record time per sector, NO_TIME if none
+uint8_t* sectorBuf = nullptr;       // One sector, internal RAM (flash read target)
+
+// Append position
+int32_t active = -1;                          // Segment being filled, -1 = none yet
+uint32_t activeSlot = SLOTS_PER_SEGMENT;      // Next free slot; SLOTS_PER_SEGMENT = start a new segment
+bool sectorReady = false;                     // Sector of activeSlot is erased
+uint32_t nextSeq = 1;
+
+// Records waiting for the next flush
+FlashRecord pending[PAGE_RECORDS];
+uint32_t pendingCount = 0;
+uint32_t firstPendingAt = 0;
+
+SampleLogStats stats = {};
+
+uint32_t headerCrc(const FlashHeader& h) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), offsetof(FlashHeader, crc));
+}
+
+uint16_t recordCheck(const FlashRecord& r, uint32_t seq) {
+    FlashRecord tmp = r;
+    tmp.check = 0;
+    return (uint16_t)esp_rom_crc32_le(seq, reinterpret_cast<const uint8_t*>(&tmp), sizeof(tmp));
+}
+
+bool recordValid(const FlashRecord& r, uint32_t seq) {
+    return r.time != NO_TIME && r.check == recordCheck(r, seq);
+}
+
+bool slotErased(const FlashRecord& r) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&r);
+    for (size_t i = 0; i < sizeof(r); i++) {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+uint32_t segmentOffset(uint32_t seg) {
+    return seg * SAMPLE_LOG_SEGMENT_BYTES;
+}
+
+uint32_t slotOffset(uint32_t seg, uint32_t slot) {
+    return segmentOffset(seg) + slot * SAMPLE_LOG_RECORD_BYTES;
+}
+
+uint32_t* segmentIndex(uint32_t seg) {
+    return &sectorFirst[seg * SECTORS_PER_SEGMENT];
+}
+
+// Slot 0 of a segment is its header
+uint32_t firstSlotOfSector(uint32_t sector) {
+    return sector == 0 ? 1 : sector * SLOTS_PER_SECTOR;
+}
+
+// ============================================================================
+// Mount
+// ============================================================================
+
+// Read the header and the first record of each sector
+void indexSegment(uint32_t seg) {
+    uint32_t* first = segmentIndex(seg);
+    for (uint32_t s = 0; s < SECTORS_PER_SEGMENT; s++) first[s] = NO_TIME;
+    segSeq[seg] = 0;
+
+    FlashHeader h;
+    if (esp_partition_read(part, segmentOffset(seg), &h, sizeof(h)) != ESP_OK) return;
+    if (h.magic != SEGMENT_MAGIC || h.seq == 0 || h.crc != headerCrc(h)) return;   // Free (or torn header)
+    segSeq[seg] = h.seq;
+
+    for (uint32_t s = 0; s < SECTORS_PER_SEGMENT; s++) {
+        FlashRecord r;
+        if (esp_partition_read(part, slotOffset(seg, firstSlotOfSector(s)), &r, sizeof(r)) != ESP_OK) break;
+        if (!recordValid(r, h.seq)) break;
+        first[s] = r.time;
+    }
+}
+
+// Find the next free slot of the newest segment
+void findTail() {
+    const uint32_t seq = segSeq[active];
+    const uint32_t* first = segmentIndex(active);
+    uint32_t s = 0;
+    while (s + 1 < SECTORS_PER_SEGMENT && first[s + 1] != NO_TIME) s++;
+
+    activeSlot = SLOTS_PER_SEGMENT;   // Unless proven appendable below
+    if (esp_partition_read(part, segmentOffset(active) + s * SECTOR_BYTES, sectorBuf, SECTOR_BYTES) != ESP_OK) return;
+    const FlashRecord* recs = reinterpret_cast<const FlashRecord*>(sectorBuf);
+
+    uint32_t i = (s == 0) ? 1 : 0;
+    while (i < SLOTS_PER_SECTOR && recordValid(recs[i], seq)) i++;
+    if (i == SLOTS_PER_SECTOR) {
+        // Sector full: continue in the next one (erased before use)
+        activeSlot = (s + 1) * SLOTS_PER_SECTOR;
+        sectorReady = false;
+        return;
+    }
+    for (uint32_t j = i; j < SLOTS_PER_SECTOR; j++) {
+        if (!slotErased(recs[j])) {
+            // Torn write: close this segment, the next append starts a new one
+            stats.tornRecords++;
+            return;
+        }
+    }
+    activeSlot = s * SLOTS_PER_SECTOR + i;
+    sectorReady = true;
+}
+
+// ============================================================================
+// Append
+// ============================================================================
+
+// Round robin: the segment after the active one is the oldest
+bool startSegment() {
+    uint32_t seg = (active < 0) ? 0 : (uint32_t)(active + 1) % segCount;
+
+    // Forget it before erasing: a crash from here on leaves a free segment
+    segSeq[seg] = 0;
+    uint32_t* first = segmentIndex(seg);
+    for (uint32_t s = 0; s < SECTORS_PER_SEGMENT; s++) first[s] = NO_TIME;
+    active = seg;
+    activeSlot = SLOTS_PER_SEGMENT;
+
+    if (esp_partition_erase_range(part, segmentOffset(seg), SECTOR_BYTES) != ESP_OK) return false;
+    stats.sectorErases++;
+
+    FlashHeader h = { SEGMENT_MAGIC, nextSeq, (uint32_t)time(nullptr), 0 };
+    h.crc = headerCrc(h);
+    if (esp_partition_write(part, segmentOffset(seg), &h, sizeof(h)) != ESP_OK) return false;
+
+    segSeq[seg] = nextSeq++;
+    activeSlot = 1;
+    sectorReady = true;
+    return true;
+}
+
+void flushPending() {
+    uint32_t done = 0;
+    while (done < pendingCount) {
+        if (activeSlot >= SLOTS_PER_SEGMENT && !startSegment()) break;
+
+        if (!sectorReady) {
+            // Lazy erase: the sector still holds the previous lap
+            if (esp_partition_erase_range(part, slotOffset(active, activeSlot), SECTOR_BYTES) != ESP_OK) {
+                activeSlot = SLOTS_PER_SEGMENT;
+                break;
+            }
+            stats.sectorErases++;
+            sectorReady = true;
+        }
+
+        // Up to the end of the sector in one write
+        uint32_t room = SLOTS_PER_SECTOR - activeSlot % SLOTS_PER_SECTOR;
+        uint32_t n = pendingCount - done;
+        if (n > room) n = room;
+        const uint32_t seq = segSeq[active];
+        for (uint32_t k = 0; k < n; k++) {
+            pending[done + k].check = recordCheck(pending[done + k], seq);
+        }
+        if (esp_partition_write(part, slotOffset(active, activeSlot), &pending[done],
+                                n * SAMPLE_LOG_RECORD_BYTES) != ESP_OK) {
+            activeSlot = SLOTS_PER_SEGMENT;   // Unknown flash state: continue in a new segment
+            break;
+        }
+
+        uint32_t& first = segmentIndex(active)[activeSlot / SLOTS_PER_SECTOR];
+        if (first == NO_TIME) first = pending[done].time;
+        activeSlot += n;
+        done += n;
+        if (activeSlot % SLOTS_PER_SECTOR == 0) sectorReady = false;
+    }
+
+    stats.dropped += pendingCount - done;
+    stats.flushes++;
+    pendingCount = 0;
+}
+
+template <typename T>
+T* allocateArray(size_t count, uint32_t caps) {
+    return static_cast<T*>(heap_caps_calloc(count, sizeof(T), caps));
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool sampleLogInit() {
+    if (part) return true;
+    uint32_t start = millis();
+
+    const esp_partition_t* p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "fat");
+    if (!p) {
+        Serial.println("Sample log: no \"fat\" partition");
+        return false;
+    }
+
+    segCount = p->size / SAMPLE_LOG_SEGMENT_BYTES;
+    segSeq = allocateArray<uint32_t>(segCount, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    sectorFirst = allocateArray<uint32_t>(segCount * SECTORS_PER_SEGMENT, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    sectorBuf = allocateArray<uint8_t>(SECTOR_BYTES, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (segCount < 2 || !segSeq || !sectorFirst || !sectorBuf) {
+        Serial.println("Sample log: init failed (partition too small or out of memory)");
+        free(segSeq);
+        free(sectorFirst);
+        free(sectorBuf);
+        segSeq = nullptr;
+        sectorFirst = nullptr;
+        sectorBuf = nullptr;
+        return false;
+    }
+    part = p;
+
+    uint32_t maxSeq = 0;
+    for (uint32_t seg = 0; seg < segCount; seg++) {
+        indexSegment(seg);
+        if (segSeq[seg]) stats.segmentsUsed++;
+        if (segSeq[seg] > maxSeq) {
+            maxSeq = segSeq[seg];
+            active = (int32_t)seg;
+        }
+    }
+    nextSeq = maxSeq + 1;
+    if (active >= 0) findTail();
+
+    stats.mounted = true;
+    stats.segments = segCount;
+    stats.mountMs = millis() - start;
+    Serial.printf("Sample log: %lu KB, %lu/%lu segments used, mounted in %lu ms\n",
+                  (unsigned long)(p->size / 1024), (unsigned long)stats.segmentsUsed,
+                  (unsigned long)segCount, (unsigned long)stats.mountMs);
+    return true;
+}
+
+bool sampleLogClockValid() {
+    return time(nullptr) >= MIN_VALID_EPOCH;
+}
+
+bool sampleLogAppend(SampleKind kind, uint8_t channel, float value, float extra) {
+    if (!part || !sampleLogClockValid()) {
+        stats.dropped++;
+        return false;
+    }
+
+    if (pendingCount == 0) firstPendingAt = millis();
+    FlashRecord& r = pending[pendingCount++];
+    r.time = (uint32_t)time(nullptr);
+    r.kind = kind;
+    r.channel = channel;
+    r.check = 0;
+    r.value = value;
+    r.extra = extra;
+    stats.appended++;
+
+    if (pendingCount == PAGE_RECORDS) flushPending();
+    return true;
+}
+
+void sampleLogFlush() {
+    if (part && pendingCount) flushPending();
+}
+
+void sampleLogLoop() {
+    if (pendingCount && millis() - firstPendingAt >= SAMPLE_LOG_FLUSH_INTERVAL_MS) {
+        flushPending();
+    }
+}
+
+uint32_t sampleLogRead(uint32_t sinceEpoch, SampleLogVisitor visit, void* ctx) {
+    if (!part) return 0;
+    uint32_t start = millis();
+    uint32_t visited = 0;
+
+    if (active >= 0) {
+        // Sparse index: last sector starting at or before sinceEpoch (else the oldest).
+        // Segments after the active one, wrapping around, are in sequence order.
+        int32_t startSeg = -1;
+        uint32_t startSector = 0;
+        for (uint32_t k = 1; k <= segCount; k++) {
+            uint32_t seg = (uint32_t)(active + k) % segCount;
+            if (!segSeq[seg]) continue;
+            const uint32_t* first = segmentIndex(seg);
+            for (uint32_t s = 0; s < SECTORS_PER_SEGMENT && first[s] != NO_TIME; s++) {
+                if (startSeg < 0 || first[s] <= sinceEpoch) {
+                    startSeg = (int32_t)seg;
+                    startSector = s;
+                }
+            }
+        }
+
+        uint32_t seg = (uint32_t)startSeg;
+        while (startSeg >= 0) {
+            const uint32_t seq = segSeq[seg];
+            const uint32_t* first = segmentIndex(seg);
+            uint32_t s = (seg == (uint32_t)startSeg) ? startSector : 0;
+            bool segmentEnded = (seq == 0);
+            for (; !segmentEnded && s < SECTORS_PER_SEGMENT && first[s] != NO_TIME; s++) {
+                if (esp_partition_read(part, segmentOffset(seg) + s * SECTOR_BYTES, sectorBuf, SECTOR_BYTES) != ESP_OK) break;
+                const FlashRecord* recs = reinterpret_cast<const FlashRecord*>(sectorBuf);
+                for (uint32_t i = (s == 0) ? 1 : 0; i < SLOTS_PER_SECTOR; i++) {
+                    if (!recordValid(recs[i], seq)) {
+                        segmentEnded = true;
+                        break;
+                    }
+                    if (recs[i].time < sinceEpoch) continue;
+                    SampleRecord rec = { recs[i].time, recs[i].kind, recs[i].channel, recs[i].value, recs[i].extra };
+                    visit(rec, ctx);
+                    visited++;
+                }
+            }
+            if (seg == (uint32_t)active) break;
+            seg = (seg + 1) % segCount;
+        }
+    }
+
+    // Not flushed yet
+    for (uint32_t i = 0; i < pendingCount; i++) {
+        if (pending[i].time < sinceEpoch) continue;
+        SampleRecord rec = { pending[i].time, pending[i].kind, pending[i].channel, pending[i].value, pending[i].extra };
+        visit(rec, ctx);
+        visited++;
+    }
+
+    stats.replayMs = millis() - start;
+    stats.replayRecords = visited;
+    return visited;
+}
+
+SampleLogStats sampleLogGetStats() {
+    SampleLogStats s = stats;
+    s.segmentsUsed = 0;
+    s.oldestTime = 0;
+    for (uint32_t k = 1; part && active >= 0 && k <= segCount; k++) {
+        uint32_t seg = (uint32_t)(active + k) % segCount;
+        if (!segSeq[seg]) continue;
+        s.segmentsUsed++;
+        if (s.oldestTime == 0 && segmentIndex(seg)[0] != NO_TIME) s.oldestTime = segmentIndex(seg)[0];
+    }
+    return s;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+
+// ============================================================================
+// Sample Log
+// ============================================================================
+// Append-only log of power, energy and temperature samples on the raw "fat"
+// partition (partitions.csv), read back at boot so history survives reboots
+// and OTA updates. No filesystem: the partition is used through esp_partition.
+//
+// Layout:
+// - The partition is a ring of 64 KB segments, used round robin (even wear;
+//   a 4 KB sector is erased once per lap of the whole partition)
+// - Slot 0 of a segment is its header: magic, sequence number, creation
+//   time and a CRC32. A segment whose header does not check is free
+// - Slots 1.. are fixed-width 16-byte records, written in order. Each record
+//   carries a CRC seeded with its segment's sequence number, so stale
+//   records from the previous lap (sectors are erased lazily, when the
+//   append reaches them) never read as valid
+//
+// Crash safety: a crash during an erase or a header write leaves a free
+// segment; a torn record ends its segment (appending resumes in a new one).
+// Records are buffered in RAM and written one flash page at a time, at most
+// SAMPLE_LOG_FLUSH_INTERVAL_MS apart: a crash loses at most that much.
+//
+// Sparse index: the time of the first record of every sector, in RAM, built
+// at mount from one small read per sector. A read from a given time starts
+// at the right sector instead of scanning the partition.
+//
+// Time: records are stamped with the wall clock (epoch seconds); nothing is
+// logged until NTP has set it.
+//
+// Flash writes and erases stall code running from flash for their duration
+// (a sector erase is tens of ms), so they are rare by design.
+// ============================================================================
+
+constexpr uint32_t SAMPLE_LOG_SEGMENT_BYTES = 64 * 1024;
+constexpr uint32_t SAMPLE_LOG_RECORD_BYTES = 16;
+constexpr uint32_t SAMPLE_LOG_FLUSH_INTERVAL_MS = 60000;
+constexpr uint32_t SAMPLE_LOG_RETENTION_S = 30 * 24 * 3600;   // What replays may ask for
+
+enum SampleKind : uint8_t {
+    SAMPLE_POWER_MINUTE = 1,    // value: average W, extra: max W (one per minute)
+    SAMPLE_ENERGY = 2,          // value: meter energy in kWh
+    SAMPLE_TEMPERATURE = 3      // value: C, channel: location binId
+};
+
+struct SampleRecord {
+    uint32_t time;      // Epoch seconds
+    uint8_t kind;       // SampleKind
+    uint8_t channel;
+    float value;
+    float extra;        // NAN when unused
+};
+
+struct SampleLogStats {
+    bool mounted;
+    uint32_t segments;          // In the partition
+    uint32_t segmentsUsed;      // With a valid header
+    uint32_t oldestTime;        // First record still on flash, 0 if none
+    uint32_t mountMs;           // Header scan + sparse index build
+    uint32_t replayMs;          // Last sampleLogRead()
+    uint32_t replayRecords;
+    uint32_t appended;          // Since boot
+    uint32_t dropped;           // Clock not set or write error
+    uint32_t flushes;
+    uint32_t sectorErases;
+    uint32_t tornRecords;       // Found at mount (crash during a write)
+};
+
+// Callback for sampleLogRead(), in time order
+typedef void (*SampleLogVisitor)(const SampleRecord& rec, void* ctx);
+
+// Find the partition and build the index (call once in setup)
+bool sampleLogInit();
+
+// True once the wall clock is set (records can be stamped)
+bool sampleLogClockValid();
+
+// Queue a record stamped now; false if not mounted or the clock is not set
+bool sampleLogAppend(SampleKind kind, uint8_t channel, float value, float extra = NAN);
+
+// Write queued records now (before a planned restart)
+void sampleLogFlush();
+
+// Flush on interval (call from loop())
+void sampleLogLoop();
+
+// Visit every record with time >= sinceEpoch, oldest first, queued ones
+// included. Blocking; returns the number visited.
+uint32_t sampleLogRead(uint32_t sinceEpoch, SampleLogVisitor visit, void* ctx);
+
+SampleLogStats sampleLogGetStats();
@@ -0,0 +1,301 @@
+#include "settings_store.h"
+
+#include <Preferences.h>
+#include <esp_system.h>
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+namespace {
+
+constexpr const char* NVS_NAMESPACE = "homepanel";
+constexpr size_t MAX_KEY_LENGTH = 15;   // NVS limit
+
+enum class SettingType : uint8_t {
+    INT,
+    UINT,
+    BYTES
+};
+
+struct Entry {
+    char key[MAX_KEY_LENGTH + 1];
+    SettingType type;
+    bool present;               // Shadow has a value (false: not set, or removed)
+    bool dirty;                 // Shadow differs from flash
+    int32_t i;                  // INT / UINT (as bits)
+    uint8_t* bytes;             // BYTES: heap copy
+    size_t len;
+    // What flash holds, to drop a change that is undone before the flush
+    bool flashPresent;
+    size_t flashLen;
+    uint32_t flashSig;          // Integer value, or blob fingerprint
+};
+
+Preferences preferences;
+bool opened = false;
+
+Entry entries[SETTINGS_MAX_KEYS];
+size_t entryCount = 0;
+size_t dirtyCount = 0;
+unsigned long firstDirtyTime = 0;
+
+SettingsStats stats = {};
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+uint32_t fingerprint(const uint8_t* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t signature(const Entry& e) {
+    return e.type == SettingType::BYTES ? fingerprint(e.bytes, e.len) : static_cast<uint32_t>(e.i);
+}
+
+bool matchesFlash(const Entry& e) {
+    if (e.present != e.flashPresent) return false;
+    return !e.present || (e.len == e.flashLen && signature(e) == e.flashSig);
+}
+
+// Read a key from flash into a new entry
+Entry* load(const char* key, SettingType type) {
+    if (entryCount >= SETTINGS_MAX_KEYS || strlen(key) > MAX_KEY_LENGTH) {
+        Serial.printf("Settings: no room for key %s\n", key);
+        return nullptr;
+    }
+    Entry& e = entries[entryCount++];
+    e = {};
+    strcpy(e.key, key);
+    e.type = type;
+
+    if (opened && preferences.isKey(key)) {
+        stats.reads++;
+        switch (type) {
+            case SettingType::INT:
+                e.i = preferences.getInt(key, 0);
+                e.len = sizeof(e.i);
+                e.present = true;
+                break;
+            case SettingType::UINT:
+                e.i = static_cast<int32_t>(preferences.getUInt(key, 0));
+                e.len = sizeof(e.i);
+                e.present = true;
+                break;
+            case SettingType::BYTES: {
+                size_t len = preferences.getBytesLength(key);
+                uint8_t* buf = (len && len <= SETTINGS_MAX_BLOB) ? static_cast<uint8_t*>(malloc(len)) : nullptr;
+                if (buf && preferences.getBytes(key, buf, len) == len) {
+                    e.bytes = buf;
+                    e.len = len;
+                    e.present = true;
+                } else {
+                    free(buf);
+                }
+                break;
+            }
+        }
+    }
+    e.flashPresent = e.present;
+    e.flashLen = e.len;
+    e.flashSig = e.present ? signature(e) : 0;
+    stats.keys = entryCount;
+    return &e;
+}
+
+// Shadow entry for a key, loaded on first use; nullptr if the table is full or
+// the key is used with another type
+Entry* lookup(const char* key, SettingType type) {
+    for (size_t i = 0; i < entryCount; i++) {
+        if (strcmp(entries[i].key, key) != 0) continue;
+        if (entries[i].type != type) {
+            Serial.printf("Settings: key %s used with another type\n", key);
+            return nullptr;
+        }
+        return &entries[i];
+    }
+    return load(key, type);
+}
+
+// After the shadow of e changed: track whether a write is still needed
+void changed(Entry& e) {
+    bool needed = !matchesFlash(e);
+    if (e.dirty) {
+        stats.coalesced++;   // The pending write carries the new value (or is no longer needed)
+        if (!needed) {
+            e.dirty = false;
+            dirtyCount--;
+        }
+    } else if (needed) {
+        e.dirty = true;
+        if (dirtyCount++ == 0) firstDirtyTime = millis();
+    }
+    stats.dirty = dirtyCount;
+}
+
+void setInteger(const char* key, SettingType type, int32_t value) {
+    stats.sets++;
+    Entry* e = lookup(key, type);
+    if (!e) return;
+    if (e->present && e->i == value) {
+        stats.unchanged++;
+        return;
+    }
+    e->i = value;
+    e->len = sizeof(e->i);
+    e->present = true;
+    changed(*e);
+}
+
+bool writeEntry(const Entry& e) {
+    if (!e.present) return preferences.remove(e.key);
+    switch (e.type) {
+        case SettingType::INT:  return preferences.putInt(e.key, e.i) == sizeof(int32_t);
+        case SettingType::UINT: return preferences.putUInt(e.key, static_cast<uint32_t>(e.i)) == sizeof(uint32_t);
+        default:                return preferences.putBytes(e.key, e.bytes, e.len) == e.len;
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool settingsInit() {
+    opened = preferences.begin(NVS_NAMESPACE, false);   // read-write, for the whole run
+    if (!opened) {
+        Serial.println("Settings: cannot open NVS namespace, using defaults");
+        return false;
+    }
+    esp_register_shutdown_handler(settingsFlush);
+    Serial.println("Settings store initialized");
+    return true;
+}
+
+int32_t settingsGetInt(const char* key, int32_t defaultValue) {
+    Entry* e = lookup(key, SettingType::INT);
+    return (e && e->present) ? e->i : defaultValue;
+}
+
+void settingsSetInt(const char* key, int32_t value) {
+    setInteger(key, SettingType::INT, value);
+}
+
+uint32_t settingsGetUInt(const char* key, uint32_t defaultValue) {
+    Entry* e = lookup(key, SettingType::UINT);
+    return (e && e->present) ? static_cast<uint32_t>(e->i) : defaultValue;
+}
+
+void settingsSetUInt(const char* key, uint32_t value) {
+    setInteger(key, SettingType::UINT, static_cast<int32_t>(value));
+}
+
+size_t settingsGetBytesLength(const char* key) {
+    Entry* e = lookup(key, SettingType::BYTES);
+    return (e && e->present) ? e->len : 0;
+}
+
+size_t settingsGetBytes(const char* key, void* buf, size_t maxLen) {
+    Entry* e = lookup(key, SettingType::BYTES);
+    if (!e || !e->present || e->len > maxLen) return 0;
+    memcpy(buf, e->bytes, e->len);
+    return e->len;
+}
+
+bool settingsSetBytes(const char* key, const void* data, size_t len) {
+    stats.sets++;
+    Entry* e = (len <= SETTINGS_MAX_BLOB) ? lookup(key, SettingType::BYTES) : nullptr;
+    if (!e) return false;
+    if (e->present && e->len == len && memcmp(e->bytes, data, len) == 0) {
+        stats.unchanged++;
+        return true;
+    }
+    if (!e->bytes || e->len != len) {
+        uint8_t* buf = static_cast<uint8_t*>(malloc(len ? len : 1));
+        if (!buf) return false;
+        free(e->bytes);
+        e->bytes = buf;
+    }
+    memcpy(e->bytes, data, len);
+    e->len = len;
+    e->present = true;
+    changed(*e);
+    return true;
+}
+
+void settingsRemove(const char* key) {
+    stats.sets++;
+    Entry* e = nullptr;
+    for (size_t i = 0; i < entryCount && !e; i++) {
+        if (strcmp(entries[i].key, key) == 0) e = &entries[i];
+    }
+    if (!e && opened && preferences.isKey(key)) {
+        // Not read yet: only its presence matters
+        if (entryCount >= SETTINGS_MAX_KEYS) return;
+        e = &entries[entryCount++];
+        *e = {};
+        strncpy(e->key, key, MAX_KEY_LENGTH);
+        e->type = SettingType::BYTES;   // Type is irrelevant once removed
+        e->flashPresent = true;
+        stats.keys = entryCount;
+        changed(*e);
+        return;
+    }
+    if (!e || !e->present) {
+        stats.unchanged++;
+        return;
+    }
+    free(e->bytes);
+    e->bytes = nullptr;
+    e->len = 0;
+    e->present = false;
+    changed(*e);
+}
+
+void settingsFlush() {
+    if (!dirtyCount || !opened) return;
+
+    unsigned long start = micros();
+    uint32_t written = 0;
+    for (size_t i = 0; i < entryCount; i++) {
+        Entry& e = entries[i];
+        if (!e.dirty) continue;
+        if (!writeEntry(e)) {
+            stats.errors++;   // Stays dirty: retried on the next flush
+            Serial.printf("Settings: write of %s failed\n", e.key);
+            continue;
+        }
+        e.dirty = false;
+        dirtyCount--;
+        e.flashPresent = e.present;
+        e.flashLen = e.len;
+        e.flashSig = e.present ? signature(e) : 0;
+        written++;
+    }
+    firstDirtyTime = millis();
+    stats.dirty = dirtyCount;
+    if (!written) return;
+
+    stats.writes += written;
+    stats.flushes++;
+    stats.lastFlushUs = micros() - start;
+    Serial.printf("Settings: flushed %lu keys in %lu us (writes saved so far: %lu)\n",
+                  (unsigned long)written, (unsigned long)stats.lastFlushUs,
+                  (unsigned long)(stats.unchanged + stats.coalesced));
+}
+
+void settingsLoop() {
+    if (dirtyCount && millis() - firstDirtyTime >= SETTINGS_FLUSH_DELAY_MS) {
+        settingsFlush();
+    }
+}
+
+SettingsStats settingsGetStats() {
+    return stats;
+}
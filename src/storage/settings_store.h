@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============================================================================
+// Settings Store
+// ============================================================================
+// The one owner of the "homepanel" NVS namespace. Modules used to open and
+// close it around every read and write, each with its own save debounce; they
+// now read and write a RAM shadow through this typed API:
+//
+// - The namespace is opened once, at settingsInit(), and stays open
+// - A key is read from flash on first use, then served from the shadow
+// - A set that matches the shadow is dropped; otherwise the key is marked
+//   dirty and the flash write is deferred
+// - Dirty keys are written together, in one pass, SETTINGS_FLUSH_DELAY_MS
+//   after the first of them changed (a value that keeps changing is written
+//   at most once per delay), and at shutdown: settingsFlush() is registered
+//   as an esp_restart() handler, so OTA and the other restarts keep the
+//   latest values. A crash or power cut loses at most one delay of changes.
+//
+// Each key keeps the NVS type it was written with before the store existed
+// (int, uint or blob), so existing values are read back as they are.
+// Single-threaded: call from the app task (the sketch's loop()).
+// ============================================================================
+
+constexpr uint32_t SETTINGS_FLUSH_DELAY_MS = 30000;
+constexpr size_t SETTINGS_MAX_KEYS = 16;
+constexpr size_t SETTINGS_MAX_BLOB = 1536;     // Largest blob value (the entity registry)
+
+// Cumulative since boot
+struct SettingsStats {
+    uint32_t keys;              // In the shadow
+    uint32_t dirty;             // Waiting for the next flush
+    uint32_t reads;             // Flash reads (first use of a key)
+    uint32_t sets;              // Set / remove calls
+    uint32_t unchanged;         // Sets equal to the stored value (no write needed)
+    uint32_t coalesced;         // Sets that replaced a value not yet written
+    uint32_t writes;            // Flash writes and removes
+    uint32_t flushes;           // Passes that wrote at least one key
+    uint32_t errors;            // Failed writes (the key stays dirty)
+    uint32_t lastFlushUs;
+};
+
+// Open the namespace (call first in setup(), before any module reads a setting)
+bool settingsInit();
+
+int32_t settingsGetInt(const char* key, int32_t defaultValue);
+void settingsSetInt(const char* key, int32_t value);
+
+uint32_t settingsGetUInt(const char* key, uint32_t defaultValue);
+void settingsSetUInt(const char* key, uint32_t value);
+
+// Blob length, 0 if the key is not set
+size_t settingsGetBytesLength(const char* key);
+// Copy of the blob into buf; returns its length, 0 if not set or larger than maxLen
+size_t settingsGetBytes(const char* key, void* buf, size_t maxLen);
+// False if len exceeds SETTINGS_MAX_BLOB or the key table is full
+bool settingsSetBytes(const char* key, const void* data, size_t len);
+
+// Delete the key (on the next flush)
+void settingsRemove(const char* key);
+
+// Write every dirty key now (shutdown; also runs from esp_restart())
+void settingsFlush();
+
+// Deferred flush (call in loop())
+void settingsLoop();
+
+// Writes saved = unchanged + coalesced
+SettingsStats settingsGetStats();
@@ -0,0 +1,172 @@
+#include "temp_history.h"
+
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+
+void* allocate(size_t bytes) {
+#ifdef ARDUINO
+    void* p = heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p) return p;
+#endif
+    return calloc(1, bytes);   // Host, or internal RAM fallback
+}
+
+}  // namespace
+
+size_t TempHistory::memoryBytes() {
+    return TEMP_HISTORY_SLOTS * (sizeof(int16_t) + 2 * sizeof(uint16_t));
+}
+
+bool TempHistory::begin() {
+    if (ring_) return true;
+    // One block: ring, then the two deques
+    uint8_t* block = static_cast<uint8_t*>(allocate(memoryBytes()));
+    if (!block) return false;
+    ring_ = reinterpret_cast<int16_t*>(block);
+    minQ_.seq = reinterpret_cast<uint16_t*>(block + TEMP_HISTORY_SLOTS * sizeof(int16_t));
+    maxQ_.seq = minQ_.seq + TEMP_HISTORY_SLOTS;
+    return true;
+}
+
+void TempHistory::reset() {
+    head_ = 0;
+    count_ = 0;
+    minQ_.head = minQ_.size = 0;
+    maxQ_.head = maxQ_.size = 0;
+    started_ = false;
+    hasBase_ = false;
+    base_ = 0;
+    slot_ = 0;
+    closed_ = 0;
+    openSum_ = 0;
+    openSamples_ = 0;
+    held_ = GAP;
+    heldSlot_ = 0;
+}
+
+int16_t TempHistory::quantize(float tempC) const {
+    float steps = roundf((tempC - base_) / TEMP_HISTORY_QUANTUM_C);
+    if (steps > INT16_MAX) steps = INT16_MAX;
+    if (steps < -INT16_MAX) steps = -INT16_MAX;   // INT16_MIN is the gap marker
+    return (int16_t)steps;
+}
+
+void TempHistory::record(uint32_t epoch, float tempC) {
+    if (!ring_ || isnan(tempC)) return;
+    if (!hasBase_) {
+        base_ = tempC;
+        hasBase_ = true;
+    }
+    if (!started_) {
+        started_ = true;
+        slot_ = epoch / TEMP_HISTORY_SLOT_S;
+        count_ = 1;
+    } else {
+        advance(epoch);
+    }
+
+    openSum_ += tempC;
+    openSamples_++;
+    ring_[head_] = quantize((float)(openSum_ / openSamples_));
+    held_ = quantize(tempC);
+    heldSlot_ = slot_;
+}
+
+void TempHistory::advance(uint32_t epoch) {
+    if (!ring_ || !started_) return;
+    uint32_t target = epoch / TEMP_HISTORY_SLOT_S;
+    if (target <= slot_) return;
+
+    // Longer than the window: nothing before it survives, close one window's worth
+    if (target - slot_ > TEMP_HISTORY_SLOTS) {
+        slot_ = target - TEMP_HISTORY_SLOTS;
+        minQ_.size = 0;
+        maxQ_.size = 0;
+    }
+    while (slot_ < target) {
+        openNext();
+    }
+}
+
+void TempHistory::openNext() {
+    int16_t q = ring_[head_];
+
+    // The new open slot takes the ring entry of the slot leaving the window
+    head_ = (head_ + 1) % TEMP_HISTORY_SLOTS;
+    if (count_ < TEMP_HISTORY_SLOTS) count_++;
+    slot_++;
+    closed_++;
+    pushClosed(q);
+
+    openSum_ = 0;
+    openSamples_ = 0;
+    ring_[head_] = (held_ != GAP && slot_ - heldSlot_ <= TEMP_HISTORY_HOLD_SLOTS) ? held_ : GAP;
+}
+
+// The slot just closed (slot_ - 1) enters the deques
+void TempHistory::pushClosed(int16_t q) {
+    dequeExpire(minQ_);
+    dequeExpire(maxQ_);
+    if (q == GAP) return;
+    dequePush(minQ_, q, true);
+    dequePush(maxQ_, q, false);
+}
+
+// Ring value of a closed slot still in the window
+int16_t TempHistory::valueOfSeq(uint16_t seq) const {
+    uint16_t age = (uint16_t)((uint16_t)slot_ - seq);
+    return ring_[(head_ + TEMP_HISTORY_SLOTS - age) % TEMP_HISTORY_SLOTS];
+}
+
+// Drop the back while it can no longer be the extreme, then append
+void TempHistory::dequePush(Deque& d, int16_t q, bool keepMin) {
+    uint16_t seq = (uint16_t)(slot_ - 1);
+    while (d.size) {
+        int16_t back = valueOfSeq(d.seq[(d.head + d.size - 1) % TEMP_HISTORY_SLOTS]);
+        if (keepMin ? back < q : back > q) break;
+        d.size--;
+    }
+    d.seq[(d.head + d.size) % TEMP_HISTORY_SLOTS] = seq;
+    d.size++;
+}
+
+// Drop the front once its slot leaves the window
+void TempHistory::dequeExpire(Deque& d) {
+    while (d.size && (uint16_t)((uint16_t)slot_ - d.seq[d.head]) >= TEMP_HISTORY_SLOTS) {
+        d.head = (d.head + 1) % TEMP_HISTORY_SLOTS;
+        d.size--;
+    }
+}
+
+float TempHistory::extreme(const Deque& d, bool wantMin) const {
+    if (!ring_ || !count_) return NAN;
+    int16_t best = d.size ? valueOfSeq(d.seq[d.head]) : GAP;
+    int16_t open = ring_[head_];
+    if (best == GAP || (open != GAP && (wantMin ? open < best : open > best))) best = open;
+    return value(best);
+}
+
+float TempHistory::min() const {
+    return extreme(minQ_, true);
+}
+
+float TempHistory::max() const {
+    return extreme(maxQ_, false);
+}
+
+float TempHistory::at(size_t ago) const {
+    if (ago >= count_) return NAN;
+    return value(ring_[(head_ + TEMP_HISTORY_SLOTS - ago) % TEMP_HISTORY_SLOTS]);
+}
+
+float TempHistory::trendPerHour() const {
+    float now = at(0);
+    float before = at(TEMP_HISTORY_TREND_SLOTS);
+    if (isnan(now) || isnan(before)) return NAN;
+    return (now - before) * 3600.0f / (TEMP_HISTORY_TREND_SLOTS * TEMP_HISTORY_SLOT_S);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Temperature History
+// ============================================================================
+// One location's temperature over the last 24 hours, one value per 5-minute
+// slot of the wall clock:
+//
+// - Values are stored as int16 deltas from a per-location base, quantized to
+//   TEMP_HISTORY_QUANTUM_C (576 bytes per location instead of 1152 as floats)
+// - The newest slot is open: it holds the average of the samples received in
+//   it so far, and is the value shown as "now"
+// - Node-RED does not publish every 5 minutes: a sample holds for up to
+//   TEMP_HISTORY_HOLD_SLOTS slots; slots beyond that are gaps
+//
+// Min/max over the window are kept incrementally with monotonic deques of
+// the closed slots (amortized O(1) per slot, no rescan when the extreme
+// leaves the window). The trend compares the open slot with the one an hour
+// earlier.
+//
+// No Arduino dependency (PSRAM allocation only under ARDUINO).
+// ============================================================================
+
+constexpr uint32_t TEMP_HISTORY_SLOT_S = 300;        // 5 minutes
+constexpr size_t TEMP_HISTORY_SLOTS = 288;           // 24 hours
+constexpr uint32_t TEMP_HISTORY_HOLD_SLOTS = 6;      // A sample fills empty slots for 30 minutes
+constexpr size_t TEMP_HISTORY_TREND_SLOTS = 12;      // Trend over the last hour
+constexpr float TEMP_HISTORY_QUANTUM_C = 0.01f;
+
+class TempHistory {
+public:
+    // Allocate the ring and deques (PSRAM on the target); false if out of memory
+    bool begin();
+
+    // Forget every sample (keeps the allocation), e.g. when the slot is reused for another location
+    void reset();
+
+    // Sample at epoch seconds (closes elapsed slots first). Samples older than
+    // the open slot (clock stepped back) are counted in the open slot.
+    void record(uint32_t epoch, float tempC);
+
+    // Close every slot before epoch (call periodically; idempotent)
+    void advance(uint32_t epoch);
+
+    // Newest first: ago = 0 is the open slot; NAN for a gap
+    size_t count() const { return count_; }
+    float at(size_t ago) const;
+    float latest() const { return at(0); }
+
+    // Over the window (open slot included); NAN if it has no value
+    float min() const;
+    float max() const;
+
+    // C per hour between the open slot and TEMP_HISTORY_TREND_SLOTS before; NAN if either is a gap
+    float trendPerHour() const;
+
+    // Slots closed since begin (consumers track their position)
+    uint32_t closedSlots() const { return closed_; }
+
+    // Bytes allocated per instance
+    static size_t memoryBytes();
+
+private:
+    static constexpr int16_t GAP = INT16_MIN;
+
+    struct Deque {
+        uint16_t* seq;      // Low 16 bits of slot numbers (the window is far shorter)
+        size_t head;
+        size_t size;
+    };
+
+    int16_t quantize(float tempC) const;
+    float value(int16_t q) const { return q == GAP ? NAN : base_ + q * TEMP_HISTORY_QUANTUM_C; }
+    int16_t valueOfSeq(uint16_t seq) const;
+    void openNext();
+    void pushClosed(int16_t q);
+    void dequePush(Deque& d, int16_t q, bool keepMin);
+    void dequeExpire(Deque& d);
+    float extreme(const Deque& d, bool wantMin) const;
+
+    int16_t* ring_ = nullptr;
+    size_t head_ = 0;              // Open slot
+    size_t count_ = 0;             // Slots in the ring, open one included
+    Deque minQ_ = {};
+    Deque maxQ_ = {};
+
+    bool started_ = false;
+    bool hasBase_ = false;
+    float base_ = 0;
+    uint32_t slot_ = 0;            // Slot number (epoch / TEMP_HISTORY_SLOT_S) of the open slot
+    uint32_t closed_ = 0;
+    double openSum_ = 0;           // Samples in the open slot
+    uint32_t openSamples_ = 0;
+    int16_t held_ = GAP;           // Last sample, held for TEMP_HISTORY_HOLD_SLOTS
+    uint32_t heldSlot_ = 0;
+};
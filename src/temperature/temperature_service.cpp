@@ -1,32 +1,32 @@
 #include "temperature_service.h"
 
-#include <Preferences.h>
+#include <time.h>
+
+#include "lv_port.h"
+#include "temp_history.h"
+#include "../net/json_scan.h"
+#include "../net/net_module.h"
+#include "../registry/entity_registry.h"
+#include "../storage/sample_log.h"
+#include "../storage/settings_store.h"
 #include "../time/time_service.h"
+#include "../ui/ui_dispatch.h"
 
 // MQTT constants
 static const char TOPIC_WEATHER[] = "weather";
+static const char TOPIC_WEATHER_BIN[] = "weather/bin";    // Fixed-layout binary samples (see below)
 static const char PAYLOAD_STATUS[] = "status";
-
-// ============================================================================
-// Location Configuration - Single Source of Truth
-// ============================================================================
-// To add/remove locations, only modify this array.
-// Everything else adapts automatically.
-
-struct LocationMeta {
-    const char* label;      // Display name
-    const char* mqttKey;    // JSON key in MQTT payload
-};
-
-const LocationMeta locationMeta[] = {
-    { "Outside", "OutsideTemp" },
-    { "Salon", "AmbientTemp" }, 
-    { "Bureau JP", "BurjpTemp" },
-    { "Maitre", "MaitreTemp" },
-    { "Myriam", "MyriamTemp" }
-};
-
-constexpr size_t TEMP_LOC_COUNT = sizeof(locationMeta) / sizeof(locationMeta[0]);
+static constexpr size_t MAX_PAYLOAD_WEATHER_BIN = 64;
+
+// Binary weather payload (topic "weather/bin"), little-endian:
+//   [0]    version (WEATHER_BIN_VERSION)
+//   [1]    sample count N
+//   [2..]  N x { uint8 location binId, int16 temperature in 0.01 C }
+// Unknown binIds are skipped so Node-RED can send locations this panel does not show.
+// Locations (names, JSON keys, binIds) come from the entity registry (src/registry/).
+static constexpr uint8_t WEATHER_BIN_VERSION = 1;
+static constexpr size_t WEATHER_BIN_HEADER = 2;
+static constexpr size_t WEATHER_BIN_SAMPLE = 3;
 
 // ============================================================================
 // Temperature Sample Storage
@@ -44,59 +44,69 @@ struct TempSample {
 
 namespace {
 
-// NVS configuration
-constexpr const char* NVS_NAMESPACE = "homepanel";
-constexpr const char* NVS_KEY_TEMP_LOC = "temp_loc";
-constexpr unsigned long NVS_DEBOUNCE_MS = 30000;  // 30 seconds
+// Settings key (written by the settings store's deferred flush)
+constexpr const char* SETTING_TEMP_LOC = "temp_loc";
 
 // Temperature samples for each location
-TempSample tempSamples[TEMP_LOC_COUNT] = {};
+TempSample tempSamples[REGISTRY_MAX_LOCATIONS] = {};
 
 // Current selected location
 size_t currentLocation = 0;
 
+// Registry the arrays below are indexed by
+uint32_t registryGeneration = 0;
+
+// Offline: values kept but shown gray
+bool valuesStale = false;
+
 // LVGL label pointers
 lv_obj_t* labelLoc = nullptr;
 lv_obj_t* labelTemp = nullptr;
 lv_obj_t* labelTime = nullptr;
 
-// MQTT client pointer (for publishing status requests)
-PubSubClient* mqtt = nullptr;
-
-// NVS debounce state
-unsigned long lastLocationChangeTime = 0;
-bool nvsSavePending = false;
-size_t pendingLocation = 0;
-size_t lastSavedLocation = 0;  // Track last saved to avoid redundant writes
-
-Preferences preferences;
+// Sample log: at most one reading per location per interval
+constexpr unsigned long SAMPLE_LOG_INTERVAL_MS = 300000;  // 5 minutes
+unsigned long lastLoggedAt[REGISTRY_MAX_LOCATIONS] = {};
+bool loggedOnce[REGISTRY_MAX_LOCATIONS] = {};
+
+// 24 h history per location (wall clock; replayed from the sample log once NTP is set)
+TempHistory histories[REGISTRY_MAX_LOCATIONS];
+bool historyReady = false;
+bool historyReplayPending = false;
+unsigned long lastHistoryAdvance = 0;
+constexpr unsigned long HISTORY_ADVANCE_INTERVAL_MS = 10000;
+constexpr float TREND_STEADY_C_PER_H = 0.3f;   // Below this (either way) no arrow
+
+// Trend view under the location button: "arrow min / max" and a 24 h sparkline
+lv_obj_t* labelTrend = nullptr;
+lv_obj_t* sparkChart = nullptr;
+lv_chart_series_t* sparkSeries = nullptr;
+size_t sparkLoc = 0;                 // Location the chart holds (LVGL side, set under the lock)
+int8_t sparkRange[2] = { 0, 0 };     // Last range sent, whole degrees
+
+// Sparkline updates carried in the ui_dispatch_call context:
+// bits 20+ location, 16..19 op, 0..15 argument
+enum SparkOp : uint32_t {
+    SPARK_SET_NEWEST = 0,   // arg: open slot value, 0.1 C
+    SPARK_APPEND = 1,       // arg: new open slot value, 0.1 C
+    SPARK_RANGE = 2         // arg: min degree (high byte), max degree (low byte)
+};
 
 // ============================================================================
 // Internal Functions
 // ============================================================================
 
-void loadLocationFromNVS() {
-    preferences.begin(NVS_NAMESPACE, true);  // read-only
-    int savedLoc = preferences.getInt(NVS_KEY_TEMP_LOC, 0);
-    preferences.end();
+void loadSavedLocation() {
+    int32_t savedLoc = settingsGetInt(SETTING_TEMP_LOC, 0);
 
     // Validate saved location is within bounds
-    if (savedLoc >= 0 && savedLoc < static_cast<int>(TEMP_LOC_COUNT)) {
+    if (savedLoc >= 0 && savedLoc < static_cast<int>(entity_registry_location_count())) {
         currentLocation = static_cast<size_t>(savedLoc);
     } else {
         currentLocation = 0;
     }
-    lastSavedLocation = currentLocation;  // Track what was loaded
-    Serial.printf("Temperature service: loaded location %d (%s) from NVS\n",
-                  currentLocation, locationMeta[currentLocation].label);
-}
-
-void saveLocationToNVS(size_t loc) {
-    preferences.begin(NVS_NAMESPACE, false);  // read-write
-    preferences.putInt(NVS_KEY_TEMP_LOC, static_cast<int>(loc));
-    preferences.end();
-    Serial.printf("Temperature service: saved location %d (%s) to NVS\n",
-                  loc, locationMeta[loc].label);
+    Serial.printf("Temperature service: loaded location %d (%s) from settings\n",
+                  currentLocation, entity_registry_location(currentLocation).name);
 }
 
 lv_color_t getTemperatureColor(float temp) {
@@ -109,36 +119,268 @@ lv_color_t getTemperatureColor(float temp) {
     }
 }
 
+lv_coord_t sparkValue(float tempC) {
+    return isnan(tempC) ? LV_CHART_POINT_NONE : (lv_coord_t)lroundf(tempC * 10.0f);
+}
+
+// Runs on the LVGL thread (ui_dispatch_call)
+void sparkOnLvgl(void* ctx) {
+    uint32_t v = (uint32_t)(uintptr_t)ctx;
+    size_t loc = v >> 20;
+    uint32_t op = (v >> 16) & 0xF;
+    uint16_t arg = v & 0xFFFF;
+    if (!sparkChart || loc != sparkLoc) return;   // Queued before a location change
+
+    if (op == SPARK_RANGE) {
+        lv_chart_set_range(sparkChart, LV_CHART_AXIS_PRIMARY_Y,
+                           (int8_t)(arg >> 8) * 10, (int8_t)(arg & 0xFF) * 10);
+    } else if (op == SPARK_APPEND) {
+        lv_chart_set_next_value(sparkChart, sparkSeries, (lv_coord_t)(int16_t)arg);
+    } else {
+        uint16_t newest = (lv_chart_get_x_start_point(sparkChart, sparkSeries) + TEMP_HISTORY_SLOTS - 1) % TEMP_HISTORY_SLOTS;
+        lv_chart_get_y_array(sparkChart, sparkSeries)[newest] = (lv_coord_t)(int16_t)arg;
+        lv_chart_refresh(sparkChart);
+    }
+}
+
+void dispatchSpark(SparkOp op, uint16_t arg) {
+    ui_dispatch_call(sparkOnLvgl, (void*)(uintptr_t)((currentLocation << 20) | (op << 16) | arg));
+}
+
+// Y range in whole degrees around the window's min/max (only sent when it changes)
+void updateSparkRange(const TempHistory& h) {
+    float lo = h.min();
+    float hi = h.max();
+    if (isnan(lo)) return;
+    int8_t range[2] = { (int8_t)floorf(lo), (int8_t)ceilf(hi) };
+    if (range[1] <= range[0]) range[1] = range[0] + 1;
+    if (range[0] == sparkRange[0] && range[1] == sparkRange[1]) return;
+    sparkRange[0] = range[0];
+    sparkRange[1] = range[1];
+    dispatchSpark(SPARK_RANGE, (uint16_t)(((uint8_t)range[0] << 8) | (uint8_t)range[1]));
+}
+
+// Whole sparkline for the current location (cycle, replay, catch-up), under the LVGL lock
+void fillSparkline() {
+    if (!sparkChart) return;
+    const TempHistory& h = histories[currentLocation];
+    float lo = h.min();
+    float hi = h.max();
+    sparkRange[0] = isnan(lo) ? 0 : (int8_t)floorf(lo);
+    sparkRange[1] = isnan(hi) ? 1 : (int8_t)ceilf(hi);
+    if (sparkRange[1] <= sparkRange[0]) sparkRange[1] = sparkRange[0] + 1;
+
+    lvgl_port_lock(0);
+    sparkLoc = currentLocation;
+    lv_chart_set_x_start_point(sparkChart, sparkSeries, 0);
+    lv_coord_t* y = lv_chart_get_y_array(sparkChart, sparkSeries);
+    for (size_t i = 0; i < TEMP_HISTORY_SLOTS; i++) {
+        y[i] = sparkValue(h.at(TEMP_HISTORY_SLOTS - 1 - i));   // Oldest first
+    }
+    lv_chart_set_range(sparkChart, LV_CHART_AXIS_PRIMARY_Y, sparkRange[0] * 10, sparkRange[1] * 10);
+    lv_chart_refresh(sparkChart);
+    lvgl_port_unlock();
+}
+
+// Bring the sparkline up to date after location i changed (closedBefore: its closed slots before)
+void syncSparkline(size_t i, uint32_t closedBefore) {
+    if (i != currentLocation || !sparkChart) return;
+    const TempHistory& h = histories[i];
+    uint32_t closed = h.closedSlots() - closedBefore;
+    if (closed > 1) {
+        fillSparkline();
+        return;
+    }
+    uint16_t newest = (uint16_t)sparkValue(h.latest());
+    dispatchSpark(closed ? SPARK_APPEND : SPARK_SET_NEWEST, newest);
+    updateSparkRange(h);
+}
+
+// "arrow min / max" of the current location, from the incremental state
+void updateTrendLabel() {
+    if (!labelTrend) return;
+    const TempHistory& h = histories[currentLocation];
+    float lo = h.min();
+    float hi = h.max();
+    if (isnan(lo)) {
+        ui_dispatch_label_text(labelTrend, "");
+        return;
+    }
+    float trend = h.trendPerHour();
+    const char* arrow = "";
+    if (!isnan(trend) && trend >= TREND_STEADY_C_PER_H) arrow = LV_SYMBOL_UP " ";
+    if (!isnan(trend) && trend <= -TREND_STEADY_C_PER_H) arrow = LV_SYMBOL_DOWN " ";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%.1f / %.1f", arrow, lo, hi);
+    ui_dispatch_label_text(labelTrend, buf);
+}
+
 void updateUI() {
     const TempSample& sample = tempSamples[currentLocation];
-    const LocationMeta& meta = locationMeta[currentLocation];
+    const LocationEntity& meta = entity_registry_location(currentLocation);
 
     // Update location label (if available)
-    if (labelLoc) {
-        lv_label_set_text(labelLoc, meta.label);
-    }
+    ui_dispatch_label_text(labelLoc, meta.name);
 
     // Update temperature label (if available)
-    if (labelTemp) {
-        if (sample.valid) {
-            char buf[16];
-            snprintf(buf, sizeof(buf), "%.1f C", sample.temperatureC);
-            lv_label_set_text(labelTemp, buf);
-            lv_obj_set_style_text_color(labelTemp, getTemperatureColor(sample.temperatureC), 0);
-        } else {
-            lv_label_set_text(labelTemp, "--");
-            lv_obj_set_style_text_color(labelTemp, lv_color_white(), 0);
-        }
+    if (sample.valid) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%.1f C", sample.temperatureC);
+        ui_dispatch_label_text(labelTemp, buf);
+        ui_dispatch_text_color(labelTemp, valuesStale ? lv_palette_main(LV_PALETTE_GREY)
+                                                      : getTemperatureColor(sample.temperatureC));
+    } else {
+        ui_dispatch_label_text(labelTemp, "--");
+        ui_dispatch_text_color(labelTemp, lv_color_white());
     }
 
     // Update time label (if available)
-    if (labelTime) {
-        if (sample.valid) {
-            lv_label_set_text(labelTime, sample.timeHHMM);
-        } else {
-            lv_label_set_text(labelTime, "--:--");
+    ui_dispatch_label_text(labelTime, sample.valid ? sample.timeHHMM : "--:--");
+
+    updateTrendLabel();
+}
+
+struct ReplayState {
+    uint32_t lastTime[REGISTRY_MAX_LOCATIONS];
+    float lastTemp[REGISTRY_MAX_LOCATIONS];
+};
+
+void replayRecord(const SampleRecord& rec, void* ctx) {
+    if (rec.kind != SAMPLE_TEMPERATURE) return;
+    int i = entity_registry_location_for_bin(rec.channel);
+    if (i < 0) return;
+    histories[i].record(rec.time, rec.value);
+    ReplayState& st = *static_cast<ReplayState*>(ctx);
+    st.lastTime[i] = rec.time;
+    st.lastTemp[i] = rec.value;
+}
+
+// Once the clock is set: last 24 h from the sample log, before any live sample
+void replayHistoryIfDue() {
+    if (!historyReplayPending || !sampleLogClockValid()) return;
+    historyReplayPending = false;
+
+    ReplayState st = {};
+    uint32_t now = (uint32_t)time(nullptr);
+    uint32_t records = sampleLogRead(now - TEMP_HISTORY_SLOTS * TEMP_HISTORY_SLOT_S, replayRecord, &st);
+
+    // Locations not heard from yet show their last logged value and its time
+    for (size_t i = 0; i < entity_registry_location_count(); i++) {
+        if (tempSamples[i].valid || !st.lastTime[i]) continue;
+        time_t t = st.lastTime[i];
+        struct tm local;
+        localtime_r(&t, &local);
+        tempSamples[i].temperatureC = st.lastTemp[i];
+        strftime(tempSamples[i].timeHHMM, sizeof(tempSamples[i].timeHHMM), "%H:%M", &local);
+        tempSamples[i].valid = true;
+    }
+    Serial.printf("Temperature service: replayed %lu records in %lu ms\n",
+                  (unsigned long)records, (unsigned long)sampleLogGetStats().replayMs);
+
+    fillSparkline();
+    updateUI();
+}
+
+// Record a live sample in the location's history (once the clock is set)
+void recordHistory(size_t i, float temp) {
+    if (!historyReady || !sampleLogClockValid()) return;
+    replayHistoryIfDue();
+    uint32_t before = histories[i].closedSlots();
+    histories[i].record((uint32_t)time(nullptr), temp);
+    syncSparkline(i, before);
+}
+
+// Store one sample; returns true if it is the location on screen
+bool applySample(size_t i, float temp, const char* timeHHMM) {
+    tempSamples[i].temperatureC = temp;
+    tempSamples[i].valid = true;
+    strncpy(tempSamples[i].timeHHMM, timeHHMM, sizeof(tempSamples[i].timeHHMM) - 1);
+    tempSamples[i].timeHHMM[sizeof(tempSamples[i].timeHHMM) - 1] = '\0';
+
+    Serial.printf("Temperature update: %s = %.1f C at %s\n",
+                  entity_registry_location(i).name, temp, tempSamples[i].timeHHMM);
+
+    recordHistory(i, temp);
+
+    if (!loggedOnce[i] || millis() - lastLoggedAt[i] >= SAMPLE_LOG_INTERVAL_MS) {
+        if (sampleLogAppend(SAMPLE_TEMPERATURE, entity_registry_location(i).binId, temp)) {
+            loggedOnce[i] = true;
+            lastLoggedAt[i] = millis();
         }
     }
+    return i == currentLocation;
+}
+
+// Sample time (hh:mm only, first 5 characters), once per message
+void currentTimeHHMM(char* out, size_t size) {
+    String timeStr = time_service_getFormattedTime();
+    strncpy(out, timeStr.c_str(), size - 1);
+    out[size - 1] = '\0';
+}
+
+void handleBinary(const uint8_t* data, size_t length) {
+    if (length < WEATHER_BIN_HEADER || data[0] != WEATHER_BIN_VERSION) {
+        Serial.printf("Temperature service: bad binary payload (%u bytes)\n", (unsigned)length);
+        return;
+    }
+    size_t count = data[1];
+    if (length != WEATHER_BIN_HEADER + count * WEATHER_BIN_SAMPLE) {
+        Serial.printf("Temperature service: binary payload length %u != %u samples\n",
+                      (unsigned)length, (unsigned)count);
+        return;
+    }
+
+    char timeHHMM[6];
+    currentTimeHHMM(timeHHMM, sizeof(timeHHMM));
+
+    bool current = false;
+    const uint8_t* p = data + WEATHER_BIN_HEADER;
+    for (size_t n = 0; n < count; n++, p += WEATHER_BIN_SAMPLE) {
+        int i = entity_registry_location_for_bin(p[0]);
+        if (i < 0) continue;
+        int16_t centi = static_cast<int16_t>(p[1] | (p[2] << 8));
+        current |= applySample(static_cast<size_t>(i), centi / 100.0f, timeHHMM);
+    }
+    if (current) {
+        updateUI();
+    }
+}
+
+// Registry replaced (retained topic): per-location state is rebuilt from the
+// sample log (keyed by binId, so locations that stayed keep their history)
+void reloadLocations() {
+    size_t count = entity_registry_location_count();
+    for (size_t i = 0; i < REGISTRY_MAX_LOCATIONS; i++) {
+        tempSamples[i] = {};
+        loggedOnce[i] = false;
+        histories[i].reset();
+        if (historyReady && i < count) historyReady = histories[i].begin();
+    }
+    if (currentLocation >= count) currentLocation = 0;
+    historyReplayPending = historyReady && sampleLogGetStats().mounted;
+    Serial.printf("Temperature service: registry reloaded, %u locations\n", (unsigned)count);
+
+    fillSparkline();
+    updateUI();
+    temperature_service_requestStatus();
+}
+
+// Event handler thunk - runs on the app task (see ui_dispatch_to_app)
+void cycleLocationOnApp(void* ctx) {
+    (void)ctx;
+    temperature_service_cycleLocation();
+}
+
+// Topic router handler (app task)
+void onWeatherMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %.*s\n", topic, (int)payload.len, payload.data);
+    if (payload.equals(PAYLOAD_STATUS)) return;   // Our own status request echoed back
+    temperature_service_handleMQTT(payload.data, payload.len);
+}
+
+void onWeatherBinMessage(const char* topic, PayloadView payload) {
+    Serial.printf("MQTT [%s]: %u bytes\n", topic, (unsigned)payload.len);
+    handleBinary(reinterpret_cast<const uint8_t*>(payload.data), payload.len);
 }
 
 }  // namespace
@@ -148,105 +390,147 @@ void updateUI() {
 // ============================================================================
 
 void temperature_service_init(lv_obj_t* locLabel, lv_obj_t* tempLabel,
-                              lv_obj_t* timeLabel, PubSubClient* mqttClient) {
-    // Store label and MQTT pointers
+                              lv_obj_t* timeLabel) {
+    // Store label pointers
     labelLoc = locLabel;
     labelTemp = tempLabel;
     labelTime = timeLabel;
-    mqtt = mqttClient;
 
     // Initialize all samples as invalid
-    for (size_t i = 0; i < TEMP_LOC_COUNT; i++) {
+    for (size_t i = 0; i < REGISTRY_MAX_LOCATIONS; i++) {
         tempSamples[i].temperatureC = 0.0f;
         tempSamples[i].timeHHMM[0] = '\0';
         tempSamples[i].valid = false;
     }
 
-    // Load saved location from NVS
-    loadLocationFromNVS();
+    // Load saved location
+    loadSavedLocation();
+    registryGeneration = entity_registry_generation();
+
+    // History rings and the trend view (below the location button)
+    historyReady = true;
+    for (size_t i = 0; i < entity_registry_location_count(); i++) {
+        historyReady &= histories[i].begin();
+    }
+    historyReplayPending = historyReady && sampleLogGetStats().mounted;
+    lv_obj_t* container = tempLabel ? lv_obj_get_parent(tempLabel) : nullptr;
+    if (container && historyReady) {
+        lvgl_port_lock(0);
+        labelTrend = lv_label_create(container);
+        lv_obj_set_align(labelTrend, LV_ALIGN_CENTER);
+        lv_obj_set_pos(labelTrend, -5, 43);
+        lv_obj_set_style_text_font(labelTrend, &lv_font_montserrat_12, LV_PART_MAIN);
+        lv_obj_set_style_text_color(labelTrend, lv_color_hex(0xC8C8C8), LV_PART_MAIN);
+        lv_label_set_text(labelTrend, "");
+
+        sparkChart = lv_chart_create(container);
+        lv_obj_set_size(sparkChart, 100, 18);
+        lv_obj_set_align(sparkChart, LV_ALIGN_BOTTOM_MID);
+        lv_obj_set_pos(sparkChart, -5, -1);
+        lv_obj_clear_flag(sparkChart, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+        lv_chart_set_type(sparkChart, LV_CHART_TYPE_LINE);
+        lv_chart_set_update_mode(sparkChart, LV_CHART_UPDATE_MODE_SHIFT);
+        lv_chart_set_point_count(sparkChart, TEMP_HISTORY_SLOTS);
+        lv_chart_set_div_line_count(sparkChart, 0, 0);
+        lv_obj_set_style_bg_opa(sparkChart, LV_OPA_TRANSP, LV_PART_MAIN);
+        lv_obj_set_style_border_width(sparkChart, 0, LV_PART_MAIN);
+        lv_obj_set_style_pad_all(sparkChart, 0, LV_PART_MAIN);
+        lv_obj_set_style_size(sparkChart, 0, LV_PART_INDICATOR);   // No point markers
+        lv_obj_set_style_line_width(sparkChart, 1, LV_PART_ITEMS);
+        sparkSeries = lv_chart_add_series(sparkChart, lv_palette_main(LV_PALETTE_ORANGE), LV_CHART_AXIS_PRIMARY_Y);
+        lv_chart_set_all_value(sparkChart, sparkSeries, LV_CHART_POINT_NONE);
+        lvgl_port_unlock();
+    } else if (!historyReady) {
+        Serial.println("Temperature service: history allocation failed");
+    }
+
+    // Weather JSON from Node-RED
+    netSubscribe(TOPIC_WEATHER, onWeatherMessage, TEMPERATURE_MAX_PAYLOAD_WEATHER);
+    netSubscribe(TOPIC_WEATHER_BIN, onWeatherBinMessage, MAX_PAYLOAD_WEATHER_BIN);
 
     // Display initial state
     updateUI();
 
-    // Request current temperature status from Node-RED
-    temperature_service_requestStatus();
+    // Current values arrive with the status snapshot of the first MQTT session
 
     Serial.println("Temperature service initialized");
 }
 
 void temperature_service_requestStatus() {
-    if (mqtt && mqtt->connected()) {
-        mqtt->publish(TOPIC_WEATHER, PAYLOAD_STATUS);
+    // One pending request at most; sent on the next session if disconnected
+    if (netPublish(TOPIC_WEATHER, PAYLOAD_STATUS, OutboxPriority::LOW, "weather_status")) {
         Serial.println("Temperature service: requested status from Node-RED");
     }
 }
 
-void temperature_service_handleMQTT(const char* payload) {
-    for (size_t i = 0; i < TEMP_LOC_COUNT; i++) {
-        // Build the key to search for (e.g., "\"OutsideTemp\":")
-        char key[32];
-        snprintf(key, sizeof(key), "\"%s\":", locationMeta[i].mqttKey);
-
-        const char* pos = strstr(payload, key);
-        if (pos) {
-            pos += strlen(key);
-
-            // Skip whitespace
-            while (*pos == ' ' || *pos == '\t') pos++;
-
-            // Parse temperature value
-            float temp = strtof(pos, nullptr);
-
-            // Update sample
-            tempSamples[i].temperatureC = temp;
-            tempSamples[i].valid = true;
-
-            // Get current time (hh:mm only, first 5 characters)
-            String timeStr = time_service_getFormattedTime();
-            if (timeStr.length() >= 5) {
-                strncpy(tempSamples[i].timeHHMM, timeStr.c_str(), 5);
-                tempSamples[i].timeHHMM[5] = '\0';
-            } else {
-                strncpy(tempSamples[i].timeHHMM, timeStr.c_str(), sizeof(tempSamples[i].timeHHMM) - 1);
-                tempSamples[i].timeHHMM[sizeof(tempSamples[i].timeHHMM) - 1] = '\0';
-            }
-
-            Serial.printf("Temperature update: %s = %.1f C at %s\n",
-                          locationMeta[i].label, temp, tempSamples[i].timeHHMM);
-
-            // Update UI if this is the currently selected location
-            if (i == currentLocation) {
-                updateUI();
-            }
+void temperature_service_handleMQTT(const char* payload, size_t length) {
+    char timeHHMM[6] = "";
+    bool current = false;
+
+    // One pass over the members, one perfect-hash lookup per key; keys must match exactly
+    JsonScanner scanner(payload, length);
+    JsonMember member;
+    while (scanner.next(&member)) {
+        EntityRef ref = entity_registry_find(EntityDomain::LOCATION_KEY, member.key, member.keyLen);
+        if (ref.index < 0) continue;
+
+        float temp;
+        if (!member.toFloat(&temp)) continue;
+        if (!timeHHMM[0]) currentTimeHHMM(timeHHMM, sizeof(timeHHMM));
+        current |= applySample(static_cast<size_t>(ref.index), temp, timeHHMM);
+    }
+    if (scanner.failed()) {
+        Serial.println("Temperature service: malformed weather JSON");
+    }
 
-            return;  // Found and processed, exit
-        }
+    // Update UI if the currently selected location changed
+    if (current) {
+        updateUI();
     }
 }
 
+void temperature_service_setStale(bool stale) {
+    if (stale == valuesStale) return;
+    valuesStale = stale;
+    updateUI();
+}
+
 void temperature_service_cycleLocation() {
     // Advance to next location with wrap-around
-    currentLocation = (currentLocation + 1) % TEMP_LOC_COUNT;
+    currentLocation = (currentLocation + 1) % entity_registry_location_count();
 
-    Serial.printf("Temperature location cycled to: %s\n", locationMeta[currentLocation].label);
+    Serial.printf("Temperature location cycled to: %s\n", entity_registry_location(currentLocation).name);
 
-    // Update UI immediately
+    // Update UI immediately (the trend view comes from the history, no request needed)
+    fillSparkline();
     updateUI();
 
-    // Start/reset NVS debounce timer
-    lastLocationChangeTime = millis();
-    nvsSavePending = true;
-    pendingLocation = currentLocation;
+    // Written on the settings store's next flush (repeated cycling is one write)
+    settingsSetInt(SETTING_TEMP_LOC, static_cast<int32_t>(currentLocation));
 }
 
 void temperature_service_loop() {
-    // Handle NVS debounce save
-    if (nvsSavePending && (millis() - lastLocationChangeTime >= NVS_DEBOUNCE_MS)) {
-        if (pendingLocation != lastSavedLocation) {
-            saveLocationToNVS(pendingLocation);
-            lastSavedLocation = pendingLocation;
+    // New registry: indices may have moved
+    if (registryGeneration != entity_registry_generation()) {
+        registryGeneration = entity_registry_generation();
+        reloadLocations();
+    }
+
+    // History: replay once the clock is set, then close 5-minute slots as time passes
+    if (historyReady && sampleLogClockValid()) {
+        replayHistoryIfDue();
+        if (millis() - lastHistoryAdvance >= HISTORY_ADVANCE_INTERVAL_MS) {
+            lastHistoryAdvance = millis();
+            uint32_t now = (uint32_t)time(nullptr);
+            for (size_t i = 0; i < entity_registry_location_count(); i++) {
+                uint32_t before = histories[i].closedSlots();
+                histories[i].advance(now);
+                if (histories[i].closedSlots() != before) {
+                    syncSparkline(i, before);
+                    if (i == currentLocation) updateTrendLabel();
+                }
+            }
         }
-        nvsSavePending = false;
     }
 }
 
@@ -258,7 +542,7 @@ void buttonTempLocation_event_handler(lv_event_t* e) {
         unsigned long now = millis();
         if (now - lastClickTime >= CLICK_DEBOUNCE_MS) {
             lastClickTime = now;
-            temperature_service_cycleLocation();
+            ui_dispatch_to_app(cycleLocationOnApp, nullptr);
         }
     }
 }
@@ -2,42 +2,59 @@
 
 #include <Arduino.h>
 #include <lvgl.h>
-#include <PubSubClient.h>
+
+#include "../registry/entity_registry.h"
 
 // ============================================================================
 // Temperature Service Module
 // ============================================================================
 // Provides cycling temperature display for multiple locations.
-// Temperature data is received via MQTT, current location is persisted in NVS.
+// Temperature data is received via MQTT, current location is persisted in the settings store.
+// The locations (names, JSON keys, binIds) come from the entity registry; a
+// new registry is picked up by temperature_service_loop().
 //
 // Features:
 // - Display temperatures from multiple locations in a single UI area
 // - Cycle through locations with button press
-// - NVS persistence of selected location (with 30-second debounce)
+// - Selected location persisted through the settings store (deferred flush)
 // - Color coding based on temperature thresholds
+// - 24 h history per location (TempHistory), replayed from the sample log;
+//   trend arrow, min / max and a sparkline under the location button,
+//   switched instantly on cycle
 // ============================================================================
 
+// Largest weather JSON: every registry location as "<key>":<temperature>,
+// with room for the value and some whitespace
+constexpr size_t TEMPERATURE_WEATHER_ENTRY_MAX = REGISTRY_MAX_STRING + 16;
+constexpr size_t TEMPERATURE_MAX_PAYLOAD_WEATHER = 16 + REGISTRY_MAX_LOCATIONS * TEMPERATURE_WEATHER_ENTRY_MAX;
+
 // Initialize temperature service
 // Pass pointers to the LVGL labels created in SquareLine Studio:
 // - locLabel: displays location name (e.g., "Outside")
 // - tempLabel: displays temperature value (e.g., "-15.8 C")
 // - timeLabel: displays sample time (e.g., "14:57")
-// - mqtt: PubSubClient pointer for publishing status requests
+// Status requests go through the MQTT outbox (netPublish)
 void temperature_service_init(lv_obj_t* locLabel, lv_obj_t* tempLabel,
-                              lv_obj_t* timeLabel, PubSubClient* mqtt);
+                              lv_obj_t* timeLabel);
 
 // Handle incoming MQTT weather message
-// Parses JSON payload for known location keys (e.g., "OutsideTemp": -15.8)
-void temperature_service_handleMQTT(const char* payload);
+// Scans the JSON payload once and updates every known location key present
+// (e.g., "OutsideTemp": -15.8). Keys match exactly; unknown keys are ignored.
+// payload is length-delimited (not NUL-terminated)
+// The binary form on "weather/bin" is handled internally.
+void temperature_service_handleMQTT(const char* payload, size_t length);
+
+// Show the last values as stale (gray) while the panel is offline
+void temperature_service_setStale(bool stale);
 
 // Cycle to the next location (call from button handler)
 void temperature_service_cycleLocation();
 
 // Request current temperature status from Node-RED via MQTT
-// Called at init and after MQTT reconnection
+// Legacy path: called by the status snapshot module when no snapshot arrives
 void temperature_service_requestStatus();
 
-// Periodic processing - handles NVS debounce save (call in loop())
+// Periodic processing - registry reload, history replay and 5-minute slots (call in loop())
 void temperature_service_loop();
 
 #ifdef __cplusplus
@@ -1,10 +1,13 @@
 #include "time_service.h"
 
 #include <WiFi.h>
+#include <esp_sntp.h>
 #include <time.h>
 #include <lvgl.h>
 
+#include "lv_port.h"
 #include "ui.h"
+#include "../ui/ui_dispatch.h"
 
 // ============================================================================
 // Constants
@@ -24,6 +27,7 @@ static const char* NTP_SERVER = "pool.ntp.org";
 static const uint32_t LABEL_UPDATE_MS = 1000;        // 1 second
 static const uint32_t NTP_SYNC_INTERVAL_MS = 21600000; // 6 hours in ms
 static const uint32_t NTP_RETRY_INTERVAL_MS = 30000;  // 30 seconds retry on failure
+static const uint32_t NTP_SYNC_TIMEOUT_MS = 15000;    // No answer: failed, retry later
 static const uint32_t COLOR_CHANGE_INTERVAL_MS = 600000; // 1200000: 20 min in ms
 
 // Time label colors (cycle randomly)
@@ -43,6 +47,8 @@ static const size_t TIME_LABEL_COLORS_COUNT = sizeof(TIME_LABEL_COLORS) / sizeof
 
 static bool timeInitialized = false;
 static unsigned long lastNtpSync = 0;
+static bool syncPending = false;           // startSync() waiting for the answer (app task)
+static unsigned long syncStartedAt = 0;
 static lv_timer_t* labelTimer = nullptr;
 static lv_timer_t* syncTimer = nullptr;
 static lv_timer_t* retryTimer = nullptr;
@@ -68,56 +74,80 @@ static void setTimezone(const char* timezone) {
 // Forward declaration for retry callback
 static void retryTimerCallback(lv_timer_t* timer);
 
-// Initialize time from NTP (from reference ntp.ino)
-static void initTime(const char* timezone) {
-    struct tm timeinfo;
-
-    Serial.println("Time: Syncing with NTP server...");
-
-    // First connect to NTP server with 0 TZ offset
-    configTime(0, 0, NTP_SERVER);
-
-    // Wait for time to be set (with timeout)
-    int retries = 0;
-    while (!getLocalTime(&timeinfo) && retries < 10) {
-        Serial.println("Time: Waiting for NTP response...");
-        delay(500);
-        retries++;
-    }
-
-    if (retries >= 10) {
-        Serial.println("Time: Failed to obtain time from NTP");
-
-        // Schedule a retry if not already scheduled
-        if (!retryTimer && WiFi.status() == WL_CONNECTED) {
-            Serial.println("Time: Scheduling retry in 30 seconds...");
-            retryTimer = lv_timer_create(retryTimerCallback, NTP_RETRY_INTERVAL_MS, nullptr);
-        }
-        return;
+// Retry timer management - runs on the LVGL thread via ui_dispatch_call()
+static void scheduleRetryTimer(void* ctx) {
+    (void)ctx;
+    if (!retryTimer) {
+        Serial.println("Time: Scheduling retry in 30 seconds...");
+        retryTimer = lv_timer_create(retryTimerCallback, NTP_RETRY_INTERVAL_MS, nullptr);
     }
+}
 
-    Serial.println("Time: Got time from NTP");
-
-    // Cancel retry timer if it exists (sync succeeded)
+static void cancelRetryTimer(void* ctx) {
+    (void)ctx;
     if (retryTimer) {
         lv_timer_del(retryTimer);
         retryTimer = nullptr;
         Serial.println("Time: Cancelled retry timer (sync successful)");
     }
+}
 
-    // Now set the real timezone
+// Start an NTP sync (from reference ntp.ino). Never waits: time_service_loop()
+// polls for the answer, so neither rendering nor MQTT keepalive stalls on it
+static void startSync(const char* timezone) {
+    Serial.println("Time: Syncing with NTP server...");
+
+    // A sync completed earlier (SNTP also re-syncs on its own) must not be taken
+    // for the answer to this request
+    sntp_set_sync_status(SNTP_SYNC_STATUS_RESET);
+
+    // Connect to the NTP server with 0 TZ offset, then set the real timezone
+    configTime(0, 0, NTP_SERVER);
     setTimezone(timezone);
 
+    syncPending = true;
+    syncStartedAt = millis();
+}
+
+// NTP answer arrived
+static void onSynced() {
+    syncPending = false;
+    Serial.println("Time: Got time from NTP");
+
+    // Cancel retry timer if it exists (sync succeeded)
+    ui_dispatch_call(cancelRetryTimer, nullptr);
+
     timeInitialized = true;
     lastNtpSync = millis();
 
     // Print current time
-    if (getLocalTime(&timeinfo)) {
+    struct tm timeinfo;
+    if (getLocalTime(&timeinfo, 0)) {
         Serial.printf("Time: Current time: %02d:%02d:%02d\n",
                       timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
     }
 }
 
+// No answer within NTP_SYNC_TIMEOUT_MS
+static void onSyncTimeout() {
+    syncPending = false;
+    Serial.println("Time: Failed to obtain time from NTP");
+
+    // Schedule a retry if not already scheduled (timer is created on the LVGL thread)
+    if (WiFi.status() == WL_CONNECTED) {
+        ui_dispatch_call(scheduleRetryTimer, nullptr);
+    }
+}
+
+// NTP sync requested by an LVGL timer - runs on the app task, which owns the
+// sync state
+static void syncOnApp(void* ctx) {
+    (void)ctx;
+    if (WiFi.status() == WL_CONNECTED) {
+        startSync(TIMEZONE);
+    }
+}
+
 // LVGL timer callback - retry NTP sync after failure
 static void retryTimerCallback(lv_timer_t* timer) {
     if (timeInitialized) {
@@ -131,7 +161,7 @@ static void retryTimerCallback(lv_timer_t* timer) {
 
     if (WiFi.status() == WL_CONNECTED) {
         Serial.println("Time: Retrying NTP sync...");
-        initTime(TIMEZONE);
+        ui_dispatch_to_app(syncOnApp, nullptr);
     }
 }
 
@@ -182,7 +212,7 @@ static void labelTimerCallback(lv_timer_t* timer) {
 static void syncTimerCallback(lv_timer_t* timer) {
     if (WiFi.status() == WL_CONNECTED) {
         Serial.println("Time: Periodic NTP re-sync");
-        initTime(TIMEZONE);
+        ui_dispatch_to_app(syncOnApp, nullptr);
     }
 }
 
@@ -204,13 +234,16 @@ static void colorTimerCallback(lv_timer_t* timer) {
 void time_service_init() {
     Serial.println("Time: Initializing time service...");
 
-    // Initial NTP sync
+    // Initial NTP sync (answer picked up by time_service_loop())
     if (WiFi.status() == WL_CONNECTED) {
-        initTime(TIMEZONE);
+        startSync(TIMEZONE);
     } else {
         Serial.println("Time: WiFi not connected, skipping initial sync");
     }
 
+    // Timers are created under the LVGL lock (no-op in single-threaded mode)
+    lvgl_port_lock(0);
+
     // Create 1-second LVGL timer for label updates
     labelTimer = lv_timer_create(labelTimerCallback, LABEL_UPDATE_MS, nullptr);
     if (labelTimer) {
@@ -229,18 +262,34 @@ void time_service_init() {
         Serial.printf("Time: Created %d-second color change timer\n", COLOR_CHANGE_INTERVAL_MS / 1000);
     }
 
+    lvgl_port_unlock();
+
     Serial.println("Time: Time service initialized");
 }
 
 void time_service_sync() {
     if (WiFi.status() == WL_CONNECTED) {
         Serial.println("Time: Manual NTP sync requested");
-        initTime(TIMEZONE);
+        startSync(TIMEZONE);
     } else {
         Serial.println("Time: Cannot sync - WiFi not connected");
     }
 }
 
+void time_service_loop() {
+    if (!syncPending) return;
+
+    // The first sync can also be seen from the clock itself (getLocalTime() with
+    // no wait checks that the year is set)
+    struct tm timeinfo;
+    if (sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED ||
+        (!timeInitialized && getLocalTime(&timeinfo, 0))) {
+        onSynced();
+    } else if (millis() - syncStartedAt >= NTP_SYNC_TIMEOUT_MS) {
+        onSyncTimeout();
+    }
+}
+
 String time_service_getFormattedDate() {
     struct tm timeinfo;
 
@@ -16,7 +16,7 @@
 // ============================================================================
 
 // Initialize time service (call after WiFi is connected)
-// - Syncs with NTP server
+// - Starts an NTP sync (never blocks; the answer is picked up by time_service_loop())
 // - Creates 1-second LVGL timer for label updates
 // - Creates 6-hour timer for periodic NTP re-sync
 void time_service_init();
@@ -25,6 +25,10 @@ void time_service_init();
 // Call this when WiFi reconnects after being disconnected
 void time_service_sync();
 
+// Call from loop(): completes a pending sync, or schedules a retry once
+// NTP_SYNC_TIMEOUT_MS has passed without an answer
+void time_service_loop();
+
 // Get formatted date string
 // Returns: "18 Jan 2026" or error string if not initialized
 String time_service_getFormattedDate();
@@ -0,0 +1,335 @@
+#include "ui_dispatch.h"
+
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "lv_port.h"
+#include "../perf/latency_probe.h"
+
+namespace {
+
+// ============================================================================
+// Command Types
+// ============================================================================
+
+enum class UiProp : uint8_t {
+    LABEL_TEXT,
+    TEXT_COLOR,
+    BG_COLOR,
+    HIDDEN
+};
+
+// Latest value of one widget property. Written only by the app task, read by
+// the LVGL thread under a sequence counter (odd = write in progress).
+struct UiSlot {
+    lv_obj_t* obj;
+    UiProp prop;
+    std::atomic<uint32_t> seq;
+    std::atomic<bool> pending;   // Slot index is queued in the ring
+    lv_color_t color;
+    bool hidden;
+    char text[UI_DISPATCH_TEXT_MAX];
+};
+
+// Ring entry: either a dirty slot or a function call
+struct UiCmd {
+    ui_dispatch_fn fn;   // nullptr => property slot update
+    void* ctx;
+    uint8_t slot;
+};
+
+struct AppCall {
+    ui_dispatch_fn fn;
+    void* ctx;
+};
+
+// Value copied out of a slot by the consumer
+struct SlotValue {
+    lv_color_t color;
+    bool hidden;
+    char text[UI_DISPATCH_TEXT_MAX];
+};
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+// One slot per (widget, property) pair ever updated - SquareLine widgets are static
+constexpr uint32_t SLOT_COUNT = 32;
+
+// Ring capacity (power of two so indices can wrap freely). Each slot is queued
+// at most once, leaving the remainder for function calls.
+constexpr uint32_t RING_SIZE = 64;
+constexpr uint32_t RING_MASK = RING_SIZE - 1;
+static_assert((RING_SIZE & RING_MASK) == 0, "RING_SIZE must be a power of two");
+static_assert(SLOT_COUNT < RING_SIZE, "ring must hold every slot plus calls");
+
+constexpr size_t APP_QUEUE_LENGTH = 16;
+
+// Slots: keys assigned by the app task only; slotCount published with release
+UiSlot slots[SLOT_COUNT];
+std::atomic<uint32_t> slotCount{0};
+
+// SPSC ring: head written only by the app task, tail only by the LVGL thread
+UiCmd ring[RING_SIZE];
+std::atomic<uint32_t> ringHead{0};
+std::atomic<uint32_t> ringTail{0};
+
+// Counters
+std::atomic<uint32_t> droppedCount{0};
+std::atomic<uint32_t> coalescedCount{0};
+std::atomic<uint32_t> appliedCount{0};
+std::atomic<uint32_t> frameCount{0};
+
+QueueHandle_t appQueue = nullptr;
+lv_timer_t* drainTimer = nullptr;
+
+// ============================================================================
+// Internal Functions
+// ============================================================================
+
+void applyProp(lv_obj_t* obj, UiProp prop, const SlotValue& v) {
+    latency_probe_on_widget_update(obj);
+    switch (prop) {
+        case UiProp::LABEL_TEXT:
+            // Skip the relayout when the text did not actually change
+            if (strcmp(lv_label_get_text(obj), v.text) != 0) {
+                lv_label_set_text(obj, v.text);
+            }
+            break;
+        case UiProp::TEXT_COLOR:
+            lv_obj_set_style_text_color(obj, v.color, LV_PART_MAIN);
+            break;
+        case UiProp::BG_COLOR:
+            lv_obj_set_style_bg_color(obj, v.color, LV_PART_MAIN);
+            break;
+        case UiProp::HIDDEN:
+            if (v.hidden) {
+                lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+            } else {
+                lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
+            }
+            break;
+    }
+}
+
+bool applyDirectly() {
+#if LVGL_PORT_USE_TASK
+    // Calls made from the LVGL thread itself must not produce into the ring
+    return lvgl_port_in_lvgl_task();
+#else
+    return false;
+#endif
+}
+
+// Producer side: publish one ring entry
+bool pushCmd(const UiCmd& cmd) {
+    uint32_t head = ringHead.load(std::memory_order_relaxed);
+    uint32_t tail = ringTail.load(std::memory_order_acquire);
+    if (head - tail >= RING_SIZE) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ring[head & RING_MASK] = cmd;
+    ringHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Producer side: find or allocate the slot for (obj, prop)
+int findSlot(lv_obj_t* obj, UiProp prop) {
+    uint32_t count = slotCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++) {
+        if (slots[i].obj == obj && slots[i].prop == prop) return i;
+    }
+    if (count >= SLOT_COUNT) return -1;
+
+    slots[count].obj = obj;
+    slots[count].prop = prop;
+    slots[count].seq.store(0, std::memory_order_relaxed);
+    slots[count].pending.store(false, std::memory_order_relaxed);
+    slotCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+// Producer side: overwrite the latest value and queue the slot if not already queued.
+// Updates arriving before the next frame overwrite the slot (last value wins).
+bool pushProp(lv_obj_t* obj, UiProp prop, const SlotValue& v) {
+    if (applyDirectly()) {
+        applyProp(obj, prop, v);
+        appliedCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    int index = findSlot(obj, prop);
+    if (index < 0) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    UiSlot& slot = slots[index];
+
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.color = v.color;
+    slot.hidden = v.hidden;
+    memcpy(slot.text, v.text, sizeof(slot.text));
+    slot.seq.store(seq + 2, std::memory_order_release);
+
+    if (slot.pending.exchange(true, std::memory_order_acq_rel)) {
+        // Already queued for this frame: the new value replaces the old one
+        coalescedCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    UiCmd cmd = { nullptr, nullptr, static_cast<uint8_t>(index) };
+    if (!pushCmd(cmd)) {
+        slot.pending.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+// Consumer side: copy a consistent snapshot of a slot value
+void readSlot(UiSlot& slot, SlotValue& out) {
+    uint32_t before, after;
+    do {
+        before = slot.seq.load(std::memory_order_acquire);
+        out.color = slot.color;
+        out.hidden = slot.hidden;
+        memcpy(out.text, slot.text, sizeof(out.text));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+// Consumer side: apply everything queued so far, once per frame (LVGL thread)
+void drainTimerCallback(lv_timer_t* timer) {
+    (void)timer;
+    uint32_t tail = ringTail.load(std::memory_order_relaxed);
+    uint32_t head = ringHead.load(std::memory_order_acquire);
+    if (tail == head) return;
+
+    frameCount.fetch_add(1, std::memory_order_relaxed);
+    while (tail != head) {
+        UiCmd cmd = ring[tail & RING_MASK];
+        tail++;
+        ringTail.store(tail, std::memory_order_release);
+
+        if (cmd.fn) {
+            cmd.fn(cmd.ctx);
+            continue;
+        }
+
+        // Clear pending before reading so a concurrent update re-queues the slot
+        UiSlot& slot = slots[cmd.slot];
+        slot.pending.store(false, std::memory_order_release);
+        SlotValue v;
+        readSlot(slot, v);
+        applyProp(slot.obj, slot.prop, v);
+        appliedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+SlotValue makeValue() {
+    SlotValue v;
+    v.color = lv_color_black();
+    v.hidden = false;
+    v.text[0] = '\0';
+    return v;
+}
+
+}  // namespace
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void ui_dispatch_init() {
+    if (!appQueue) {
+        appQueue = xQueueCreate(APP_QUEUE_LENGTH, sizeof(AppCall));
+    }
+    if (!drainTimer) {
+        // Drain once per display refresh period so updates land in the next frame
+        drainTimer = lv_timer_create(drainTimerCallback, LV_DISP_DEF_REFR_PERIOD, nullptr);
+    }
+    Serial.printf("UI dispatch initialized (%s)\n",
+                  LVGL_PORT_USE_TASK ? "LVGL task mode" : "single-threaded mode");
+}
+
+bool ui_dispatch_label_text(lv_obj_t* obj, const char* text) {
+    if (!obj || !text) return false;
+    SlotValue v = makeValue();
+    strncpy(v.text, text, sizeof(v.text) - 1);
+    v.text[sizeof(v.text) - 1] = '\0';
+    return pushProp(obj, UiProp::LABEL_TEXT, v);
+}
+
+bool ui_dispatch_text_color(lv_obj_t* obj, lv_color_t color) {
+    if (!obj) return false;
+    SlotValue v = makeValue();
+    v.color = color;
+    return pushProp(obj, UiProp::TEXT_COLOR, v);
+}
+
+bool ui_dispatch_bg_color(lv_obj_t* obj, lv_color_t color) {
+    if (!obj) return false;
+    SlotValue v = makeValue();
+    v.color = color;
+    return pushProp(obj, UiProp::BG_COLOR, v);
+}
+
+bool ui_dispatch_hidden(lv_obj_t* obj, bool hidden) {
+    if (!obj) return false;
+    SlotValue v = makeValue();
+    v.hidden = hidden;
+    return pushProp(obj, UiProp::HIDDEN, v);
+}
+
+bool ui_dispatch_call(ui_dispatch_fn fn, void* ctx) {
+    if (!fn) return false;
+    if (applyDirectly()) {
+        fn(ctx);
+        return true;
+    }
+    UiCmd cmd = { fn, ctx, 0 };
+    return pushCmd(cmd);
+}
+
+bool ui_dispatch_to_app(ui_dispatch_fn fn, void* ctx) {
+    if (!fn) return false;
+#if LVGL_PORT_USE_TASK
+    AppCall call = { fn, ctx };
+    if (!appQueue || xQueueSend(appQueue, &call, 0) != pdTRUE) {
+        Serial.println("UI dispatch: app queue full, event dropped");
+        return false;
+    }
+    return true;
+#else
+    // Single-threaded: event handlers already run on the app task
+    fn(ctx);
+    return true;
+#endif
+}
+
+void ui_dispatch_app_loop() {
+    if (!appQueue) return;
+    AppCall call;
+    while (xQueueReceive(appQueue, &call, 0) == pdTRUE) {
+        call.fn(call.ctx);
+    }
+}
+
+uint32_t ui_dispatch_get_dropped() {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+void ui_dispatch_get_stats(UiDispatchStats* stats) {
+    if (!stats) return;
+    stats->applied = appliedCount.load(std::memory_order_relaxed);
+    stats->coalesced = coalescedCount.load(std::memory_order_relaxed);
+    stats->dropped = droppedCount.load(std::memory_order_relaxed);
+    stats->frames = frameCount.load(std::memory_order_relaxed);
+    stats->slots = slotCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+// ============================================================================
+// UI Dispatch Module
+// ============================================================================
+// Moves work between the app task (Arduino loop(): MQTT, HTTP, services) and
+// the LVGL thread. In single-threaded mode both are the same task; in
+// LVGL_PORT_USE_TASK mode (lv_port.h) LVGL runs on its own pinned task.
+//
+// App task -> LVGL thread: widget updates are coalesced per (widget, property)
+// slot - the last value written before the next frame wins - and the dirty slot
+// is queued once on a lock-free single-producer/single-consumer ring drained
+// once per LVGL refresh period. N updates between frames cost one relayout.
+// The app task is the only producer; calls made from the LVGL thread itself
+// (task mode) are applied immediately.
+//
+// LVGL thread -> app task: event handlers forward service calls (toggle,
+// cycle, image request) with ui_dispatch_to_app() so network clients are only
+// ever used from the app task.
+// ============================================================================
+
+// Maximum label text length (including terminator) carried by one update
+constexpr size_t UI_DISPATCH_TEXT_MAX = 64;
+
+typedef void (*ui_dispatch_fn)(void* ctx);
+
+// Queue statistics (cumulative since boot)
+struct UiDispatchStats {
+    uint32_t applied;     // Property updates applied to widgets
+    uint32_t coalesced;   // Updates overwritten by a newer value before the frame
+    uint32_t dropped;     // Updates lost (ring or slot table full)
+    uint32_t frames;      // Drain passes that applied at least one command
+    uint32_t slots;       // (widget, property) slots in use
+};
+
+// Initialize queues and the drain timer (call once after ui_init(), under lvgl_port_lock)
+void ui_dispatch_init();
+
+// Widget updates applied on the LVGL thread
+bool ui_dispatch_label_text(lv_obj_t* obj, const char* text);
+bool ui_dispatch_text_color(lv_obj_t* obj, lv_color_t color);
+bool ui_dispatch_bg_color(lv_obj_t* obj, lv_color_t color);
+bool ui_dispatch_hidden(lv_obj_t* obj, bool hidden);
+
+// Run an arbitrary function on the LVGL thread (e.g. create/delete an lv_timer)
+bool ui_dispatch_call(ui_dispatch_fn fn, void* ctx);
+
+// Run a function on the app task (called from LVGL event handlers)
+// Single-threaded mode: runs immediately. Task mode: runs in ui_dispatch_app_loop().
+bool ui_dispatch_to_app(ui_dispatch_fn fn, void* ctx);
+
+// Drain calls forwarded with ui_dispatch_to_app() (call from loop())
+void ui_dispatch_app_loop();
+
+// Number of updates dropped because the ring or slot table was full
+uint32_t ui_dispatch_get_dropped();
+
+// Snapshot of applied / coalesced / dropped counters
+void ui_dispatch_get_stats(UiDispatchStats* stats);
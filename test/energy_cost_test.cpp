@@ -0,0 +1,408 @@
+// EnergyCost: trapezoid sums, splits at period / midnight / peak-event edges,
+// gaps, daily charges, then the recorded traces in test/data against a
+// reference integration
+//
+// Local time is Montreal (the panel's TZ); the dates used are all in EST.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+#include "power/energy_cost.h"
+#include "test_check.h"
+
+namespace {
+
+const char* const TIMEZONE = "EST5EDT,M3.2.0,M11.1.0";
+constexpr double EST_OFFSET_S = 5 * 3600;
+constexpr double KWH = 3600.0 * 1000.0;     // Watt-seconds
+constexpr double TOLERANCE_KWH = 1e-9;
+
+// Thu 2026-01-15 and Sat 2026-01-31, local midnight
+constexpr double THU = 1768453200;
+constexpr double SAT = 1769835600;
+constexpr double HOUR = 3600;
+
+constexpr uint8_t WEEKDAYS = 0x3E;          // Monday..Friday
+constexpr uint8_t ALL_DAYS = 0x7F;
+
+// Buckets of the test tariff
+constexpr size_t MORNING = 1;
+constexpr size_t EVENING = 2;
+constexpr size_t NIGHT = 3;
+
+Tariff testTariff() {
+    Tariff t = {};
+    t.basePrice = 0.0738f;
+    t.peakPrice = 0.4511f;
+    t.dailyCharge = 0.4603f;
+    t.periods[0] = { "Morning", 6 * 60, 9 * 60, WEEKDAYS, 0.12f };
+    t.periods[1] = { "Evening", 16 * 60, 20 * 60, WEEKDAYS, 0.15f };
+    t.periods[2] = { "Night", 22 * 60, 6 * 60, ALL_DAYS, 0.05f };   // Wraps midnight
+    t.periodCount = 3;
+    return t;
+}
+
+double bucketKwh(const EnergyTotals& totals, size_t bucket) {
+    return totals.buckets[bucket].kwh;
+}
+
+// ============================================================================
+// Engine
+// ============================================================================
+
+void testTrapezoid() {
+    EnergyCost e;
+    e.setTariff(testTariff());
+    double t0 = THU + 12 * HOUR;    // Base price at noon
+
+    e.sample(t0, 1000);
+    e.sample(t0 + 60, 2000);
+    e.sample(t0 + 120, 2000);
+    e.sample(t0 + 120.5, 3000);     // Fractional seconds
+    double kwh = (1500.0 * 60 + 2000.0 * 60 + 2500.0 * 0.5) / KWH;
+
+    const EnergyTotals& today = e.today();
+    CHECK_NEAR(today.kwh, kwh, TOLERANCE_KWH);
+    CHECK_NEAR(bucketKwh(today, ENERGY_COST_BUCKET_BASE), kwh, TOLERANCE_KWH);
+    CHECK_NEAR(today.buckets[ENERGY_COST_BUCKET_BASE].cost, kwh * 0.0738f, 1e-9);
+    CHECK_NEAR(today.cost, kwh * 0.0738f + 0.4603f, 1e-6);
+    CHECK_EQ(e.stats().samples, 4);
+    CHECK_EQ(e.stats().slices, 3);
+    CHECK_EQ(e.stats().splits, 0);
+
+    // Same time again adds nothing; NAN and negative readings are rejected
+    e.sample(t0 + 120.5, 3000);
+    e.sample(t0 + 121, NAN);
+    e.sample(t0 + 121, -5);
+    CHECK_NEAR(e.today().kwh, kwh, TOLERANCE_KWH);
+    CHECK_EQ(e.stats().rejected, 2);
+}
+
+void testSplitAtPeriodEdge() {
+    EnergyCost e;
+    e.setTariff(testTariff());
+    double edge = THU + 16 * HOUR;
+
+    // 1000 W -> 3000 W across 16:00: 2000 W interpolated at the edge
+    e.sample(edge - 60, 1000);
+    e.sample(edge + 60, 3000);
+    CHECK_EQ(e.stats().splits, 1);
+    CHECK_NEAR(bucketKwh(e.today(), ENERGY_COST_BUCKET_BASE), 1500.0 * 60 / KWH, TOLERANCE_KWH);
+    CHECK_NEAR(bucketKwh(e.today(), EVENING), 2500.0 * 60 / KWH, TOLERANCE_KWH);
+
+    // Weekday periods do not apply on Saturday: the morning is base
+    EnergyCost sat;
+    sat.setTariff(testTariff());
+    sat.sample(SAT + 7 * HOUR, 1000);
+    sat.sample(SAT + 7 * HOUR + 60, 1000);
+    CHECK_NEAR(bucketKwh(sat.today(), ENERGY_COST_BUCKET_BASE), 1000.0 * 60 / KWH, TOLERANCE_KWH);
+    CHECK_NEAR(bucketKwh(sat.today(), MORNING), 0, TOLERANCE_KWH);
+
+    // A wrapping period ends at its toMinute on the next morning
+    EnergyCost many;
+    many.setTariff(testTariff());
+    many.sample(THU + 6 * HOUR - 60, 1000);
+    many.sample(THU + 6 * HOUR + 60, 1000);
+    CHECK_NEAR(bucketKwh(many.today(), NIGHT), 1000.0 * 60 / KWH, TOLERANCE_KWH);
+    CHECK_NEAR(bucketKwh(many.today(), MORNING), 1000.0 * 60 / KWH, TOLERANCE_KWH);
+}
+
+void testSplitAtMidnight() {
+    EnergyCost e;
+    e.setTariff(testTariff());
+    double midnight = THU + 24 * HOUR;
+
+    // 600 W -> 1200 W from 23:59:30 to 00:00:30: 900 W at midnight
+    e.sample(midnight - 30, 600);
+    int32_t thursday = e.today().key;
+    e.sample(midnight + 30, 1200);
+    CHECK_EQ(e.stats().splits, 1);
+    CHECK(e.today().key > thursday);
+    CHECK_NEAR(e.today().kwh, 1050.0 * 30 / KWH, TOLERANCE_KWH);           // Friday's half only
+    CHECK_NEAR(e.month().kwh, (750.0 + 1050.0) * 30 / KWH, TOLERANCE_KWH);
+    CHECK_NEAR(bucketKwh(e.month(), NIGHT), e.month().kwh, TOLERANCE_KWH);
+}
+
+void testPeakEdges() {
+    EnergyCost e;
+    e.setTariff(testTariff());
+    double start = THU + 17 * HOUR;
+    double end = start + 2 * HOUR;
+    e.setPeakEvent((uint32_t)start, (uint32_t)end);
+    CHECK(!e.peakActive(start - 1));
+    CHECK(e.peakActive(start));
+    CHECK(!e.peakActive(end));
+
+    // Flat 2000 W from 16:59 to 17:01, then from 18:59 to 19:01
+    e.sample(start - 60, 2000);
+    e.sample(start + 60, 2000);
+    e.breakRun();
+    e.sample(end - 60, 2000);
+    e.sample(end + 60, 2000);
+    CHECK_EQ(e.stats().splits, 2);
+    CHECK_NEAR(bucketKwh(e.today(), ENERGY_COST_BUCKET_PEAK), 2000.0 * 120 / KWH, TOLERANCE_KWH);
+    CHECK_NEAR(bucketKwh(e.today(), EVENING), 2000.0 * 120 / KWH, TOLERANCE_KWH);   // Overridden in between
+    CHECK_NEAR(e.today().buckets[ENERGY_COST_BUCKET_PEAK].cost, 2000.0 * 120 / KWH * 0.4511f, 1e-9);
+
+    // Cleared: back to the period price
+    e.setPeakEvent(0, 0);
+    CHECK(!e.peakActive(start + 60));
+    CHECK_EQ(e.bucketAt(start + 60), EVENING);
+}
+
+void testGaps() {
+    EnergyCost e;
+    e.setTariff(testTariff());
+    double t0 = THU + 12 * HOUR;
+
+    // Exactly the limit is integrated, longer is a gap and starts a new run
+    e.sample(t0, 1000);
+    e.sample(t0 + ENERGY_COST_MAX_GAP_S, 1000);
+    double kwh = 1000.0 * ENERGY_COST_MAX_GAP_S / KWH;
+    CHECK_NEAR(e.today().kwh, kwh, TOLERANCE_KWH);
+    CHECK_EQ(e.stats().gaps, 0);
+
+    double t1 = t0 + ENERGY_COST_MAX_GAP_S + 300;
+    e.sample(t1, 5000);
+    CHECK_NEAR(e.today().kwh, kwh, TOLERANCE_KWH);
+    CHECK_EQ(e.stats().gaps, 1);
+    CHECK_NEAR(e.stats().gapSeconds, 300, 1e-9);
+
+    e.sample(t1 + 10, 5000);        // Integrates from the reading after the gap
+    kwh += 5000.0 * 10 / KWH;
+    CHECK_NEAR(e.today().kwh, kwh, TOLERANCE_KWH);
+
+    // Clock stepped back: a gap, not negative energy
+    e.sample(t1 - 100, 5000);
+    CHECK_EQ(e.stats().gaps, 2);
+    CHECK_NEAR(e.today().kwh, kwh, TOLERANCE_KWH);
+
+    // breakRun(): the next reading starts a new run
+    e.breakRun();
+    e.sample(t1 + 60, 5000);
+    CHECK_NEAR(e.today().kwh, kwh, TOLERANCE_KWH);
+    CHECK_EQ(e.stats().gaps, 2);
+}
+
+void testDailyCharges() {
+    EnergyCost e;
+    Tariff t = testTariff();
+    e.setTariff(t);
+
+    // First day seen mid-month: the month carries one charge per day elapsed
+    e.advance(THU + 10 * HOUR);     // January 15
+    CHECK_EQ(e.today().days, 1);
+    CHECK_NEAR(e.today().cost, t.dailyCharge, 1e-6);
+    CHECK_EQ(e.month().days, 15);
+    CHECK_NEAR(e.month().cost, 15 * t.dailyCharge, 1e-5);
+
+    // Same day: nothing added; two days later (panel off in between): two more
+    e.advance(THU + 23 * HOUR);
+    CHECK_EQ(e.month().days, 15);
+    e.advance(THU + 48 * HOUR + 1);
+    CHECK_EQ(e.month().days, 17);
+    CHECK_NEAR(e.month().cost, 17 * t.dailyCharge, 1e-5);
+
+    // Energy adds to both on top of the charges
+    e.sample(THU + 60 * HOUR, 1000);
+    e.sample(THU + 60 * HOUR + 60, 1000);
+    double cost = 1000.0 * 60 / KWH * t.basePrice;
+    CHECK_NEAR(e.today().cost, t.dailyCharge + cost, 1e-6);
+    CHECK_NEAR(e.month().cost, 17 * t.dailyCharge + cost, 1e-5);
+
+    // February 1: the month restarts
+    e.advance(SAT + 24 * HOUR + 1);
+    CHECK_EQ(e.month().days, 1);
+    CHECK_NEAR(e.month().kwh, 0, TOLERANCE_KWH);
+    CHECK_NEAR(e.month().cost, t.dailyCharge, 1e-6);
+
+    // Restored minutes are whole slices, priced at their midpoint
+    e.addMinute((uint32_t)(SAT + 24 * HOUR + 120), 600, 60);
+    e.addMinute((uint32_t)(SAT + 24 * HOUR + 180), 600, 0);    // Empty: ignored
+    CHECK_NEAR(bucketKwh(e.month(), NIGHT), 600.0 * 60 / KWH, TOLERANCE_KWH);
+    CHECK_EQ(e.stats().replayedMinutes, 1);
+}
+
+// ============================================================================
+// Recorded Traces
+// ============================================================================
+
+struct Reading {
+    double t;
+    float watts;
+};
+
+// "epoch,watts" lines; '#' starts a comment
+std::vector<Reading> loadTrace(const char* name) {
+    std::vector<Reading> readings;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", TEST_DATA_DIR, name);
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("cannot open %s\n", path);
+        CHECK(f != nullptr);
+        return readings;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        double t;
+        float w;
+        if (line[0] != '#' && sscanf(line, "%lf,%f", &t, &w) == 2) readings.push_back({ t, w });
+    }
+    fclose(f);
+    return readings;
+}
+
+// Days since the epoch, local (EST)
+int32_t localDay(double t) {
+    return (int32_t)floor((t - EST_OFFSET_S) / 86400);
+}
+
+// Reference: fixed EST offset, the tariff above spelled out, 1 s steps. The
+// trace times and the edges are whole seconds, so each step lies in one
+// bucket and its trapezoid is exact.
+struct Reference {
+    double peakStart;
+    double peakEnd;
+    int32_t day;                    // Local day to total (days since the epoch)
+    double buckets[ENERGY_COST_BUCKETS] = {};
+    double kwh = 0;
+    double gapSeconds = 0;
+    uint32_t gaps = 0;
+    uint32_t splits = 0;            // Edges strictly inside an interval
+
+    size_t bucket(double t) const {
+        if (t >= peakStart && t < peakEnd) return ENERGY_COST_BUCKET_PEAK;
+        double local = t - EST_OFFSET_S;
+        int64_t days = (int64_t)floor(local / 86400);
+        int minute = (int)((local - days * 86400.0) / 60);
+        int wday = (int)((days + 4) % 7);              // 1970-01-01 was a Thursday
+        bool weekday = wday >= 1 && wday <= 5;
+        if (weekday && minute >= 6 * 60 && minute < 9 * 60) return MORNING;
+        if (weekday && minute >= 16 * 60 && minute < 20 * 60) return EVENING;
+        if (minute >= 22 * 60 || minute < 6 * 60) return NIGHT;
+        return ENERGY_COST_BUCKET_BASE;
+    }
+
+    bool isEdge(double t) const {
+        if (t == peakStart || t == peakEnd) return peakEnd > peakStart;
+        double local = t - EST_OFFSET_S;
+        double second = local - floor(local / 86400) * 86400;
+        for (int minute : { 0, 6 * 60, 9 * 60, 16 * 60, 20 * 60, 22 * 60 }) {
+            if (second == minute * 60.0) return true;
+        }
+        return false;
+    }
+
+    void integrate(const std::vector<Reading>& readings) {
+        for (size_t i = 1; i < readings.size(); i++) {
+            const Reading& a = readings[i - 1];
+            const Reading& b = readings[i];
+            double dt = b.t - a.t;
+            if (dt > ENERGY_COST_MAX_GAP_S) {
+                gaps++;
+                gapSeconds += dt;
+                continue;
+            }
+            for (double s = a.t; s < b.t; s++) {
+                if (s > a.t && isEdge(s)) splits++;
+                if (localDay(s) != day) continue;
+                double w0 = a.watts + (b.watts - a.watts) * (s - a.t) / dt;
+                double w1 = a.watts + (b.watts - a.watts) * (s + 1 - a.t) / dt;
+                double kwhStep = (w0 + w1) / 2 / KWH;
+                buckets[bucket(s + 0.5)] += kwhStep;
+                kwh += kwhStep;
+            }
+        }
+    }
+};
+
+void checkAgainst(const EnergyTotals& totals, const Reference& ref) {
+    CHECK_NEAR(totals.kwh, ref.kwh, 1e-6);
+    double sum = 0;
+    for (size_t b = 0; b < ENERGY_COST_BUCKETS; b++) {
+        if (fabs(totals.buckets[b].kwh - ref.buckets[b]) > 1e-6) {
+            printf("bucket %u: %.9f kWh, reference %.9f\n", (unsigned)b, totals.buckets[b].kwh, ref.buckets[b]);
+        }
+        CHECK_NEAR(totals.buckets[b].kwh, ref.buckets[b], 1e-6);
+        sum += totals.buckets[b].kwh;
+    }
+    CHECK_NEAR(sum, totals.kwh, 1e-9);
+}
+
+void testPeakEveningTrace() {
+    std::vector<Reading> readings = loadTrace("power_trace_peak_evening.csv");
+    CHECK(readings.size() > 1000);
+
+    Tariff tariff = testTariff();
+    EnergyCost e;
+    e.setTariff(tariff);
+    Reference ref = { THU + 17 * HOUR, THU + 19 * HOUR, localDay(THU) };
+    e.setPeakEvent((uint32_t)ref.peakStart, (uint32_t)ref.peakEnd);
+    for (const Reading& r : readings) {
+        e.sample(r.t, r.watts);
+    }
+    ref.integrate(readings);
+
+    CHECK_EQ(e.stats().gaps, 1);                // MQTT down 18:20 -> 18:24:40
+    CHECK_EQ(e.stats().gaps, ref.gaps);
+    CHECK_NEAR(e.stats().gapSeconds, ref.gapSeconds, 1e-9);
+    CHECK_EQ(e.stats().splits, ref.splits);
+    CHECK_EQ(ref.splits, 4);                    // 16:00, 17:00, 19:00, 20:00 fall between readings
+    checkAgainst(e.today(), ref);
+    checkAgainst(e.month(), ref);
+
+    // Cost: every bucket at its price, plus today's charge
+    double cost = tariff.dailyCharge;
+    for (size_t b = 0; b < ENERGY_COST_BUCKETS; b++) {
+        cost += ref.buckets[b] * e.bucketPrice(b);
+    }
+    CHECK_NEAR(e.today().cost, cost, 1e-6);
+    CHECK(ref.buckets[ENERGY_COST_BUCKET_PEAK] > 0);
+    CHECK(ref.buckets[EVENING] > 0);
+}
+
+void testMonthEndTrace() {
+    std::vector<Reading> readings = loadTrace("power_trace_month_end.csv");
+    CHECK(readings.size() > 100);
+
+    Tariff tariff = testTariff();
+    EnergyCost e;
+    e.setTariff(tariff);
+    for (const Reading& r : readings) {
+        e.sample(r.t, r.watts);
+    }
+
+    // After midnight both totals hold February 1 only
+    Reference ref = { 0, 0, localDay(SAT + 24 * HOUR) };
+    ref.integrate(readings);
+    CHECK_EQ(e.stats().gaps, 0);
+    CHECK_EQ(e.stats().splits, ref.splits);
+    CHECK(ref.splits >= 1);                     // Midnight falls between two readings
+    CHECK_EQ(e.today().days, 1);
+    CHECK_EQ(e.month().days, 1);
+    checkAgainst(e.today(), ref);
+    checkAgainst(e.month(), ref);
+    CHECK(ref.buckets[NIGHT] > 0);
+    CHECK_NEAR(e.month().cost, tariff.dailyCharge + ref.kwh * tariff.periods[2].price, 1e-6);
+}
+
+}  // namespace
+
+int main() {
+    setenv("TZ", TIMEZONE, 1);
+    tzset();
+
+    testTrapezoid();
+    testSplitAtPeriodEdge();
+    testSplitAtMidnight();
+    testPeakEdges();
+    testGaps();
+    testDailyCharges();
+    testPeakEveningTrace();
+    testMonthEndTrace();
+    return test_result("energy_cost_test");
+}
@@ -0,0 +1,102 @@
+// Micro-benchmark: weather payload, one JsonScanner pass against the former
+// per-key strstr + strtof lookup. Not part of ctest (timings are host-specific);
+// configure with -DHOST_TESTS_SANITIZE=OFF -DCMAKE_BUILD_TYPE=Release, then
+//   build-test/json_scan_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "net/json_scan.h"
+
+namespace {
+
+struct Payload {
+    const char* name;
+    std::string json;
+    size_t keys;
+};
+
+// {"Loc0Temp":-15.8,"Loc1Temp":-14.8,...}
+Payload weather(size_t keys) {
+    std::string json = "{";
+    for (size_t i = 0; i < keys; i++) {
+        char member[48];
+        snprintf(member, sizeof(member), "%s\"Loc%uTemp\":%.1f", i ? "," : "", (unsigned)i, -15.8 + i);
+        json += member;
+    }
+    json += "}";
+    return { keys == 5 ? "5 locations" : "12 locations", json, keys };
+}
+
+// Key tables built once, outside the timed loops
+char quotedKeys[16][24];    // "\"Loc0Temp\":" as searched by the former code
+char plainKeys[16][16];     // "Loc0Temp"
+
+void buildKeys() {
+    for (size_t i = 0; i < 16; i++) {
+        snprintf(quotedKeys[i], sizeof(quotedKeys[i]), "\"Loc%uTemp\":", (unsigned)i);
+        snprintf(plainKeys[i], sizeof(plainKeys[i]), "Loc%uTemp", (unsigned)i);
+    }
+}
+
+// Former temperature_service_handleMQTT: one strstr over the payload per key
+float lookupStrstr(const std::string& json, size_t count) {
+    float sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* pos = strstr(json.c_str(), quotedKeys[i]);
+        if (pos) sum += strtof(pos + strlen(quotedKeys[i]), nullptr);
+    }
+    return sum;
+}
+
+// One pass; each key compared against the names (the registry hash replaces this loop)
+float lookupScanner(const std::string& json, size_t count) {
+    float sum = 0;
+    JsonScanner scanner(json.data(), json.size());
+    JsonMember m;
+    while (scanner.next(&m)) {
+        for (size_t i = 0; i < count; i++) {
+            float v;
+            if (m.keyEquals(plainKeys[i]) && m.toFloat(&v)) {
+                sum += v;
+                break;
+            }
+        }
+    }
+    return sum;
+}
+
+template <typename F>
+double nsPerCall(F fn, const Payload& p, long iterations, volatile float* sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        *sink = *sink + fn(p.json, p.keys);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    volatile float sink = 0;
+    buildKeys();
+
+    printf("%-14s %7s %14s %14s\n", "payload", "bytes", "strstr ns", "scanner ns");
+    for (size_t keys : { (size_t)5, (size_t)12 }) {
+        Payload p = weather(keys);
+        if (lookupStrstr(p.json, keys) != lookupScanner(p.json, keys)) {
+            printf("%s: results differ\n", p.name);
+            return 1;
+        }
+        double a = nsPerCall(lookupStrstr, p, iterations, &sink);
+        double b = nsPerCall(lookupScanner, p, iterations, &sink);
+        printf("%-14s %7u %14.0f %14.0f\n", p.name, (unsigned)p.json.size(), a, b);
+    }
+    return 0;
+}
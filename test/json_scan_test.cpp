@@ -0,0 +1,210 @@
+// JsonScanner: known answers, then a fuzz pass over mutated and random inputs
+//
+// Every input is copied into a buffer of exactly its length, so a read past the
+// end is caught by the sanitizers (HOST_TESTS_SANITIZE).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "net/json_scan.h"
+#include "test_check.h"
+
+namespace {
+
+constexpr uint32_t FUZZ_ITERATIONS = 200000;
+constexpr size_t FUZZ_MAX_LEN = 600;
+
+const char* const SEEDS[] = {
+    "{\"OutsideTemp\":-15.8,\"AmbientTemp\":21.4,\"BurjpTemp\":19.9,\"MaitreTemp\":18,\"MyriamTemp\":20.5}",
+    "{\"lights\":{\"cuisine\":1,\"salon\":false},\"weather\":{\"OutsideTemp\":-1e1}}",
+    "{\"base\":0.0738,\"peak\":0.4511,\"periods\":{\"Evening\":{\"from\":\"16:00\",\"to\":\"20:00\",\"days\":\"12345\"}}}",
+    "{\"a\":[1,2,{\"b\":\"]}\"}],\"c\":null,\"d\":true,\"e\":\"\\u00e9\\n\\\"\"}",
+    "  { }  ",
+};
+
+struct Member {
+    std::string key;
+    JsonType type;
+    std::string value;
+};
+
+// All members of a NUL-free string; failed set on a syntax error
+std::vector<Member> scan(const char* json, bool* failed) {
+    std::vector<Member> members;
+    size_t len = strlen(json);
+    char* buf = static_cast<char*>(malloc(len ? len : 1));
+    memcpy(buf, json, len);
+    JsonScanner scanner(buf, len);
+    JsonMember m;
+    while (scanner.next(&m)) {
+        members.push_back({ std::string(m.key, m.keyLen), m.type, std::string(m.value, m.valueLen) });
+    }
+    *failed = scanner.failed();
+    free(buf);
+    return members;
+}
+
+void testKnownAnswers() {
+    bool failed;
+    std::vector<Member> m = scan(SEEDS[0], &failed);
+    CHECK(!failed);
+    CHECK_EQ(m.size(), 5);
+    CHECK(m[0].key == "OutsideTemp" && m[0].type == JsonType::NUMBER && m[0].value == "-15.8");
+    CHECK(m[3].key == "MaitreTemp" && m[3].value == "18");
+
+    // Nested spans include their brackets; strings inside them may hold brackets
+    m = scan(SEEDS[3], &failed);
+    CHECK(!failed);
+    CHECK_EQ(m.size(), 4);
+    CHECK(m[0].type == JsonType::ARRAY && m[0].value == "[1,2,{\"b\":\"]}\"}]");
+    CHECK(m[1].type == JsonType::NUL);
+    CHECK(m[2].type == JsonType::BOOL && m[2].value == "true");
+    CHECK(m[3].type == JsonType::STRING && m[3].value == "\\u00e9\\n\\\"");   // Not decoded
+
+    m = scan(SEEDS[4], &failed);
+    CHECK(!failed);
+    CHECK_EQ(m.size(), 0);
+
+    // Keys match exactly: a prefix is a different key
+    m = scan("{\"Temp\":1,\"TempX\":2}", &failed);
+    CHECK_EQ(m.size(), 2);
+    JsonMember jm = { m[1].key.c_str(), m[1].key.size(), JsonType::NUMBER, m[1].value.c_str(), m[1].value.size() };
+    CHECK(jm.keyEquals("TempX"));
+    CHECK(!jm.keyEquals("Temp"));
+
+    // Malformed input stops with failed() set, after the members before it
+    const char* const bad[] = {
+        "", "[1]", "{", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{\"a\":1 \"b\":2}", "{\"a\":\"x}",
+        "{\"a\":\"\\q\"}", "{\"a\":\"\x01\"}", "{\"a\":[1,2}", "{\"a\":{\"b\":1]}", "{\"a\":tru}",
+        "{\"a\":\"\\u12\"}",
+    };
+    for (const char* json : bad) {
+        scan(json, &failed);
+        if (!failed) printf("not rejected: %s\n", json);
+        CHECK(failed);
+    }
+    m = scan("{\"a\":1,\"b\":2,oops}", &failed);
+    CHECK(failed);
+    CHECK_EQ(m.size(), 2);
+
+    // Nesting deeper than the limit is rejected, not recursed into
+    std::string deep = "{\"a\":" + std::string(64, '[') + std::string(64, ']') + "}";
+    scan(deep.c_str(), &failed);
+    CHECK(failed);
+
+    // Number conversion: whole token only, NUMBER members only
+    JsonMember num = { "k", 1, JsonType::NUMBER, "-15.8", 5 };
+    float f = 0;
+    long l = 0;
+    CHECK(num.toFloat(&f));
+    CHECK_NEAR(f, -15.8, 1e-5);
+    CHECK(!num.toInt(&l));
+    JsonMember garbled = { "k", 1, JsonType::NUMBER, "1.2.3", 5 };
+    CHECK(!garbled.toFloat(&f));
+    JsonMember str = { "k", 1, JsonType::STRING, "12", 2 };
+    CHECK(!str.toFloat(&f));
+    std::string longNumber(40, '1');
+    JsonMember huge = { "k", 1, JsonType::NUMBER, longNumber.c_str(), longNumber.size() };
+    CHECK(!huge.toInt(&l));
+
+    // nullptr data is an empty, failed scan
+    JsonScanner none(nullptr, 10);
+    CHECK(!none.next(&jm));
+}
+
+// xorshift32: fixed seed, the run is reproducible
+uint32_t rng = 2463534242u;
+uint32_t rnd() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+std::string mutate(const std::string& seed) {
+    static const char alphabet[] = "{}[]\":,\\ \t\n0123456789-+.eEtrufalsn\x01\x7f\xff";
+    std::string s = seed;
+    uint32_t edits = 1 + rnd() % 8;
+    for (uint32_t i = 0; i < edits; i++) {
+        size_t pos = s.empty() ? 0 : rnd() % (s.size() + 1);
+        char c = alphabet[rnd() % (sizeof(alphabet) - 1)];
+        switch (rnd() % 4) {
+            case 0: if (pos < s.size()) s[pos] = c; break;
+            case 1: s.insert(pos, 1, c); break;
+            case 2: if (pos < s.size()) s.erase(pos, 1); break;
+            default: s = s.substr(0, pos); break;     // Truncated message
+        }
+    }
+    if (s.size() > FUZZ_MAX_LEN) s.resize(FUZZ_MAX_LEN);
+    return s;
+}
+
+std::string randomBytes() {
+    std::string s(rnd() % 64, '\0');
+    for (char& c : s) c = (char)(rnd() & 0xFF);
+    if (!s.empty() && rnd() % 2) s[0] = '{';
+    return s;
+}
+
+// Invariants for any input: terminates, spans inside the buffer, types consistent
+void fuzzOne(const std::string& input) {
+    size_t len = input.size();
+    char* buf = static_cast<char*>(malloc(len ? len : 1));
+    memcpy(buf, input.data(), len);
+    const char* end = buf + len;
+
+    JsonScanner scanner(buf, len);
+    JsonMember m;
+    size_t members = 0;
+    while (scanner.next(&m)) {
+        members++;
+        CHECK(members <= len);
+        CHECK(m.key >= buf && m.key + m.keyLen <= end);
+        CHECK(m.value >= buf && m.value + m.valueLen <= end);
+        if (m.type == JsonType::OBJECT) {
+            CHECK(m.valueLen >= 2 && m.value[0] == '{' && m.value[m.valueLen - 1] == '}');
+        } else if (m.type == JsonType::ARRAY) {
+            CHECK(m.valueLen >= 2 && m.value[0] == '[' && m.value[m.valueLen - 1] == ']');
+        } else if (m.type == JsonType::NUMBER) {
+            CHECK(m.valueLen > 0);
+            float f;
+            long l;
+            m.toFloat(&f);
+            m.toInt(&l);
+        }
+        if (m.type == JsonType::OBJECT) {
+            // Services scan nested objects with a second scanner
+            JsonScanner inner(m.value, m.valueLen);
+            JsonMember im;
+            while (inner.next(&im)) {
+                CHECK(im.value >= m.value && im.value + im.valueLen <= m.value + m.valueLen);
+            }
+        }
+        if (test_failures() > 20) break;
+    }
+    CHECK(!scanner.next(&m));   // Stays done
+    free(buf);
+}
+
+void testFuzz() {
+    std::vector<std::string> seeds(SEEDS, SEEDS + sizeof(SEEDS) / sizeof(SEEDS[0]));
+    for (uint32_t i = 0; i < FUZZ_ITERATIONS && test_failures() == 0; i++) {
+        if (i % 8 == 0) {
+            fuzzOne(randomBytes());
+        } else {
+            fuzzOne(mutate(seeds[rnd() % seeds.size()]));
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    testKnownAnswers();
+    testFuzz();
+    return test_result("json_scan_test");
+}
@@ -0,0 +1,224 @@
+// MqttOutbox: priority order, dedup, cancel, TTL, drop policy, retry
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "net/mqtt_outbox.h"
+#include "test_check.h"
+
+namespace {
+
+// Stub transport: records what was published, refuses while closed
+struct Transport {
+    bool open = true;
+    std::vector<std::string> sent;     // "topic payload"
+};
+
+bool publish(const char* topic, const char* payload, void* ctx) {
+    Transport* t = static_cast<Transport*>(ctx);
+    if (!t->open) return false;
+    t->sent.push_back(std::string(topic) + " " + payload);
+    return true;
+}
+
+// Send everything due (several flushes, OUTBOX_MAX_SENDS_PER_FLUSH each)
+void drain(MqttOutbox& outbox, uint32_t nowMs) {
+    for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+        outbox.flush(nowMs, true);
+    }
+}
+
+void testPriorityOrder() {
+    Transport t;
+    MqttOutbox outbox;
+    CHECK(outbox.begin(publish, &t));
+
+    CHECK(outbox.enqueue("s", "low1", OutboxPriority::LOW, nullptr, 0));
+    CHECK(outbox.enqueue("s", "normal", OutboxPriority::NORMAL, nullptr, 1));
+    CHECK(outbox.enqueue("s", "high", OutboxPriority::HIGH, nullptr, 2));
+    CHECK(outbox.enqueue("s", "low2", OutboxPriority::LOW, nullptr, 3));
+    outbox.flush(10, false);
+    CHECK_EQ(t.sent.size(), 0);
+    CHECK_EQ(outbox.stats().pending, 4);
+
+    drain(outbox, 10);
+    CHECK_EQ(t.sent.size(), 4);
+    CHECK(t.sent[0] == "s high");
+    CHECK(t.sent[1] == "s normal");
+    CHECK(t.sent[2] == "s low1");       // FIFO within a priority
+    CHECK(t.sent[3] == "s low2");
+    CHECK_EQ(outbox.stats().sent, 4);
+    CHECK_EQ(outbox.stats().pending, 0);
+}
+
+void testSendsPerFlush() {
+    Transport t;
+    MqttOutbox outbox;
+    outbox.begin(publish, &t);
+    for (int i = 0; i < 10; i++) {
+        outbox.enqueue("s", "x", OutboxPriority::NORMAL, nullptr, 0);
+    }
+    outbox.flush(0, true);
+    CHECK_EQ(t.sent.size(), OUTBOX_MAX_SENDS_PER_FLUSH);
+}
+
+void testDedup() {
+    Transport t;
+    MqttOutbox outbox;
+    outbox.begin(publish, &t);
+
+    CHECK(outbox.enqueue("weather", "status", OutboxPriority::LOW, "weather", 0));
+    CHECK(outbox.enqueue("weather", "status", OutboxPriority::LOW, "weather", 5));
+    CHECK(outbox.enqueue("m", "first", OutboxPriority::NORMAL, "metrics", 6));
+    CHECK(outbox.enqueue("m", "latest", OutboxPriority::NORMAL, "metrics", 7));
+    CHECK_EQ(outbox.stats().pending, 2);
+    CHECK_EQ(outbox.stats().deduped, 2);
+
+    drain(outbox, 10);
+    CHECK_EQ(t.sent.size(), 2);
+    CHECK(t.sent[0] == "m latest");     // The replacement keeps only the newest payload
+    CHECK(t.sent[1] == "weather status");
+}
+
+void testCancel() {
+    Transport t;
+    MqttOutbox outbox;
+    outbox.begin(publish, &t);
+
+    // Two presses while disconnected: the second withdraws the first, nothing is sent
+    CHECK(outbox.enqueue("m18toggle", "cuisine", OutboxPriority::HIGH, "cuisine", 0));
+    CHECK(outbox.cancel("cuisine"));
+    CHECK_EQ(outbox.stats().pending, 0);
+    CHECK_EQ(outbox.stats().cancelled, 1);
+    CHECK(!outbox.cancel("cuisine"));    // Nothing left to withdraw
+    CHECK(!outbox.cancel(""));
+    CHECK(!outbox.cancel(nullptr));
+
+    // A third press queues again; other lights are untouched
+    CHECK(outbox.enqueue("m18toggle", "salon", OutboxPriority::HIGH, "salon", 1));
+    CHECK(outbox.enqueue("m18toggle", "cuisine", OutboxPriority::HIGH, "cuisine", 2));
+    drain(outbox, 3);
+    CHECK_EQ(t.sent.size(), 2);
+    CHECK(t.sent[0] == "m18toggle salon");
+    CHECK(t.sent[1] == "m18toggle cuisine");
+
+    // Sent messages cannot be withdrawn
+    CHECK(!outbox.cancel("cuisine"));
+}
+
+void testTtl() {
+    Transport t;
+    MqttOutbox outbox;
+    outbox.begin(publish, &t);
+
+    // TTL: HIGH 30 s, NORMAL 60 s, LOW 120 s
+    outbox.enqueue("s", "high", OutboxPriority::HIGH, nullptr, 0);
+    outbox.enqueue("s", "normal", OutboxPriority::NORMAL, nullptr, 0);
+    outbox.enqueue("s", "low", OutboxPriority::LOW, nullptr, 0);
+
+    outbox.flush(30000, false);
+    CHECK_EQ(outbox.stats().expired, 0);    // Expires strictly after the TTL
+    outbox.flush(30001, false);
+    CHECK_EQ(outbox.stats().expired, 1);
+    outbox.flush(60001, false);
+    CHECK_EQ(outbox.stats().expired, 2);
+
+    drain(outbox, 60002);
+    CHECK_EQ(t.sent.size(), 1);
+    CHECK(t.sent[0] == "s low");
+
+    // millis() wrap: age is computed modulo 2^32
+    uint32_t nearWrap = 0xFFFFF000u;
+    outbox.enqueue("s", "wrap", OutboxPriority::HIGH, nullptr, nearWrap);
+    outbox.flush(nearWrap + 20000, false);
+    CHECK_EQ(outbox.stats().pending, 1);
+    outbox.flush(nearWrap + 30001, false);
+    CHECK_EQ(outbox.stats().pending, 0);
+}
+
+void testEviction() {
+    Transport t;
+    MqttOutbox outbox;
+    outbox.begin(publish, &t);
+
+    // Full of LOW: a NORMAL evicts the oldest LOW
+    for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+        char payload[8];
+        snprintf(payload, sizeof(payload), "l%u", (unsigned)i);
+        CHECK(outbox.enqueue("s", payload, OutboxPriority::LOW, nullptr, (uint32_t)i));
+    }
+    CHECK(outbox.enqueue("s", "n0", OutboxPriority::NORMAL, nullptr, 100));
+    CHECK_EQ(outbox.stats().dropped, 1);
+    CHECK_EQ(outbox.stats().pending, OUTBOX_CAPACITY);
+
+    drain(outbox, 200);
+    CHECK_EQ(t.sent.size(), OUTBOX_CAPACITY);
+    CHECK(t.sent[0] == "s n0");
+    CHECK(t.sent[1] == "s l1");         // l0 was the victim
+
+    // Full of HIGH: a LOW is refused, a HIGH evicts the oldest HIGH
+    t.sent.clear();
+    for (size_t i = 0; i < OUTBOX_CAPACITY; i++) {
+        char payload[8];
+        snprintf(payload, sizeof(payload), "h%u", (unsigned)i);
+        outbox.enqueue("s", payload, OutboxPriority::HIGH, nullptr, 300);
+    }
+    uint32_t dropped = outbox.stats().dropped;
+    CHECK(!outbox.enqueue("s", "low", OutboxPriority::LOW, nullptr, 301));
+    CHECK_EQ(outbox.stats().dropped, dropped + 1);
+    CHECK(outbox.enqueue("s", "hnew", OutboxPriority::HIGH, nullptr, 302));
+    drain(outbox, 303);
+    CHECK(t.sent[0] == "s h1");
+    CHECK(t.sent.back() == "s hnew");
+}
+
+void testRetry() {
+    Transport t;
+    MqttOutbox outbox;
+    outbox.begin(publish, &t);
+
+    t.open = false;
+    outbox.enqueue("s", "a", OutboxPriority::NORMAL, nullptr, 0);
+    outbox.flush(0, true);
+    CHECK_EQ(outbox.stats().retried, 1);
+    CHECK_EQ(outbox.stats().pending, 1);
+
+    t.open = true;
+    outbox.flush(OUTBOX_RETRY_MS - 1, true);    // Still backing off
+    CHECK_EQ(t.sent.size(), 0);
+    outbox.flush(OUTBOX_RETRY_MS, true);
+    CHECK_EQ(t.sent.size(), 1);
+}
+
+void testLimits() {
+    Transport t;
+    MqttOutbox outbox;
+    CHECK(!outbox.enqueue("s", "x", OutboxPriority::LOW, nullptr, 0));    // Not initialized
+    outbox.begin(publish, &t);
+
+    std::string longTopic(OUTBOX_TOPIC_MAX, 't');
+    std::string longPayload(OUTBOX_PAYLOAD_MAX, 'p');
+    std::string longKey(OUTBOX_KEY_MAX, 'k');
+    std::string maxKey(OUTBOX_KEY_MAX - 1, 'k');
+    CHECK(!outbox.enqueue(longTopic.c_str(), "x", OutboxPriority::LOW, nullptr, 0));
+    CHECK(!outbox.enqueue("s", longPayload.c_str(), OutboxPriority::LOW, nullptr, 0));
+    CHECK(!outbox.enqueue("s", "x", OutboxPriority::LOW, longKey.c_str(), 0));
+    CHECK(outbox.enqueue("s", "x", OutboxPriority::LOW, maxKey.c_str(), 0));
+    CHECK(!outbox.enqueue(nullptr, "x", OutboxPriority::LOW, nullptr, 0));
+}
+
+}  // namespace
+
+int main() {
+    testPriorityOrder();
+    testSendsPerFlush();
+    testDedup();
+    testCancel();
+    testTtl();
+    testEviction();
+    testRetry();
+    testLimits();
+    return test_result("mqtt_outbox_test");
+}
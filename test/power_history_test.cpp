@@ -0,0 +1,250 @@
+// PowerHistory: hold and gaps, per-second averaging, minute / quarter rollup
+// boundaries, ring wrap and the restore of persisted minutes; chart values
+
+#include "power/power_history.h"
+#include "test_check.h"
+
+namespace {
+
+// Hold one reading from t0 and close seconds up to (excluding) t1
+void hold(PowerHistory& h, uint32_t t0, uint32_t t1, float watts) {
+    h.record(t0, watts);
+    h.advance(t1);
+}
+
+void testHoldAndGaps() {
+    PowerHistory h;
+    CHECK(h.begin());
+
+    h.advance(100);                     // Nothing before the first reading
+    CHECK_EQ(h.rawCount(), 0);
+
+    hold(h, 1000, 1000 + POWER_HOLD_S + 10, 500);
+    CHECK_EQ(h.rawCount(), POWER_HOLD_S + 10);
+    // ago counts back from the last closed second (1000 + POWER_HOLD_S + 9)
+    CHECK_NEAR(h.raw(10), 500, 0);                  // Second 1000 + POWER_HOLD_S - 1: still held
+    CHECK(isnan(h.raw(9)));                         // Second 1000 + POWER_HOLD_S: gap
+    CHECK(isnan(h.raw(0)));
+    CHECK_NEAR(h.raw(POWER_HOLD_S + 9), 500, 0);    // First second
+    CHECK(isnan(h.raw(h.rawCount())));              // Out of range
+
+    // A new reading ends the gap
+    hold(h, 1000 + POWER_HOLD_S + 10, 1000 + POWER_HOLD_S + 12, 700);
+    CHECK_NEAR(h.raw(0), 700, 0);
+    CHECK_NEAR(h.raw(1), 700, 0);
+    CHECK(isnan(h.raw(2)));
+
+    // advance() is idempotent, and time going back closes nothing
+    uint32_t closed = h.closedSeconds();
+    h.advance(1000 + POWER_HOLD_S + 12);
+    h.advance(1000);
+    CHECK_EQ(h.closedSeconds(), closed);
+}
+
+void testSecondAverage() {
+    PowerHistory h;
+    h.begin();
+    h.record(10, 100);
+    h.record(10, 200);
+    h.record(10, 600);
+    h.advance(11);
+    CHECK_NEAR(h.raw(0), 300, 1e-3);    // Samples in one second are averaged
+    h.advance(12);
+    CHECK_NEAR(h.raw(0), 600, 1e-3);    // Then the last reading holds
+}
+
+void testMinuteRollup() {
+    PowerHistory h;
+    h.begin();
+
+    // First minute: 30 s at 1000 W, 30 s at 3000 W
+    hold(h, 0, 30, 1000);
+    hold(h, 30, 59, 3000);
+    CHECK_EQ(h.minuteCount(), 0);
+    CHECK_EQ(h.currentMinute().seconds, 59);
+    h.advance(60);
+    CHECK_EQ(h.minuteCount(), 1);
+    CHECK_EQ(h.closedMinutes(), 1);
+    PowerRollup m = h.minute(0);
+    CHECK_NEAR(m.min, 1000, 0);
+    CHECK_NEAR(m.max, 3000, 0);
+    CHECK_NEAR(m.avg, 2000, 1e-3);
+    CHECK_EQ(m.seconds, 60);
+    CHECK_EQ(h.currentMinute().seconds, 0);
+
+    // The 3000 W reading (t = 30) holds until t = 30 + POWER_HOLD_S: the minute
+    // [120, 180) has 30 s of data, its avg is over those seconds only
+    h.advance(240);
+    CHECK_EQ(h.minuteCount(), 4);
+    CHECK_EQ(h.minute(2).seconds, 60);
+    m = h.minute(1);
+    CHECK_EQ(m.seconds, 30 + POWER_HOLD_S - 120);
+    CHECK_NEAR(m.avg, 3000, 1e-3);
+    CHECK_EQ(h.minute(0).seconds, 0);
+
+    // A minute without any data
+    PowerHistory e;
+    e.begin();
+    e.record(0, 10);
+    e.advance(POWER_HOLD_S + 180);
+    m = e.minute(0);
+    CHECK_EQ(m.seconds, 0);
+    CHECK(isnan(m.avg));
+}
+
+void testQuarterRollup() {
+    PowerHistory h;
+    h.begin();
+
+    // 14 minutes at 1000 W, then one at 4000 W closes the quarter
+    uint32_t t = 0;
+    for (; t < 14 * 60; t += 60) {
+        hold(h, t, t + 60, 1000);
+    }
+    hold(h, t, t + 59, 4000);
+    CHECK_EQ(h.quarterCount(), 0);
+    h.advance(t + 60);
+    CHECK_EQ(h.quarterCount(), 1);
+    PowerRollup q = h.quarter(0);
+    CHECK_NEAR(q.min, 1000, 0);
+    CHECK_NEAR(q.max, 4000, 0);
+    CHECK_EQ(q.seconds, 15 * 60);
+    CHECK_NEAR(q.avg, (14 * 60 * 1000.0 + 60 * 4000.0) / (15 * 60), 1e-2);
+
+    // Minutes are weighted by their seconds with data, gaps do not dilute the avg
+    PowerHistory w;
+    w.begin();
+    hold(w, 0, 60, 1000);                       // Minute 0: 60 s at 1000 W
+    hold(w, 60, 61, 9000);                      // Minute 1: 1 s at 9000 W...
+    w.record(61, 0);                            // ...then 0 W, held POWER_HOLD_S
+    w.advance(61 + POWER_HOLD_S + 15 * 60);     // Then silent past the quarter
+    CHECK_EQ(w.quarterCount(), 1);
+    q = w.quarter(0);
+    CHECK_NEAR(q.min, 0, 0);
+    CHECK_EQ(q.seconds, 60 + 1 + POWER_HOLD_S);
+    CHECK_NEAR(q.avg, (60 * 1000.0 + 9000.0) / q.seconds, 1e-2);
+}
+
+void testRingWrap() {
+    PowerHistory h;
+    h.begin();
+    uint32_t end = POWER_RAW_CAPACITY + 100;
+    for (uint32_t t = 0; t < end; t++) {
+        h.record(t, (float)t);
+    }
+    h.advance(end);
+    CHECK_EQ(h.rawCount(), POWER_RAW_CAPACITY);
+    CHECK_EQ(h.closedSeconds(), end);
+    CHECK_NEAR(h.raw(0), end - 1, 0);
+    CHECK_NEAR(h.raw(POWER_RAW_CAPACITY - 1), end - POWER_RAW_CAPACITY, 0);
+
+    // Minutes over capacity keep the newest
+    PowerHistory m;
+    m.begin();
+    uint32_t minutes = POWER_MINUTE_CAPACITY + 5;
+    for (uint32_t i = 0; i < minutes; i++) {
+        hold(m, i * 60, (i + 1) * 60, (float)i);
+    }
+    CHECK_EQ(m.minuteCount(), POWER_MINUTE_CAPACITY);
+    CHECK_NEAR(m.minute(0).avg, minutes - 1, 1e-3);
+    CHECK_NEAR(m.minute(POWER_MINUTE_CAPACITY - 1).avg, 5, 1e-3);
+    CHECK_EQ(m.quarterCount(), minutes / 15);
+    CHECK_NEAR(m.quarter(0).avg, (minutes / 15) * 15 - 8, 1e-3);   // Mean of the last full quarter's minutes
+}
+
+void testClockWrap() {
+    // Seconds are compared modulo 2^32
+    PowerHistory h;
+    h.begin();
+    uint32_t t = 0xFFFFFFF0u;
+    h.record(t, 100);
+    h.advance(t + 32);     // Wraps through 0
+    CHECK_EQ(h.closedSeconds(), 32);
+    CHECK_NEAR(h.raw(0), 100, 0);
+}
+
+PowerRollup flat(float watts, uint16_t seconds) {
+    return PowerRollup{ watts, watts, watts, seconds };
+}
+
+void testRestore() {
+    PowerHistory h;
+    h.begin();
+
+    // Two live minutes before the log is replayed
+    hold(h, 0, 60, 500);
+    hold(h, 60, 120, 700);
+    CHECK_EQ(h.minuteCount(), 2);
+
+    // 14 persisted minutes with a gap: they go before the live ones
+    CHECK(h.beginRestore());
+    CHECK(!h.beginRestore());          // One restore at a time
+    for (int i = 0; i < 14; i++) {
+        h.restoreMinute(i == 5 ? PowerRollup{ NAN, NAN, NAN, 0 } : flat(100.0f * i, 60));
+    }
+    h.endRestore();
+
+    CHECK_EQ(h.minuteCount(), 16);
+    CHECK_NEAR(h.minute(0).avg, 700, 1e-3);        // Live minutes are the newest
+    CHECK_NEAR(h.minute(1).avg, 500, 1e-3);
+    CHECK_NEAR(h.minute(2).avg, 1300, 1e-3);       // Last restored
+    CHECK_NEAR(h.minute(15).avg, 0, 1e-3);         // First restored
+    CHECK_EQ(h.minute(10).seconds, 0);             // The gap
+    CHECK_EQ(h.closedMinutes(), 2);                // Restored minutes are not "closed since boot"
+
+    // Quarter rebuilt from restored + live minutes: 14 restored + the first live one
+    CHECK_EQ(h.quarterCount(), 1);
+    PowerRollup q = h.quarter(0);
+    CHECK_EQ(q.seconds, 14 * 60);
+    double sum = 0;
+    for (int i = 0; i < 14; i++) {
+        if (i != 5) sum += 100.0 * i * 60;
+    }
+    sum += 500.0 * 60;
+    CHECK_NEAR(q.avg, sum / (14 * 60), 1e-2);
+    CHECK_NEAR(q.max, 1300, 0);
+    CHECK_NEAR(q.min, 0, 0);
+
+    // Live recording carries on after the restore
+    hold(h, 120, 180, 900);
+    CHECK_NEAR(h.minute(0).avg, 900, 1e-3);
+    CHECK_EQ(h.minuteCount(), 17);
+}
+
+void testChartValues() {
+    // Rounded; what a 16-bit lv_coord_t cannot hold is clamped, never wrapped
+    // and never equal to LV_CHART_POINT_NONE (INT16_MAX, drawn as a gap)
+    CHECK_EQ(powerChartValue(1234.4), 1234);
+    CHECK_EQ(powerChartValue(1234.5), 1235);
+    CHECK_EQ(powerChartValue(0), 0);
+    CHECK_EQ(powerChartValue(-3), 0);
+    CHECK_EQ(powerChartValue(NAN), 0);
+    CHECK_EQ(powerChartValue(32766.4), 32766);
+    CHECK_EQ(powerChartValue(32767), POWER_CHART_VALUE_MAX);
+    CHECK_EQ(powerChartValue(50000), POWER_CHART_VALUE_MAX);   // POWER_PLAUSIBLE_MAX_W
+    CHECK(POWER_CHART_VALUE_MAX < INT16_MAX);
+
+    // Range: next step above the value, clamped to what the axis can take
+    CHECK_EQ(powerChartRangeFor(0, 2500), 2500);
+    CHECK_EQ(powerChartRangeFor(2499, 2500), 2500);
+    CHECK_EQ(powerChartRangeFor(2500, 2500), 5000);
+    CHECK_EQ(powerChartRangeFor(29999, 2500), 30000);
+    CHECK_EQ(powerChartRangeFor(30000, 2500), 32500);
+    CHECK_EQ(powerChartRangeFor(32500, 2500), POWER_CHART_VALUE_MAX);
+    CHECK_EQ(powerChartRangeFor(powerChartValue(50000), 2500), POWER_CHART_VALUE_MAX);
+    CHECK(powerChartRangeFor(powerChartValue(50000), 2500) >= powerChartValue(50000));
+}
+
+}  // namespace
+
+int main() {
+    testHoldAndGaps();
+    testSecondAverage();
+    testMinuteRollup();
+    testQuarterRollup();
+    testRingWrap();
+    testClockWrap();
+    testRestore();
+    testChartValues();
+    return test_result("power_history_test");
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+
+// ============================================================================
+// Minimal Host Test Checks
+// ============================================================================
+// The pure modules (no Arduino dependency) are built on the host by
+// test/CMakeLists.txt. Each test is a plain executable: failed checks are
+// printed and counted, and main() returns test_result().
+// ============================================================================
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);     \
+            test_failures()++;                                                  \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                          \
+    do {                                                                        \
+        long long va_ = (long long)(a);                                         \
+        long long vb_ = (long long)(b);                                         \
+        if (va_ != vb_) {                                                       \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",            \
+                   __FILE__, __LINE__, #a, #b, va_, vb_);                       \
+            test_failures()++;                                                  \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                   \
+    do {                                                                        \
+        double va_ = (double)(a);                                               \
+        double vb_ = (double)(b);                                               \
+        if (!(fabs(va_ - vb_) <= (tol))) {                                      \
+            printf("%s:%d: CHECK_NEAR(%s, %s) failed: %.6f != %.6f\n",          \
+                   __FILE__, __LINE__, #a, #b, va_, vb_);                       \
+            test_failures()++;                                                  \
+        }                                                                       \
+    } while (0)
+
+inline int test_result(const char* name) {
+    if (test_failures()) {
+        printf("%s: %d check(s) failed\n", name, test_failures());
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}